@@ -109,6 +109,16 @@ STATIC int _mbedtls_ssl_recv(void *ctx, byte *buf, size_t len) {
 }
 
 
+// mbedtls wants PEM data with a terminating null, which the data of a str or
+// bytes object need not have, so this makes a null-terminated copy in vstr.
+STATIC const byte *ssl_pem_data(mp_obj_t obj, vstr_t *vstr) {
+    size_t len;
+    const char *data = mp_obj_str_get_data(obj, &len);
+    vstr_init(vstr, len + 1);
+    vstr_add_strn(vstr, data, len);
+    return (const byte*)vstr_null_terminated_str(vstr);
+}
+
 STATIC mp_obj_ssl_socket_t *socket_new(mp_obj_t sock, struct ssl_args *args) {
     // Verify the socket object has the full stream protocol
     mp_get_stream_raise(sock, MP_STREAM_OP_READ | MP_STREAM_OP_WRITE | MP_STREAM_OP_IOCTL);
@@ -170,16 +180,17 @@ STATIC mp_obj_ssl_socket_t *socket_new(mp_obj_t sock, struct ssl_args *args) {
     mbedtls_ssl_set_bio(&o->ssl, &o->sock, _mbedtls_ssl_send, _mbedtls_ssl_recv, NULL);
 
     if (args->key.u_obj != MP_OBJ_NULL) {
-        size_t key_len;
-        const byte *key = (const byte*)mp_obj_str_get_data(args->key.u_obj, &key_len);
+        vstr_t pem;
+        const byte *key = ssl_pem_data(args->key.u_obj, &pem);
         // len should include terminating null
-        ret = mbedtls_pk_parse_key(&o->pkey, key, key_len + 1, NULL, 0);
+        ret = mbedtls_pk_parse_key(&o->pkey, key, pem.len + 1, NULL, 0);
+        vstr_clear(&pem);
         assert(ret == 0);
 
-        size_t cert_len;
-        const byte *cert = (const byte*)mp_obj_str_get_data(args->cert.u_obj, &cert_len);
+        const byte *cert = ssl_pem_data(args->cert.u_obj, &pem);
         // len should include terminating null
-        ret = mbedtls_x509_crt_parse(&o->cert, cert, cert_len + 1);
+        ret = mbedtls_x509_crt_parse(&o->cert, cert, pem.len + 1);
+        vstr_clear(&pem);
         assert(ret == 0);
 
         ret = mbedtls_ssl_conf_own_cert(&o->conf, &o->cert, &o->pkey);
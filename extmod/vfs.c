@@ -122,7 +122,11 @@ STATIC mp_obj_t mp_vfs_proxy_call(mp_vfs_mount_t *vfs, qstr meth_name, size_t n_
     return mp_call_method_n_kw(n_args, 0, meth);
 }
 
-mp_import_stat_t mp_vfs_import_stat(const char *path) {
+STATIC mp_import_stat_t import_stat_fs(const char *path) {
+    #if MICROPY_VFS_IMPORT_CACHE
+    MP_STATE_VM(vfs_import_fs_ops) += 1;
+    #endif
+
     const char *path_out;
     mp_vfs_mount_t *vfs = mp_vfs_lookup_path(path, &path_out);
     if (vfs == MP_VFS_NONE || vfs == MP_VFS_ROOT) {
@@ -156,6 +160,175 @@ mp_import_stat_t mp_vfs_import_stat(const char *path) {
     }
 }
 
+#if MICROPY_VFS_IMPORT_CACHE
+
+// Whether names in the given directory are matched regardless of case, as FAT
+// does.  The root directory only holds mount points, which are matched exactly.
+STATIC bool import_cache_folds_case(const char *dir) {
+    #if MICROPY_VFS_FAT
+    const char *path_out;
+    mp_vfs_mount_t *vfs = mp_vfs_lookup_path(dir, &path_out);
+    return vfs != MP_VFS_NONE && vfs != MP_VFS_ROOT
+        && mp_obj_get_type(vfs->obj) == &mp_fat_vfs_type;
+    #else
+    (void)dir;
+    return false;
+    #endif
+}
+
+// Folds ASCII letters to lower case.  Returns false if the name has non-ASCII
+// bytes, which FAT folds by its code page, so that they can't be matched here.
+STATIC bool import_cache_fold(char *dest, const char *src, size_t len) {
+    bool ascii = true;
+    for (size_t i = 0; i < len; ++i) {
+        byte c = src[i];
+        ascii &= c < 0x80;
+        dest[i] = c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+    }
+    return ascii;
+}
+
+// An import stats a few candidate names in each directory of sys.path, and
+// most of them don't exist.  On FAT each stat is a walk of the directory, so
+// instead each directory is listed once and the stats are answered from that.
+// Returns a dict mapping the names in the directory to their import stat (or
+// to None if that needs a real stat), None if the directory doesn't exist, or
+// False if it can't be listed.  If fold is true the names are stored in lower
+// case, and a directory with names that can't be folded isn't cached.
+STATIC mp_obj_t import_cache_list_dir(mp_obj_t dir, bool fold) {
+    MP_STATE_VM(vfs_import_fs_ops) += 1;
+    mp_obj_t entries = mp_obj_new_dict(0);
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        size_t n = 0;
+        mp_obj_t iter = mp_vfs_ilistdir(1, &dir);
+        mp_obj_t item;
+        while ((item = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
+            // the listing is always finished so that it gets closed
+            if (++n > MICROPY_VFS_IMPORT_CACHE) {
+                entries = mp_const_false;
+            }
+            if (entries == mp_const_false) {
+                continue;
+            }
+            size_t len;
+            mp_obj_t *items;
+            mp_obj_get_array(item, &len, &items);
+            if (len == 0) {
+                // a Python filesystem may list entries without a name
+                entries = mp_const_false;
+                continue;
+            }
+            mp_obj_t stat = mp_const_none;
+            if (len >= 2) {
+                mp_int_t mode = mp_obj_get_int(items[1]);
+                if (mode == MP_S_IFDIR) {
+                    stat = MP_OBJ_NEW_SMALL_INT(MP_IMPORT_STAT_DIR);
+                } else if (mode == MP_S_IFREG) {
+                    stat = MP_OBJ_NEW_SMALL_INT(MP_IMPORT_STAT_FILE);
+                }
+            }
+            mp_obj_t name = items[0];
+            if (fold) {
+                size_t name_len;
+                const char *str = mp_obj_str_get_data(name, &name_len);
+                vstr_t vstr;
+                vstr_init_len(&vstr, name_len);
+                if (!import_cache_fold(vstr.buf, str, name_len)) {
+                    // FAT folds it by its code page, so a lookup here can't
+                    // tell which names it matches
+                    vstr_clear(&vstr);
+                    entries = mp_const_false;
+                    continue;
+                }
+                name = mp_obj_new_str_from_vstr(&mp_type_str, &vstr);
+            }
+            mp_obj_dict_store(entries, name, stat);
+        }
+        nlr_pop();
+    } else {
+        // eg the filesystem doesn't support listing, then its stats aren't cached
+        entries = mp_const_false;
+        mp_obj_t exc = MP_OBJ_FROM_PTR(nlr.ret_val);
+        if (!mp_obj_is_subclass_fast(MP_OBJ_FROM_PTR(mp_obj_get_type(exc)), MP_OBJ_FROM_PTR(&mp_type_Exception))) {
+            // KeyboardInterrupt and the like
+            nlr_jump(nlr.ret_val);
+        }
+        if (mp_obj_is_subclass_fast(MP_OBJ_FROM_PTR(mp_obj_get_type(exc)), MP_OBJ_FROM_PTR(&mp_type_OSError))
+            && mp_obj_exception_get_value(exc) == MP_OBJ_NEW_SMALL_INT(MP_ENOENT)) {
+            entries = mp_const_none;
+        }
+    }
+    return entries;
+}
+
+#endif
+
+mp_import_stat_t mp_vfs_import_stat(const char *path) {
+    #if MICROPY_VFS_IMPORT_CACHE
+    // the cache is looked up with keys on the stack, so a hit doesn't allocate
+    const char *name = strrchr(path, '/');
+    size_t dir_len = 0;
+    if (name == NULL) {
+        name = path;
+    } else {
+        dir_len = name == path ? 1 : name - path;
+        name += 1;
+    }
+    mp_obj_str_t dir_key = {{&mp_type_str}, qstr_compute_hash((const byte*)path, dir_len), dir_len, (const byte*)path};
+    size_t name_len = strlen(name);
+
+    if (MP_STATE_VM(vfs_import_cache) == MP_OBJ_NULL) {
+        MP_STATE_VM(vfs_import_cache) = mp_obj_new_dict(0);
+    }
+    mp_map_elem_t *elem = mp_map_lookup(mp_obj_dict_get_map(MP_STATE_VM(vfs_import_cache)), MP_OBJ_FROM_PTR(&dir_key), MP_MAP_LOOKUP);
+    mp_obj_t dir;
+    mp_obj_t entries;
+    bool fold;
+    if (elem != NULL) {
+        dir = elem->key;
+        entries = elem->value;
+        fold = import_cache_folds_case(mp_obj_str_get_str(dir));
+    } else {
+        dir = mp_obj_new_str(path, dir_len);
+        fold = import_cache_folds_case(mp_obj_str_get_str(dir));
+        entries = import_cache_list_dir(dir, fold);
+        if (MP_STATE_VM(vfs_import_cache) != MP_OBJ_NULL) {
+            mp_obj_dict_store(MP_STATE_VM(vfs_import_cache), dir, entries);
+        }
+    }
+
+    char folded[MICROPY_ALLOC_PATH_MAX];
+    if (fold) {
+        if (name_len > sizeof(folded) || !import_cache_fold(folded, name, name_len)) {
+            return import_stat_fs(path);
+        }
+        name = folded;
+    }
+    mp_obj_str_t name_key = {{&mp_type_str}, qstr_compute_hash((const byte*)name, name_len), name_len, (const byte*)name};
+
+    if (entries == mp_const_none) {
+        MP_STATE_VM(vfs_import_cached) += 1;
+        return MP_IMPORT_STAT_NO_EXIST;
+    } else if (entries != mp_const_false) {
+        elem = mp_map_lookup(mp_obj_dict_get_map(entries), MP_OBJ_FROM_PTR(&name_key), MP_MAP_LOOKUP);
+        if (elem == NULL || elem->value != mp_const_none) {
+            MP_STATE_VM(vfs_import_cached) += 1;
+            return elem == NULL ? MP_IMPORT_STAT_NO_EXIST : MP_OBJ_SMALL_INT_VALUE(elem->value);
+        }
+    }
+    #endif
+
+    return import_stat_fs(path);
+}
+
+// The import cache must be dropped whenever a filesystem may have changed
+STATIC void import_cache_clear(void) {
+    #if MICROPY_VFS_IMPORT_CACHE
+    MP_STATE_VM(vfs_import_cache) = MP_OBJ_NULL;
+    #endif
+}
+
 mp_obj_t mp_vfs_mount(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     enum { ARG_readonly, ARG_mkfs };
     static const mp_arg_t allowed_args[] = {
@@ -217,6 +390,7 @@ mp_obj_t mp_vfs_mount(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args
         vfsp = &(*vfsp)->next;
     }
     *vfsp = vfs;
+    import_cache_clear();
 
     return mp_const_none;
 }
@@ -241,6 +415,7 @@ mp_obj_t mp_vfs_umount(mp_obj_t mnt_in) {
     if (vfs == NULL) {
         mp_raise_OSError(MP_EINVAL);
     }
+    import_cache_clear();
 
     // if we unmounted the current device then set current to root
     if (MP_STATE_VM(vfs_cur) == vfs) {
@@ -276,7 +451,12 @@ mp_obj_t mp_vfs_open(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args)
     #endif
 
     mp_vfs_mount_t *vfs = lookup_path(args[ARG_file].u_obj, &args[ARG_file].u_obj);
-    return mp_vfs_proxy_call(vfs, MP_QSTR_open, 2, (mp_obj_t*)&args);
+    mp_obj_t file = mp_vfs_proxy_call(vfs, MP_QSTR_open, 2, (mp_obj_t*)&args);
+    if (strpbrk(mp_obj_str_get_str(args[ARG_mode].u_obj), "wax+") != NULL) {
+        // the file may have been created
+        import_cache_clear();
+    }
+    return file;
 }
 MP_DEFINE_CONST_FUN_OBJ_KW(mp_vfs_open_obj, 0, mp_vfs_open);
 
@@ -284,6 +464,8 @@ mp_obj_t mp_vfs_chdir(mp_obj_t path_in) {
     mp_obj_t path_out;
     mp_vfs_mount_t *vfs = lookup_path(path_in, &path_out);
     MP_STATE_VM(vfs_cur) = vfs;
+    // relative paths in sys.path now refer to other directories
+    import_cache_clear();
     if (vfs == MP_VFS_ROOT) {
         // If we change to the root dir and a VFS is mounted at the root then
         // we must change that VFS's current dir to the root dir so that any
@@ -407,14 +589,18 @@ mp_obj_t mp_vfs_mkdir(mp_obj_t path_in) {
     if (vfs == MP_VFS_ROOT || (vfs != MP_VFS_NONE && !strcmp(mp_obj_str_get_str(path_out), "/"))) {
         mp_raise_OSError(MP_EEXIST);
     }
-    return mp_vfs_proxy_call(vfs, MP_QSTR_mkdir, 1, &path_out);
+    mp_obj_t ret = mp_vfs_proxy_call(vfs, MP_QSTR_mkdir, 1, &path_out);
+    import_cache_clear();
+    return ret;
 }
 MP_DEFINE_CONST_FUN_OBJ_1(mp_vfs_mkdir_obj, mp_vfs_mkdir);
 
 mp_obj_t mp_vfs_remove(mp_obj_t path_in) {
     mp_obj_t path_out;
     mp_vfs_mount_t *vfs = lookup_path(path_in, &path_out);
-    return mp_vfs_proxy_call(vfs, MP_QSTR_remove, 1, &path_out);
+    mp_obj_t ret = mp_vfs_proxy_call(vfs, MP_QSTR_remove, 1, &path_out);
+    import_cache_clear();
+    return ret;
 }
 MP_DEFINE_CONST_FUN_OBJ_1(mp_vfs_remove_obj, mp_vfs_remove);
 
@@ -426,14 +612,18 @@ mp_obj_t mp_vfs_rename(mp_obj_t old_path_in, mp_obj_t new_path_in) {
         // can't rename across filesystems
         mp_raise_OSError(MP_EPERM);
     }
-    return mp_vfs_proxy_call(old_vfs, MP_QSTR_rename, 2, args);
+    mp_obj_t ret = mp_vfs_proxy_call(old_vfs, MP_QSTR_rename, 2, args);
+    import_cache_clear();
+    return ret;
 }
 MP_DEFINE_CONST_FUN_OBJ_2(mp_vfs_rename_obj, mp_vfs_rename);
 
 mp_obj_t mp_vfs_rmdir(mp_obj_t path_in) {
     mp_obj_t path_out;
     mp_vfs_mount_t *vfs = lookup_path(path_in, &path_out);
-    return mp_vfs_proxy_call(vfs, MP_QSTR_rmdir, 1, &path_out);
+    mp_obj_t ret = mp_vfs_proxy_call(vfs, MP_QSTR_rmdir, 1, &path_out);
+    import_cache_clear();
+    return ret;
 }
 MP_DEFINE_CONST_FUN_OBJ_1(mp_vfs_rmdir_obj, mp_vfs_rmdir);
 
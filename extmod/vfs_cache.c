@@ -0,0 +1,167 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/stream.h"
+#include "py/persistentcode.h"
+#include "extmod/vfs.h"
+
+#if MICROPY_PERSISTENT_CODE_CACHE
+
+// The compiled copy of a .py file is kept next to it with the extension .mpc.
+// It starts with the mtime and size of the source it was made from, as two
+// 32-bit little-endian words, and the rest is a normal .mpy file.
+
+#define STAMP_LEN (8)
+
+STATIC void stamp_to_bytes(const uint32_t *stamp, byte *buf) {
+    for (size_t i = 0; i < STAMP_LEN; ++i) {
+        buf[i] = stamp[i / 4] >> (i % 4 * 8);
+    }
+}
+
+// Errors while using the cache just mean the source gets compiled, but
+// KeyboardInterrupt and the like must still get through
+STATIC void reraise_if_not_exception(nlr_buf_t *nlr) {
+    if (!mp_obj_is_subclass_fast(MP_OBJ_FROM_PTR(((mp_obj_base_t*)nlr->ret_val)->type),
+        MP_OBJ_FROM_PTR(&mp_type_Exception))) {
+        nlr_jump(nlr->ret_val);
+    }
+}
+
+bool mp_raw_code_cache_stamp(const char *src_path, uint32_t *stamp) {
+    // Filesystems written in Python only see the calls an import always made
+    const char *path_out;
+    mp_vfs_mount_t *vfs = mp_vfs_lookup_path(src_path, &path_out);
+    if (vfs == MP_VFS_NONE || vfs == MP_VFS_ROOT || mp_obj_get_type(vfs->obj)->protocol == NULL) {
+        return false;
+    }
+
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_obj_t *items;
+        mp_obj_get_array_fixed_n(mp_vfs_stat(mp_obj_new_str(src_path, strlen(src_path))), 10, &items);
+        stamp[0] = mp_obj_int_get_truncated(items[8]); // st_mtime
+        stamp[1] = mp_obj_int_get_truncated(items[6]); // st_size
+        nlr_pop();
+        // without timestamps an edit that keeps the size would go unnoticed
+        return stamp[0] != 0;
+    } else {
+        reraise_if_not_exception(&nlr);
+        return false;
+    }
+}
+
+mp_raw_code_t *mp_raw_code_load_cache(const char *cache_path, const uint32_t *stamp) {
+    if (mp_vfs_import_stat(cache_path) != MP_IMPORT_STAT_FILE) {
+        return NULL;
+    }
+    mp_reader_t reader;
+    reader.data = NULL;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_reader_new_file(&reader, cache_path);
+        byte buf[STAMP_LEN];
+        stamp_to_bytes(stamp, buf);
+        bool fresh = true;
+        for (size_t i = 0; i < STAMP_LEN; ++i) {
+            if (reader.readbyte(reader.data) != buf[i]) {
+                fresh = false;
+            }
+        }
+        mp_raw_code_t *rc = NULL;
+        if (fresh) {
+            // this closes the reader
+            rc = mp_raw_code_load(&reader);
+        } else {
+            reader.close(reader.data);
+        }
+        nlr_pop();
+        return rc;
+    } else {
+        // the copy can't be read or was made by an incompatible build
+        reraise_if_not_exception(&nlr);
+        if (reader.data != NULL) {
+            reader.close(reader.data);
+        }
+        return NULL;
+    }
+}
+
+STATIC void remove_quietly(mp_obj_t path) {
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_vfs_remove(path);
+        nlr_pop();
+    } else {
+        reraise_if_not_exception(&nlr);
+    }
+}
+
+void mp_raw_code_save_cache(mp_raw_code_t *rc, const char *cache_path, const uint32_t *stamp) {
+    // The copy is written under a temporary name and then renamed into place,
+    // so an interrupted save can't leave a truncated copy behind
+    size_t len = strlen(cache_path);
+    mp_obj_t path = mp_obj_new_str(cache_path, len);
+    vstr_t tmp;
+    vstr_init(&tmp, len);
+    vstr_add_strn(&tmp, cache_path, len - 1);
+    vstr_add_char(&tmp, '~');
+    mp_obj_t tmp_path = mp_obj_new_str_from_vstr(&mp_type_str, &tmp);
+
+    mp_obj_t volatile file = MP_OBJ_NULL;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_obj_t args[2] = {tmp_path, MP_OBJ_NEW_QSTR(MP_QSTR_wb)};
+        file = mp_vfs_open(MP_ARRAY_SIZE(args), args, (mp_map_t*)&mp_const_empty_map);
+        byte buf[STAMP_LEN];
+        stamp_to_bytes(stamp, buf);
+        mp_stream_write_adaptor(MP_OBJ_TO_PTR(file), (const char*)buf, STAMP_LEN);
+        mp_print_t print = {MP_OBJ_TO_PTR(file), mp_stream_write_adaptor};
+        mp_raw_code_save(rc, &print);
+        mp_stream_close(file);
+        file = MP_OBJ_NULL;
+        // FAT can't rename over an existing file
+        remove_quietly(path);
+        mp_vfs_rename(tmp_path, path);
+        nlr_pop();
+    } else {
+        // eg a read-only filesystem or no space left, so just go without
+        reraise_if_not_exception(&nlr);
+        if (file != MP_OBJ_NULL) {
+            nlr_buf_t nlr2;
+            if (nlr_push(&nlr2) == 0) {
+                mp_stream_close(file);
+                nlr_pop();
+            }
+        }
+        remove_quietly(tmp_path);
+    }
+}
+
+#endif // MICROPY_PERSISTENT_CODE_CACHE
@@ -29,6 +29,7 @@
 
 #include "py/runtime.h"
 #include "py/stream.h"
+#include "py/objtype.h"
 #include "py/reader.h"
 #include "extmod/vfs.h"
 
@@ -69,6 +70,28 @@ STATIC void mp_reader_vfs_close(void *data) {
     m_del_obj(mp_reader_vfs_t, reader);
 }
 
+bool mp_reader_vfs_try_seek(mp_reader_t *reader, size_t offset) {
+    if (reader->readbyte != mp_reader_vfs_readbyte) {
+        return false;
+    }
+    mp_reader_vfs_t *rf = (mp_reader_vfs_t*)reader->data;
+    if (!mp_obj_is_native_type(mp_obj_get_type(rf->file))) {
+        // the ioctl of a file implemented in Python may not seek
+        return false;
+    }
+    struct mp_stream_seek_t seek_s = {offset, MP_SEEK_SET};
+    int errcode;
+    if (mp_get_stream(rf->file)->ioctl(rf->file, MP_STREAM_SEEK, (uintptr_t)&seek_s, &errcode) == MP_STREAM_ERROR) {
+        return false;
+    }
+    rf->len = mp_stream_rw(rf->file, rf->buf, sizeof(rf->buf), &errcode, MP_STREAM_RW_READ | MP_STREAM_RW_ONCE);
+    if (errcode != 0) {
+        rf->len = 0;
+    }
+    rf->pos = 0;
+    return true;
+}
+
 void mp_reader_new_file(mp_reader_t *reader, const char *filename) {
     mp_reader_vfs_t *rf = m_new_obj(mp_reader_vfs_t);
     mp_obj_t arg = mp_obj_new_str(filename, strlen(filename));
@@ -87,9 +87,16 @@ STATIC int parse_compile_execute(const void *source, mp_parse_input_kind_t input
                 lex = (mp_lexer_t*)source;
             }
             // source is a lexer, parse and compile the script
-            qstr source_name = lex->source_name;
-            mp_parse_tree_t parse_tree = mp_parse(lex, input_kind);
-            module_fun = mp_compile(&parse_tree, source_name, MP_EMIT_OPT_NONE, exec_flags & EXEC_FLAG_IS_REPL);
+            #if MICROPY_COMP_STREAMING
+            if (input_kind == MP_PARSE_FILE_INPUT && !(exec_flags & EXEC_FLAG_IS_REPL)) {
+                module_fun = mp_compile_lexer(lex, MP_EMIT_OPT_NONE);
+            } else
+            #endif
+            {
+                qstr source_name = lex->source_name;
+                mp_parse_tree_t parse_tree = mp_parse(lex, input_kind);
+                module_fun = mp_compile(&parse_tree, source_name, MP_EMIT_OPT_NONE, exec_flags & EXEC_FLAG_IS_REPL);
+            }
             #else
             mp_raise_msg(&mp_type_RuntimeError, "script compilation not supported");
             #endif
@@ -28,6 +28,14 @@
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/wait.h>
+#else
+#include <direct.h>
+#endif
 
 #include "py/compile.h"
 #include "py/persistentcode.h"
@@ -55,9 +63,188 @@ STATIC void stderr_print_strn(void *env, const char *str, mp_uint_t len) {
 
 STATIC const mp_print_t mp_stderr_print = {NULL, stderr_print_strn};
 
-STATIC int compile_and_save(const char *file, const char *output_file, const char *source_file) {
+#if MICROPY_COMP_CONST_IMPORT
+// Splits the argument of -c, [<module>=]<file>, into the module name and the
+// file.  Without an explicit name the module is named after the file, or after
+// its directory for a package's __init__.py.
+STATIC qstr const_module_name(const char *arg, const char **file) {
+    const char *eq = strchr(arg, '=');
+    if (eq != NULL) {
+        *file = eq + 1;
+        return qstr_from_strn(arg, eq - arg);
+    }
+    *file = arg;
+    const char *end = arg + strlen(arg);
+    if (end - arg >= 3 && strcmp(end - 3, ".py") == 0) {
+        end -= 3;
+    }
+    const char *start = end;
+    while (start > arg && start[-1] != '/') {
+        --start;
+    }
+    if (end - start == 8 && strncmp(start, "__init__", 8) == 0 && start > arg) {
+        // name of the package directory
+        end = start - 1;
+        start = end;
+        while (start > arg && start[-1] != '/') {
+            --start;
+        }
+    }
+    return qstr_from_strn(start, end - start);
+}
+
+// Parses a file without inlining imported constants, to find the names that
+// it binds other than by a module-level import from a -c module.  Those names
+// don't always have the imported value, so the parse of the file that follows
+// doesn't inline them.
+STATIC void find_const_stores(const char *file) {
+    MP_STATE_VM(parse_const_stores) = MP_OBJ_NULL;
+    if (MP_STATE_VM(parse_const_modules) == MP_OBJ_NULL) {
+        return;
+    }
+    mp_parse_tree_t parse_tree = mp_parse(mp_lexer_new_from_file(file), MP_PARSE_FILE_INPUT);
+    mp_obj_t stores = mp_obj_new_dict(0);
+    mp_parse_find_const_stores(&parse_tree, stores);
+    mp_parse_tree_clear(&parse_tree);
+    MP_STATE_VM(parse_const_stores) = stores;
+}
+
+// Parses a module and records its const() values, so that they are inlined
+// where the module being compiled uses "from <module> import <name>".
+STATIC int load_consts(const char *arg) {
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        const char *file;
+        qstr module = const_module_name(arg, &file);
+        mp_obj_t consts = mp_obj_new_dict(0);
+        find_const_stores(file);
+        mp_lexer_t *lex = mp_lexer_new_from_file(file);
+        MP_STATE_VM(parse_const_export) = consts;
+        mp_parse_tree_t parse_tree = mp_parse(lex, MP_PARSE_FILE_INPUT);
+        MP_STATE_VM(parse_const_export) = MP_OBJ_NULL;
+        MP_STATE_VM(parse_const_stores) = MP_OBJ_NULL;
+        mp_parse_tree_clear(&parse_tree);
+        if (MP_STATE_VM(parse_const_modules) == MP_OBJ_NULL) {
+            MP_STATE_VM(parse_const_modules) = mp_obj_new_dict(0);
+        }
+        mp_obj_dict_store(MP_STATE_VM(parse_const_modules), MP_OBJ_NEW_QSTR(module), consts);
+        nlr_pop();
+        return 0;
+    } else {
+        MP_STATE_VM(parse_const_export) = MP_OBJ_NULL;
+        mp_obj_print_exception(&mp_stderr_print, (mp_obj_t)nlr.ret_val);
+        return 1;
+    }
+}
+
+#endif
+
+// The input files, and where their outputs go.  With more than one input file,
+// or if it ends with a slash, -o names a directory below which each output
+// keeps the path of its input.
+STATIC const char **input_files;
+STATIC size_t n_input_files;
+STATIC const char *output_opt = NULL;
+STATIC const char *source_file = NULL;
+
+STATIC void output_file_name(vstr_t *vstr, const char *input_file) {
+    vstr_reset(vstr);
+    if (output_opt != NULL) {
+        vstr_add_str(vstr, output_opt);
+        if (vstr->len == 0 || vstr->buf[vstr->len - 1] != '/') {
+            if (n_input_files == 1) {
+                return;
+            }
+            vstr_add_char(vstr, '/');
+        }
+    }
+    vstr_add_str(vstr, input_file);
+    vstr_cut_tail_bytes(vstr, 2);
+    vstr_add_str(vstr, "mpy");
+}
+
+// Creates the directories that the output file name leads through, as the
+// relative path of an input below -o can name ones that don't exist yet.
+STATIC int make_output_dirs(vstr_t *vstr) {
+    char *path = vstr_null_terminated_str(vstr);
+    for (char *p = path + 1; *p != '\0'; p++) {
+        if (*p != '/') {
+            continue;
+        }
+        *p = '\0';
+        #ifdef _WIN32
+        int ret = _mkdir(path);
+        #else
+        int ret = mkdir(path, 0777);
+        #endif
+        *p = '/';
+        if (ret != 0 && errno != EEXIST) {
+            mp_printf(&mp_stderr_print, "can't create directory for %s\n", path);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Writes a manifest for the outputs, in makefile syntax, so they are rebuilt
+// when their input or a module given with -c changes.  The constants that may
+// have been inlined are listed as comments, to check whether a build is stale
+// by their values.
+STATIC int save_manifest(const char *manifest_file, size_t n_const, const char **const_args) {
+    FILE *f = fopen(manifest_file, "w");
+    if (f == NULL) {
+        mp_printf(&mp_stderr_print, "can't write manifest %s\n", manifest_file);
+        return 1;
+    }
+    vstr_t vstr;
+    vstr_init(&vstr, 16);
+    for (size_t i = 0; i < n_input_files; i++) {
+        output_file_name(&vstr, input_files[i]);
+        fprintf(f, "%s: %s", vstr_null_terminated_str(&vstr), input_files[i]);
+        #if MICROPY_COMP_CONST_IMPORT
+        for (size_t j = 0; j < n_const; j++) {
+            const char *file;
+            const_module_name(const_args[j], &file);
+            fprintf(f, " %s", file);
+        }
+        #endif
+        fprintf(f, "\n");
+    }
+    #if MICROPY_COMP_CONST_IMPORT
+    mp_print_t print;
+    vstr_clear(&vstr);
+    vstr_init_print(&vstr, 16, &print);
+    for (size_t i = 0; i < n_const; i++) {
+        const char *file;
+        qstr module = const_module_name(const_args[i], &file);
+        fprintf(f, "%s:\n", file);
+        mp_obj_t consts = mp_obj_dict_get(MP_STATE_VM(parse_const_modules), MP_OBJ_NEW_QSTR(module));
+        mp_map_t *map = mp_obj_dict_get_map(consts);
+        for (size_t j = 0; j < map->alloc; j++) {
+            if (mp_map_slot_is_filled(map, j)) {
+                vstr_reset(&vstr);
+                mp_obj_print_helper(&print, map->table[j].value, PRINT_REPR);
+                fprintf(f, "#const %s.%s %s\n", qstr_str(module),
+                    qstr_str(MP_OBJ_QSTR_VALUE(map->table[j].key)), vstr_null_terminated_str(&vstr));
+            }
+        }
+    }
+    #else
+    (void)n_const;
+    (void)const_args;
+    #endif
+    vstr_clear(&vstr);
+    fclose(f);
+    return 0;
+}
+
+STATIC int compile_and_save(const char *file, const char *output_file) {
     nlr_buf_t nlr;
     if (nlr_push(&nlr) == 0) {
+        #if MICROPY_COMP_CONST_IMPORT
+        find_const_stores(file);
+        #endif
+
         mp_lexer_t *lex = mp_lexer_new_from_file(file);
 
         qstr source_name;
@@ -72,19 +259,12 @@ STATIC int compile_and_save(const char *file, const char *output_file, const cha
         #endif
 
         mp_parse_tree_t parse_tree = mp_parse(lex, MP_PARSE_FILE_INPUT);
+        #if MICROPY_COMP_CONST_IMPORT
+        MP_STATE_VM(parse_const_stores) = MP_OBJ_NULL;
+        #endif
         mp_raw_code_t *rc = mp_compile_to_raw_code(&parse_tree, source_name, emit_opt, false);
 
-        vstr_t vstr;
-        vstr_init(&vstr, 16);
-        if (output_file == NULL) {
-            vstr_add_str(&vstr, file);
-            vstr_cut_tail_bytes(&vstr, 2);
-            vstr_add_str(&vstr, "mpy");
-        } else {
-            vstr_add_str(&vstr, output_file);
-        }
-        mp_raw_code_save_file(rc, vstr_null_terminated_str(&vstr));
-        vstr_clear(&vstr);
+        mp_raw_code_save_file(rc, output_file);
 
         nlr_pop();
         return 0;
@@ -95,13 +275,129 @@ STATIC int compile_and_save(const char *file, const char *output_file, const cha
     }
 }
 
+// Compiles one of the input files, as if by a process of its own.  Numbers of
+// qstrs end up in the output (in the prelude and in native code), so the qstrs
+// made for a file are forgotten afterwards and the output doesn't depend on the
+// files compiled before it.  The builtin qstrs and those of the -c modules are
+// kept, and the heap is collected so each file starts with all of it.
+STATIC int compile_input_file(size_t i) {
+    qstr_pool_t *last_pool = MP_STATE_VM(last_pool);
+    size_t last_pool_len = last_pool->len;
+
+    vstr_t output;
+    vstr_init(&output, 16);
+    output_file_name(&output, input_files[i]);
+    int ret = make_output_dirs(&output);
+    if (ret == 0) {
+        ret = compile_and_save(input_files[i], vstr_null_terminated_str(&output));
+    }
+    vstr_clear(&output);
+
+    MP_STATE_VM(last_pool) = last_pool;
+    if (last_pool->len != last_pool_len) {
+        // not when it's the (read-only) pool of builtin qstrs
+        last_pool->len = last_pool_len;
+    }
+    MP_STATE_VM(qstr_last_chunk) = NULL;
+    gc_collect();
+    return ret;
+}
+
+#ifndef _WIN32
+// Compiles the input files with up to n_jobs worker processes.  The heap and
+// qstr pool aren't thread safe, so each worker is a fork of this process,
+// which already has the -c modules loaded, and takes the index of the next
+// file to compile from a pipe.  Writes of an index are atomic, so the workers
+// never see part of one.  Returns -1 if no worker could be started.
+STATIC int compile_input_files_jobs(unsigned n_jobs) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return -1;
+    }
+    fflush(stdout);
+    fflush(stderr);
+    unsigned n_workers = 0;
+    while (n_workers < n_jobs) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            break;
+        }
+        if (pid == 0) {
+            close(fds[1]);
+            int ret = 0;
+            uint32_t i;
+            while (read(fds[0], &i, sizeof(i)) == sizeof(i)) {
+                ret |= compile_input_file(i);
+            }
+            fflush(stdout);
+            _exit(ret);
+        }
+        n_workers++;
+    }
+    close(fds[0]);
+    int ret = 0;
+    if (n_workers == 0) {
+        ret = -1;
+    } else {
+        // if the workers all exit early a write fails, instead of killing us
+        signal(SIGPIPE, SIG_IGN);
+        for (uint32_t i = 0; i < n_input_files; i++) {
+            if (write(fds[1], &i, sizeof(i)) != sizeof(i)) {
+                ret = 1;
+                break;
+            }
+        }
+    }
+    close(fds[1]);
+    while (n_workers > 0) {
+        int status;
+        if (wait(&status) < 0) {
+            break;
+        }
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            ret = 1;
+        }
+        n_workers--;
+    }
+    return ret;
+}
+#endif
+
+STATIC int compile_input_files(unsigned n_jobs) {
+    #ifndef _WIN32
+    if (n_jobs > n_input_files) {
+        n_jobs = n_input_files;
+    }
+    if (n_jobs > 1) {
+        int ret = compile_input_files_jobs(n_jobs);
+        if (ret >= 0) {
+            return ret;
+        }
+    }
+    #else
+    (void)n_jobs;
+    #endif
+    int ret = 0;
+    for (size_t i = 0; i < n_input_files; i++) {
+        ret |= compile_input_file(i);
+    }
+    return ret;
+}
+
 STATIC int usage(char **argv) {
     printf(
-"usage: %s [<opts>] [-X <implopt>] <input filename>\n"
+"usage: %s [<opts>] [-X <implopt>] <input filename>...\n"
 "Options:\n"
 "--version : show version information\n"
-"-o : output file for compiled bytecode (defaults to input with .mpy extension)\n"
+"-o : output file for compiled bytecode (defaults to input with .mpy extension);\n"
+"    with multiple input files, or ending with /, the directory to write below\n"
 "-s : source filename to embed in the compiled bytecode (defaults to input file)\n"
+#if MICROPY_COMP_CONST_IMPORT
+"-c [<module>=]<file> : inline the const() values of this module where they are\n"
+"    imported with \"from <module> import <name>\"; can be given multiple times\n"
+#endif
+"-M <file> : write a manifest of the dependencies of the outputs\n"
+"-j <n> : compile multiple input files with up to n worker processes\n"
 "-v : verbose (trace various operations); can be multiple\n"
 "-O[N] : apply bytecode optimizations of level N\n"
 "\n"
@@ -110,6 +406,7 @@ STATIC int usage(char **argv) {
 "-mno-unicode : don't support unicode in compiled strings\n"
 "-mcache-lookup-bc : cache map lookups in the bytecode\n"
 "-march=<arch> : set architecture for native emitter; x86, x64, armv6, armv7m, xtensa\n"
+"-mxip : save an execute-in-place image (bytecode only)\n"
 "\n"
 "Implementation specific options:\n", argv[0]
 );
@@ -203,10 +500,18 @@ MP_NOINLINE int main_(int argc, char **argv) {
     #else
     mp_dynamic_compiler.native_arch = MP_NATIVE_ARCH_NONE;
     #endif
+    mp_dynamic_compiler.persistent_code_xip = false;
 
-    const char *input_file = NULL;
-    const char *output_file = NULL;
-    const char *source_file = NULL;
+    // not on the GC heap, which is collected between input files
+    input_files = malloc(argc * sizeof(const char*));
+    n_input_files = 0;
+    unsigned n_jobs = 1;
+    const char *manifest_file = NULL;
+    const char **const_args = NULL;
+    size_t n_const = 0;
+    #if MICROPY_COMP_CONST_IMPORT
+    const_args = malloc(argc * sizeof(const char*));
+    #endif
 
     // parse main options
     for (int a = 1; a < argc; a++) {
@@ -231,13 +536,40 @@ MP_NOINLINE int main_(int argc, char **argv) {
                     exit(usage(argv));
                 }
                 a += 1;
-                output_file = argv[a];
+                output_opt = argv[a];
             } else if (strcmp(argv[a], "-s") == 0) {
                 if (a + 1 >= argc) {
                     exit(usage(argv));
                 }
                 a += 1;
                 source_file = argv[a];
+            #if MICROPY_COMP_CONST_IMPORT
+            } else if (strcmp(argv[a], "-c") == 0) {
+                if (a + 1 >= argc) {
+                    exit(usage(argv));
+                }
+                a += 1;
+                if (load_consts(argv[a]) != 0) {
+                    exit(1);
+                }
+                const_args[n_const++] = argv[a];
+            #endif
+            } else if (strcmp(argv[a], "-M") == 0) {
+                if (a + 1 >= argc) {
+                    exit(usage(argv));
+                }
+                a += 1;
+                manifest_file = argv[a];
+            } else if (strcmp(argv[a], "-j") == 0) {
+                if (a + 1 >= argc) {
+                    exit(usage(argv));
+                }
+                a += 1;
+                char *end;
+                n_jobs = strtoul(argv[a], &end, 0);
+                if (*end || n_jobs == 0) {
+                    return usage(argv);
+                }
             } else if (strncmp(argv[a], "-msmall-int-bits=", sizeof("-msmall-int-bits=") - 1) == 0) {
                 char *end;
                 mp_dynamic_compiler.small_int_bits =
@@ -254,6 +586,8 @@ MP_NOINLINE int main_(int argc, char **argv) {
                 mp_dynamic_compiler.py_builtins_str_unicode = 0;
             } else if (strcmp(argv[a], "-municode") == 0) {
                 mp_dynamic_compiler.py_builtins_str_unicode = 1;
+            } else if (strcmp(argv[a], "-mxip") == 0) {
+                mp_dynamic_compiler.persistent_code_xip = true;
             } else if (strncmp(argv[a], "-march=", sizeof("-march=") - 1) == 0) {
                 const char *arch = argv[a] + sizeof("-march=") - 1;
                 if (strcmp(arch, "x86") == 0) {
@@ -273,20 +607,25 @@ MP_NOINLINE int main_(int argc, char **argv) {
                 return usage(argv);
             }
         } else {
-            if (input_file != NULL) {
-                mp_printf(&mp_stderr_print, "multiple input files\n");
-                exit(1);
-            }
-            input_file = argv[a];
+            input_files[n_input_files++] = argv[a];
         }
     }
 
-    if (input_file == NULL) {
+    if (n_input_files == 0) {
         mp_printf(&mp_stderr_print, "no input file\n");
         exit(1);
     }
 
-    int ret = compile_and_save(input_file, output_file, source_file);
+    if (n_input_files > 1 && source_file != NULL) {
+        mp_printf(&mp_stderr_print, "-s needs a single input file\n");
+        exit(1);
+    }
+
+    int ret = compile_input_files(n_jobs);
+
+    if (ret == 0 && manifest_file != NULL) {
+        ret = save_manifest(manifest_file, n_const, const_args);
+    }
 
     #if MICROPY_PY_MICROPYTHON_MEM_INFO
     if (mp_verbose_flag) {
@@ -47,6 +47,9 @@
 #define MICROPY_COMP_DOUBLE_TUPLE_ASSIGN (1)
 #define MICROPY_COMP_TRIPLE_TUPLE_ASSIGN (1)
 #define MICROPY_COMP_RETURN_IF_EXPR (1)
+#define MICROPY_COMP_CONST_FOLDING_EXTRA (1)
+#define MICROPY_COMP_CONST_IMPORT   (1)
+#define MICROPY_COMP_PEEPHOLE       (1)
 
 #define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE (0)
 
@@ -17,6 +17,10 @@
 
 // emitters
 #define MICROPY_PERSISTENT_CODE_LOAD (1)
+#define MICROPY_PERSISTENT_CODE_XIP (1)
+#define MICROPY_PERSISTENT_CODE_LAZY_LINES (1)
+#define MICROPY_PERSISTENT_CODE_SAVE (1)
+#define MICROPY_PERSISTENT_CODE_CACHE (1)
 #ifndef MICROPY_EMIT_THUMB
 #define MICROPY_EMIT_THUMB          (1)
 #endif
@@ -28,10 +32,12 @@
 #define MICROPY_COMP_MODULE_CONST   (1)
 #define MICROPY_COMP_TRIPLE_TUPLE_ASSIGN (1)
 #define MICROPY_COMP_RETURN_IF_EXPR (1)
+#define MICROPY_COMP_STREAMING      (1)
 
 // optimisations
 #define MICROPY_OPT_COMPUTED_GOTO   (1)
 #define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE (1)
+#define MICROPY_OPT_GEN_RECYCLE     (1)
 #define MICROPY_OPT_MPZ_BITWISE     (1)
 #define MICROPY_OPT_MATH_FACTORIAL  (1)
 
@@ -39,9 +45,18 @@
 #define MICROPY_READER_VFS          (1)
 #define MICROPY_ENABLE_GC           (1)
 #define MICROPY_ENABLE_FINALISER    (1)
+#define MICROPY_GC_SPLIT_HEAP       (1)
+#define MICROPY_GC_SIZE_CLASSES     (8)
+#define MICROPY_GC_FINALISER_LIST   (1)
+#define MICROPY_GC_FINALISER_DEFERRED (1)
 #define MICROPY_STACK_CHECK         (0)
+#define MICROPY_ENABLE_PYSTACK      (1)
+#define MICROPY_PYSTACK_GROW        (1)
+#define MICROPY_PYSTACK_SEGMENT_SIZE (512)
 #define MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF (1)
 #define MICROPY_EMERGENCY_EXCEPTION_BUF_SIZE (1)
+#define MICROPY_EXC_TRACEBACK_BUF   (8)
+#define MICROPY_OSERROR_PREALLOC    (1)
 #define MICROPY_KBD_EXCEPTION       (1)
 #define MICROPY_HELPER_REPL         (1)
 #define MICROPY_REPL_EMACS_KEYS     (1)
@@ -58,6 +73,7 @@
 #define MICROPY_ENABLE_SCHEDULER    (1)
 #define MICROPY_SCHEDULER_DEPTH     (8)
 #define MICROPY_VFS                 (1)
+#define MICROPY_VFS_IMPORT_CACHE    (32)
 #ifndef MICROPY_VFS_FAT
 #define MICROPY_VFS_FAT             (1)
 #endif
@@ -66,10 +82,16 @@
 #define MICROPY_PY_FUNCTION_ATTRS   (1)
 #define MICROPY_PY_DESCRIPTORS      (1)
 #define MICROPY_PY_DELATTR_SETATTR  (1)
+#define MICROPY_PY_INSTANCE_SHAPES  (1)
+#define MICROPY_PY_SLOTS            (1)
+#define MICROPY_PY_INSTANCE_SHAPES_MAX (64)
 #define MICROPY_PY_BUILTINS_STR_UNICODE (1)
+#define MICROPY_PY_BUILTINS_STR_UNICODE_INDEX (2)
 #define MICROPY_PY_BUILTINS_STR_CENTER (1)
 #define MICROPY_PY_BUILTINS_STR_PARTITION (1)
 #define MICROPY_PY_BUILTINS_STR_SPLITLINES (1)
+#define MICROPY_PY_STR_SLICE_VIEW   (1)
+#define MICROPY_PY_STR_INPLACE_CONCAT (1)
 #define MICROPY_PY_BUILTINS_MEMORYVIEW (1)
 #define MICROPY_PY_BUILTINS_FROZENSET (1)
 #define MICROPY_PY_BUILTINS_SLICE_ATTRS (1)
@@ -215,6 +237,11 @@ extern const struct _mp_obj_module_t mp_module_webrepl;
 
 #include "FreeRTOS.h"
 
+// execute-in-place .mpy files are run from the memory-mapped /flash
+const void *storage_map_file(const char *filename, size_t *len);
+#define MP_PLAT_MAP_FILE(filename, len) storage_map_file(filename, len)
+#define MP_PLAT_UNMAP_FILE(ptr, len) (void)0
+
 #if MICROPY_PY_THREAD
 #define MICROPY_EVENT_POLL_HOOK \
     do { \
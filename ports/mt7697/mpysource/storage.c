@@ -209,6 +209,49 @@ mp_uint_t storage_write_blocks(const uint8_t *src, uint32_t block_num, uint32_t
     return 0; // success
 }
 
+#if MICROPY_PERSISTENT_CODE_XIP
+
+extern fs_user_mount_t fs_user_mount_flash;
+extern const unsigned int _flash_fs_start; // defined in mt7697_flash.ld
+
+// Map a file on /flash so an execute-in-place .mpy can run from it.  The
+// filesystem's flash is memory mapped (and not cached) at _flash_fs_start,
+// so a file whose clusters follow each other can be read directly there.
+// Other files return NULL and are read in the usual way.  A mapped file is
+// used for as long as its module is, so it must not be rewritten until reset.
+const void *storage_map_file(const char *filename, size_t *len) {
+    const char *path;
+    mp_vfs_mount_t *vfs = mp_vfs_lookup_path(filename, &path);
+    if (vfs == MP_VFS_NONE || vfs == MP_VFS_ROOT || MP_OBJ_TO_PTR(vfs->obj) != &fs_user_mount_flash) {
+        return NULL;
+    }
+    FATFS *fs = &fs_user_mount_flash.fatfs;
+    FIL fp;
+    if (f_open(fs, &fp, path, FA_READ) != FR_OK) {
+        return NULL;
+    }
+    const void *ptr = NULL;
+    DWORD size = f_size(&fp);
+    DWORD sclust = fp.obj.sclust;
+    DWORD cluster_size = (DWORD)fs->csize * FLASH_BLOCK_SIZE;
+    DWORD n = 1;
+    // seek one byte into each cluster to check it follows the one before
+    while (n * cluster_size < size && f_lseek(&fp, n * cluster_size + 1) == FR_OK && fp.clust == sclust + n) {
+        ++n;
+    }
+    if (size > 0 && n * cluster_size >= size) {
+        // the last blocks written may still be in the flash write buffer
+        storage_flush();
+        DWORD block = fs->database + (sclust - 2) * fs->csize - FLASH_PART1_START_BLOCK;
+        ptr = (const byte*)&_flash_fs_start + block * FLASH_BLOCK_SIZE;
+        *len = size;
+    }
+    f_close(&fp);
+    return ptr;
+}
+
+#endif // MICROPY_PERSISTENT_CODE_XIP
+
 /******************************************************************************/
 // MicroPython bindings
 //
@@ -77,6 +77,16 @@ fs_user_mount_t fs_user_mount_flash;
 #define MP_TASK_STACK_LEN     (MP_TASK_STACK_SIZE / sizeof(StackType_t))
 
 static char heap[25*1024];
+#if MICROPY_GC_SPLIT_HEAP
+// the TCM after the SDK's sections, from the linker script, is added to the
+// heap as a second region
+extern char __tcm_heap_start__[];
+extern char __tcm_heap_end__[];
+#endif
+#if MICROPY_ENABLE_PYSTACK
+// frames of Python calls go here first, then in segments from the heap
+static mp_obj_t pystack[256];
+#endif
 static char *stack_top;
 extern uint32_t __StackTop;
 extern uint32_t __StackLimit;
@@ -255,9 +265,16 @@ void mp_task(void *pvParameters)
 
     // GC init
     gc_init(heap, heap + sizeof(heap));
+    #if MICROPY_GC_SPLIT_HEAP
+    gc_add_region(__tcm_heap_start__, __tcm_heap_end__);
+    #endif
     #endif
     SysInitStatus_Set();
 
+    #if MICROPY_ENABLE_PYSTACK
+    mp_pystack_init(pystack, &pystack[MP_ARRAY_SIZE(pystack)]);
+    #endif
+
     // MicroPython init
     mp_init();
     mp_obj_list_init(MP_OBJ_TO_PTR(mp_sys_path), 0);
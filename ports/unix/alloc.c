@@ -28,7 +28,10 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "py/mpstate.h"
 #include "py/gc.h"
@@ -105,3 +108,28 @@ void ffi_closure_free(void *ptr) {
 #endif
 
 #endif // MICROPY_EMIT_NATIVE || (MICROPY_PY_FFI && MICROPY_FORCE_PLAT_ALLOC_EXEC)
+
+#if MICROPY_PERSISTENT_CODE_XIP
+
+// Map a file read-only into memory, returning NULL if that's not possible.
+// Execute-in-place .mpy files are run from such a mapping.
+const void *mp_unix_map_file(const char *filename, size_t *len) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    void *ptr = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        *len = st.st_size;
+        ptr = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+void mp_unix_unmap_file(const void *ptr, size_t len) {
+    munmap((void*)ptr, len);
+}
+
+#endif // MICROPY_PERSISTENT_CODE_XIP
@@ -134,6 +134,41 @@ STATIC const mp_obj_type_t mp_type_stest_textio2 = {
     .locals_dict = (mp_obj_dict_t*)&rawfile_locals_dict2,
 };
 
+// object whose finaliser calls fun(arg), for testing finalisers from scripts
+typedef struct _mp_obj_ftest_t {
+    mp_obj_base_t base;
+    mp_obj_t fun;
+    mp_obj_t arg;
+} mp_obj_ftest_t;
+
+STATIC mp_obj_t ftest_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 2, 2, false);
+    mp_obj_ftest_t *o = m_new_obj_with_finaliser(mp_obj_ftest_t);
+    o->base.type = type;
+    o->fun = args[0];
+    o->arg = args[1];
+    return MP_OBJ_FROM_PTR(o);
+}
+
+STATIC mp_obj_t ftest_del(mp_obj_t self_in) {
+    mp_obj_ftest_t *self = MP_OBJ_TO_PTR(self_in);
+    return mp_call_function_1(self->fun, self->arg);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ftest_del_obj, ftest_del);
+
+STATIC const mp_rom_map_elem_t ftest_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___del__), MP_ROM_PTR(&ftest_del_obj) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(ftest_locals_dict, ftest_locals_dict_table);
+
+const mp_obj_type_t mp_type_ftest = {
+    { &mp_type_type },
+    .name = MP_QSTR_FinaliserTest,
+    .make_new = ftest_make_new,
+    .locals_dict = (mp_obj_dict_t*)&ftest_locals_dict,
+};
+
 // str/bytes objects without a valid hash
 STATIC const mp_obj_str_t str_no_hash_obj = {{&mp_type_str}, 0, 10, (const byte*)"0123456789"};
 STATIC const mp_obj_str_t bytes_no_hash_obj = {{&mp_type_bytes}, 0, 10, (const byte*)"0123456789"};
@@ -179,6 +214,20 @@ STATIC mp_obj_t extra_coverage(void) {
 
         // calling gc_nbytes with a non-heap pointer
         mp_printf(&mp_plat_print, "%p\n", gc_nbytes(NULL));
+
+        #if MICROPY_GC_FINALISER_LIST
+        // freeing an object with a finaliser takes it off the finaliser list,
+        // so its finaliser is never called
+        size_t n_fin = MP_STATE_MEM(gc_finaliser_len);
+        mp_obj_ftest_t *f = m_new_obj_with_finaliser(mp_obj_ftest_t);
+        f->base.type = &mp_type_ftest;
+        f->fun = MP_OBJ_FROM_PTR(&mp_builtin_print_obj);
+        f->arg = mp_obj_new_str("finaliser of freed object", 25);
+        mp_printf(&mp_plat_print, "%d\n", (int)(MP_STATE_MEM(gc_finaliser_len) - n_fin));
+        gc_free(f);
+        mp_printf(&mp_plat_print, "%d\n", (int)(MP_STATE_MEM(gc_finaliser_len) - n_fin));
+        gc_collect();
+        #endif
     }
 
     // vstr
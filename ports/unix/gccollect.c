@@ -164,6 +164,74 @@ MP_NOINLINE void gc_collect_regs_and_stack(void) {
     gc_collect_root(regs_ptr, ((uintptr_t)MP_STATE_THREAD(stack_top) - (uintptr_t)&regs) / sizeof(uintptr_t));
 }
 
+#if MICROPY_GC_PARALLEL_MARK
+#include <pthread.h>
+#include <signal.h>
+
+// The helper threads that run the other markers.  Each collection hands out
+// the marker ids 1 to n - 1 to them, and waits until they're all finished.
+STATIC pthread_mutex_t marker_mutex = PTHREAD_MUTEX_INITIALIZER;
+STATIC pthread_cond_t marker_start_cond = PTHREAD_COND_INITIALIZER;
+STATIC pthread_cond_t marker_done_cond = PTHREAD_COND_INITIALIZER;
+STATIC size_t marker_next_id;
+STATIC size_t marker_n;
+STATIC size_t marker_running;
+
+STATIC void *marker_thread(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&marker_mutex);
+    for (;;) {
+        while (marker_next_id >= marker_n) {
+            pthread_cond_wait(&marker_start_cond, &marker_mutex);
+        }
+        size_t id = marker_next_id++;
+        pthread_mutex_unlock(&marker_mutex);
+        gc_mark_worker(id);
+        pthread_mutex_lock(&marker_mutex);
+        if (--marker_running == 0) {
+            pthread_cond_signal(&marker_done_cond);
+        }
+    }
+    return NULL;
+}
+
+// Start the helper threads for n markers, returning how many markers there
+// can be.  Signals are blocked in the helpers so they're handled by the
+// interpreter's threads.
+size_t mp_unix_start_markers(size_t n) {
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    size_t started = 1;
+    for (; started < n; started++) {
+        pthread_t t;
+        if (pthread_create(&t, NULL, marker_thread, NULL) != 0) {
+            break;
+        }
+        pthread_detach(t);
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    return started;
+}
+
+void gc_port_run_markers(size_t n) {
+    pthread_mutex_lock(&marker_mutex);
+    marker_next_id = 1;
+    marker_n = n;
+    marker_running = n - 1;
+    pthread_cond_broadcast(&marker_start_cond);
+    pthread_mutex_unlock(&marker_mutex);
+
+    gc_mark_worker(0);
+
+    pthread_mutex_lock(&marker_mutex);
+    while (marker_running != 0) {
+        pthread_cond_wait(&marker_done_cond, &marker_mutex);
+    }
+    pthread_mutex_unlock(&marker_mutex);
+}
+#endif
+
 void gc_collect(void) {
     //gc_dump_info();
 
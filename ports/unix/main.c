@@ -52,6 +52,10 @@
 #include "genhdr/mpversion.h"
 #include "input.h"
 
+#if MICROPY_GC_SPLIT_HEAP
+#include <sys/mman.h>
+#endif
+
 // Command line options, with their defaults
 STATIC bool compile_only = false;
 STATIC uint emit_opt = MP_EMIT_OPT_NONE;
@@ -60,6 +64,46 @@ STATIC uint emit_opt = MP_EMIT_OPT_NONE;
 // Heap size of GC heap (if enabled)
 // Make it larger on a 64 bit machine, because pointers are larger.
 long heap_size = 1024*1024 * (sizeof(mp_uint_t) / 4);
+#if MICROPY_GC_SPLIT_HEAP
+// Number of separate regions that the GC heap is split into
+STATIC long heap_regions = 1;
+#endif
+#if MICROPY_GC_SPLIT_HEAP_AUTO
+// Size that the GC heap may grow to when it is full (0 to not grow), and its
+// current total size
+STATIC long heap_max = 0;
+STATIC size_t heap_total;
+#endif
+#if MICROPY_GC_PARALLEL_MARK
+// Number of threads to mark the heap with (0 for one per CPU)
+STATIC long gc_threads = 0;
+#endif
+#endif
+
+#if MICROPY_GC_SPLIT_HEAP_AUTO
+void *gc_port_new_region(size_t *len) {
+    // grow by a quarter of the current heap so that a growing program needs
+    // only a few collections to reach its working size, or by enough for the
+    // allocation if that's bigger
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t n = MAX(*len, heap_total / 4);
+    n = (n + page - 1) & ~(page - 1);
+    if (heap_total + n > (size_t)heap_max) {
+        return NULL;
+    }
+    void *region = mmap(NULL, n, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) {
+        return NULL;
+    }
+    heap_total += n;
+    *len = n;
+    return region;
+}
+
+void gc_port_free_region(void *start, size_t len) {
+    munmap(start, len);
+    heap_total -= len;
+}
 #endif
 
 STATIC void stderr_print_strn(void *env, const char *str, size_t len) {
@@ -127,18 +171,27 @@ STATIC int execute_from_lexer(int source_kind, const void *source, mp_parse_inpu
         }
         #endif
 
-        mp_parse_tree_t parse_tree = mp_parse(lex, input_kind);
-
-        #if defined(MICROPY_UNIX_COVERAGE)
-        // allow to print the parse tree in the coverage build
-        if (mp_verbose_flag >= 3) {
-            printf("----------------\n");
-            mp_parse_node_print(parse_tree.root, 0);
-            printf("----------------\n");
-        }
+        mp_obj_t module_fun;
+        #if MICROPY_COMP_STREAMING
+        // the verbose parse tree and bytecode dumps need the whole file compiled at once
+        if (input_kind == MP_PARSE_FILE_INPUT && !is_repl && mp_verbose_flag == 0) {
+            module_fun = mp_compile_lexer(lex, emit_opt);
+        } else
         #endif
+        {
+            mp_parse_tree_t parse_tree = mp_parse(lex, input_kind);
+
+            #if defined(MICROPY_UNIX_COVERAGE)
+            // allow to print the parse tree in the coverage build
+            if (mp_verbose_flag >= 3) {
+                printf("----------------\n");
+                mp_parse_node_print(parse_tree.root, 0);
+                printf("----------------\n");
+            }
+            #endif
 
-        mp_obj_t module_fun = mp_compile(&parse_tree, source_name, emit_opt, is_repl);
+            module_fun = mp_compile(&parse_tree, source_name, emit_opt, is_repl);
+        }
 
         if (!compile_only) {
             // execute it
@@ -321,6 +374,24 @@ STATIC int usage(char **argv) {
 "  heapsize=<n>[w][K|M] -- set the heap size for the GC (default %ld)\n"
 , heap_size);
     impl_opts_cnt++;
+#if MICROPY_GC_SPLIT_HEAP
+    printf(
+"  heapregions=<n> -- split the GC heap into n separately mapped regions\n"
+);
+    impl_opts_cnt++;
+#endif
+#if MICROPY_GC_SPLIT_HEAP_AUTO
+    printf(
+"  heapmax=<n>[w][K|M] -- let the GC heap grow up to this size when full\n"
+);
+    impl_opts_cnt++;
+#endif
+#if MICROPY_GC_PARALLEL_MARK
+    printf(
+"  gcthreads=<n> -- mark the GC heap with up to n threads (default one per CPU)\n"
+);
+    impl_opts_cnt++;
+#endif
 #endif
 
     if (impl_opts_cnt == 0) {
@@ -330,6 +401,45 @@ STATIC int usage(char **argv) {
     return 1;
 }
 
+#if MICROPY_ENABLE_GC
+// Parse a heap size given as <n>[w][K|M], returning false if it's invalid
+STATIC bool parse_heap_size(const char *arg, long *size_out) {
+    char *end;
+    long size = strtol(arg, &end, 0);
+    // Don't bring unneeded libc dependencies like tolower()
+    // If there's 'w' immediately after number, adjust it for
+    // target word size. Note that it should be *before* size
+    // suffix like K or M, to avoid confusion with kilowords,
+    // etc. the size is still in bytes, just can be adjusted
+    // for word size (taking 32bit as baseline).
+    bool word_adjust = false;
+    if ((*end | 0x20) == 'w') {
+        word_adjust = true;
+        end++;
+    }
+    if ((*end | 0x20) == 'k') {
+        size *= 1024;
+    } else if ((*end | 0x20) == 'm') {
+        size *= 1024 * 1024;
+    } else {
+        // Compensate for ++ below
+        --end;
+    }
+    if (*++end != 0) {
+        return false;
+    }
+    if (word_adjust) {
+        size = size * BYTES_PER_WORD / 4;
+    }
+    // If requested size too small, we'll crash anyway
+    if (size < 700) {
+        return false;
+    }
+    *size_out = size;
+    return true;
+}
+#endif
+
 // Process options which set interpreter init options
 STATIC void pre_process_options(int argc, char **argv) {
     for (int a = 1; a < argc; a++) {
@@ -349,37 +459,31 @@ STATIC void pre_process_options(int argc, char **argv) {
                     emit_opt = MP_EMIT_OPT_VIPER;
 #if MICROPY_ENABLE_GC
                 } else if (strncmp(argv[a + 1], "heapsize=", sizeof("heapsize=") - 1) == 0) {
-                    char *end;
-                    heap_size = strtol(argv[a + 1] + sizeof("heapsize=") - 1, &end, 0);
-                    // Don't bring unneeded libc dependencies like tolower()
-                    // If there's 'w' immediately after number, adjust it for
-                    // target word size. Note that it should be *before* size
-                    // suffix like K or M, to avoid confusion with kilowords,
-                    // etc. the size is still in bytes, just can be adjusted
-                    // for word size (taking 32bit as baseline).
-                    bool word_adjust = false;
-                    if ((*end | 0x20) == 'w') {
-                        word_adjust = true;
-                        end++;
-                    }
-                    if ((*end | 0x20) == 'k') {
-                        heap_size *= 1024;
-                    } else if ((*end | 0x20) == 'm') {
-                        heap_size *= 1024 * 1024;
-                    } else {
-                        // Compensate for ++ below
-                        --end;
+                    if (!parse_heap_size(argv[a + 1] + sizeof("heapsize=") - 1, &heap_size)) {
+                        goto invalid_arg;
                     }
-                    if (*++end != 0) {
+#if MICROPY_GC_SPLIT_HEAP_AUTO
+                } else if (strncmp(argv[a + 1], "heapmax=", sizeof("heapmax=") - 1) == 0) {
+                    if (!parse_heap_size(argv[a + 1] + sizeof("heapmax=") - 1, &heap_max)) {
                         goto invalid_arg;
                     }
-                    if (word_adjust) {
-                        heap_size = heap_size * BYTES_PER_WORD / 4;
+#endif
+#if MICROPY_GC_SPLIT_HEAP
+                } else if (strncmp(argv[a + 1], "heapregions=", sizeof("heapregions=") - 1) == 0) {
+                    char *end;
+                    heap_regions = strtol(argv[a + 1] + sizeof("heapregions=") - 1, &end, 0);
+                    if (*end != 0 || heap_regions < 1 || heap_regions > 64) {
+                        goto invalid_arg;
                     }
-                    // If requested size too small, we'll crash anyway
-                    if (heap_size < 700) {
+#endif
+#if MICROPY_GC_PARALLEL_MARK
+                } else if (strncmp(argv[a + 1], "gcthreads=", sizeof("gcthreads=") - 1) == 0) {
+                    char *end;
+                    gc_threads = strtol(argv[a + 1] + sizeof("gcthreads=") - 1, &end, 0);
+                    if (*end != 0 || gc_threads < 1 || gc_threads > MICROPY_GC_PARALLEL_MARK) {
                         goto invalid_arg;
                     }
+#endif
 #endif
                 } else {
 invalid_arg:
@@ -439,8 +543,41 @@ MP_NOINLINE int main_(int argc, char **argv) {
     pre_process_options(argc, argv);
 
 #if MICROPY_ENABLE_GC
+    #if MICROPY_GC_SPLIT_HEAP
+    // The first region comes from malloc and the rest are mapped separately,
+    // each a bit bigger than the last so the GC has to order them.
+    long region_size = heap_size / heap_regions;
+    char *heap = malloc(region_size);
+    gc_init(heap, heap + region_size);
+    for (long i = 1; i < heap_regions; i++) {
+        size_t len = region_size + i * 256;
+        void *region = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (region == MAP_FAILED) {
+            perror("heapregions");
+            return 1;
+        }
+        gc_add_region(region, (char*)region + len);
+    }
+    #else
     char *heap = malloc(heap_size);
     gc_init(heap, heap + heap_size);
+    #endif
+    #if MICROPY_GC_SPLIT_HEAP_AUTO
+    heap_total = heap_size;
+    #endif
+    #if MICROPY_GC_PARALLEL_MARK
+    // the other markers are only used once the heap is big enough
+    long heap_limit = heap_size;
+    #if MICROPY_GC_SPLIT_HEAP_AUTO
+    heap_limit = MAX(heap_limit, heap_max);
+    #endif
+    if (heap_limit >= MICROPY_GC_PARALLEL_MARK_MIN_HEAP) {
+        if (gc_threads == 0) {
+            gc_threads = MIN(sysconf(_SC_NPROCESSORS_ONLN), MICROPY_GC_PARALLEL_MARK);
+        }
+        gc_set_mark_threads(mp_unix_start_markers(gc_threads));
+    }
+    #endif
 #endif
 
     #if MICROPY_ENABLE_PYSTACK
@@ -513,6 +650,8 @@ MP_NOINLINE int main_(int argc, char **argv) {
     {
         MP_DECLARE_CONST_FUN_OBJ_0(extra_coverage_obj);
         mp_store_global(QSTR_FROM_STR_STATIC("extra_coverage"), MP_OBJ_FROM_PTR(&extra_coverage_obj));
+        extern const mp_obj_type_t mp_type_ftest;
+        mp_store_global(MP_QSTR_FinaliserTest, MP_OBJ_FROM_PTR(&mp_type_ftest));
     }
     #endif
 
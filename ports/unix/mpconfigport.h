@@ -28,6 +28,9 @@
 
 #define MICROPY_ALLOC_PATH_MAX      (PATH_MAX)
 #define MICROPY_PERSISTENT_CODE_LOAD (1)
+#define MICROPY_PERSISTENT_CODE_XIP (1)
+#define MICROPY_PERSISTENT_CODE_LAZY (1)
+#define MICROPY_PERSISTENT_CODE_LAZY_LINES (1)
 #if !defined(MICROPY_EMIT_X64) && defined(__x86_64__)
     #define MICROPY_EMIT_X64        (1)
 #endif
@@ -46,9 +49,19 @@
 #define MICROPY_COMP_MODULE_CONST   (1)
 #define MICROPY_COMP_TRIPLE_TUPLE_ASSIGN (1)
 #define MICROPY_COMP_RETURN_IF_EXPR (1)
+#define MICROPY_COMP_STREAMING      (1)
 #define MICROPY_ENABLE_GC           (1)
 #define MICROPY_ENABLE_FINALISER    (1)
+#define MICROPY_GC_SPLIT_HEAP       (1)
+#define MICROPY_GC_SPLIT_HEAP_AUTO  (1)
+#define MICROPY_GC_SIZE_CLASSES     (8)
+#define MICROPY_GC_FINALISER_LIST   (1)
+#if MICROPY_PY_THREAD
+#define MICROPY_GC_PARALLEL_MARK    (16)
+#endif
 #define MICROPY_STACK_CHECK         (1)
+#define MICROPY_ENABLE_PYSTACK      (1)
+#define MICROPY_PYSTACK_GROW        (1)
 #define MICROPY_MALLOC_USES_ALLOCATED_SIZE (1)
 #define MICROPY_MEM_STATS           (1)
 #define MICROPY_DEBUG_PRINTERS      (1)
@@ -70,13 +83,20 @@
 #ifndef MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE
 #define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE (1)
 #endif
+#define MICROPY_OPT_MAP_COMPACT     (1)
+#define MICROPY_OPT_GEN_RECYCLE     (1)
 #define MICROPY_CAN_OVERRIDE_BUILTINS (1)
 #define MICROPY_PY_FUNCTION_ATTRS   (1)
 #define MICROPY_PY_DESCRIPTORS      (1)
+#define MICROPY_PY_INSTANCE_SHAPES  (1)
+#define MICROPY_PY_SLOTS            (1)
 #define MICROPY_PY_BUILTINS_STR_UNICODE (1)
+#define MICROPY_PY_BUILTINS_STR_UNICODE_INDEX (2)
 #define MICROPY_PY_BUILTINS_STR_CENTER (1)
 #define MICROPY_PY_BUILTINS_STR_PARTITION (1)
 #define MICROPY_PY_BUILTINS_STR_SPLITLINES (1)
+#define MICROPY_PY_STR_SLICE_VIEW   (1)
+#define MICROPY_PY_STR_INPLACE_CONCAT (1)
 #define MICROPY_PY_BUILTINS_MEMORYVIEW (1)
 #define MICROPY_PY_BUILTINS_FROZENSET (1)
 #define MICROPY_PY_BUILTINS_COMPILE (1)
@@ -169,6 +189,8 @@ extern const struct _mp_print_t mp_stderr_print;
 
 #define MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF   (1)
 #define MICROPY_EMERGENCY_EXCEPTION_BUF_SIZE  (256)
+#define MICROPY_EXC_TRACEBACK_BUF   (16)
+#define MICROPY_OSERROR_PREALLOC    (1)
 #define MICROPY_KBD_EXCEPTION       (1)
 #define MICROPY_ASYNC_KBD_INTR      (1)
 
@@ -256,8 +278,13 @@ typedef long mp_off_t;
 void mp_unix_alloc_exec(size_t min_size, void** ptr, size_t *size);
 void mp_unix_free_exec(void *ptr, size_t size);
 void mp_unix_mark_exec(void);
+size_t mp_unix_start_markers(size_t n);
 #define MP_PLAT_ALLOC_EXEC(min_size, ptr, size) mp_unix_alloc_exec(min_size, ptr, size)
 #define MP_PLAT_FREE_EXEC(ptr, size) mp_unix_free_exec(ptr, size)
+const void *mp_unix_map_file(const char *filename, size_t *len);
+void mp_unix_unmap_file(const void *ptr, size_t len);
+#define MP_PLAT_MAP_FILE(filename, len) mp_unix_map_file(filename, len)
+#define MP_PLAT_UNMAP_FILE(ptr, len) mp_unix_unmap_file(ptr, len)
 #ifndef MICROPY_FORCE_PLAT_ALLOC_EXEC
 // Use MP_PLAT_ALLOC_EXEC for any executable memory allocation, including for FFI
 // (overriding libffi own implementation)
@@ -321,6 +348,12 @@ void mp_unix_mark_exec(void);
 #define _DIRENT_HAVE_D_INO (1)
 #endif
 
+#if MICROPY_GC_PARALLEL_MARK
+// Let the other markers run while one is waiting for work
+#include <sched.h>
+#define MICROPY_GC_PARALLEL_MARK_YIELD() sched_yield()
+#endif
+
 #ifndef __APPLE__
 // For debugging purposes, make printf() available to any source file.
 #include <stdio.h>
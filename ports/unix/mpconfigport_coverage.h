@@ -35,7 +35,11 @@
 #define MICROPY_OPT_MATH_FACTORIAL     (1)
 #define MICROPY_FLOAT_HIGH_QUALITY_HASH (1)
 #define MICROPY_ENABLE_SCHEDULER       (1)
+#define MICROPY_GC_FINALISER_DEFERRED  (1)
 #define MICROPY_READER_VFS             (1)
+#define MICROPY_PERSISTENT_CODE_SAVE   (1)
+#define MICROPY_PERSISTENT_CODE_CACHE  (1)
+#define MICROPY_VFS_IMPORT_CACHE       (64)
 #define MICROPY_WARNINGS_CATEGORY      (1)
 #define MICROPY_MODULE_GETATTR         (1)
 #define MICROPY_PY_DELATTR_SETATTR     (1)
@@ -47,7 +47,9 @@ typedef struct _thread_t {
     struct _thread_t *next;
 } thread_t;
 
-STATIC pthread_key_t tls_key;
+// the state of the current thread; a compiler TLS variable is much quicker to
+// get at than a pthread key, and the pystack makes heavy use of it
+STATIC __thread mp_state_thread_t *tls_state;
 
 // the mutex controls access to the linked list
 STATIC pthread_mutex_t thread_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -73,7 +75,9 @@ STATIC void mp_thread_gc(int signo, siginfo_t *info, void *context) {
         // that we don't need the extra information, enough is captured by the
         // gc_collect_regs_and_stack function above
         //gc_collect_root((void**)context, sizeof(ucontext_t) / sizeof(uintptr_t));
-        #if MICROPY_ENABLE_PYSTACK
+        #if MICROPY_PYSTACK_GROW
+        mp_pystack_gc_collect();
+        #elif MICROPY_ENABLE_PYSTACK
         void **ptrs = (void**)(void*)MP_STATE_THREAD(pystack_start);
         gc_collect_root(ptrs, (MP_STATE_THREAD(pystack_cur) - MP_STATE_THREAD(pystack_start)) / sizeof(void*));
         #endif
@@ -86,8 +90,7 @@ STATIC void mp_thread_gc(int signo, siginfo_t *info, void *context) {
 }
 
 void mp_thread_init(void) {
-    pthread_key_create(&tls_key, NULL);
-    pthread_setspecific(tls_key, &mp_state_ctx.thread);
+    tls_state = &mp_state_ctx.thread;
 
     // create first entry in linked list of all threads
     thread = malloc(sizeof(thread_t));
@@ -155,11 +158,11 @@ void mp_thread_gc_others(void) {
 }
 
 mp_state_thread_t *mp_thread_get_state(void) {
-    return (mp_state_thread_t*)pthread_getspecific(tls_key);
+    return tls_state;
 }
 
 void mp_thread_set_state(void *state) {
-    pthread_setspecific(tls_key, state);
+    tls_state = state;
 }
 
 void mp_thread_start(void) {
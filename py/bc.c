@@ -32,6 +32,7 @@
 #include "py/runtime.h"
 #include "py/bc0.h"
 #include "py/bc.h"
+#include "py/persistentcode.h"
 
 #if MICROPY_DEBUG_VERBOSE // print debugging info
 #define DEBUG_PRINT (1)
@@ -112,6 +113,17 @@ void mp_setup_code_state(mp_code_state_t *code_state, size_t n_args, size_t n_kw
     // get the function object that we want to set up (could be bytecode or native code)
     mp_obj_fun_bc_t *self = code_state->fun_bc;
 
+    #if MICROPY_PERSISTENT_CODE_LAZY
+    if (MP_UNLIKELY((uintptr_t)self->qstr_table & 1)) {
+        // first call of a lazily loaded function, see mp_make_function_from_raw_code
+        mp_raw_code_t *rc = (mp_raw_code_t*)self->const_table;
+        mp_raw_code_load_lazy(rc);
+        self->bytecode = rc->fun_data;
+        self->const_table = rc->const_table;
+        self->qstr_table = rc->qstr_table;
+    }
+    #endif
+
     // ip comes in as an offset into bytecode, so turn it into a true pointer
     code_state->ip = self->bytecode + (size_t)code_state->ip;
 
@@ -178,27 +190,31 @@ void mp_setup_code_state(mp_code_state_t *code_state, size_t n_args, size_t n_kw
         DEBUG_printf("Initial args: ");
         dump_args(code_state->state + n_state - n_pos_args - n_kwonly_args, n_pos_args + n_kwonly_args);
 
+        // the dict for **kwargs is only created once an unmatched keyword is
+        // found, so it can be sized for the remaining keywords
         mp_obj_t dict = MP_OBJ_NULL;
-        if ((scope_flags & MP_SCOPE_FLAG_VARKEYWORDS) != 0) {
-            dict = mp_obj_new_dict(n_kw); // TODO: better go conservative with 0?
-            *var_pos_kw_args = dict;
-        }
 
         // get pointer to arg_names array
         const mp_obj_t *arg_names = (const mp_obj_t*)self->const_table;
 
+        // keywords are usually passed in the same order as they are declared,
+        // so first try the name just after the previous match
+        size_t n_names = n_pos_args + n_kwonly_args;
+        size_t j = 0;
         for (size_t i = 0; i < n_kw; i++) {
             // the keys in kwargs are expected to be qstr objects
             mp_obj_t wanted_arg_name = kwargs[2 * i];
-            for (size_t j = 0; j < n_pos_args + n_kwonly_args; j++) {
-                if (wanted_arg_name == arg_names[j]) {
-                    if (code_state->state[n_state - 1 - j] != MP_OBJ_NULL) {
-                        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_TypeError,
-                            "function got multiple values for argument '%q'", MP_OBJ_QSTR_VALUE(wanted_arg_name)));
-                    }
-                    code_state->state[n_state - 1 - j] = kwargs[2 * i + 1];
-                    goto continue2;
+            if (j >= n_names || wanted_arg_name != arg_names[j]) {
+                for (j = 0; j < n_names && wanted_arg_name != arg_names[j]; j++) {
+                }
+            }
+            if (j < n_names) {
+                if (code_state->state[n_state - 1 - j] != MP_OBJ_NULL) {
+                    nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_TypeError,
+                        "function got multiple values for argument '%q'", MP_OBJ_QSTR_VALUE(wanted_arg_name)));
                 }
+                code_state->state[n_state - 1 - j++] = kwargs[2 * i + 1];
+                continue;
             }
             // Didn't find name match with positional args
             if ((scope_flags & MP_SCOPE_FLAG_VARKEYWORDS) == 0) {
@@ -209,8 +225,15 @@ void mp_setup_code_state(mp_code_state_t *code_state, size_t n_args, size_t n_kw
                         "unexpected keyword argument '%q'", MP_OBJ_QSTR_VALUE(wanted_arg_name)));
                 }
             }
+            if (dict == MP_OBJ_NULL) {
+                dict = mp_obj_new_dict(n_kw - i);
+                *var_pos_kw_args = dict;
+            }
             mp_obj_dict_store(dict, kwargs[2 * i], kwargs[2 * i + 1]);
-continue2:;
+        }
+
+        if (dict == MP_OBJ_NULL && (scope_flags & MP_SCOPE_FLAG_VARKEYWORDS) != 0) {
+            *var_pos_kw_args = mp_obj_new_dict(0);
         }
 
         DEBUG_printf("Args with kws flattened: ");
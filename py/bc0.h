@@ -105,6 +105,10 @@
 #define MP_BC_CALL_METHOD           (0x66) // uint
 #define MP_BC_CALL_METHOD_VAR_KW    (0x67) // uint
 
+// Flag in the uint argument of MP_BC_CALL_FUNCTION, set when the only argument
+// is a generator expression that is referenced from nowhere else
+#define MP_BC_CALL_FLAG_TEMP_GEN    (0x10000)
+
 #define MP_BC_IMPORT_NAME        (0x68) // qstr
 #define MP_BC_IMPORT_FROM        (0x69) // qstr
 #define MP_BC_IMPORT_STAR        (0x6a)
@@ -181,6 +181,47 @@ STATIC void do_execute_raw_code(mp_obj_t module_obj, mp_raw_code_t *raw_code) {
 }
 #endif
 
+#if MICROPY_PERSISTENT_CODE_CACHE
+// Load a .py file from its compiled copy, first making the copy if there is
+// none or the source has changed since it was made
+STATIC void do_load_cached(mp_obj_t module_obj, const char *file_str, size_t file_len) {
+    uint32_t stamp[2];
+    if (!mp_raw_code_cache_stamp(file_str, stamp)) {
+        do_load_from_lexer(module_obj, mp_lexer_new_from_file(file_str));
+        return;
+    }
+
+    // foo.py is cached in foo.mpc
+    vstr_t cache;
+    vstr_init(&cache, file_len + 1);
+    vstr_add_strn(&cache, file_str, file_len - 2);
+    vstr_add_str(&cache, "mpc");
+    const char *cache_str = vstr_null_terminated_str(&cache);
+
+    qstr source_name = qstr_from_strn(file_str, file_len);
+    mp_raw_code_t *raw_code = mp_raw_code_load_cache(cache_str, stamp);
+    if (raw_code == NULL) {
+        mp_lexer_t *lex = mp_lexer_new_from_file(file_str);
+        source_name = lex->source_name;
+        #if MICROPY_COMP_STREAMING
+        raw_code = mp_compile_lexer_to_raw_code(lex, MP_EMIT_OPT_NONE);
+        #else
+        mp_parse_tree_t parse_tree = mp_parse(lex, MP_PARSE_FILE_INPUT);
+        raw_code = mp_compile_to_raw_code(&parse_tree, source_name, MP_EMIT_OPT_NONE, false);
+        #endif
+        mp_raw_code_save_cache(raw_code, cache_str, stamp);
+    }
+    vstr_clear(&cache);
+
+    #if MICROPY_PY___FILE__
+    mp_store_attr(module_obj, MP_QSTR___file__, MP_OBJ_NEW_QSTR(source_name));
+    #else
+    (void)source_name;
+    #endif
+    do_execute_raw_code(module_obj, raw_code);
+}
+#endif
+
 STATIC void do_load(mp_obj_t module_obj, vstr_t *file) {
     #if MICROPY_MODULE_FROZEN || MICROPY_ENABLE_COMPILER || (MICROPY_PERSISTENT_CODE_LOAD && MICROPY_HAS_FILE_READER)
     char *file_str = vstr_null_terminated_str(file);
@@ -224,8 +265,12 @@ STATIC void do_load(mp_obj_t module_obj, vstr_t *file) {
     // If we can compile scripts then load the file and compile and execute it.
     #if MICROPY_ENABLE_COMPILER
     {
+        #if MICROPY_PERSISTENT_CODE_CACHE
+        do_load_cached(module_obj, file_str, file->len);
+        #else
         mp_lexer_t *lex = mp_lexer_new_from_file(file_str);
         do_load_from_lexer(module_obj, lex);
+        #endif
         return;
     }
     #else
@@ -174,6 +174,9 @@ typedef struct _compiler_t {
 
     scope_t *scope_head;
     scope_t *scope_cur;
+    #if MICROPY_COMP_STREAMING
+    scope_t *scope_early; // scopes of definitions that were compiled early
+    #endif
 
     emit_t *emit;                                   // current emitter
     #if NEED_METHOD_TABLE
@@ -767,8 +770,8 @@ STATIC void compile_funcdef_lambdef(compiler_t *comp, scope_t *scope, mp_parse_n
 // leaves function object on stack
 // returns function name
 STATIC qstr compile_funcdef_helper(compiler_t *comp, mp_parse_node_struct_t *pns, uint emit_options) {
-    if (comp->pass == MP_PASS_SCOPE) {
-        // create a new scope for this function
+    if (comp->pass == MP_PASS_SCOPE && pns->nodes[4] == MP_PARSE_NODE_NULL) {
+        // create a new scope for this function (unless it was compiled early)
         scope_t *s = scope_new_and_link(comp, SCOPE_FUNCTION, (mp_parse_node_t)pns, emit_options);
         // store the function scope so the compiling function can use it at each pass
         pns->nodes[4] = (mp_parse_node_t)s;
@@ -787,8 +790,8 @@ STATIC qstr compile_funcdef_helper(compiler_t *comp, mp_parse_node_struct_t *pns
 // leaves class object on stack
 // returns class name
 STATIC qstr compile_classdef_helper(compiler_t *comp, mp_parse_node_struct_t *pns, uint emit_options) {
-    if (comp->pass == MP_PASS_SCOPE) {
-        // create a new scope for this class
+    if (comp->pass == MP_PASS_SCOPE && pns->nodes[3] == MP_PARSE_NODE_NULL) {
+        // create a new scope for this class (unless it was compiled early)
         scope_t *s = scope_new_and_link(comp, SCOPE_CLASS, (mp_parse_node_t)pns, emit_options);
         // store the class scope so the compiling function can use it at each pass
         pns->nodes[3] = (mp_parse_node_t)s;
@@ -2094,8 +2097,8 @@ STATIC void compile_test_if_expr(compiler_t *comp, mp_parse_node_struct_t *pns)
 }
 
 STATIC void compile_lambdef(compiler_t *comp, mp_parse_node_struct_t *pns) {
-    if (comp->pass == MP_PASS_SCOPE) {
-        // create a new scope for this lambda
+    if (comp->pass == MP_PASS_SCOPE && pns->nodes[2] == MP_PARSE_NODE_NULL) {
+        // create a new scope for this lambda (unless it was compiled early)
         scope_t *s = scope_new_and_link(comp, SCOPE_LAMBDA, (mp_parse_node_t)pns, comp->scope_cur->emit_options);
         // store the lambda scope so the compiling function (this one) can use it at each pass
         pns->nodes[2] = (mp_parse_node_t)s;
@@ -2352,6 +2355,7 @@ STATIC void compile_trailer_paren_helper(compiler_t *comp, mp_parse_node_t pn_ar
     int n_positional = n_positional_extra;
     uint n_keyword = 0;
     uint star_flags = 0;
+    uint call_flags = 0;
     mp_parse_node_struct_t *star_args_node = NULL, *dblstar_args_node = NULL;
     for (int i = 0; i < n_args; i++) {
         if (MP_PARSE_NODE_IS_STRUCT(args[i])) {
@@ -2382,6 +2386,15 @@ STATIC void compile_trailer_paren_helper(compiler_t *comp, mp_parse_node_t pn_ar
                 } else {
                     compile_comprehension(comp, pns_arg, SCOPE_GEN_EXPR);
                     n_positional++;
+                    #if MICROPY_OPT_GEN_RECYCLE
+                    // a sole generator-expression argument to a plain function call is
+                    // only referenced from the stack, so the VM may free it after the call
+                    if (n_args == 1 && n_positional_extra == 0 && !is_method_call
+                        && comp->scope_cur->emit_options != MP_EMIT_OPT_NATIVE_PYTHON
+                        && comp->scope_cur->emit_options != MP_EMIT_OPT_VIPER) {
+                        call_flags = MP_EMIT_CALL_FLAG_TEMP_GEN;
+                    }
+                    #endif
                 }
             } else {
                 goto normal_argument;
@@ -2420,7 +2433,7 @@ STATIC void compile_trailer_paren_helper(compiler_t *comp, mp_parse_node_t pn_ar
     if (is_method_call) {
         EMIT_ARG(call_method, n_positional, n_keyword, star_flags);
     } else {
-        EMIT_ARG(call_function, n_positional, n_keyword, star_flags);
+        EMIT_ARG(call_function, n_positional, n_keyword, star_flags | call_flags);
     }
 }
 
@@ -2430,8 +2443,8 @@ STATIC void compile_comprehension(compiler_t *comp, mp_parse_node_struct_t *pns,
     assert(MP_PARSE_NODE_IS_STRUCT_KIND(pns->nodes[1], PN_comp_for));
     mp_parse_node_struct_t *pns_comp_for = (mp_parse_node_struct_t*)pns->nodes[1];
 
-    if (comp->pass == MP_PASS_SCOPE) {
-        // create a new scope for this comprehension
+    if (comp->pass == MP_PASS_SCOPE && pns_comp_for->nodes[3] == MP_PARSE_NODE_NULL) {
+        // create a new scope for this comprehension (unless it was compiled early)
         scope_t *s = scope_new_and_link(comp, kind, (mp_parse_node_t)pns, comp->scope_cur->emit_options);
         // store the comprehension scope so the compiling function (this one) can use it at each pass
         pns_comp_for->nodes[3] = (mp_parse_node_t)s;
@@ -3431,22 +3444,8 @@ STATIC void scope_compute_things(scope_t *scope) {
     }
 }
 
-#if !MICROPY_PERSISTENT_CODE_SAVE
-STATIC
-#endif
-mp_raw_code_t *mp_compile_to_raw_code(mp_parse_tree_t *parse_tree, qstr source_file, uint emit_opt, bool is_repl) {
-    // put compiler state on the stack, it's relatively small
-    compiler_t comp_state = {0};
-    compiler_t *comp = &comp_state;
-
-    comp->source_file = source_file;
-    comp->is_repl = is_repl;
-    comp->break_label = INVALID_LABEL;
-    comp->continue_label = INVALID_LABEL;
-
-    // create the module scope
-    scope_t *module_scope = scope_new_and_link(comp, SCOPE_MODULE, parse_tree->root, emit_opt);
-
+// compile all scopes in the list starting at comp->scope_head
+STATIC void compile_scopes(compiler_t *comp) {
     // create standard emitter; it's used at least for MP_PASS_SCOPE
     emit_t *emit_bc = emit_bc_new();
 
@@ -3578,8 +3577,26 @@ mp_raw_code_t *mp_compile_to_raw_code(mp_parse_tree_t *parse_tree, qstr source_f
     #if MICROPY_EMIT_INLINE_ASM
     if (comp->emit_inline_asm != NULL) {
         ASM_EMITTER(free)(comp->emit_inline_asm);
+        comp->emit_inline_asm = NULL;
     }
     #endif
+}
+
+STATIC void compiler_init(compiler_t *comp, qstr source_file, bool is_repl) {
+    comp->source_file = source_file;
+    comp->is_repl = is_repl;
+    comp->break_label = INVALID_LABEL;
+    comp->continue_label = INVALID_LABEL;
+}
+
+STATIC mp_raw_code_t *compile_module(compiler_t *comp, mp_parse_tree_t *parse_tree) {
+    scope_t *module_scope = comp->scope_head;
+    module_scope->pn = parse_tree->root;
+
+    // the error may already be set if a definition was compiled early
+    if (comp->compile_error == MP_OBJ_NULL) {
+        compile_scopes(comp);
+    }
 
     // free the parse tree
     mp_parse_tree_clear(parse_tree);
@@ -3591,6 +3608,13 @@ mp_raw_code_t *mp_compile_to_raw_code(mp_parse_tree_t *parse_tree, qstr source_f
         scope_free(s);
         s = next;
     }
+    #if MICROPY_COMP_STREAMING
+    for (scope_t *s = comp->scope_early; s;) {
+        scope_t *next = s->next;
+        scope_free(s);
+        s = next;
+    }
+    #endif
 
     if (comp->compile_error != MP_OBJ_NULL) {
         nlr_raise(comp->compile_error);
@@ -3599,6 +3623,120 @@ mp_raw_code_t *mp_compile_to_raw_code(mp_parse_tree_t *parse_tree, qstr source_f
     }
 }
 
+#if !MICROPY_PERSISTENT_CODE_SAVE
+STATIC
+#endif
+mp_raw_code_t *mp_compile_to_raw_code(mp_parse_tree_t *parse_tree, qstr source_file, uint emit_opt, bool is_repl) {
+    // put compiler state on the stack, it's relatively small
+    compiler_t comp_state = {0};
+    compiler_t *comp = &comp_state;
+    compiler_init(comp, source_file, is_repl);
+
+    // create the module scope
+    scope_new_and_link(comp, SCOPE_MODULE, parse_tree->root, emit_opt);
+
+    return compile_module(comp, parse_tree);
+}
+
+#if MICROPY_COMP_STREAMING
+// Compiles a top-level def or class of a module while the rest of the module
+// is still being parsed.  The scope of the definition (and of any lambdas in
+// its default arguments, decorators and base classes) is kept until the
+// module is compiled, but its body is freed by the parser.
+STATIC bool compile_definition_early(void *env, mp_parse_node_t pn) {
+    compiler_t *comp = env;
+    if (comp->compile_error != MP_OBJ_NULL || !MP_PARSE_NODE_IS_STRUCT(pn)) {
+        return false;
+    }
+
+    // find the def or class
+    mp_parse_node_struct_t *pns = (mp_parse_node_struct_t*)pn;
+    if (MP_PARSE_NODE_STRUCT_KIND(pns) == PN_decorated) {
+        pns = (mp_parse_node_struct_t*)pns->nodes[1];
+        #if MICROPY_PY_ASYNC_AWAIT
+        if (MP_PARSE_NODE_STRUCT_KIND(pns) == PN_async_funcdef) {
+            pns = (mp_parse_node_struct_t*)pns->nodes[0];
+        }
+        #endif
+    #if MICROPY_PY_ASYNC_AWAIT
+    } else if (MP_PARSE_NODE_STRUCT_KIND(pns) == PN_async_stmt) {
+        pns = (mp_parse_node_struct_t*)pns->nodes[0];
+    #endif
+    }
+    if (MP_PARSE_NODE_STRUCT_KIND(pns) != PN_funcdef && MP_PARSE_NODE_STRUCT_KIND(pns) != PN_classdef) {
+        return false;
+    }
+
+    // run the scope pass of the module over this statement, which creates the new scopes
+    scope_t *module_scope = comp->scope_head;
+    emit_t *emit_bc = emit_bc_new();
+    comp->emit = emit_bc;
+    #if MICROPY_EMIT_NATIVE
+    comp->emit_method_table = &emit_bc_method_table;
+    #endif
+    comp->pass = MP_PASS_SCOPE;
+    comp->scope_cur = module_scope;
+    EMIT_ARG(start_pass, MP_PASS_SCOPE, module_scope);
+    compile_node(comp, pn);
+    emit_bc_free(emit_bc);
+
+    // compile the new scopes on their own
+    scope_t *first = module_scope->next;
+    module_scope->next = NULL;
+    comp->scope_head = first;
+    compile_scopes(comp);
+    comp->scope_head = module_scope;
+
+    // keep the scopes that the module refers to, and free the rest
+    for (scope_t *s = first; s != NULL;) {
+        scope_t *next = s->next;
+        if (s->parent == module_scope) {
+            m_del(id_info_t, s->id_info, s->id_info_alloc);
+            s->id_info = NULL;
+            s->id_info_alloc = 0;
+            s->id_info_len = 0;
+            s->pn = MP_PARSE_NODE_NULL;
+            s->next = comp->scope_early;
+            comp->scope_early = s;
+        } else {
+            scope_free(s);
+        }
+        s = next;
+    }
+
+    if (comp->compile_error != MP_OBJ_NULL) {
+        return false;
+    }
+
+    // the module only needs the name, arguments and bases of the definition
+    if (MP_PARSE_NODE_STRUCT_KIND(pns) == PN_funcdef) {
+        pns->nodes[2] = MP_PARSE_NODE_NULL; // return annotation
+        pns->nodes[3] = MP_PARSE_NODE_NULL; // body
+    } else {
+        pns->nodes[2] = MP_PARSE_NODE_NULL; // body
+    }
+    return true;
+}
+
+mp_raw_code_t *mp_compile_lexer_to_raw_code(mp_lexer_t *lex, uint emit_opt) {
+    compiler_t comp_state = {0};
+    compiler_t *comp = &comp_state;
+    compiler_init(comp, lex->source_name, false);
+
+    // create the module scope; its parse node is set once parsing is finished
+    scope_new_and_link(comp, SCOPE_MODULE, MP_PARSE_NODE_NULL, emit_opt);
+
+    mp_parse_tree_t parse_tree = mp_parse_streaming(lex, MP_PARSE_FILE_INPUT, compile_definition_early, comp);
+    return compile_module(comp, &parse_tree);
+}
+
+mp_obj_t mp_compile_lexer(mp_lexer_t *lex, uint emit_opt) {
+    mp_raw_code_t *rc = mp_compile_lexer_to_raw_code(lex, emit_opt);
+    // return function that executes the outer module
+    return mp_make_function_from_raw_code(rc, MP_OBJ_NULL, MP_OBJ_NULL);
+}
+#endif
+
 mp_obj_t mp_compile(mp_parse_tree_t *parse_tree, qstr source_file, uint emit_opt, bool is_repl) {
     mp_raw_code_t *rc = mp_compile_to_raw_code(parse_tree, source_file, emit_opt, is_repl);
     // return function that executes the outer module
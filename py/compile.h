@@ -39,6 +39,13 @@ mp_obj_t mp_compile(mp_parse_tree_t *parse_tree, qstr source_file, uint emit_opt
 mp_raw_code_t *mp_compile_to_raw_code(mp_parse_tree_t *parse_tree, qstr source_file, uint emit_opt, bool is_repl);
 #endif
 
+#if MICROPY_COMP_STREAMING
+// parse and compile file input, compiling each top-level def/class as soon as it's parsed
+// these have the same semantics as mp_compile, and they free the lexer
+mp_obj_t mp_compile_lexer(mp_lexer_t *lex, uint emit_opt);
+mp_raw_code_t *mp_compile_lexer_to_raw_code(mp_lexer_t *lex, uint emit_opt);
+#endif
+
 // this is implemented in runtime.c
 mp_obj_t mp_parse_compile_execute(mp_lexer_t *lex, mp_parse_input_kind_t parse_input_kind, mp_obj_dict_t *globals, mp_obj_dict_t *locals);
 
@@ -48,6 +48,7 @@ typedef enum {
 
 #define MP_EMIT_STAR_FLAG_SINGLE (0x01)
 #define MP_EMIT_STAR_FLAG_DOUBLE (0x02)
+#define MP_EMIT_CALL_FLAG_TEMP_GEN (0x04) // bytecode emitter only
 
 #define MP_EMIT_BREAK_FROM_FOR (0x8000)
 
@@ -39,6 +39,13 @@
 #define BYTES_FOR_INT ((BYTES_PER_WORD * 8 + 6) / 7)
 #define DUMMY_DATA_SIZE (BYTES_FOR_INT)
 
+#if MICROPY_COMP_PEEPHOLE
+// maximum number of labels at the same offset that can be threaded to a jump
+#define LABEL_RUN_MAX (4)
+// marks a label as a finally handler until the label is assigned
+#define LABEL_IS_FINALLY ((mp_uint_t)-1)
+#endif
+
 struct _emit_t {
     // Accessed as mp_obj_t, so must be aligned as such, and we rely on the
     // memory allocator returning a suitably aligned pointer.
@@ -58,6 +65,15 @@ struct _emit_t {
     mp_uint_t max_num_labels;
     mp_uint_t *label_offsets;
 
+    #if MICROPY_COMP_PEEPHOLE
+    bool unreachable; // set after an unconditional jump until the next label
+    uint8_t label_run_len;
+    mp_uint_t label_run[LABEL_RUN_MAX]; // labels assigned at label_run_offset
+    size_t label_run_offset;
+    size_t removable_push_offset; // offset of a push with no side effects, or -1
+    mp_uint_t *label_alias; // label that each label can be threaded to
+    #endif
+
     size_t code_info_offset;
     size_t code_info_size;
     size_t bytecode_offset;
@@ -80,10 +96,16 @@ emit_t *emit_bc_new(void) {
 void emit_bc_set_max_num_labels(emit_t *emit, mp_uint_t max_num_labels) {
     emit->max_num_labels = max_num_labels;
     emit->label_offsets = m_new(mp_uint_t, emit->max_num_labels);
+    #if MICROPY_COMP_PEEPHOLE
+    emit->label_alias = m_new(mp_uint_t, emit->max_num_labels);
+    #endif
 }
 
 void emit_bc_free(emit_t *emit) {
     m_del(mp_uint_t, emit->label_offsets, emit->max_num_labels);
+    #if MICROPY_COMP_PEEPHOLE
+    m_del(mp_uint_t, emit->label_alias, emit->max_num_labels);
+    #endif
     m_del_obj(emit_t, emit);
 }
 
@@ -171,6 +193,12 @@ STATIC void emit_write_code_info_bytes_lines(emit_t *emit, mp_uint_t bytes_to_sk
 // all functions must go through this one to emit byte code
 STATIC byte *emit_get_cur_to_write_bytecode(emit_t *emit, int num_bytes_to_write) {
     //printf("emit %d\n", num_bytes_to_write);
+    #if MICROPY_COMP_PEEPHOLE
+    if (emit->unreachable) {
+        // code that can't be reached is not stored
+        return emit->dummy_data;
+    }
+    #endif
     if (emit->pass < MP_PASS_EMIT) {
         emit->bytecode_offset += num_bytes_to_write;
         return emit->dummy_data;
@@ -298,6 +326,13 @@ STATIC void emit_write_bytecode_byte_signed_label(emit_t *emit, byte b1, mp_uint
     if (emit->pass < MP_PASS_EMIT) {
         bytecode_offset = 0;
     } else {
+        #if MICROPY_COMP_PEEPHOLE
+        // jump straight to the final destination of a chain of jumps; the
+        // number of steps is limited in case the jumps form a loop
+        for (int i = 0; i < 8 && emit->label_alias[label] != label; ++i) {
+            label = emit->label_alias[label];
+        }
+        #endif
         bytecode_offset = emit->label_offsets[label] - emit->bytecode_offset - 3 + 0x8000;
     }
     byte *c = emit_get_cur_to_write_bytecode(emit, 3);
@@ -313,6 +348,11 @@ void mp_emit_bc_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scope) {
     emit->scope = scope;
     emit->last_source_line_offset = 0;
     emit->last_source_line = 1;
+    #if MICROPY_COMP_PEEPHOLE
+    emit->unreachable = false;
+    emit->label_run_len = 0;
+    emit->removable_push_offset = (size_t)-1;
+    #endif
     #ifndef NDEBUG
     // With debugging enabled labels are checked for unique assignment
     if (pass < MP_PASS_EMIT && emit->label_offsets != NULL) {
@@ -457,6 +497,9 @@ bool mp_emit_bc_last_emit_was_return_value(emit_t *emit) {
 }
 
 void mp_emit_bc_adjust_stack_size(emit_t *emit, mp_int_t delta) {
+    #if MICROPY_COMP_PEEPHOLE
+    emit->removable_push_offset = (size_t)-1;
+    #endif
     if (emit->pass == MP_PASS_SCOPE) {
         return;
     }
@@ -472,6 +515,34 @@ static inline void emit_bc_pre(emit_t *emit, mp_int_t stack_size_delta) {
     mp_emit_bc_adjust_stack_size(emit, stack_size_delta);
 }
 
+#if MICROPY_COMP_PEEPHOLE
+// Called after an instruction that never continues to the next one.
+static inline void emit_bc_unreachable(emit_t *emit) {
+    emit->unreachable = true;
+}
+
+// Called after a push that has no side effects, so it can be removed if the
+// value is popped straight away.
+static inline void emit_bc_removable_push(emit_t *emit, size_t offset) {
+    emit->removable_push_offset = offset;
+}
+
+// Called before an unconditional jump to label: any label that is assigned to
+// the offset of the jump can be replaced by label.
+STATIC void emit_bc_thread_labels(emit_t *emit, mp_uint_t label) {
+    if (emit->pass < MP_PASS_EMIT && !emit->unreachable
+        && emit->label_run_offset == emit->bytecode_offset) {
+        for (size_t i = 0; i < emit->label_run_len; ++i) {
+            emit->label_alias[emit->label_run[i]] = label;
+        }
+    }
+}
+#else
+#define emit_bc_unreachable(emit) (void)0
+#define emit_bc_removable_push(emit, offset) (void)0
+#define emit_bc_thread_labels(emit, label) (void)0
+#endif
+
 void mp_emit_bc_set_source_line(emit_t *emit, mp_uint_t source_line) {
     //printf("source: line %d -> %d  offset %d -> %d\n", emit->last_source_line, source_line, emit->last_source_line_offset, emit->bytecode_offset);
 #if MICROPY_ENABLE_SOURCE_LINE
@@ -498,10 +569,34 @@ void mp_emit_bc_label_assign(emit_t *emit, mp_uint_t l) {
         return;
     }
     assert(l < emit->max_num_labels);
+    #if MICROPY_COMP_PEEPHOLE
+    if (emit->unreachable) {
+        emit->unreachable = false;
+        // The VM needs at least one byte between the end of a block protected
+        // by finally/with and its handler, to tell if the handler is active,
+        // so pad with an instruction that is never executed.
+        if (emit->pass < MP_PASS_EMIT
+            ? emit->label_alias[l] == LABEL_IS_FINALLY
+            : emit->label_offsets[l] != emit->bytecode_offset) {
+            emit_write_bytecode_byte(emit, MP_BC_LOAD_CONST_NONE);
+        }
+    }
+    #endif
     if (emit->pass < MP_PASS_EMIT) {
         // assign label offset
         assert(emit->label_offsets[l] == (mp_uint_t)-1);
         emit->label_offsets[l] = emit->bytecode_offset;
+        #if MICROPY_COMP_PEEPHOLE
+        // keep track of the labels at this offset, for jump threading
+        emit->label_alias[l] = l;
+        if (emit->label_run_offset != emit->bytecode_offset) {
+            emit->label_run_offset = emit->bytecode_offset;
+            emit->label_run_len = 0;
+        }
+        if (emit->label_run_len < LABEL_RUN_MAX) {
+            emit->label_run[emit->label_run_len++] = l;
+        }
+        #endif
     } else {
         // ensure label offset has not changed from MP_PASS_CODE_SIZE to MP_PASS_EMIT
         assert(emit->label_offsets[l] == emit->bytecode_offset);
@@ -525,6 +620,7 @@ void mp_emit_bc_import(emit_t *emit, qstr qst, int kind) {
 
 void mp_emit_bc_load_const_tok(emit_t *emit, mp_token_kind_t tok) {
     emit_bc_pre(emit, 1);
+    emit_bc_removable_push(emit, emit->bytecode_offset);
     switch (tok) {
         case MP_TOKEN_KW_FALSE: emit_write_bytecode_byte(emit, MP_BC_LOAD_CONST_FALSE); break;
         case MP_TOKEN_KW_NONE: emit_write_bytecode_byte(emit, MP_BC_LOAD_CONST_NONE); break;
@@ -538,6 +634,7 @@ void mp_emit_bc_load_const_tok(emit_t *emit, mp_token_kind_t tok) {
 
 void mp_emit_bc_load_const_small_int(emit_t *emit, mp_int_t arg) {
     emit_bc_pre(emit, 1);
+    emit_bc_removable_push(emit, emit->bytecode_offset);
     if (-16 <= arg && arg <= 47) {
         emit_write_bytecode_byte(emit, MP_BC_LOAD_CONST_SMALL_INT_MULTI + 16 + arg);
     } else {
@@ -547,6 +644,7 @@ void mp_emit_bc_load_const_small_int(emit_t *emit, mp_int_t arg) {
 
 void mp_emit_bc_load_const_str(emit_t *emit, qstr qst) {
     emit_bc_pre(emit, 1);
+    emit_bc_removable_push(emit, emit->bytecode_offset);
     emit_write_bytecode_byte_qstr(emit, MP_BC_LOAD_CONST_STRING, qst);
 }
 
@@ -659,6 +757,7 @@ void mp_emit_bc_delete_global(emit_t *emit, qstr qst, int kind) {
 
 void mp_emit_bc_dup_top(emit_t *emit) {
     emit_bc_pre(emit, 1);
+    emit_bc_removable_push(emit, emit->bytecode_offset);
     emit_write_bytecode_byte(emit, MP_BC_DUP_TOP);
 }
 
@@ -668,6 +767,18 @@ void mp_emit_bc_dup_top_two(emit_t *emit) {
 }
 
 void mp_emit_bc_pop_top(emit_t *emit) {
+    #if MICROPY_COMP_PEEPHOLE
+    size_t push_offset = emit->removable_push_offset;
+    if (push_offset != (size_t)-1 && emit->last_source_line_offset <= push_offset) {
+        // the value was pushed by the previous instruction which has no side
+        // effects, so remove that instruction instead of emitting the pop
+        emit_bc_pre(emit, -1);
+        if (!emit->unreachable) {
+            emit->bytecode_offset = push_offset;
+        }
+        return;
+    }
+    #endif
     emit_bc_pre(emit, -1);
     emit_write_bytecode_byte(emit, MP_BC_POP_TOP);
 }
@@ -684,7 +795,9 @@ void mp_emit_bc_rot_three(emit_t *emit) {
 
 void mp_emit_bc_jump(emit_t *emit, mp_uint_t label) {
     emit_bc_pre(emit, 0);
+    emit_bc_thread_labels(emit, label);
     emit_write_bytecode_byte_signed_label(emit, MP_BC_JUMP, label);
+    emit_bc_unreachable(emit);
 }
 
 void mp_emit_bc_pop_jump_if(emit_t *emit, bool cond, mp_uint_t label) {
@@ -716,11 +829,13 @@ void mp_emit_bc_unwind_jump(emit_t *emit, mp_uint_t label, mp_uint_t except_dept
                 emit_write_bytecode_byte(emit, MP_BC_POP_TOP);
             }
         }
+        emit_bc_thread_labels(emit, label & ~MP_EMIT_BREAK_FROM_FOR);
         emit_write_bytecode_byte_signed_label(emit, MP_BC_JUMP, label & ~MP_EMIT_BREAK_FROM_FOR);
     } else {
         emit_write_bytecode_byte_signed_label(emit, MP_BC_UNWIND_JUMP, label & ~MP_EMIT_BREAK_FROM_FOR);
         emit_write_bytecode_byte(emit, ((label & MP_EMIT_BREAK_FROM_FOR) ? 0x80 : 0) | except_depth);
     }
+    emit_bc_unreachable(emit);
 }
 
 void mp_emit_bc_setup_block(emit_t *emit, mp_uint_t label, int kind) {
@@ -734,6 +849,12 @@ void mp_emit_bc_setup_block(emit_t *emit, mp_uint_t label, int kind) {
     } else {
         emit_bc_pre(emit, 0);
     }
+    #if MICROPY_COMP_PEEPHOLE
+    if (emit->pass != MP_PASS_SCOPE && emit->pass < MP_PASS_EMIT
+        && kind != MP_EMIT_SETUP_BLOCK_EXCEPT) {
+        emit->label_alias[label] = LABEL_IS_FINALLY;
+    }
+    #endif
     emit_write_bytecode_byte_unsigned_label(emit, MP_BC_SETUP_WITH + kind, label);
 }
 
@@ -768,6 +889,7 @@ void mp_emit_bc_pop_except_jump(emit_t *emit, mp_uint_t label, bool within_exc_h
     (void)within_exc_handler;
     emit_bc_pre(emit, 0);
     emit_write_bytecode_byte_unsigned_label(emit, MP_BC_POP_EXCEPT_JUMP, label);
+    emit_bc_unreachable(emit);
 }
 
 void mp_emit_bc_unary_op(emit_t *emit, mp_unary_op_t op) {
@@ -863,7 +985,10 @@ void mp_emit_bc_make_closure(emit_t *emit, scope_t *scope, mp_uint_t n_closed_ov
 }
 
 STATIC void emit_bc_call_function_method_helper(emit_t *emit, mp_int_t stack_adj, mp_uint_t bytecode_base, mp_uint_t n_positional, mp_uint_t n_keyword, mp_uint_t star_flags) {
-    if (star_flags) {
+    if (star_flags & MP_EMIT_CALL_FLAG_TEMP_GEN) {
+        emit_bc_pre(emit, stack_adj - (mp_int_t)n_positional);
+        emit_write_bytecode_byte_uint(emit, bytecode_base, MP_BC_CALL_FLAG_TEMP_GEN | n_positional);
+    } else if (star_flags) {
         emit_bc_pre(emit, stack_adj - (mp_int_t)n_positional - 2 * (mp_int_t)n_keyword - 2);
         emit_write_bytecode_byte_uint(emit, bytecode_base + 1, (n_keyword << 8) | n_positional); // TODO make it 2 separate uints?
     } else {
@@ -884,12 +1009,14 @@ void mp_emit_bc_return_value(emit_t *emit) {
     emit_bc_pre(emit, -1);
     emit->last_emit_was_return_value = true;
     emit_write_bytecode_byte(emit, MP_BC_RETURN_VALUE);
+    emit_bc_unreachable(emit);
 }
 
 void mp_emit_bc_raise_varargs(emit_t *emit, mp_uint_t n_args) {
     assert(n_args <= 2);
     emit_bc_pre(emit, -n_args);
     emit_write_bytecode_byte_byte(emit, MP_BC_RAISE_VARARGS, n_args);
+    emit_bc_unreachable(emit);
 }
 
 void mp_emit_bc_yield(emit_t *emit, int kind) {
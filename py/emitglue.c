@@ -166,8 +166,21 @@ mp_obj_t mp_make_function_from_raw_code(const mp_raw_code_t *rc, mp_obj_t def_ar
         #endif
         default:
             // rc->kind should always be set and BYTECODE is the only remaining case
-            assert(rc->kind == MP_CODE_BYTECODE);
+            assert(rc->kind == MP_CODE_BYTECODE || rc->kind == MP_CODE_BYTECODE_LAZY);
             fun = mp_obj_new_fun_bc(def_args, def_kw_args, rc->fun_data, rc->const_table);
+            #if MICROPY_PERSISTENT_CODE_XIP
+            ((mp_obj_fun_bc_t*)MP_OBJ_TO_PTR(fun))->qstr_table = rc->qstr_table;
+            #endif
+            #if MICROPY_PERSISTENT_CODE_LAZY
+            if (rc->kind == MP_CODE_BYTECODE_LAZY) {
+                // Until mp_setup_code_state loads the function on the first
+                // call, const_table holds the raw code and the qstr table is
+                // tagged (the raw code mustn't be tagged, to keep it alive)
+                mp_obj_fun_bc_t *fun_bc = MP_OBJ_TO_PTR(fun);
+                fun_bc->const_table = (const mp_uint_t*)rc;
+                fun_bc->qstr_table = (const uint16_t*)((uintptr_t)rc->qstr_table | 1);
+            }
+            #endif
             // check for generator functions and if so change the type of the object
             if ((rc->scope_flags & MP_SCOPE_FLAG_GENERATOR) != 0) {
                 ((mp_obj_base_t*)MP_OBJ_TO_PTR(fun))->type = &mp_type_gen_wrap;
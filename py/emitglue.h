@@ -46,6 +46,7 @@ typedef enum {
     MP_CODE_NATIVE_PY,
     MP_CODE_NATIVE_VIPER,
     MP_CODE_NATIVE_ASM,
+    MP_CODE_BYTECODE_LAZY, // not fully loaded yet, see mp_raw_code_load_lazy
 } mp_raw_code_kind_t;
 
 typedef struct _mp_qstr_link_entry_t {
@@ -59,6 +60,9 @@ typedef struct _mp_raw_code_t {
     mp_uint_t n_pos_args : 11;
     const void *fun_data;
     const mp_uint_t *const_table;
+    #if MICROPY_PERSISTENT_CODE_XIP
+    const uint16_t *qstr_table;
+    #endif
     #if MICROPY_PERSISTENT_CODE_SAVE
     size_t fun_data_len;
     uint16_t n_obj;
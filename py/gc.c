@@ -34,6 +34,18 @@
 
 #if MICROPY_ENABLE_GC
 
+#if MICROPY_GC_SPLIT_HEAP_AUTO && !MICROPY_GC_SPLIT_HEAP
+#error MICROPY_GC_SPLIT_HEAP_AUTO requires MICROPY_GC_SPLIT_HEAP
+#endif
+
+#if MICROPY_GC_FINALISER_LIST && !MICROPY_ENABLE_FINALISER
+#error MICROPY_GC_FINALISER_LIST requires MICROPY_ENABLE_FINALISER
+#endif
+
+#if MICROPY_GC_FINALISER_DEFERRED && !(MICROPY_GC_FINALISER_LIST && MICROPY_ENABLE_SCHEDULER)
+#error MICROPY_GC_FINALISER_DEFERRED requires MICROPY_GC_FINALISER_LIST and MICROPY_ENABLE_SCHEDULER
+#endif
+
 #if MICROPY_DEBUG_VERBOSE // print debugging info
 #define DEBUG_PRINT (1)
 #define DEBUG_printf DEBUG_printf
@@ -75,15 +87,15 @@
 #define ATB_3_IS_FREE(a) (((a) & ATB_MASK_3) == 0)
 
 #define BLOCK_SHIFT(block) (2 * ((block) & (BLOCKS_PER_ATB - 1)))
-#define ATB_GET_KIND(block) ((MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] >> BLOCK_SHIFT(block)) & 3)
-#define ATB_ANY_TO_FREE(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] &= (~(AT_MARK << BLOCK_SHIFT(block))); } while (0)
-#define ATB_FREE_TO_HEAD(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] |= (AT_HEAD << BLOCK_SHIFT(block)); } while (0)
-#define ATB_FREE_TO_TAIL(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] |= (AT_TAIL << BLOCK_SHIFT(block)); } while (0)
-#define ATB_HEAD_TO_MARK(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] |= (AT_MARK << BLOCK_SHIFT(block)); } while (0)
-#define ATB_MARK_TO_HEAD(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] &= (~(AT_TAIL << BLOCK_SHIFT(block))); } while (0)
-
-#define BLOCK_FROM_PTR(ptr) (((byte*)(ptr) - MP_STATE_MEM(gc_pool_start)) / BYTES_PER_BLOCK)
-#define PTR_FROM_BLOCK(block) (((block) * BYTES_PER_BLOCK + (uintptr_t)MP_STATE_MEM(gc_pool_start)))
+#define ATB_GET_KIND(area, block) (((area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] >> BLOCK_SHIFT(block)) & 3)
+#define ATB_ANY_TO_FREE(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] &= (~(AT_MARK << BLOCK_SHIFT(block))); } while (0)
+#define ATB_FREE_TO_HEAD(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] |= (AT_HEAD << BLOCK_SHIFT(block)); } while (0)
+#define ATB_FREE_TO_TAIL(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] |= (AT_TAIL << BLOCK_SHIFT(block)); } while (0)
+#define ATB_HEAD_TO_MARK(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] |= (AT_MARK << BLOCK_SHIFT(block)); } while (0)
+#define ATB_MARK_TO_HEAD(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] &= (~(AT_TAIL << BLOCK_SHIFT(block))); } while (0)
+
+#define BLOCK_FROM_PTR(area, ptr) (((byte*)(ptr) - (area)->gc_pool_start) / BYTES_PER_BLOCK)
+#define PTR_FROM_BLOCK(area, block) (((block) * BYTES_PER_BLOCK + (uintptr_t)(area)->gc_pool_start))
 #define ATB_FROM_BLOCK(bl) ((bl) / BLOCKS_PER_ATB)
 
 #if MICROPY_ENABLE_FINALISER
@@ -92,9 +104,9 @@
 
 #define BLOCKS_PER_FTB (8)
 
-#define FTB_GET(block) ((MP_STATE_MEM(gc_finaliser_table_start)[(block) / BLOCKS_PER_FTB] >> ((block) & 7)) & 1)
-#define FTB_SET(block) do { MP_STATE_MEM(gc_finaliser_table_start)[(block) / BLOCKS_PER_FTB] |= (1 << ((block) & 7)); } while (0)
-#define FTB_CLEAR(block) do { MP_STATE_MEM(gc_finaliser_table_start)[(block) / BLOCKS_PER_FTB] &= (~(1 << ((block) & 7))); } while (0)
+#define FTB_GET(area, block) (((area)->gc_finaliser_table_start[(block) / BLOCKS_PER_FTB] >> ((block) & 7)) & 1)
+#define FTB_SET(area, block) do { (area)->gc_finaliser_table_start[(block) / BLOCKS_PER_FTB] |= (1 << ((block) & 7)); } while (0)
+#define FTB_CLEAR(area, block) do { (area)->gc_finaliser_table_start[(block) / BLOCKS_PER_FTB] &= (~(1 << ((block) & 7))); } while (0)
 #endif
 
 #if MICROPY_PY_THREAD && !MICROPY_PY_THREAD_GIL
@@ -105,8 +117,102 @@
 #define GC_EXIT()
 #endif
 
+#if MICROPY_GC_SPLIT_HEAP
+#define FIRST_AREA() (MP_STATE_MEM(gc_area_head))
+#define NEXT_AREA(area) ((area)->next)
+#else
+#define FIRST_AREA() (&MP_STATE_MEM(area))
+#define NEXT_AREA(area) (NULL)
+#endif
+
+#if MICROPY_GC_SIZE_CLASSES
+// Every run of free blocks is in the free list for its size class, and the
+// list entry is kept in the first block of the run.  The lists are rebuilt by
+// each sweep, which joins up neighbouring runs.  Any free block that follows
+// a used block is the start of a run.
+typedef struct _gc_free_run_t {
+    struct _gc_free_run_t *next;
+    struct _gc_free_run_t *prev;
+    size_t len;
+} gc_free_run_t;
+
+#define RUN_FROM_BLOCK(area, block) ((gc_free_run_t*)PTR_FROM_BLOCK(area, block))
+
+STATIC size_t gc_size_class(size_t n_blocks) {
+    size_t c = 0;
+    while (n_blocks > 1 && c < MICROPY_GC_SIZE_CLASSES - 1) {
+        n_blocks >>= 1;
+        c += 1;
+    }
+    return c;
+}
+
+STATIC void gc_link_free_run(mp_state_mem_area_t *area, gc_free_run_t *run) {
+    gc_free_run_t **head = &area->gc_free_runs[gc_size_class(run->len)];
+    run->prev = NULL;
+    run->next = *head;
+    if (*head != NULL) {
+        (*head)->prev = run;
+    }
+    *head = run;
+}
+
+STATIC void gc_unlink_free_run(mp_state_mem_area_t *area, gc_free_run_t *run) {
+    if (run->prev == NULL) {
+        area->gc_free_runs[gc_size_class(run->len)] = run->next;
+    } else {
+        run->prev->next = run->next;
+    }
+    if (run->next != NULL) {
+        run->next->prev = run->prev;
+    }
+}
+
+STATIC void gc_add_free_run(mp_state_mem_area_t *area, size_t block, size_t len) {
+    gc_free_run_t *run = RUN_FROM_BLOCK(area, block);
+    run->len = len;
+    gc_link_free_run(area, run);
+}
+
+// Find a run of at least n_blocks free blocks, or return NULL if there's none.
+STATIC gc_free_run_t *gc_find_free_run(mp_state_mem_area_t *area, size_t n_blocks) {
+    size_t c = gc_size_class(n_blocks);
+    if (c < MICROPY_GC_SIZE_CLASSES - 1) {
+        // any run in a bigger class will do, as will any in the class of
+        // n_blocks if that's the smallest size in the class
+        for (size_t k = (n_blocks & (n_blocks - 1)) == 0 ? c : c + 1; k < MICROPY_GC_SIZE_CLASSES; k++) {
+            if (area->gc_free_runs[k] != NULL) {
+                return area->gc_free_runs[k];
+            }
+        }
+    }
+    // otherwise look for a run that's long enough in the class of n_blocks
+    for (gc_free_run_t *run = area->gc_free_runs[c]; run != NULL; run = run->next) {
+        if (run->len >= n_blocks) {
+            return run;
+        }
+    }
+    return NULL;
+}
+
+// Take n_blocks from the start of the free runs at block, for gc_realloc.
+STATIC void gc_take_free_blocks(mp_state_mem_area_t *area, size_t block, size_t n_blocks) {
+    while (n_blocks > 0) {
+        gc_free_run_t *run = RUN_FROM_BLOCK(area, block);
+        size_t len = run->len;
+        gc_unlink_free_run(area, run);
+        if (len > n_blocks) {
+            gc_add_free_run(area, block + n_blocks, len - n_blocks);
+            return;
+        }
+        block += len;
+        n_blocks -= len;
+    }
+}
+#endif
+
 // TODO waste less memory; currently requires that all entries in alloc_table have a corresponding block in pool
-void gc_init(void *start, void *end) {
+STATIC void gc_setup_area(mp_state_mem_area_t *area, void *start, void *end) {
     // align end pointer on block boundary
     end = (void*)((uintptr_t)end & (~(BYTES_PER_BLOCK - 1)));
     DEBUG_printf("Initializing GC heap: %p..%p = " UINT_FMT " bytes\n", start, end, (byte*)end - (byte*)start);
@@ -118,36 +224,80 @@ void gc_init(void *start, void *end) {
     // => T = A * (1 + BLOCKS_PER_ATB / BLOCKS_PER_FTB + BLOCKS_PER_ATB * BYTES_PER_BLOCK)
     size_t total_byte_len = (byte*)end - (byte*)start;
 #if MICROPY_ENABLE_FINALISER
-    MP_STATE_MEM(gc_alloc_table_byte_len) = total_byte_len * BITS_PER_BYTE / (BITS_PER_BYTE + BITS_PER_BYTE * BLOCKS_PER_ATB / BLOCKS_PER_FTB + BITS_PER_BYTE * BLOCKS_PER_ATB * BYTES_PER_BLOCK);
+    area->gc_alloc_table_byte_len = total_byte_len * BITS_PER_BYTE / (BITS_PER_BYTE + BITS_PER_BYTE * BLOCKS_PER_ATB / BLOCKS_PER_FTB + BITS_PER_BYTE * BLOCKS_PER_ATB * BYTES_PER_BLOCK);
 #else
-    MP_STATE_MEM(gc_alloc_table_byte_len) = total_byte_len / (1 + BITS_PER_BYTE / 2 * BYTES_PER_BLOCK);
+    area->gc_alloc_table_byte_len = total_byte_len / (1 + BITS_PER_BYTE / 2 * BYTES_PER_BLOCK);
 #endif
 
-    MP_STATE_MEM(gc_alloc_table_start) = (byte*)start;
+    area->gc_alloc_table_start = (byte*)start;
 
 #if MICROPY_ENABLE_FINALISER
-    size_t gc_finaliser_table_byte_len = (MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB + BLOCKS_PER_FTB - 1) / BLOCKS_PER_FTB;
-    MP_STATE_MEM(gc_finaliser_table_start) = MP_STATE_MEM(gc_alloc_table_start) + MP_STATE_MEM(gc_alloc_table_byte_len);
+    size_t gc_finaliser_table_byte_len = (area->gc_alloc_table_byte_len * BLOCKS_PER_ATB + BLOCKS_PER_FTB - 1) / BLOCKS_PER_FTB;
+    area->gc_finaliser_table_start = area->gc_alloc_table_start + area->gc_alloc_table_byte_len;
 #endif
 
-    size_t gc_pool_block_len = MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB;
-    MP_STATE_MEM(gc_pool_start) = (byte*)end - gc_pool_block_len * BYTES_PER_BLOCK;
-    MP_STATE_MEM(gc_pool_end) = end;
+    size_t gc_pool_block_len = area->gc_alloc_table_byte_len * BLOCKS_PER_ATB;
+    area->gc_pool_start = (byte*)end - gc_pool_block_len * BYTES_PER_BLOCK;
+    area->gc_pool_end = end;
 
 #if MICROPY_ENABLE_FINALISER
-    assert(MP_STATE_MEM(gc_pool_start) >= MP_STATE_MEM(gc_finaliser_table_start) + gc_finaliser_table_byte_len);
+    assert(area->gc_pool_start >= area->gc_finaliser_table_start + gc_finaliser_table_byte_len);
 #endif
 
     // clear ATBs
-    memset(MP_STATE_MEM(gc_alloc_table_start), 0, MP_STATE_MEM(gc_alloc_table_byte_len));
+    memset(area->gc_alloc_table_start, 0, area->gc_alloc_table_byte_len);
 
 #if MICROPY_ENABLE_FINALISER
     // clear FTBs
-    memset(MP_STATE_MEM(gc_finaliser_table_start), 0, gc_finaliser_table_byte_len);
+    memset(area->gc_finaliser_table_start, 0, gc_finaliser_table_byte_len);
 #endif
 
     // set last free ATB index to start of heap
-    MP_STATE_MEM(gc_last_free_atb_index) = 0;
+    area->gc_last_free_atb_index = 0;
+
+    #if MICROPY_GC_SIZE_CLASSES
+    // the whole pool is one free run
+    MP_STATIC_ASSERT(sizeof(gc_free_run_t) <= BYTES_PER_BLOCK);
+    memset(area->gc_free_runs, 0, sizeof(area->gc_free_runs));
+    gc_add_free_run(area, 0, gc_pool_block_len);
+    #endif
+
+    DEBUG_printf("GC layout:\n");
+    DEBUG_printf("  alloc table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_alloc_table_start, area->gc_alloc_table_byte_len, area->gc_alloc_table_byte_len * BLOCKS_PER_ATB);
+#if MICROPY_ENABLE_FINALISER
+    DEBUG_printf("  finaliser table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_finaliser_table_start, gc_finaliser_table_byte_len, gc_finaliser_table_byte_len * BLOCKS_PER_FTB);
+#endif
+    DEBUG_printf("  pool at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_pool_start, gc_pool_block_len * BYTES_PER_BLOCK, gc_pool_block_len);
+}
+
+void gc_init(void *start, void *end) {
+    gc_setup_area(&MP_STATE_MEM(area), start, end);
+
+    #if MICROPY_GC_SPLIT_HEAP
+    MP_STATE_MEM(area).next = NULL;
+    MP_STATE_MEM(gc_area_head) = &MP_STATE_MEM(area);
+    #endif
+
+    #if MICROPY_GC_SPLIT_HEAP_AUTO
+    MP_STATE_MEM(area).gc_auto = false;
+    MP_STATE_MEM(gc_grow_count) = 0;
+    MP_STATE_MEM(gc_shrink_count) = 0;
+    #endif
+
+    #if MICROPY_GC_FINALISER_LIST
+    MP_STATE_MEM(gc_finaliser_list) = NULL;
+    MP_STATE_MEM(gc_finaliser_len) = 0;
+    MP_STATE_MEM(gc_finaliser_alloc) = 0;
+    #if MICROPY_GC_FINALISER_DEFERRED
+    MP_STATE_MEM(gc_finaliser_pending) = 0;
+    MP_STATE_MEM(gc_finaliser_scheduled) = false;
+    #endif
+    #endif
+
+    #if MICROPY_GC_PARALLEL_MARK
+    MP_STATE_MEM(gc_mark_threads) = 1;
+    MP_STATE_MEM(gc_mark_parallel) = false;
+    #endif
 
     // unlock the GC
     MP_STATE_MEM(gc_lock_depth) = 0;
@@ -164,15 +314,104 @@ void gc_init(void *start, void *end) {
     #if MICROPY_PY_THREAD
     mp_thread_mutex_init(&MP_STATE_MEM(gc_mutex));
     #endif
+}
 
-    DEBUG_printf("GC layout:\n");
-    DEBUG_printf("  alloc table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", MP_STATE_MEM(gc_alloc_table_start), MP_STATE_MEM(gc_alloc_table_byte_len), MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB);
-#if MICROPY_ENABLE_FINALISER
-    DEBUG_printf("  finaliser table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", MP_STATE_MEM(gc_finaliser_table_start), gc_finaliser_table_byte_len, gc_finaliser_table_byte_len * BLOCKS_PER_FTB);
+#if MICROPY_GC_SPLIT_HEAP
+STATIC mp_state_mem_area_t *gc_add_area(void *start, void *end, bool is_auto) {
+    // the area's state is kept at the start of the region itself
+    start = (void*)(((uintptr_t)start + sizeof(void*) - 1) & ~(sizeof(void*) - 1));
+    mp_state_mem_area_t *area = (mp_state_mem_area_t*)start;
+    if ((byte*)end - (byte*)start < (ptrdiff_t)(sizeof(mp_state_mem_area_t) + 2 * BYTES_PER_BLOCK)) {
+        // too small to be worth using
+        return NULL;
+    }
+    gc_setup_area(area, area + 1, end);
+    if (area->gc_alloc_table_byte_len == 0) {
+        return NULL;
+    }
+    #if MICROPY_GC_SPLIT_HEAP_AUTO
+    area->gc_auto = is_auto;
+    area->gc_idle_collections = 0;
+    #else
+    (void)is_auto;
+    #endif
+
+    // Keep the areas in order of increasing size.  Allocations take the first
+    // area with room, so small objects fill up small regions (eg TCM) first and
+    // the big runs of free blocks in the large regions are kept for big objects.
+    // Areas added automatically go at the end so that they are only used when
+    // the rest of the heap is full, and can empty out again.
+    GC_ENTER();
+    mp_state_mem_area_t **link = &MP_STATE_MEM(gc_area_head);
+    while (*link != NULL) {
+        #if MICROPY_GC_SPLIT_HEAP_AUTO
+        if (!is_auto && (*link)->gc_auto) {
+            break;
+        }
+        #endif
+        if (!is_auto && (*link)->gc_alloc_table_byte_len > area->gc_alloc_table_byte_len) {
+            break;
+        }
+        link = &(*link)->next;
+    }
+    area->next = *link;
+    *link = area;
+    GC_EXIT();
+    return area;
+}
+
+void gc_add_region(void *start, void *end) {
+    gc_add_area(start, end, false);
+}
 #endif
-    DEBUG_printf("  pool at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", MP_STATE_MEM(gc_pool_start), gc_pool_block_len * BYTES_PER_BLOCK, gc_pool_block_len);
+
+#if MICROPY_GC_SPLIT_HEAP_AUTO
+// Ask the port for a new region big enough for an allocation of n_blocks.
+STATIC bool gc_grow_heap(size_t n_blocks) {
+    // the pool, its alloc and finaliser tables, and the area state
+    size_t len = n_blocks * BYTES_PER_BLOCK + n_blocks + sizeof(mp_state_mem_area_t) + 2 * BYTES_PER_BLOCK;
+    void *start = gc_port_new_region(&len);
+    if (start == NULL) {
+        return false;
+    }
+    if (gc_add_area(start, (byte*)start + len, true) == NULL) {
+        gc_port_free_region(start, len);
+        return false;
+    }
+    DEBUG_printf("gc_grow_heap: added %p, " UINT_FMT " bytes\n", start, len);
+    MP_STATE_MEM(gc_grow_count)++;
+    return true;
 }
 
+// Give back to the port any automatically added areas that have been empty
+// for the last MICROPY_GC_SPLIT_HEAP_AUTO_IDLE collections.
+STATIC void gc_shrink_heap(void) {
+    mp_state_mem_area_t **link = &MP_STATE_MEM(gc_area_head);
+    while (*link != NULL) {
+        mp_state_mem_area_t *area = *link;
+        if (area->gc_auto) {
+            bool empty = true;
+            for (size_t i = 0; i < area->gc_alloc_table_byte_len; i++) {
+                if (area->gc_alloc_table_start[i] != 0) {
+                    empty = false;
+                    break;
+                }
+            }
+            if (!empty) {
+                area->gc_idle_collections = 0;
+            } else if (++area->gc_idle_collections >= MICROPY_GC_SPLIT_HEAP_AUTO_IDLE) {
+                DEBUG_printf("gc_shrink_heap: releasing %p\n", area);
+                *link = area->next;
+                gc_port_free_region(area, area->gc_pool_end - (byte*)area);
+                MP_STATE_MEM(gc_shrink_count)++;
+                continue;
+            }
+        }
+        link = &area->next;
+    }
+}
+#endif
+
 void gc_lock(void) {
     GC_ENTER();
     MP_STATE_MEM(gc_lock_depth)++;
@@ -190,12 +429,27 @@ bool gc_is_locked(void) {
 }
 
 // ptr should be of type void*
-#define VERIFY_PTR(ptr) ( \
+#define VERIFY_PTR(area, ptr) ( \
         ((uintptr_t)(ptr) & (BYTES_PER_BLOCK - 1)) == 0      /* must be aligned on a block */ \
-        && ptr >= (void*)MP_STATE_MEM(gc_pool_start)     /* must be above start of pool */ \
-        && ptr < (void*)MP_STATE_MEM(gc_pool_end)        /* must be below end of pool */ \
+        && ptr >= (void*)(area)->gc_pool_start     /* must be above start of pool */ \
+        && ptr < (void*)(area)->gc_pool_end        /* must be below end of pool */ \
     )
 
+// Returns the area that the given pointer is in, or NULL if it doesn't point
+// to the start of a block in the heap.
+static inline mp_state_mem_area_t *gc_get_ptr_area(const void *ptr) {
+    #if MICROPY_GC_SPLIT_HEAP
+    for (mp_state_mem_area_t *area = FIRST_AREA(); area != NULL; area = NEXT_AREA(area)) {
+        if (VERIFY_PTR(area, ptr)) {
+            return area;
+        }
+    }
+    return NULL;
+    #else
+    return VERIFY_PTR(&MP_STATE_MEM(area), ptr) ? &MP_STATE_MEM(area) : NULL;
+    #endif
+}
+
 #ifndef TRACE_MARK
 #if DEBUG_PRINT
 #define TRACE_MARK(block, ptr) DEBUG_printf("gc_mark(%p)\n", ptr)
@@ -208,7 +462,7 @@ bool gc_is_locked(void) {
 // children: mark the unmarked child blocks and put those newly marked
 // blocks on the stack. When all children have been checked, pop off the
 // topmost block on the stack and repeat with that one.
-STATIC void gc_mark_subtree(size_t block) {
+STATIC void gc_mark_subtree(mp_state_mem_area_t *area, size_t block) {
     // Start with the block passed in the argument.
     size_t sp = 0;
     for (;;) {
@@ -216,21 +470,26 @@ STATIC void gc_mark_subtree(size_t block) {
         size_t n_blocks = 0;
         do {
             n_blocks += 1;
-        } while (ATB_GET_KIND(block + n_blocks) == AT_TAIL);
+        } while (ATB_GET_KIND(area, block + n_blocks) == AT_TAIL);
 
         // check this block's children
-        void **ptrs = (void**)PTR_FROM_BLOCK(block);
+        void **ptrs = (void**)PTR_FROM_BLOCK(area, block);
         for (size_t i = n_blocks * BYTES_PER_BLOCK / sizeof(void*); i > 0; i--, ptrs++) {
             void *ptr = *ptrs;
-            if (VERIFY_PTR(ptr)) {
+            mp_state_mem_area_t *ptr_area = gc_get_ptr_area(ptr);
+            if (ptr_area != NULL) {
                 // Mark and push this pointer
-                size_t childblock = BLOCK_FROM_PTR(ptr);
-                if (ATB_GET_KIND(childblock) == AT_HEAD) {
+                size_t childblock = BLOCK_FROM_PTR(ptr_area, ptr);
+                if (ATB_GET_KIND(ptr_area, childblock) == AT_HEAD) {
                     // an unmarked head, mark it, and push it on gc stack
                     TRACE_MARK(childblock, ptr);
-                    ATB_HEAD_TO_MARK(childblock);
+                    ATB_HEAD_TO_MARK(ptr_area, childblock);
                     if (sp < MICROPY_ALLOC_GC_STACK_SIZE) {
-                        MP_STATE_MEM(gc_stack)[sp++] = childblock;
+                        MP_STATE_MEM(gc_stack)[sp] = childblock;
+                        #if MICROPY_GC_SPLIT_HEAP
+                        MP_STATE_MEM(gc_area_stack)[sp] = ptr_area;
+                        #endif
+                        sp++;
                     } else {
                         MP_STATE_MEM(gc_stack_overflow) = 1;
                     }
@@ -245,6 +504,9 @@ STATIC void gc_mark_subtree(size_t block) {
 
         // pop the next block off the stack
         block = MP_STATE_MEM(gc_stack)[--sp];
+        #if MICROPY_GC_SPLIT_HEAP
+        area = MP_STATE_MEM(gc_area_stack)[sp];
+        #endif
     }
 }
 
@@ -253,67 +515,419 @@ STATIC void gc_deal_with_stack_overflow(void) {
         MP_STATE_MEM(gc_stack_overflow) = 0;
 
         // scan entire memory looking for blocks which have been marked but not their children
-        for (size_t block = 0; block < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB; block++) {
-            // trace (again) if mark bit set
-            if (ATB_GET_KIND(block) == AT_MARK) {
-                gc_mark_subtree(block);
+        for (mp_state_mem_area_t *area = FIRST_AREA(); area != NULL; area = NEXT_AREA(area)) {
+            for (size_t block = 0; block < area->gc_alloc_table_byte_len * BLOCKS_PER_ATB; block++) {
+                // trace (again) if mark bit set
+                if (ATB_GET_KIND(area, block) == AT_MARK) {
+                    gc_mark_subtree(area, block);
+                }
+            }
+        }
+    }
+}
+
+#if MICROPY_GC_PARALLEL_MARK
+// Parallel marking.  The roots are marked and pushed on the stack of marker 0,
+// then the port runs gc_mark_worker on each marker thread.  The markers' stacks
+// are fixed-size Chase-Lev deques: a marker works from the bottom of its own
+// and, when that's empty, steals from the top of the others'.  Mark bits are
+// set with an atomic OR so that only one marker pushes each object.
+
+#define GC_MARK_DEQUE_MASK (MICROPY_GC_PARALLEL_MARK_STACK_SIZE - 1)
+
+#if MICROPY_GC_PARALLEL_MARK_STACK_SIZE & GC_MARK_DEQUE_MASK
+#error MICROPY_GC_PARALLEL_MARK_STACK_SIZE must be a power of 2
+#endif
+
+#define ATB_GET_KIND_RELAXED(area, block) ((__atomic_load_n(&(area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB], __ATOMIC_RELAXED) >> BLOCK_SHIFT(block)) & 3)
+
+void gc_set_mark_threads(size_t n) {
+    MP_STATE_MEM(gc_mark_threads) = MIN(MAX(n, 1), MICROPY_GC_PARALLEL_MARK);
+}
+
+// Only called by the owner of the deque.
+STATIC void gc_mark_push(mp_gc_mark_deque_t *dq, void *ptr) {
+    size_t b = __atomic_load_n(&dq->bottom, __ATOMIC_RELAXED);
+    size_t t = __atomic_load_n(&dq->top, __ATOMIC_ACQUIRE);
+    if (b - t > GC_MARK_DEQUE_MASK) {
+        // full: the object is marked, and its children are found by a rescan
+        __atomic_store_n(&MP_STATE_MEM(gc_stack_overflow), 1, __ATOMIC_RELAXED);
+        return;
+    }
+    __atomic_store_n(&dq->buf[b & GC_MARK_DEQUE_MASK], ptr, __ATOMIC_RELAXED);
+    __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELEASE);
+}
+
+// Only called by the owner of the deque.  Returns NULL if it's empty.
+STATIC void *gc_mark_pop(mp_gc_mark_deque_t *dq) {
+    size_t b = __atomic_load_n(&dq->bottom, __ATOMIC_RELAXED);
+    if (b == __atomic_load_n(&dq->top, __ATOMIC_RELAXED)) {
+        return NULL;
+    }
+    b -= 1;
+    __atomic_store_n(&dq->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    size_t t = __atomic_load_n(&dq->top, __ATOMIC_RELAXED);
+    if ((ptrdiff_t)(b - t) < 0) {
+        // a thief took the last one
+        __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    void *ptr = __atomic_load_n(&dq->buf[b & GC_MARK_DEQUE_MASK], __ATOMIC_RELAXED);
+    if (b == t) {
+        // the last one, which a thief may be taking too
+        if (!__atomic_compare_exchange_n(&dq->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            ptr = NULL;
+        }
+        __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+    return ptr;
+}
+
+// Called by the other markers.  Returns NULL if the deque is empty or another
+// marker got there first.
+STATIC void *gc_mark_steal(mp_gc_mark_deque_t *dq) {
+    size_t t = __atomic_load_n(&dq->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    size_t b = __atomic_load_n(&dq->bottom, __ATOMIC_ACQUIRE);
+    if ((ptrdiff_t)(b - t) <= 0) {
+        return NULL;
+    }
+    void *ptr = __atomic_load_n(&dq->buf[t & GC_MARK_DEQUE_MASK], __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&dq->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        return NULL;
+    }
+    return ptr;
+}
+
+STATIC bool gc_mark_work_left(size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        mp_gc_mark_deque_t *dq = &MP_STATE_MEM(gc_mark_deque)[i];
+        size_t t = __atomic_load_n(&dq->top, __ATOMIC_RELAXED);
+        if ((ptrdiff_t)(__atomic_load_n(&dq->bottom, __ATOMIC_RELAXED) - t) > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Mark the unmarked children of the marked object at ptr, pushing them on dq.
+STATIC void gc_mark_children(mp_gc_mark_deque_t *dq, void *obj) {
+    mp_state_mem_area_t *area = gc_get_ptr_area(obj);
+    size_t block = BLOCK_FROM_PTR(area, obj);
+    size_t n_blocks = 0;
+    do {
+        n_blocks += 1;
+    } while (ATB_GET_KIND_RELAXED(area, block + n_blocks) == AT_TAIL);
+
+    void **ptrs = obj;
+    for (size_t i = n_blocks * BYTES_PER_BLOCK / sizeof(void*); i > 0; i--, ptrs++) {
+        void *ptr = *ptrs;
+        mp_state_mem_area_t *ptr_area = gc_get_ptr_area(ptr);
+        if (ptr_area != NULL) {
+            size_t childblock = BLOCK_FROM_PTR(ptr_area, ptr);
+            if (ATB_GET_KIND_RELAXED(ptr_area, childblock) == AT_HEAD) {
+                // an unmarked head, unless another marker has just marked it
+                byte *atb = &ptr_area->gc_alloc_table_start[childblock / BLOCKS_PER_ATB];
+                byte old = __atomic_fetch_or(atb, AT_MARK << BLOCK_SHIFT(childblock), __ATOMIC_RELAXED);
+                if (((old >> BLOCK_SHIFT(childblock)) & 3) == AT_HEAD) {
+                    TRACE_MARK(childblock, ptr);
+                    gc_mark_push(dq, ptr);
+                }
             }
         }
     }
 }
 
+void gc_mark_worker(size_t id) {
+    size_t n = MP_STATE_MEM(gc_mark_threads);
+    mp_gc_mark_deque_t *dq = &MP_STATE_MEM(gc_mark_deque)[id];
+    void *ptr;
+
+    if (MP_STATE_MEM(gc_mark_rescan)) {
+        // a stack overflowed, so each marker scans its share of the heap for
+        // marked blocks, whose children may not have been marked
+        for (mp_state_mem_area_t *area = FIRST_AREA(); area != NULL; area = NEXT_AREA(area)) {
+            size_t len = area->gc_alloc_table_byte_len * BLOCKS_PER_ATB;
+            for (size_t block = len * id / n; block < len * (id + 1) / n; block++) {
+                if (ATB_GET_KIND_RELAXED(area, block) == AT_MARK) {
+                    gc_mark_children(dq, (void*)PTR_FROM_BLOCK(area, block));
+                    while ((ptr = gc_mark_pop(dq)) != NULL) {
+                        gc_mark_children(dq, ptr);
+                    }
+                }
+            }
+        }
+    }
+
+    for (;;) {
+        while ((ptr = gc_mark_pop(dq)) != NULL) {
+            gc_mark_children(dq, ptr);
+        }
+
+        // out of work, so try to steal some
+        for (size_t i = 1; i < n && ptr == NULL; i++) {
+            ptr = gc_mark_steal(&MP_STATE_MEM(gc_mark_deque)[(id + i) % n]);
+        }
+        if (ptr != NULL) {
+            gc_mark_children(dq, ptr);
+            continue;
+        }
+
+        // Wait until there's work again, or all the markers are idle.  Only a
+        // marker that isn't counted as idle can have work, so once they all are
+        // the marking is done.
+        __atomic_add_fetch(&MP_STATE_MEM(gc_mark_idle), 1, __ATOMIC_SEQ_CST);
+        for (;;) {
+            if (__atomic_load_n(&MP_STATE_MEM(gc_mark_done), __ATOMIC_ACQUIRE)) {
+                return;
+            }
+            if (__atomic_load_n(&MP_STATE_MEM(gc_mark_idle), __ATOMIC_SEQ_CST) == n) {
+                __atomic_store_n(&MP_STATE_MEM(gc_mark_done), true, __ATOMIC_RELEASE);
+                return;
+            }
+            if (gc_mark_work_left(n)) {
+                __atomic_sub_fetch(&MP_STATE_MEM(gc_mark_idle), 1, __ATOMIC_SEQ_CST);
+                break;
+            }
+            MICROPY_GC_PARALLEL_MARK_YIELD();
+        }
+    }
+}
+
+STATIC void gc_mark_run_parallel(void) {
+    MP_STATE_MEM(gc_mark_rescan) = false;
+    for (;;) {
+        MP_STATE_MEM(gc_mark_idle) = 0;
+        MP_STATE_MEM(gc_mark_done) = false;
+        gc_port_run_markers(MP_STATE_MEM(gc_mark_threads));
+        if (!MP_STATE_MEM(gc_stack_overflow)) {
+            break;
+        }
+        MP_STATE_MEM(gc_stack_overflow) = 0;
+        MP_STATE_MEM(gc_mark_rescan) = true;
+    }
+    MP_STATE_MEM(gc_mark_parallel) = false;
+}
+#endif
+
+#if MICROPY_ENABLE_FINALISER
+STATIC void gc_call_finaliser(mp_obj_base_t *obj) {
+    if (obj->type != NULL) {
+        // if the object has a type then see if it has a __del__ method
+        mp_obj_t dest[2];
+        mp_load_method_maybe(MP_OBJ_FROM_PTR(obj), MP_QSTR___del__, dest);
+        if (dest[0] != MP_OBJ_NULL) {
+            // load_method returned a method, execute it in a protected environment
+            #if MICROPY_ENABLE_SCHEDULER
+            mp_sched_lock();
+            #endif
+            mp_call_function_1_protected(dest[0], dest[1]);
+            #if MICROPY_ENABLE_SCHEDULER
+            mp_sched_unlock();
+            #endif
+        }
+    }
+}
+#endif
+
+#if MICROPY_GC_FINALISER_LIST
+// Add a newly allocated object to the finaliser list, growing the list if
+// needed.  The object is kept alive meanwhile by the caller's reference.
+STATIC bool gc_finaliser_add(void *ptr) {
+    for (;;) {
+        GC_ENTER();
+        size_t alloc = MP_STATE_MEM(gc_finaliser_alloc);
+        if (MP_STATE_MEM(gc_finaliser_len) < alloc) {
+            MP_STATE_MEM(gc_finaliser_list)[MP_STATE_MEM(gc_finaliser_len)++] = ptr;
+            GC_EXIT();
+            return true;
+        }
+        GC_EXIT();
+        void **list = gc_alloc((alloc * 2 + 4) * sizeof(void*), 0);
+        if (list == NULL) {
+            return false;
+        }
+        GC_ENTER();
+        void **old_list = MP_STATE_MEM(gc_finaliser_list);
+        if (MP_STATE_MEM(gc_finaliser_alloc) == alloc) {
+            if (old_list != NULL) {
+                memcpy(list, old_list, MP_STATE_MEM(gc_finaliser_len) * sizeof(void*));
+            }
+            MP_STATE_MEM(gc_finaliser_list) = list;
+            MP_STATE_MEM(gc_finaliser_alloc) = alloc * 2 + 4;
+        } else {
+            // another thread has grown the list already
+            old_list = list;
+        }
+        GC_EXIT();
+        gc_free(old_list);
+    }
+}
+
+// Remove entry i from the finaliser list, keeping the pending ones first.
+STATIC void gc_finaliser_remove(size_t i) {
+    void **list = MP_STATE_MEM(gc_finaliser_list);
+    #if MICROPY_GC_FINALISER_DEFERRED
+    if (i < MP_STATE_MEM(gc_finaliser_pending)) {
+        size_t last_pending = --MP_STATE_MEM(gc_finaliser_pending);
+        list[i] = list[last_pending];
+        i = last_pending;
+    }
+    #endif
+    list[i] = list[--MP_STATE_MEM(gc_finaliser_len)];
+}
+
+// Called once everything reachable has been marked.  The list isn't traced,
+// so that it doesn't keep the objects in it alive, but it must be kept
+// itself.  Unreachable objects in it have their finaliser called now, or are
+// made pending and kept (along with everything they refer to) until it's
+// called from the scheduler.
+STATIC void gc_finaliser_pass(void) {
+    void **list = MP_STATE_MEM(gc_finaliser_list);
+    if (list == NULL) {
+        return;
+    }
+    mp_state_mem_area_t *area = gc_get_ptr_area(list);
+    size_t block = BLOCK_FROM_PTR(area, list);
+    if (ATB_GET_KIND(area, block) == AT_HEAD) {
+        ATB_HEAD_TO_MARK(area, block);
+    }
+
+    size_t i = 0;
+    #if MICROPY_GC_FINALISER_DEFERRED
+    gc_collect_root(list, MP_STATE_MEM(gc_finaliser_pending));
+    i = MP_STATE_MEM(gc_finaliser_pending);
+    #endif
+    while (i < MP_STATE_MEM(gc_finaliser_len)) {
+        void *ptr = list[i];
+        area = gc_get_ptr_area(ptr);
+        block = BLOCK_FROM_PTR(area, ptr);
+        if (ATB_GET_KIND(area, block) == AT_MARK) {
+            i += 1;
+            continue;
+        }
+        #if MICROPY_GC_FINALISER_DEFERRED
+        size_t pending = MP_STATE_MEM(gc_finaliser_pending)++;
+        list[i] = list[pending];
+        list[pending] = ptr;
+        gc_collect_root(&list[pending], 1);
+        i += 1;
+        #else
+        gc_finaliser_remove(i);
+        FTB_CLEAR(area, block);
+        gc_call_finaliser((mp_obj_base_t*)ptr);
+        #endif
+    }
+    #if MICROPY_GC_FINALISER_DEFERRED
+    gc_deal_with_stack_overflow();
+    #endif
+}
+#endif
+
+#if MICROPY_GC_FINALISER_DEFERRED
+// Called from the scheduler to call the finalisers of pending objects.
+STATIC mp_obj_t gc_finaliser_run(mp_obj_t arg) {
+    (void)arg;
+    MP_STATE_MEM(gc_finaliser_scheduled) = false;
+    for (;;) {
+        GC_ENTER();
+        if (MP_STATE_MEM(gc_finaliser_pending) == 0) {
+            GC_EXIT();
+            break;
+        }
+        // once out of the list the object is only kept by this reference
+        void *ptr = MP_STATE_MEM(gc_finaliser_list)[MP_STATE_MEM(gc_finaliser_pending) - 1];
+        gc_finaliser_remove(MP_STATE_MEM(gc_finaliser_pending) - 1);
+        mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+        FTB_CLEAR(area, BLOCK_FROM_PTR(area, ptr));
+        GC_EXIT();
+        gc_call_finaliser((mp_obj_base_t*)ptr);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(gc_finaliser_run_obj, gc_finaliser_run);
+#endif
+
 STATIC void gc_sweep(void) {
     #if MICROPY_PY_GC_COLLECT_RETVAL
     MP_STATE_MEM(gc_collected) = 0;
     #endif
     // free unmarked heads and their tails
-    int free_tail = 0;
-    for (size_t block = 0; block < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB; block++) {
-        switch (ATB_GET_KIND(block)) {
-            case AT_HEAD:
-#if MICROPY_ENABLE_FINALISER
-                if (FTB_GET(block)) {
-                    mp_obj_base_t *obj = (mp_obj_base_t*)PTR_FROM_BLOCK(block);
-                    if (obj->type != NULL) {
-                        // if the object has a type then see if it has a __del__ method
-                        mp_obj_t dest[2];
-                        mp_load_method_maybe(MP_OBJ_FROM_PTR(obj), MP_QSTR___del__, dest);
-                        if (dest[0] != MP_OBJ_NULL) {
-                            // load_method returned a method, execute it in a protected environment
-                            #if MICROPY_ENABLE_SCHEDULER
-                            mp_sched_lock();
-                            #endif
-                            mp_call_function_1_protected(dest[0], dest[1]);
-                            #if MICROPY_ENABLE_SCHEDULER
-                            mp_sched_unlock();
-                            #endif
-                        }
+    for (mp_state_mem_area_t *area = FIRST_AREA(); area != NULL; area = NEXT_AREA(area)) {
+        int free_tail = 0;
+        #if MICROPY_GC_SIZE_CLASSES
+        // rebuild the free lists as the area is swept
+        memset(area->gc_free_runs, 0, sizeof(area->gc_free_runs));
+        size_t free_run = 0;
+        #endif
+        for (size_t block = 0; block < area->gc_alloc_table_byte_len * BLOCKS_PER_ATB; block++) {
+            #if MICROPY_GC_FINALISER_LIST || !MICROPY_ENABLE_FINALISER
+            // With no finalisers to look for, an ATB byte of free blocks, or
+            // of the tail of a chain, can be dealt with in one go.
+            if ((block & (BLOCKS_PER_ATB - 1)) == 0) {
+                byte *a = &area->gc_alloc_table_start[block / BLOCKS_PER_ATB];
+                if (*a == AT_TAIL * 0x55 && free_tail) {
+                    *a = 0;
+                    #if CLEAR_ON_SWEEP
+                    memset((void*)PTR_FROM_BLOCK(area, block), 0, BLOCKS_PER_ATB * BYTES_PER_BLOCK);
+                    #endif
+                }
+                if (*a == 0 || *a == AT_TAIL * 0x55) {
+                    #if MICROPY_GC_SIZE_CLASSES
+                    if (*a == 0) {
+                        free_run += BLOCKS_PER_ATB;
                     }
-                    // clear finaliser flag
-                    FTB_CLEAR(block);
+                    #endif
+                    block += BLOCKS_PER_ATB - 1;
+                    continue;
                 }
+            }
+            #endif
+            switch (ATB_GET_KIND(area, block)) {
+                case AT_HEAD:
+#if MICROPY_ENABLE_FINALISER && !MICROPY_GC_FINALISER_LIST
+                    if (FTB_GET(area, block)) {
+                        gc_call_finaliser((mp_obj_base_t*)PTR_FROM_BLOCK(area, block));
+                        // clear finaliser flag
+                        FTB_CLEAR(area, block);
+                    }
 #endif
-                free_tail = 1;
-                DEBUG_printf("gc_sweep(%p)\n", PTR_FROM_BLOCK(block));
-                #if MICROPY_PY_GC_COLLECT_RETVAL
-                MP_STATE_MEM(gc_collected)++;
-                #endif
-                // fall through to free the head
-
-            case AT_TAIL:
-                if (free_tail) {
-                    ATB_ANY_TO_FREE(block);
-                    #if CLEAR_ON_SWEEP
-                    memset((void*)PTR_FROM_BLOCK(block), 0, BYTES_PER_BLOCK);
+                    free_tail = 1;
+                    DEBUG_printf("gc_sweep(%p)\n", PTR_FROM_BLOCK(area, block));
+                    #if MICROPY_PY_GC_COLLECT_RETVAL
+                    MP_STATE_MEM(gc_collected)++;
                     #endif
-                }
-                break;
+                    // fall through to free the head
+
+                case AT_TAIL:
+                    if (free_tail) {
+                        ATB_ANY_TO_FREE(area, block);
+                        #if CLEAR_ON_SWEEP
+                        memset((void*)PTR_FROM_BLOCK(area, block), 0, BYTES_PER_BLOCK);
+                        #endif
+                    }
+                    break;
 
-            case AT_MARK:
-                ATB_MARK_TO_HEAD(block);
-                free_tail = 0;
-                break;
+                case AT_MARK:
+                    ATB_MARK_TO_HEAD(area, block);
+                    free_tail = 0;
+                    break;
+            }
+            #if MICROPY_GC_SIZE_CLASSES
+            if (ATB_GET_KIND(area, block) == AT_FREE) {
+                free_run += 1;
+            } else if (free_run != 0) {
+                gc_add_free_run(area, block - free_run, free_run);
+                free_run = 0;
+            }
+            #endif
         }
+        #if MICROPY_GC_SIZE_CLASSES
+        if (free_run != 0) {
+            gc_add_free_run(area, area->gc_alloc_table_byte_len * BLOCKS_PER_ATB - free_run, free_run);
+        }
+        #endif
     }
 }
 
@@ -325,6 +939,20 @@ void gc_collect_start(void) {
     #endif
     MP_STATE_MEM(gc_stack_overflow) = 0;
 
+    #if MICROPY_GC_PARALLEL_MARK
+    // Mark in parallel if the heap is big enough.  Until gc_collect_end the
+    // roots are only marked and pushed, for the markers to trace.
+    size_t heap_bytes = 0;
+    for (mp_state_mem_area_t *area = FIRST_AREA(); area != NULL; area = NEXT_AREA(area)) {
+        heap_bytes += area->gc_pool_end - area->gc_pool_start;
+    }
+    MP_STATE_MEM(gc_mark_parallel) = MP_STATE_MEM(gc_mark_threads) > 1 && heap_bytes >= MICROPY_GC_PARALLEL_MARK_MIN_HEAP;
+    for (size_t i = 0; i < MP_STATE_MEM(gc_mark_threads); i++) {
+        MP_STATE_MEM(gc_mark_deque)[i].top = 0;
+        MP_STATE_MEM(gc_mark_deque)[i].bottom = 0;
+    }
+    #endif
+
     // Trace root pointers.  This relies on the root pointers being organised
     // correctly in the mp_state_ctx structure.  We scan nlr_top, dict_locals,
     // dict_globals, then the root pointer section of mp_state_vm.
@@ -333,7 +961,10 @@ void gc_collect_start(void) {
     size_t root_end = offsetof(mp_state_ctx_t, vm.qstr_last_chunk);
     gc_collect_root(ptrs + root_start / sizeof(void*), (root_end - root_start) / sizeof(void*));
 
-    #if MICROPY_ENABLE_PYSTACK
+    #if MICROPY_PYSTACK_GROW
+    // Trace root pointers from the Python stack.
+    mp_pystack_gc_collect();
+    #elif MICROPY_ENABLE_PYSTACK
     // Trace root pointers from the Python stack.
     ptrs = (void**)(void*)MP_STATE_THREAD(pystack_start);
     gc_collect_root(ptrs, (MP_STATE_THREAD(pystack_cur) - MP_STATE_THREAD(pystack_start)) / sizeof(void*));
@@ -343,88 +974,133 @@ void gc_collect_start(void) {
 void gc_collect_root(void **ptrs, size_t len) {
     for (size_t i = 0; i < len; i++) {
         void *ptr = ptrs[i];
-        if (VERIFY_PTR(ptr)) {
-            size_t block = BLOCK_FROM_PTR(ptr);
-            if (ATB_GET_KIND(block) == AT_HEAD) {
+        mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+        if (area != NULL) {
+            size_t block = BLOCK_FROM_PTR(area, ptr);
+            if (ATB_GET_KIND(area, block) == AT_HEAD) {
                 // An unmarked head: mark it, and mark all its children
                 TRACE_MARK(block, ptr);
-                ATB_HEAD_TO_MARK(block);
-                gc_mark_subtree(block);
+                ATB_HEAD_TO_MARK(area, block);
+                #if MICROPY_GC_PARALLEL_MARK
+                if (MP_STATE_MEM(gc_mark_parallel)) {
+                    gc_mark_push(&MP_STATE_MEM(gc_mark_deque)[0], ptr);
+                    continue;
+                }
+                #endif
+                gc_mark_subtree(area, block);
             }
         }
     }
 }
 
 void gc_collect_end(void) {
+    #if MICROPY_GC_PARALLEL_MARK
+    if (MP_STATE_MEM(gc_mark_parallel)) {
+        gc_mark_run_parallel();
+    }
+    #endif
     gc_deal_with_stack_overflow();
+    #if MICROPY_GC_FINALISER_LIST
+    gc_finaliser_pass();
+    #endif
     gc_sweep();
-    MP_STATE_MEM(gc_last_free_atb_index) = 0;
+    #if MICROPY_GC_SPLIT_HEAP_AUTO
+    gc_shrink_heap();
+    #endif
+    for (mp_state_mem_area_t *area = FIRST_AREA(); area != NULL; area = NEXT_AREA(area)) {
+        area->gc_last_free_atb_index = 0;
+    }
     MP_STATE_MEM(gc_lock_depth)--;
     GC_EXIT();
+    #if MICROPY_GC_FINALISER_DEFERRED
+    if (MP_STATE_MEM(gc_finaliser_pending) != 0 && !MP_STATE_MEM(gc_finaliser_scheduled)) {
+        // if the scheduler is full this is tried again after the next collection
+        MP_STATE_MEM(gc_finaliser_scheduled) = mp_sched_schedule(MP_OBJ_FROM_PTR(&gc_finaliser_run_obj), mp_const_none);
+    }
+    #endif
 }
 
 void gc_sweep_all(void) {
+    #if MICROPY_GC_FINALISER_DEFERRED
+    // The finalisers can't wait for the scheduler here.  Objects only reachable
+    // from a pending one are made pending by the next pass, so repeat until
+    // none are left.
+    for (;;) {
+        GC_ENTER();
+        MP_STATE_MEM(gc_lock_depth)++;
+        MP_STATE_MEM(gc_stack_overflow) = 0;
+        gc_collect_end();
+        if (MP_STATE_MEM(gc_finaliser_pending) == 0) {
+            break;
+        }
+        gc_finaliser_run(mp_const_none);
+    }
+    #else
     GC_ENTER();
     MP_STATE_MEM(gc_lock_depth)++;
     MP_STATE_MEM(gc_stack_overflow) = 0;
     gc_collect_end();
+    #endif
 }
 
 void gc_info(gc_info_t *info) {
     GC_ENTER();
-    info->total = MP_STATE_MEM(gc_pool_end) - MP_STATE_MEM(gc_pool_start);
+    info->total = 0;
     info->used = 0;
     info->free = 0;
     info->max_free = 0;
     info->num_1block = 0;
     info->num_2block = 0;
     info->max_block = 0;
-    bool finish = false;
-    for (size_t block = 0, len = 0, len_free = 0; !finish;) {
-        size_t kind = ATB_GET_KIND(block);
-        switch (kind) {
-            case AT_FREE:
-                info->free += 1;
-                len_free += 1;
-                len = 0;
-                break;
-
-            case AT_HEAD:
-                info->used += 1;
-                len = 1;
-                break;
-
-            case AT_TAIL:
-                info->used += 1;
-                len += 1;
-                break;
-
-            case AT_MARK:
-                // shouldn't happen
-                break;
-        }
-
-        block++;
-        finish = (block == MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB);
-        // Get next block type if possible
-        if (!finish) {
-            kind = ATB_GET_KIND(block);
-        }
-
-        if (finish || kind == AT_FREE || kind == AT_HEAD) {
-            if (len == 1) {
-                info->num_1block += 1;
-            } else if (len == 2) {
-                info->num_2block += 1;
+    for (mp_state_mem_area_t *area = FIRST_AREA(); area != NULL; area = NEXT_AREA(area)) {
+        info->total += area->gc_pool_end - area->gc_pool_start;
+        bool finish = false;
+        for (size_t block = 0, len = 0, len_free = 0; !finish;) {
+            size_t kind = ATB_GET_KIND(area, block);
+            switch (kind) {
+                case AT_FREE:
+                    info->free += 1;
+                    len_free += 1;
+                    len = 0;
+                    break;
+
+                case AT_HEAD:
+                    info->used += 1;
+                    len = 1;
+                    break;
+
+                case AT_TAIL:
+                    info->used += 1;
+                    len += 1;
+                    break;
+
+                case AT_MARK:
+                    // shouldn't happen
+                    break;
             }
-            if (len > info->max_block) {
-                info->max_block = len;
+
+            block++;
+            finish = (block == area->gc_alloc_table_byte_len * BLOCKS_PER_ATB);
+            // Get next block type if possible
+            if (!finish) {
+                kind = ATB_GET_KIND(area, block);
             }
-            if (finish || kind == AT_HEAD) {
-                if (len_free > info->max_free) {
-                    info->max_free = len_free;
+
+            if (finish || kind == AT_FREE || kind == AT_HEAD) {
+                if (len == 1) {
+                    info->num_1block += 1;
+                } else if (len == 2) {
+                    info->num_2block += 1;
+                }
+                if (len > info->max_block) {
+                    info->max_block = len;
+                }
+                if (finish || kind == AT_HEAD) {
+                    if (len_free > info->max_free) {
+                        info->max_free = len_free;
+                    }
+                    len_free = 0;
                 }
-                len_free = 0;
             }
         }
     }
@@ -452,10 +1128,13 @@ void *gc_alloc(size_t n_bytes, unsigned int alloc_flags) {
         return NULL;
     }
 
+    #if !MICROPY_GC_SIZE_CLASSES
     size_t i;
+    size_t n_free;
+    #endif
     size_t end_block;
     size_t start_block;
-    size_t n_free;
+    mp_state_mem_area_t *area;
     int collected = !MP_STATE_MEM(gc_auto_collect_enabled);
 
     #if MICROPY_GC_ALLOC_THRESHOLD
@@ -469,19 +1148,55 @@ void *gc_alloc(size_t n_bytes, unsigned int alloc_flags) {
 
     for (;;) {
 
-        // look for a run of n_blocks available blocks
-        n_free = 0;
-        for (i = MP_STATE_MEM(gc_last_free_atb_index); i < MP_STATE_MEM(gc_alloc_table_byte_len); i++) {
-            byte a = MP_STATE_MEM(gc_alloc_table_start)[i];
-            if (ATB_0_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 0; goto found; } } else { n_free = 0; }
-            if (ATB_1_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 1; goto found; } } else { n_free = 0; }
-            if (ATB_2_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 2; goto found; } } else { n_free = 0; }
-            if (ATB_3_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 3; goto found; } } else { n_free = 0; }
+        #if MICROPY_GC_SIZE_CLASSES
+        for (area = FIRST_AREA(); area != NULL; area = NEXT_AREA(area)) {
+            gc_free_run_t *run = gc_find_free_run(area, n_blocks);
+            if (run != NULL) {
+                // take the blocks from the end of the run, which keeps its place
+                // unless it moves to a smaller size class
+                gc_unlink_free_run(area, run);
+                run->len -= n_blocks;
+                start_block = BLOCK_FROM_PTR(area, run) + run->len;
+                end_block = start_block + n_blocks - 1;
+                if (run->len != 0) {
+                    gc_link_free_run(area, run);
+                }
+                goto found;
+            }
         }
+        #else
+        for (area = FIRST_AREA(); area != NULL; area = NEXT_AREA(area)) {
+            // look for a run of n_blocks available blocks
+            n_free = 0;
+            for (i = area->gc_last_free_atb_index; i < area->gc_alloc_table_byte_len; i++) {
+                byte a = area->gc_alloc_table_start[i];
+                if (ATB_0_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 0; goto found; } } else { n_free = 0; }
+                if (ATB_1_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 1; goto found; } } else { n_free = 0; }
+                if (ATB_2_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 2; goto found; } } else { n_free = 0; }
+                if (ATB_3_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 3; goto found; } } else { n_free = 0; }
+            }
+            #if MICROPY_GC_SPLIT_HEAP
+            // Nothing fits in this area, so when a single block was wanted it
+            // has no free blocks past its free index, which can move to the
+            // end.  Otherwise a full area at the start of the list is scanned
+            // on every allocation.
+            if (n_blocks == 1) {
+                area->gc_last_free_atb_index = area->gc_alloc_table_byte_len;
+            }
+            #endif
+        }
+        #endif
 
         GC_EXIT();
         // nothing found!
         if (collected) {
+            #if MICROPY_GC_SPLIT_HEAP_AUTO
+            // try to get more memory from the port, then search again
+            if (gc_grow_heap(n_blocks)) {
+                GC_ENTER();
+                continue;
+            }
+            #endif
             return NULL;
         }
         DEBUG_printf("gc_alloc(" UINT_FMT "): no free mem, triggering GC\n", n_bytes);
@@ -492,6 +1207,7 @@ void *gc_alloc(size_t n_bytes, unsigned int alloc_flags) {
 
     // found, ending at block i inclusive
 found:
+    #if !MICROPY_GC_SIZE_CLASSES
     // get starting and end blocks, both inclusive
     end_block = i;
     start_block = i - n_free + 1;
@@ -502,21 +1218,22 @@ found:
     // before this one.  Also, whenever we free or shink a block we must check
     // if this index needs adjusting (see gc_realloc and gc_free).
     if (n_free == 1) {
-        MP_STATE_MEM(gc_last_free_atb_index) = (i + 1) / BLOCKS_PER_ATB;
+        area->gc_last_free_atb_index = (i + 1) / BLOCKS_PER_ATB;
     }
+    #endif
 
     // mark first block as used head
-    ATB_FREE_TO_HEAD(start_block);
+    ATB_FREE_TO_HEAD(area, start_block);
 
     // mark rest of blocks as used tail
     // TODO for a run of many blocks can make this more efficient
     for (size_t bl = start_block + 1; bl <= end_block; bl++) {
-        ATB_FREE_TO_TAIL(bl);
+        ATB_FREE_TO_TAIL(area, bl);
     }
 
     // get pointer to first block
     // we must create this pointer before unlocking the GC so a collection can find it
-    void *ret_ptr = (void*)(MP_STATE_MEM(gc_pool_start) + start_block * BYTES_PER_BLOCK);
+    void *ret_ptr = (void*)PTR_FROM_BLOCK(area, start_block);
     DEBUG_printf("gc_alloc(%p)\n", ret_ptr);
 
     #if MICROPY_GC_ALLOC_THRESHOLD
@@ -541,9 +1258,15 @@ found:
     if (has_finaliser) {
         // clear type pointer in case it is never set
         ((mp_obj_base_t*)ret_ptr)->type = NULL;
+        #if MICROPY_GC_FINALISER_LIST
+        if (!gc_finaliser_add(ret_ptr)) {
+            gc_free(ret_ptr);
+            return NULL;
+        }
+        #endif
         // set mp_obj flag only if it has a finaliser
         GC_ENTER();
-        FTB_SET(start_block);
+        FTB_SET(area, start_block);
         GC_EXIT();
     }
     #else
@@ -583,24 +1306,41 @@ void gc_free(void *ptr) {
         GC_EXIT();
     } else {
         // get the GC block number corresponding to this pointer
-        assert(VERIFY_PTR(ptr));
-        size_t block = BLOCK_FROM_PTR(ptr);
-        assert(ATB_GET_KIND(block) == AT_HEAD);
+        mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+        assert(area != NULL);
+        size_t block = BLOCK_FROM_PTR(area, ptr);
+        assert(ATB_GET_KIND(area, block) == AT_HEAD);
 
         #if MICROPY_ENABLE_FINALISER
-        FTB_CLEAR(block);
+        #if MICROPY_GC_FINALISER_LIST
+        if (FTB_GET(area, block)) {
+            size_t i = 0;
+            while (MP_STATE_MEM(gc_finaliser_list)[i] != ptr) {
+                i += 1;
+            }
+            gc_finaliser_remove(i);
+        }
+        #endif
+        FTB_CLEAR(area, block);
         #endif
 
         // set the last_free pointer to this block if it's earlier in the heap
-        if (block / BLOCKS_PER_ATB < MP_STATE_MEM(gc_last_free_atb_index)) {
-            MP_STATE_MEM(gc_last_free_atb_index) = block / BLOCKS_PER_ATB;
+        if (block / BLOCKS_PER_ATB < area->gc_last_free_atb_index) {
+            area->gc_last_free_atb_index = block / BLOCKS_PER_ATB;
         }
 
         // free head and all of its tail blocks
+        #if MICROPY_GC_SIZE_CLASSES
+        size_t start_block = block;
+        #endif
         do {
-            ATB_ANY_TO_FREE(block);
+            ATB_ANY_TO_FREE(area, block);
             block += 1;
-        } while (ATB_GET_KIND(block) == AT_TAIL);
+        } while (ATB_GET_KIND(area, block) == AT_TAIL);
+
+        #if MICROPY_GC_SIZE_CLASSES
+        gc_add_free_run(area, start_block, block - start_block);
+        #endif
 
         GC_EXIT();
 
@@ -612,14 +1352,15 @@ void gc_free(void *ptr) {
 
 size_t gc_nbytes(const void *ptr) {
     GC_ENTER();
-    if (VERIFY_PTR(ptr)) {
-        size_t block = BLOCK_FROM_PTR(ptr);
-        if (ATB_GET_KIND(block) == AT_HEAD) {
+    mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+    if (area != NULL) {
+        size_t block = BLOCK_FROM_PTR(area, ptr);
+        if (ATB_GET_KIND(area, block) == AT_HEAD) {
             // work out number of consecutive blocks in the chain starting with this on
             size_t n_blocks = 0;
             do {
                 n_blocks += 1;
-            } while (ATB_GET_KIND(block + n_blocks) == AT_TAIL);
+            } while (ATB_GET_KIND(area, block + n_blocks) == AT_TAIL);
             GC_EXIT();
             return n_blocks * BYTES_PER_BLOCK;
         }
@@ -642,7 +1383,7 @@ void *gc_realloc(void *ptr, mp_uint_t n_bytes) {
             has_finaliser = false;
         } else {
 #if MICROPY_ENABLE_FINALISER
-            has_finaliser = FTB_GET(BLOCK_FROM_PTR((mp_uint_t)ptr));
+            has_finaliser = FTB_GET(area, BLOCK_FROM_PTR(area, (mp_uint_t)ptr));
 #else
             has_finaliser = false;
 #endif
@@ -681,9 +1422,10 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     }
 
     // get the GC block number corresponding to this pointer
-    assert(VERIFY_PTR(ptr));
-    size_t block = BLOCK_FROM_PTR(ptr);
-    assert(ATB_GET_KIND(block) == AT_HEAD);
+    mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+    assert(area != NULL);
+    size_t block = BLOCK_FROM_PTR(area, ptr);
+    assert(ATB_GET_KIND(area, block) == AT_HEAD);
 
     // compute number of new blocks that are requested
     size_t new_blocks = (n_bytes + BYTES_PER_BLOCK - 1) / BYTES_PER_BLOCK;
@@ -696,9 +1438,9 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     // efficiently shrink it (see below for shrinking code).
     size_t n_free   = 0;
     size_t n_blocks = 1; // counting HEAD block
-    size_t max_block = MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB;
+    size_t max_block = area->gc_alloc_table_byte_len * BLOCKS_PER_ATB;
     for (size_t bl = block + n_blocks; bl < max_block; bl++) {
-        byte block_type = ATB_GET_KIND(bl);
+        byte block_type = ATB_GET_KIND(area, bl);
         if (block_type == AT_TAIL) {
             n_blocks++;
             continue;
@@ -724,14 +1466,18 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     if (new_blocks < n_blocks) {
         // free unneeded tail blocks
         for (size_t bl = block + new_blocks, count = n_blocks - new_blocks; count > 0; bl++, count--) {
-            ATB_ANY_TO_FREE(bl);
+            ATB_ANY_TO_FREE(area, bl);
         }
 
         // set the last_free pointer to end of this block if it's earlier in the heap
-        if ((block + new_blocks) / BLOCKS_PER_ATB < MP_STATE_MEM(gc_last_free_atb_index)) {
-            MP_STATE_MEM(gc_last_free_atb_index) = (block + new_blocks) / BLOCKS_PER_ATB;
+        if ((block + new_blocks) / BLOCKS_PER_ATB < area->gc_last_free_atb_index) {
+            area->gc_last_free_atb_index = (block + new_blocks) / BLOCKS_PER_ATB;
         }
 
+        #if MICROPY_GC_SIZE_CLASSES
+        gc_add_free_run(area, block + new_blocks, n_blocks - new_blocks);
+        #endif
+
         GC_EXIT();
 
         #if EXTENSIVE_HEAP_PROFILING
@@ -743,10 +1489,14 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
 
     // check if we can expand in place
     if (new_blocks <= n_blocks + n_free) {
+        #if MICROPY_GC_SIZE_CLASSES
+        gc_take_free_blocks(area, block + n_blocks, new_blocks - n_blocks);
+        #endif
+
         // mark few more blocks as used tail
         for (size_t bl = block + n_blocks; bl < block + new_blocks; bl++) {
-            assert(ATB_GET_KIND(bl) == AT_FREE);
-            ATB_FREE_TO_TAIL(bl);
+            assert(ATB_GET_KIND(area, bl) == AT_FREE);
+            ATB_FREE_TO_TAIL(area, bl);
         }
 
         GC_EXIT();
@@ -767,7 +1517,7 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     }
 
     #if MICROPY_ENABLE_FINALISER
-    bool ftb_state = FTB_GET(block);
+    bool ftb_state = FTB_GET(area, block);
     #else
     bool ftb_state = false;
     #endif
@@ -801,115 +1551,127 @@ void gc_dump_info(void) {
         (uint)info.total, (uint)info.used, (uint)info.free);
     mp_printf(&mp_plat_print, " No. of 1-blocks: %u, 2-blocks: %u, max blk sz: %u, max free sz: %u\n",
            (uint)info.num_1block, (uint)info.num_2block, (uint)info.max_block, (uint)info.max_free);
+    #if MICROPY_GC_SPLIT_HEAP_AUTO
+    if (MP_STATE_MEM(gc_grow_count) != 0) {
+        size_t n_areas = 0;
+        for (mp_state_mem_area_t *area = FIRST_AREA(); area != NULL; area = NEXT_AREA(area)) {
+            n_areas += 1;
+        }
+        mp_printf(&mp_plat_print, " Regions: %u, grown: %u times, shrunk: %u times\n",
+            (uint)n_areas, (uint)MP_STATE_MEM(gc_grow_count), (uint)MP_STATE_MEM(gc_shrink_count));
+    }
+    #endif
 }
 
 void gc_dump_alloc_table(void) {
     GC_ENTER();
     static const size_t DUMP_BYTES_PER_LINE = 64;
-    #if !EXTENSIVE_HEAP_PROFILING
-    // When comparing heap output we don't want to print the starting
-    // pointer of the heap because it changes from run to run.
-    mp_printf(&mp_plat_print, "GC memory layout; from %p:", MP_STATE_MEM(gc_pool_start));
-    #endif
-    for (size_t bl = 0; bl < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB; bl++) {
-        if (bl % DUMP_BYTES_PER_LINE == 0) {
-            // a new line of blocks
-            {
-                // check if this line contains only free blocks
-                size_t bl2 = bl;
-                while (bl2 < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB && ATB_GET_KIND(bl2) == AT_FREE) {
-                    bl2++;
-                }
-                if (bl2 - bl >= 2 * DUMP_BYTES_PER_LINE) {
-                    // there are at least 2 lines containing only free blocks, so abbreviate their printing
-                    mp_printf(&mp_plat_print, "\n       (%u lines all free)", (uint)(bl2 - bl) / DUMP_BYTES_PER_LINE);
-                    bl = bl2 & (~(DUMP_BYTES_PER_LINE - 1));
-                    if (bl >= MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB) {
-                        // got to end of heap
-                        break;
-                    }
-                }
-            }
-            // print header for new line of blocks
-            // (the cast to uint32_t is for 16-bit ports)
-            //mp_printf(&mp_plat_print, "\n%05x: ", (uint)(PTR_FROM_BLOCK(bl) & (uint32_t)0xfffff));
-            mp_printf(&mp_plat_print, "\n%05x: ", (uint)((bl * BYTES_PER_BLOCK) & (uint32_t)0xfffff));
-        }
-        int c = ' ';
-        switch (ATB_GET_KIND(bl)) {
-            case AT_FREE: c = '.'; break;
-            /* this prints out if the object is reachable from BSS or STACK (for unix only)
-            case AT_HEAD: {
-                c = 'h';
-                void **ptrs = (void**)(void*)&mp_state_ctx;
-                mp_uint_t len = offsetof(mp_state_ctx_t, vm.stack_top) / sizeof(mp_uint_t);
-                for (mp_uint_t i = 0; i < len; i++) {
-                    mp_uint_t ptr = (mp_uint_t)ptrs[i];
-                    if (VERIFY_PTR(ptr) && BLOCK_FROM_PTR(ptr) == bl) {
-                        c = 'B';
-                        break;
+    for (mp_state_mem_area_t *area = FIRST_AREA(); area != NULL; area = NEXT_AREA(area)) {
+        #if !EXTENSIVE_HEAP_PROFILING
+        // When comparing heap output we don't want to print the starting
+        // pointer of the heap because it changes from run to run.
+        mp_printf(&mp_plat_print, "GC memory layout; from %p:", area->gc_pool_start);
+        #endif
+        for (size_t bl = 0; bl < area->gc_alloc_table_byte_len * BLOCKS_PER_ATB; bl++) {
+            if (bl % DUMP_BYTES_PER_LINE == 0) {
+                // a new line of blocks
+                {
+                    // check if this line contains only free blocks
+                    size_t bl2 = bl;
+                    while (bl2 < area->gc_alloc_table_byte_len * BLOCKS_PER_ATB && ATB_GET_KIND(area, bl2) == AT_FREE) {
+                        bl2++;
                     }
-                }
-                if (c == 'h') {
-                    ptrs = (void**)&c;
-                    len = ((mp_uint_t)MP_STATE_THREAD(stack_top) - (mp_uint_t)&c) / sizeof(mp_uint_t);
-                    for (mp_uint_t i = 0; i < len; i++) {
-                        mp_uint_t ptr = (mp_uint_t)ptrs[i];
-                        if (VERIFY_PTR(ptr) && BLOCK_FROM_PTR(ptr) == bl) {
-                            c = 'S';
+                    if (bl2 - bl >= 2 * DUMP_BYTES_PER_LINE) {
+                        // there are at least 2 lines containing only free blocks, so abbreviate their printing
+                        mp_printf(&mp_plat_print, "\n       (%u lines all free)", (uint)(bl2 - bl) / DUMP_BYTES_PER_LINE);
+                        bl = bl2 & (~(DUMP_BYTES_PER_LINE - 1));
+                        if (bl >= area->gc_alloc_table_byte_len * BLOCKS_PER_ATB) {
+                            // got to end of heap
                             break;
                         }
                     }
                 }
-                break;
+                // print header for new line of blocks
+                // (the cast to uint32_t is for 16-bit ports)
+                //mp_printf(&mp_plat_print, "\n%05x: ", (uint)(PTR_FROM_BLOCK(area, bl) & (uint32_t)0xfffff));
+                mp_printf(&mp_plat_print, "\n%05x: ", (uint)((bl * BYTES_PER_BLOCK) & (uint32_t)0xfffff));
             }
-            */
-            /* this prints the uPy object type of the head block */
-            case AT_HEAD: {
-                void **ptr = (void**)(MP_STATE_MEM(gc_pool_start) + bl * BYTES_PER_BLOCK);
-                if (*ptr == &mp_type_tuple) { c = 'T'; }
-                else if (*ptr == &mp_type_list) { c = 'L'; }
-                else if (*ptr == &mp_type_dict) { c = 'D'; }
-                else if (*ptr == &mp_type_str || *ptr == &mp_type_bytes) { c = 'S'; }
-                #if MICROPY_PY_BUILTINS_BYTEARRAY
-                else if (*ptr == &mp_type_bytearray) { c = 'A'; }
-                #endif
-                #if MICROPY_PY_ARRAY
-                else if (*ptr == &mp_type_array) { c = 'A'; }
-                #endif
-                #if MICROPY_PY_BUILTINS_FLOAT
-                else if (*ptr == &mp_type_float) { c = 'F'; }
-                #endif
-                else if (*ptr == &mp_type_fun_bc) { c = 'B'; }
-                else if (*ptr == &mp_type_module) { c = 'M'; }
-                else {
+            int c = ' ';
+            switch (ATB_GET_KIND(area, bl)) {
+                case AT_FREE: c = '.'; break;
+                /* this prints out if the object is reachable from BSS or STACK (for unix only)
+                case AT_HEAD: {
                     c = 'h';
-                    #if 0
-                    // This code prints "Q" for qstr-pool data, and "q" for qstr-str
-                    // data.  It can be useful to see how qstrs are being allocated,
-                    // but is disabled by default because it is very slow.
-                    for (qstr_pool_t *pool = MP_STATE_VM(last_pool); c == 'h' && pool != NULL; pool = pool->prev) {
-                        if ((qstr_pool_t*)ptr == pool) {
-                            c = 'Q';
+                    void **ptrs = (void**)(void*)&mp_state_ctx;
+                    mp_uint_t len = offsetof(mp_state_ctx_t, vm.stack_top) / sizeof(mp_uint_t);
+                    for (mp_uint_t i = 0; i < len; i++) {
+                        mp_uint_t ptr = (mp_uint_t)ptrs[i];
+                        if (VERIFY_PTR(area, ptr) && BLOCK_FROM_PTR(area, ptr) == bl) {
+                            c = 'B';
                             break;
                         }
-                        for (const byte **q = pool->qstrs, **q_top = pool->qstrs + pool->len; q < q_top; q++) {
-                            if ((const byte*)ptr == *q) {
-                                c = 'q';
+                    }
+                    if (c == 'h') {
+                        ptrs = (void**)&c;
+                        len = ((mp_uint_t)MP_STATE_THREAD(stack_top) - (mp_uint_t)&c) / sizeof(mp_uint_t);
+                        for (mp_uint_t i = 0; i < len; i++) {
+                            mp_uint_t ptr = (mp_uint_t)ptrs[i];
+                            if (VERIFY_PTR(area, ptr) && BLOCK_FROM_PTR(area, ptr) == bl) {
+                                c = 'S';
                                 break;
                             }
                         }
                     }
+                    break;
+                }
+                */
+                /* this prints the uPy object type of the head block */
+                case AT_HEAD: {
+                    void **ptr = (void**)PTR_FROM_BLOCK(area, bl);
+                    if (*ptr == &mp_type_tuple) { c = 'T'; }
+                    else if (*ptr == &mp_type_list) { c = 'L'; }
+                    else if (*ptr == &mp_type_dict) { c = 'D'; }
+                    else if (*ptr == &mp_type_str || *ptr == &mp_type_bytes) { c = 'S'; }
+                    #if MICROPY_PY_BUILTINS_BYTEARRAY
+                    else if (*ptr == &mp_type_bytearray) { c = 'A'; }
+                    #endif
+                    #if MICROPY_PY_ARRAY
+                    else if (*ptr == &mp_type_array) { c = 'A'; }
+                    #endif
+                    #if MICROPY_PY_BUILTINS_FLOAT
+                    else if (*ptr == &mp_type_float) { c = 'F'; }
                     #endif
+                    else if (*ptr == &mp_type_fun_bc) { c = 'B'; }
+                    else if (*ptr == &mp_type_module) { c = 'M'; }
+                    else {
+                        c = 'h';
+                        #if 0
+                        // This code prints "Q" for qstr-pool data, and "q" for qstr-str
+                        // data.  It can be useful to see how qstrs are being allocated,
+                        // but is disabled by default because it is very slow.
+                        for (qstr_pool_t *pool = MP_STATE_VM(last_pool); c == 'h' && pool != NULL; pool = pool->prev) {
+                            if ((qstr_pool_t*)ptr == pool) {
+                                c = 'Q';
+                                break;
+                            }
+                            for (const byte **q = pool->qstrs, **q_top = pool->qstrs + pool->len; q < q_top; q++) {
+                                if ((const byte*)ptr == *q) {
+                                    c = 'q';
+                                    break;
+                                }
+                            }
+                        }
+                        #endif
+                    }
+                    break;
                 }
-                break;
+                case AT_TAIL: c = '='; break;
+                case AT_MARK: c = 'm'; break;
             }
-            case AT_TAIL: c = '='; break;
-            case AT_MARK: c = 'm'; break;
+            mp_printf(&mp_plat_print, "%c", c);
         }
-        mp_printf(&mp_plat_print, "%c", c);
+        mp_print_str(&mp_plat_print, "\n");
     }
-    mp_print_str(&mp_plat_print, "\n");
     GC_EXIT();
 }
 
@@ -33,6 +33,31 @@
 
 void gc_init(void *start, void *end);
 
+#if MICROPY_GC_SPLIT_HEAP
+// Add another region of memory to the heap; it can be called at any time
+// after gc_init, and the memory must stay available until the heap is reset.
+void gc_add_region(void *start, void *end);
+#endif
+
+#if MICROPY_GC_SPLIT_HEAP_AUTO
+// These must be provided by the port.  gc_port_new_region is called when the
+// heap is full even after a collection; it should return a new region of at
+// least *len bytes and set *len to its actual size, or return NULL if the heap
+// may not grow.  gc_port_free_region gives such a region back.
+void *gc_port_new_region(size_t *len);
+void gc_port_free_region(void *start, size_t len);
+#endif
+
+#if MICROPY_GC_PARALLEL_MARK
+// Set the number of threads that mark the heap, from 1 (the default) up to
+// MICROPY_GC_PARALLEL_MARK.  gc_port_run_markers must be provided by the port:
+// it should call gc_mark_worker(i) for each i from 1 to n - 1 on other threads
+// while it calls gc_mark_worker(0) itself, and return once they all have.
+void gc_set_mark_threads(size_t n);
+void gc_port_run_markers(size_t n);
+void gc_mark_worker(size_t id);
+#endif
+
 // These lock/unlock functions can be nested.
 // They can be used to prevent the GC from allocating/freeing.
 void gc_lock(void);
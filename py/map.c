@@ -76,13 +76,172 @@ STATIC size_t get_hash_alloc_greater_or_equal_to(size_t x) {
 /******************************************************************************/
 /* map                                                                        */
 
+#if MICROPY_OPT_MAP_COMPACT
+
+// A compact map keeps its entries densely in table[0:alloc], in the order they
+// were added.  Removed entries have their key set to MP_OBJ_SENTINEL and are
+// squeezed out the next time the table is rebuilt.
+//
+// A map of up to MAP_LINEAR_MAX entries whose keys are all qstrs, strs or small
+// ints (so they can be compared cheaply and without side effects) is searched
+// linearly and needs nothing else; the end of the used entries is marked by a
+// NULL key.  Bigger maps, and maps with other kinds of keys, are followed in
+// the same allocation by a map_index_t giving the number of entries used and a
+// hash table of entry positions plus one, 1, 2 or 4 bytes each, with 0 marking
+// an empty bucket.
+//
+// The open-addressed table used otherwise is only grown once it's completely
+// full, so it has no empty slots to pay for the index with.  To keep the extra
+// memory small the index header is one word, and the entries of small maps
+// grow by 1/8 at a time (see mp_map_rehash).
+#define MAP_LINEAR_MAX (8)
+
+typedef struct _map_index_t {
+    size_t filled : (8 * sizeof(size_t) - 5); // number of entries used, including removed ones
+    size_t log2_buckets : 5;
+    byte buckets[];
+} map_index_t;
+
+static inline bool map_is_linear(size_t alloc) {
+    return alloc <= MAP_LINEAR_MAX;
+}
+
+static inline bool map_key_is_simple(mp_obj_t key) {
+    return mp_obj_is_small_int(key) || mp_obj_is_str(key);
+}
+
+static inline size_t map_index_width(size_t alloc) {
+    return alloc < 0xff ? 1 : alloc < 0xffff ? 2 : 4;
+}
+
+STATIC size_t map_index_log2_buckets(size_t alloc) {
+    // keep the index at most 4/5 full
+    size_t n = 4;
+    while (((size_t)1 << n) < alloc + alloc / 4) {
+        n += 1;
+    }
+    return n;
+}
+
+STATIC size_t map_table_bytes(size_t alloc) {
+    size_t n = alloc * sizeof(mp_map_elem_t);
+    if (!map_is_linear(alloc)) {
+        n += sizeof(map_index_t) + ((size_t)1 << map_index_log2_buckets(alloc)) * map_index_width(alloc);
+    }
+    return n;
+}
+
+static inline map_index_t *map_get_index(const mp_map_t *map) {
+    return (map_index_t*)&map->table[map->alloc];
+}
+
+static inline size_t map_index_mask(const map_index_t *index) {
+    return ((size_t)1 << index->log2_buckets) - 1;
+}
+
+static inline size_t map_bucket_get(const map_index_t *index, size_t width, size_t pos) {
+    if (width == 1) {
+        return index->buckets[pos];
+    } else if (width == 2) {
+        return ((const uint16_t*)index->buckets)[pos];
+    } else {
+        return ((const uint32_t*)index->buckets)[pos];
+    }
+}
+
+static inline void map_bucket_set(map_index_t *index, size_t width, size_t pos, size_t value) {
+    if (width == 1) {
+        index->buckets[pos] = value;
+    } else if (width == 2) {
+        ((uint16_t*)index->buckets)[pos] = value;
+    } else {
+        ((uint32_t*)index->buckets)[pos] = value;
+    }
+}
+
+STATIC mp_uint_t map_hash(mp_obj_t key) {
+    if (mp_obj_is_qstr(key)) {
+        return qstr_hash(MP_OBJ_QSTR_VALUE(key));
+    } else {
+        return MP_OBJ_SMALL_INT_VALUE(mp_unary_op(MP_UNARY_OP_HASH, key));
+    }
+}
+
+STATIC size_t map_filled(const mp_map_t *map) {
+    if (map_is_linear(map->alloc)) {
+        size_t n = map->alloc;
+        while (n > 0 && map->table[n - 1].key == MP_OBJ_NULL) {
+            --n;
+        }
+        return n;
+    } else {
+        return map_get_index(map)->filled;
+    }
+}
+
+STATIC mp_map_elem_t *map_table_new(size_t alloc) {
+    mp_map_elem_t *table = m_malloc0(map_table_bytes(alloc));
+    if (!map_is_linear(alloc)) {
+        map_index_t *index = (map_index_t*)&table[alloc];
+        index->log2_buckets = map_index_log2_buckets(alloc);
+    }
+    return table;
+}
+
+STATIC void map_table_free(mp_map_t *map) {
+    if (map->is_fixed) {
+        return;
+    }
+    if (map->is_ordered) {
+        m_del(mp_map_elem_t, map->table, map->alloc);
+    } else {
+        m_free(map->table
+            #if MICROPY_MALLOC_USES_ALLOCATED_SIZE
+            , map_table_bytes(map->alloc)
+            #endif
+            );
+    }
+}
+
+// Append a new entry to the map, which must have room for it and not already
+// contain the key.
+STATIC mp_map_elem_t *map_append(mp_map_t *map, mp_obj_t key, mp_uint_t hash) {
+    mp_map_elem_t *elem;
+    if (map_is_linear(map->alloc)) {
+        elem = &map->table[map_filled(map)];
+    } else {
+        map_index_t *index = map_get_index(map);
+        size_t width = map_index_width(map->alloc);
+        size_t mask = map_index_mask(index);
+        size_t pos = hash & mask;
+        while (map_bucket_get(index, width, pos) != 0) {
+            pos = (pos + 1) & mask;
+        }
+        map_bucket_set(index, width, pos, index->filled + 1);
+        elem = &map->table[index->filled++];
+    }
+    map->used += 1;
+    elem->key = key;
+    elem->value = MP_OBJ_NULL;
+    if (!mp_obj_is_qstr(key)) {
+        map->all_keys_are_qstrs = 0;
+    }
+    return elem;
+}
+
+#endif
+
 void mp_map_init(mp_map_t *map, size_t n) {
     if (n == 0) {
         map->alloc = 0;
         map->table = NULL;
     } else {
         map->alloc = n;
+        #if MICROPY_OPT_MAP_COMPACT
+        map->table = map_table_new(n);
+        #else
         map->table = m_new0(mp_map_elem_t, map->alloc);
+        #endif
     }
     map->used = 0;
     map->all_keys_are_qstrs = 1;
@@ -99,18 +258,39 @@ void mp_map_init_fixed_table(mp_map_t *map, size_t n, const mp_obj_t *table) {
     map->table = (mp_map_elem_t*)table;
 }
 
+// Initialise map to be a copy of src; the new map is never fixed.
+void mp_map_init_copy(mp_map_t *map, const mp_map_t *src) {
+    *map = *src;
+    map->is_fixed = 0;
+    #if MICROPY_OPT_MAP_COMPACT
+    size_t n = src->is_ordered ? src->alloc * sizeof(mp_map_elem_t) : map_table_bytes(src->alloc);
+    #else
+    size_t n = src->alloc * sizeof(mp_map_elem_t);
+    #endif
+    map->table = m_malloc(n);
+    memcpy(map->table, src->table, n);
+}
+
 // Differentiate from mp_map_clear() - semantics is different
 void mp_map_deinit(mp_map_t *map) {
+    #if MICROPY_OPT_MAP_COMPACT
+    map_table_free(map);
+    #else
     if (!map->is_fixed) {
         m_del(mp_map_elem_t, map->table, map->alloc);
     }
+    #endif
     map->used = map->alloc = 0;
 }
 
 void mp_map_clear(mp_map_t *map) {
+    #if MICROPY_OPT_MAP_COMPACT
+    map_table_free(map);
+    #else
     if (!map->is_fixed) {
         m_del(mp_map_elem_t, map->table, map->alloc);
     }
+    #endif
     map->alloc = 0;
     map->used = 0;
     map->all_keys_are_qstrs = 1;
@@ -118,6 +298,48 @@ void mp_map_clear(mp_map_t *map) {
     map->table = NULL;
 }
 
+#if MICROPY_OPT_MAP_COMPACT
+
+// Rebuild the table to make room for at least one more entry, dropping any
+// removed entries.  If need_index is true then the new table will be indexed.
+STATIC void mp_map_rehash(mp_map_t *map, bool need_index) {
+    size_t old_alloc = map->alloc;
+    size_t old_filled = old_alloc == 0 ? 0 : map_filled(map);
+    size_t new_alloc = get_hash_alloc_greater_or_equal_to(map->used + 1);
+    if (!map_is_linear(new_alloc) || !map_is_linear(old_alloc) || need_index) {
+        // grow small maps in small steps, to leave few entries unused, and
+        // bigger ones by 1/4 so they aren't rebuilt too often
+        new_alloc = map->used + map->used / (map->used < 256 ? 8 : 4) + 1;
+        // once a map has keys that need hashing it stays indexed
+        if (map_is_linear(new_alloc)) {
+            new_alloc = MAP_LINEAR_MAX + 1;
+        }
+        // entries can be added one at a time, so fill up the last GC block
+        size_t n = (map_table_bytes(new_alloc) + MICROPY_BYTES_PER_GC_BLOCK - 1) & ~(MICROPY_BYTES_PER_GC_BLOCK - 1);
+        while (map_table_bytes(new_alloc + 1) <= n) {
+            new_alloc += 1;
+        }
+    }
+    DEBUG_printf("mp_map_rehash(%p): " UINT_FMT " -> " UINT_FMT "\n", map, old_alloc, new_alloc);
+    mp_map_t old_map = *map;
+    mp_map_elem_t *new_table = map_table_new(new_alloc);
+    // If we reach this point, table resizing succeeded, now we can edit the old map.
+    map->alloc = new_alloc;
+    map->used = 0;
+    map->all_keys_are_qstrs = 1;
+    map->table = new_table;
+    for (size_t i = 0; i < old_filled; i++) {
+        mp_map_elem_t *old_elem = &old_map.table[i];
+        if (old_elem->key != MP_OBJ_NULL && old_elem->key != MP_OBJ_SENTINEL) {
+            mp_uint_t hash = map_is_linear(new_alloc) ? 0 : map_hash(old_elem->key);
+            map_append(map, old_elem->key, hash)->value = old_elem->value;
+        }
+    }
+    map_table_free(&old_map);
+}
+
+#else
+
 STATIC void mp_map_rehash(mp_map_t *map) {
     size_t old_alloc = map->alloc;
     size_t new_alloc = get_hash_alloc_greater_or_equal_to(map->alloc + 1);
@@ -137,6 +359,8 @@ STATIC void mp_map_rehash(mp_map_t *map) {
     m_del(mp_map_elem_t, old_table, old_alloc);
 }
 
+#endif
+
 // MP_MAP_LOOKUP behaviour:
 //  - returns NULL if not found, else the slot it was found in with key,value non-null
 // MP_MAP_LOOKUP_ADD_IF_NOT_FOUND behaviour:
@@ -208,6 +432,104 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
 
     // map is a hash table (not an ordered array), so do a hash lookup
 
+    #if MICROPY_OPT_MAP_COMPACT
+
+    if (map->alloc == 0) {
+        if (lookup_kind == MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
+            mp_map_rehash(map, !map_key_is_simple(index));
+        } else {
+            return NULL;
+        }
+    }
+
+    mp_uint_t hash = 0;
+
+    if (map_is_linear(map->alloc)) {
+        // all keys are simple so only compare those that could be equal to index
+        bool index_is_simple = map_key_is_simple(index);
+        if (!index_is_simple) {
+            hash = map_hash(index);
+        }
+        mp_map_elem_t *elem = &map->table[0], *top = &map->table[map->alloc];
+        for (; elem < top && elem->key != MP_OBJ_NULL; elem++) {
+            mp_obj_t key = elem->key;
+            if (key != index) {
+                if (compare_only_ptrs || key == MP_OBJ_SENTINEL) {
+                    continue;
+                } else if (index_is_simple) {
+                    if (mp_obj_is_small_int(index) || mp_obj_is_small_int(key) || !mp_obj_equal(key, index)) {
+                        continue;
+                    }
+                } else if (map_hash(key) != hash || !mp_obj_equal(key, index)) {
+                    continue;
+                }
+            }
+            // found index
+            if (lookup_kind == MP_MAP_LOOKUP_REMOVE_IF_FOUND) {
+                map->used--;
+                if (elem + 1 == top || elem[1].key == MP_OBJ_NULL) {
+                    // trim removed entries from the end of the table
+                    elem->key = MP_OBJ_NULL;
+                    for (mp_map_elem_t *e = elem; e > map->table && e[-1].key == MP_OBJ_SENTINEL; --e) {
+                        e[-1].key = MP_OBJ_NULL;
+                    }
+                } else {
+                    elem->key = MP_OBJ_SENTINEL;
+                }
+                // keep elem->value so that caller can access it if needed
+            }
+            return elem;
+        }
+        if (lookup_kind != MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
+            return NULL;
+        }
+        if (index_is_simple && elem < top) {
+            return map_append(map, index, 0);
+        }
+        mp_map_rehash(map, !index_is_simple);
+        if (map_is_linear(map->alloc)) {
+            return map_append(map, index, 0);
+        }
+        if (index_is_simple) {
+            hash = map_hash(index);
+        }
+        return map_append(map, index, hash);
+    }
+
+    hash = map_hash(index);
+    map_index_t *map_index = map_get_index(map);
+    size_t width = map_index_width(map->alloc);
+    size_t mask = map_index_mask(map_index);
+    for (size_t pos = hash & mask;; pos = (pos + 1) & mask) {
+        size_t n = map_bucket_get(map_index, width, pos);
+        if (n == 0) {
+            // found empty bucket, so index is not in table
+            break;
+        }
+        mp_map_elem_t *elem = &map->table[n - 1];
+        if (elem->key == index || (!compare_only_ptrs && elem->key != MP_OBJ_SENTINEL && mp_obj_equal(elem->key, index))) {
+            // found index
+            // Note: CPython does not replace the index; try x={True:'true'};x[1]='one';x
+            if (lookup_kind == MP_MAP_LOOKUP_REMOVE_IF_FOUND) {
+                // the bucket keeps pointing to the removed entry until the next rehash
+                map->used--;
+                elem->key = MP_OBJ_SENTINEL;
+                // keep elem->value so that caller can access it if needed
+            }
+            return elem;
+        }
+    }
+
+    if (lookup_kind != MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
+        return NULL;
+    }
+    if (map_index->filled == map->alloc) {
+        mp_map_rehash(map, true);
+    }
+    return map_append(map, index, hash);
+
+    #else
+
     if (map->alloc == 0) {
         if (lookup_kind == MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
             mp_map_rehash(map);
@@ -293,6 +615,8 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
             }
         }
     }
+
+    #endif
 }
 
 /******************************************************************************/
@@ -62,6 +62,7 @@ endif
 
 MAKE_FROZEN = $(PYTHON) $(TOP)/tools/make-frozen.py
 MPY_CROSS = $(TOP)/mpy-cross/mpy-cross
+MPY_CROSS_JOBS ?= $(shell nproc 2>/dev/null)
 MPY_TOOL = $(PYTHON) $(TOP)/tools/mpy-tool.py
 
 all:
@@ -111,16 +111,24 @@ $(TOP)/mpy-cross/mpy-cross: $(TOP)/py/*.[ch] $(TOP)/mpy-cross/*.[ch] $(TOP)/port
 FROZEN_MPY_PY_FILES := $(shell find -L $(FROZEN_MPY_DIR) -type f -name '*.py' | $(SED) -e 's=^$(FROZEN_MPY_DIR)/==')
 FROZEN_MPY_MPY_FILES := $(addprefix $(BUILD)/frozen_mpy/,$(FROZEN_MPY_PY_FILES:.py=.mpy))
 
-# to build .mpy files from .py files
-$(BUILD)/frozen_mpy/%.mpy: $(FROZEN_MPY_DIR)/%.py $(TOP)/mpy-cross/mpy-cross
-	@$(ECHO) "MPY $<"
-	$(Q)$(MKDIR) -p $(dir $@)
-	$(Q)$(MPY_CROSS) -o $@ -s $(<:$(FROZEN_MPY_DIR)/%=%) $(MPY_CROSS_FLAGS) $<
+# to build .mpy files from .py files; those that are out of date or missing
+# (or all of them if mpy-cross changed) are compiled by a single run of
+# mpy-cross, from within FROZEN_MPY_DIR so their source names are relative to it
+FROZEN_MPY_STAMP = $(BUILD)/frozen_mpy/.stamp
+FROZEN_MPY_MISSING = $(strip $(foreach f,$(FROZEN_MPY_PY_FILES),$(if $(wildcard $(BUILD)/frozen_mpy/$(f:.py=.mpy)),,$(f))))
+FROZEN_MPY_UPDATE = $(if $(filter $(TOP)/mpy-cross/mpy-cross,$?),$(FROZEN_MPY_PY_FILES),$(sort $(patsubst $(FROZEN_MPY_DIR)/%,%,$(filter-out FORCE,$?)) $(FROZEN_MPY_MISSING)))
+$(FROZEN_MPY_STAMP): $(addprefix $(FROZEN_MPY_DIR)/,$(FROZEN_MPY_PY_FILES)) $(TOP)/mpy-cross/mpy-cross $(if $(FROZEN_MPY_MISSING),FORCE)
+	@$(ECHO) "MPY $(FROZEN_MPY_DIR): $(words $(FROZEN_MPY_UPDATE)) files"
+	$(Q)$(MKDIR) -p $(sort $(dir $(addprefix $(BUILD)/frozen_mpy/,$(FROZEN_MPY_UPDATE))))
+	$(Q)cd $(FROZEN_MPY_DIR) && $(abspath $(MPY_CROSS)) -o $(abspath $(BUILD)/frozen_mpy)/ $(if $(MPY_CROSS_JOBS),-j $(MPY_CROSS_JOBS)) $(MPY_CROSS_FLAGS) $(FROZEN_MPY_UPDATE)
+	$(Q)touch $@
+
+$(FROZEN_MPY_MPY_FILES): $(FROZEN_MPY_STAMP) ;
 
 # to build frozen_mpy.c from all .mpy files
 $(BUILD)/frozen_mpy.c: $(FROZEN_MPY_MPY_FILES) $(BUILD)/genhdr/qstrdefs.generated.h
 	@$(ECHO) "GEN $@"
-	$(Q)$(MPY_TOOL) -f -q $(BUILD)/genhdr/qstrdefs.preprocessed.h $(FROZEN_MPY_MPY_FILES) > $@
+	$(Q)$(MPY_TOOL) -f -q $(BUILD)/genhdr/qstrdefs.preprocessed.h $(MPY_TOOL_FLAGS) $(FROZEN_MPY_MPY_FILES) > $@
 endif
 
 ifneq ($(PROG),)
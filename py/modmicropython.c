@@ -78,6 +78,12 @@ mp_obj_t mp_micropython_mem_info(size_t n_args, const mp_obj_t *args) {
 #else
     mp_printf(&mp_plat_print, "stack: " UINT_FMT "\n", mp_stack_usage());
 #endif
+#if MICROPY_VFS_IMPORT_CACHE
+    if (MP_STATE_VM(vfs_import_fs_ops) != 0) {
+        mp_printf(&mp_plat_print, "import stat: filesystem=%u, cached=%u\n",
+            (uint)MP_STATE_VM(vfs_import_fs_ops), (uint)MP_STATE_VM(vfs_import_cached));
+    }
+#endif
 #if MICROPY_ENABLE_GC
     gc_dump_info();
     if (n_args == 1) {
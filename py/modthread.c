@@ -175,6 +175,14 @@ STATIC void *thread_entry(void *args_in) {
     mp_locals_set(args->dict_locals);
     mp_globals_set(args->dict_globals);
 
+    #if MICROPY_OPT_GEN_RECYCLE
+    MP_STATE_THREAD(gen_spare) = NULL;
+    #endif
+
+    #if MICROPY_EXC_TRACEBACK_BUF
+    MP_STATE_THREAD(tb_owner) = NULL;
+    #endif
+
     MP_THREAD_GIL_ENTER();
 
     // signal that we are set up and running
@@ -205,6 +213,11 @@ STATIC void *thread_entry(void *args_in) {
         }
     }
 
+    #if MICROPY_EXC_TRACEBACK_BUF
+    // an exception kept by this thread must not point into ts once it's gone
+    mp_obj_exception_release_traceback_buf();
+    #endif
+
     DEBUG_printf("[thread] finish ts=%p\n", &ts);
 
     // signal that we are finished
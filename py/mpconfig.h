@@ -148,6 +148,72 @@
 #define MICROPY_GC_ALLOC_THRESHOLD (1)
 #endif
 
+// Whether the GC heap can be made of several discontiguous regions, added
+// after gc_init with gc_add_region
+#ifndef MICROPY_GC_SPLIT_HEAP
+#define MICROPY_GC_SPLIT_HEAP (0)
+#endif
+
+// Whether gc_alloc asks the port for a new heap region when it runs out of
+// memory, and gives back added regions once they stay empty.  Requires the port
+// to provide gc_port_new_region and gc_port_free_region.
+#ifndef MICROPY_GC_SPLIT_HEAP_AUTO
+#define MICROPY_GC_SPLIT_HEAP_AUTO (0)
+#endif
+
+// Number of collections in a row after which an added region must be empty
+// before it is given back to the port
+#ifndef MICROPY_GC_SPLIT_HEAP_AUTO_IDLE
+#define MICROPY_GC_SPLIT_HEAP_AUTO_IDLE (4)
+#endif
+
+// Number of size classes of free lists that the GC keeps runs of free blocks
+// in, so gc_alloc doesn't need to scan the allocation table (0 to disable).
+// Class n holds runs of 2**n to 2**(n+1)-1 blocks, and the last class any
+// longer runs too.  The lists are kept in the free blocks themselves.
+#ifndef MICROPY_GC_SIZE_CLASSES
+#define MICROPY_GC_SIZE_CLASSES (0)
+#endif
+
+// Whether objects with a finaliser are kept in a list, so that the sweep
+// doesn't need to check every block it frees for one, and all finalisers are
+// called before any memory is freed (requires MICROPY_ENABLE_FINALISER)
+#ifndef MICROPY_GC_FINALISER_LIST
+#define MICROPY_GC_FINALISER_LIST (0)
+#endif
+
+// Whether finalisers are called from the scheduler once a collection is over,
+// rather than by the collector with the heap locked.  Unreachable objects are
+// kept until their finaliser has run (requires MICROPY_GC_FINALISER_LIST and
+// MICROPY_ENABLE_SCHEDULER)
+#ifndef MICROPY_GC_FINALISER_DEFERRED
+#define MICROPY_GC_FINALISER_DEFERRED (0)
+#endif
+
+// Maximum number of threads that can mark the heap in parallel during a
+// collection (0 to always mark from the collecting thread only).  Requires the
+// compiler's __atomic builtins, and the port to provide gc_port_run_markers.
+#ifndef MICROPY_GC_PARALLEL_MARK
+#define MICROPY_GC_PARALLEL_MARK (0)
+#endif
+
+// Number of entries in each parallel marker's stack of objects still to be
+// scanned (must be a power of 2).  If one fills up the heap is rescanned.
+#ifndef MICROPY_GC_PARALLEL_MARK_STACK_SIZE
+#define MICROPY_GC_PARALLEL_MARK_STACK_SIZE (4096)
+#endif
+
+// Called by a parallel marker that is waiting for more work
+#ifndef MICROPY_GC_PARALLEL_MARK_YIELD
+#define MICROPY_GC_PARALLEL_MARK_YIELD()
+#endif
+
+// Heap size below which a collection is always marked by one thread, because
+// starting the other markers would take longer than marking
+#ifndef MICROPY_GC_PARALLEL_MARK_MIN_HEAP
+#define MICROPY_GC_PARALLEL_MARK_MIN_HEAP (4 * 1024 * 1024)
+#endif
+
 // Number of bytes to allocate initially when creating new chunks to store
 // interned string data.  Smaller numbers lead to more chunks being needed
 // and more wastage at the end of the chunk.  Larger numbers lead to wasted
@@ -272,6 +338,37 @@
 #define MICROPY_PERSISTENT_CODE_SAVE (0)
 #endif
 
+// Whether to support loading execute-in-place .mpy images, whose bytecode is
+// run from the memory holding the image (eg a mapped file or flash) with its
+// qstrs resolved through a per-module table
+#ifndef MICROPY_PERSISTENT_CODE_XIP
+#define MICROPY_PERSISTENT_CODE_XIP (0)
+#endif
+
+// Whether the nested functions of a .mpy file are only skipped over on import
+// and loaded on their first call: for an execute-in-place image in memory just
+// their constants are loaded then, and otherwise, if the file can seek, all of
+// the function is read again from the file, which is opened again from the path
+// that import used.  Either way this allocates, so such a function can't first
+// be called while the heap is locked (requires MICROPY_PERSISTENT_CODE_XIP)
+#ifndef MICROPY_PERSISTENT_CODE_LAZY
+#define MICROPY_PERSISTENT_CODE_LAZY (0)
+#endif
+
+// Whether the line-number tables of bytecode loaded from a .mpy file are left
+// in the file, and only read from it when a traceback is printed
+// (requires MICROPY_ENABLE_SOURCE_LINE and a file reader)
+#ifndef MICROPY_PERSISTENT_CODE_LAZY_LINES
+#define MICROPY_PERSISTENT_CODE_LAZY_LINES (0)
+#endif
+
+// Whether importing a .py file keeps a compiled copy of it in a .mpc file
+// next to it, which is loaded instead while the source is unchanged
+// (requires MICROPY_VFS and both loading and saving of persistent code)
+#ifndef MICROPY_PERSISTENT_CODE_CACHE
+#define MICROPY_PERSISTENT_CODE_CACHE (0)
+#endif
+
 // Whether generated code can persist independently of the VM/runtime instance
 // This is enabled automatically when needed by other features
 #ifndef MICROPY_PERSISTENT_CODE
@@ -389,6 +486,33 @@
 #define MICROPY_COMP_RETURN_IF_EXPR (0)
 #endif
 
+// Whether "from <module> import <name>" can inline a constant declared with
+// const() in another module; the values are supplied by the compiler driver
+// in MP_STATE_VM(parse_const_modules), see mpy-cross
+#ifndef MICROPY_COMP_CONST_IMPORT
+#define MICROPY_COMP_CONST_IMPORT (0)
+#endif
+
+// Whether to enable extra constant folding of comparisons and conditional
+// expressions whose operands are constant, eg DEBUG > 1 with DEBUG = const(0)
+#ifndef MICROPY_COMP_CONST_FOLDING_EXTRA
+#define MICROPY_COMP_CONST_FOLDING_EXTRA (0)
+#endif
+
+// Whether the bytecode emitter does peephole optimisations: jump threading,
+// removal of unreachable code after a jump/return/raise, and removal of a
+// constant or DUP_TOP that is immediately popped
+#ifndef MICROPY_COMP_PEEPHOLE
+#define MICROPY_COMP_PEEPHOLE (0)
+#endif
+
+// Whether to compile each top-level def/class of file input as soon as it is
+// parsed, and then free its parse nodes, so that peak compiler RAM depends on
+// the largest definition rather than on the size of the whole file
+#ifndef MICROPY_COMP_STREAMING
+#define MICROPY_COMP_STREAMING (0)
+#endif
+
 /*****************************************************************************/
 /* Internal debugging stuff                                                  */
 
@@ -442,6 +566,23 @@
 #define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE (0)
 #endif
 
+// Whether maps (dicts, globals, instance members) keep their entries densely
+// in insertion order with a separate small hash index, and search small maps of
+// str and small int keys linearly.  Makes dicts iterate in insertion order and
+// speeds up failed lookups, at the cost of a little extra code ROM, and RAM for
+// the index of maps of more than 8 entries (a few percent of their size).
+#ifndef MICROPY_OPT_MAP_COMPACT
+#define MICROPY_OPT_MAP_COMPACT (0)
+#endif
+
+// Whether a generator expression passed as the sole argument to a builtin that
+// just consumes it (eg sum, any, all, list) has its frame freed as soon as the
+// call returns, with the most recent one kept for reuse by the next generator.
+// Saves a heap allocation per evaluation of such expressions.
+#ifndef MICROPY_OPT_GEN_RECYCLE
+#define MICROPY_OPT_GEN_RECYCLE (0)
+#endif
+
 // Whether to use fast versions of bitwise operations (and, or, xor) when the
 // arguments are both positive.  Increases Thumb2 code size by about 250 bytes.
 #ifndef MICROPY_OPT_MPZ_BITWISE
@@ -511,6 +652,19 @@
 #define MICROPY_ENABLE_PYSTACK (0)
 #endif
 
+// Whether the pystack grows when it's full, by chaining segments allocated from
+// the GC heap (requires MICROPY_ENABLE_PYSTACK).  A segment is given back as
+// soon as nothing in it is in use, apart from one kept for the next time the
+// stack grows.  Small function call states stay on the C stack.
+#ifndef MICROPY_PYSTACK_GROW
+#define MICROPY_PYSTACK_GROW (0)
+#endif
+
+// Minimum size in bytes of a segment added to the pystack
+#ifndef MICROPY_PYSTACK_SEGMENT_SIZE
+#define MICROPY_PYSTACK_SEGMENT_SIZE (1024)
+#endif
+
 // Number of bytes that memory returned by mp_pystack_alloc will be aligned by.
 #ifndef MICROPY_PYSTACK_ALIGN
 #define MICROPY_PYSTACK_ALIGN (8)
@@ -532,6 +686,21 @@
 #   endif
 #endif
 
+// Number of traceback entries kept in a per-thread buffer for the exception
+// being raised, so that unwinding doesn't allocate.  The entries are moved to
+// the heap only when another exception needs the buffer, or when there are
+// more of them.  Set to 0 to always record tracebacks on the heap.
+#ifndef MICROPY_EXC_TRACEBACK_BUF
+#define MICROPY_EXC_TRACEBACK_BUF (0)
+#endif
+
+// Whether mp_raise_OSError raises preallocated instances for EAGAIN and
+// ETIMEDOUT, which non-blocking and timeout-based I/O see in normal operation.
+// As with the KeyboardInterrupt object, the same instance is raised each time.
+#ifndef MICROPY_OSERROR_PREALLOC
+#define MICROPY_OSERROR_PREALLOC (0)
+#endif
+
 // Whether to provide the mp_kbd_exception object, and micropython.kbd_intr function
 #ifndef MICROPY_KBD_EXCEPTION
 #define MICROPY_KBD_EXCEPTION (0)
@@ -748,6 +917,13 @@ typedef double mp_float_t;
 #define MICROPY_VFS (0)
 #endif
 
+// Whether mp_vfs_import_stat answers from a cache of directory listings, and
+// the most entries a directory can have to be cached.  The cache is dropped
+// when the filesystem is changed or remounted through the VFS functions.
+#ifndef MICROPY_VFS_IMPORT_CACHE
+#define MICROPY_VFS_IMPORT_CACHE (0)
+#endif
+
 // Support for VFS POSIX component, to mount a POSIX filesystem within VFS
 #ifndef MICROPY_VFS
 #define MICROPY_VFS_POSIX (0)
@@ -780,6 +956,27 @@ typedef double mp_float_t;
 #define MICROPY_PY_DESCRIPTORS (0)
 #endif
 
+// Whether to store instance attributes in a compact array described by a
+// shape shared between instances, instead of a hash table per instance
+#ifndef MICROPY_PY_INSTANCE_SHAPES
+#define MICROPY_PY_INSTANCE_SHAPES (0)
+#endif
+
+// Maximum number of attributes an instance can have before it falls back to
+// a hash table, and the maximum number of shapes that can be created
+#ifndef MICROPY_PY_INSTANCE_SHAPES_MAX_ATTRS
+#define MICROPY_PY_INSTANCE_SHAPES_MAX_ATTRS (16)
+#endif
+#ifndef MICROPY_PY_INSTANCE_SHAPES_MAX
+#define MICROPY_PY_INSTANCE_SHAPES_MAX (256)
+#endif
+
+// Whether to support __slots__ in classes, giving instances a fixed set of
+// attributes stored inline (requires MICROPY_PY_INSTANCE_SHAPES)
+#ifndef MICROPY_PY_SLOTS
+#define MICROPY_PY_SLOTS (0)
+#endif
+
 // Whether to support class __delattr__ and __setattr__ methods
 // This costs some code size and makes store/delete of instance
 // attributes slower for the classes that use this feature
@@ -806,11 +1003,36 @@ typedef double mp_float_t;
 #define MICROPY_PY_STR_BYTES_CMP_WARN (0)
 #endif
 
+// Whether slicing a str/bytes object may return a view which shares the data
+// of the original object, instead of allocating a copy of the data
+#ifndef MICROPY_PY_STR_SLICE_VIEW
+#define MICROPY_PY_STR_SLICE_VIEW (0)
+#endif
+
+// Minimum length (in bytes) of a str/bytes slice for it to be made a view
+#ifndef MICROPY_PY_STR_SLICE_VIEW_MIN_LEN
+#define MICROPY_PY_STR_SLICE_VIEW_MIN_LEN (32)
+#endif
+
+// Whether in-place concatenation (+=) of str/bytes objects appends to a growable
+// buffer shared by the results, so that repeated += takes linear time in total
+// (the results are views into the buffer, see MICROPY_PY_STR_SLICE_VIEW)
+#ifndef MICROPY_PY_STR_INPLACE_CONCAT
+#define MICROPY_PY_STR_INPLACE_CONCAT (0)
+#endif
+
 // Whether str object is proper unicode
 #ifndef MICROPY_PY_BUILTINS_STR_UNICODE
 #define MICROPY_PY_BUILTINS_STR_UNICODE (0)
 #endif
 
+// Number of recently used unicode str indices to cache (0 to disable).  An index
+// maps char positions to byte offsets so that indexing a long non-ASCII str doesn't
+// need to walk its UTF-8 data from the start.  Requires MICROPY_PY_BUILTINS_STR_UNICODE.
+#ifndef MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+#define MICROPY_PY_BUILTINS_STR_UNICODE_INDEX (0)
+#endif
+
 // Whether to check for valid UTF-8 when converting bytes to str
 #ifndef MICROPY_PY_BUILTINS_STR_UNICODE_CHECK
 #define MICROPY_PY_BUILTINS_STR_UNICODE_CHECK (MICROPY_PY_BUILTINS_STR_UNICODE)
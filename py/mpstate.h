@@ -47,6 +47,7 @@ typedef struct mp_dynamic_compiler_t {
     bool opt_cache_map_lookup_in_bytecode;
     bool py_builtins_str_unicode;
     uint8_t native_arch;
+    bool persistent_code_xip; // save .mpy files as execute-in-place images
 } mp_dynamic_compiler_t;
 extern mp_dynamic_compiler_t mp_dynamic_compiler;
 #endif
@@ -61,12 +62,10 @@ typedef struct _mp_sched_item_t {
     mp_obj_t arg;
 } mp_sched_item_t;
 
-// This structure hold information about the memory allocation system.
-typedef struct _mp_state_mem_t {
-    #if MICROPY_MEM_STATS
-    size_t total_bytes_allocated;
-    size_t current_bytes_allocated;
-    size_t peak_bytes_allocated;
+// This structure holds the state of one contiguous region of the GC heap.
+typedef struct _mp_state_mem_area_t {
+    #if MICROPY_GC_SPLIT_HEAP
+    struct _mp_state_mem_area_t *next;
     #endif
 
     byte *gc_alloc_table_start;
@@ -77,8 +76,82 @@ typedef struct _mp_state_mem_t {
     byte *gc_pool_start;
     byte *gc_pool_end;
 
+    size_t gc_last_free_atb_index;
+
+    #if MICROPY_GC_SIZE_CLASSES
+    // lists of all the runs of free blocks in this area, by size class
+    struct _gc_free_run_t *gc_free_runs[MICROPY_GC_SIZE_CLASSES];
+    #endif
+
+    #if MICROPY_GC_SPLIT_HEAP_AUTO
+    // whether this area was added by gc_alloc, and so can be given back
+    bool gc_auto;
+    // number of collections in a row after which this area was empty
+    uint16_t gc_idle_collections;
+    #endif
+} mp_state_mem_area_t;
+
+#if MICROPY_GC_PARALLEL_MARK
+// A parallel marker's stack of objects whose children still need marking.  The
+// owner pushes and pops at the bottom and the other markers steal from the top.
+typedef struct _mp_gc_mark_deque_t {
+    size_t top;
+    size_t bottom;
+    void *buf[MICROPY_GC_PARALLEL_MARK_STACK_SIZE];
+} mp_gc_mark_deque_t;
+#endif
+
+// This structure hold information about the memory allocation system.
+typedef struct _mp_state_mem_t {
+    #if MICROPY_MEM_STATS
+    size_t total_bytes_allocated;
+    size_t current_bytes_allocated;
+    size_t peak_bytes_allocated;
+    #endif
+
+    // the area passed to gc_init
+    mp_state_mem_area_t area;
+
+    #if MICROPY_GC_SPLIT_HEAP
+    // all areas of the heap, in order of increasing size
+    mp_state_mem_area_t *gc_area_head;
+    #endif
+
+    #if MICROPY_GC_SPLIT_HEAP_AUTO
+    size_t gc_grow_count;
+    size_t gc_shrink_count;
+    #endif
+
+    #if MICROPY_GC_FINALISER_LIST
+    // Objects that have a finaliser.  This list is in the heap but isn't
+    // traced.  With MICROPY_GC_FINALISER_DEFERRED the first
+    // gc_finaliser_pending of them are unreachable and waiting for their
+    // finaliser to be called.
+    void **gc_finaliser_list;
+    size_t gc_finaliser_len;
+    size_t gc_finaliser_alloc;
+    #if MICROPY_GC_FINALISER_DEFERRED
+    size_t gc_finaliser_pending;
+    bool gc_finaliser_scheduled;
+    #endif
+    #endif
+
+    #if MICROPY_GC_PARALLEL_MARK
+    // Number of threads to mark with, whether this collection is marked in
+    // parallel, and the state shared by the markers while it is
+    size_t gc_mark_threads;
+    bool gc_mark_parallel;
+    bool gc_mark_rescan;
+    bool gc_mark_done;
+    size_t gc_mark_idle;
+    mp_gc_mark_deque_t gc_mark_deque[MICROPY_GC_PARALLEL_MARK];
+    #endif
+
     int gc_stack_overflow;
     MICROPY_GC_STACK_ENTRY_TYPE gc_stack[MICROPY_ALLOC_GC_STACK_SIZE];
+    #if MICROPY_GC_SPLIT_HEAP
+    mp_state_mem_area_t *gc_area_stack[MICROPY_ALLOC_GC_STACK_SIZE];
+    #endif
     uint16_t gc_lock_depth;
 
     // This variable controls auto garbage collection.  If set to 0 then the
@@ -91,8 +164,6 @@ typedef struct _mp_state_mem_t {
     size_t gc_alloc_threshold;
     #endif
 
-    size_t gc_last_free_atb_index;
-
     #if MICROPY_PY_GC_COLLECT_RETVAL
     size_t gc_collected;
     #endif
@@ -134,6 +205,11 @@ typedef struct _mp_state_vm_t {
     mp_obj_exception_t mp_kbd_exception;
     #endif
 
+    #if MICROPY_OSERROR_PREALLOC
+    // exception objects of type OSError, for EAGAIN and ETIMEDOUT
+    mp_obj_exception_t mp_oserror_prealloc[2];
+    #endif
+
     // dictionary with loaded modules (may be exposed as sys.modules)
     mp_obj_dict_t mp_loaded_modules_dict;
 
@@ -156,11 +232,32 @@ typedef struct _mp_state_vm_t {
     mp_obj_list_t mp_sys_path_obj;
     mp_obj_list_t mp_sys_argv_obj;
 
+    #if MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+    // cache of indices of unicode strs, most recently used first
+    struct _mp_str_index_t *str_index_cache[MICROPY_PY_BUILTINS_STR_UNICODE_INDEX];
+    #endif
+
+    #if MICROPY_PY_INSTANCE_SHAPES
+    // the empty shape, root of the tree of all instance shapes
+    struct _mp_obj_shape_t *instance_shape_root;
+    #endif
+
     // dictionary for overridden builtins
     #if MICROPY_CAN_OVERRIDE_BUILTINS
     mp_obj_dict_t *mp_module_builtins_override_dict;
     #endif
 
+    #if MICROPY_COMP_CONST_IMPORT
+    // dict mapping a module name to a dict of its const() values, which the
+    // parser substitutes for names imported with "from <module> import"
+    mp_obj_t parse_const_modules;
+    // if not MP_OBJ_NULL then the parser also stores the constants it finds here
+    mp_obj_t parse_const_export;
+    // dict of the names that the module being parsed binds elsewhere, which
+    // aren't inlined; if MP_OBJ_NULL then no imported constants are inlined
+    mp_obj_t parse_const_stores;
+    #endif
+
     // include any root pointers defined by a port
     MICROPY_PORT_ROOT_POINTERS
 
@@ -183,6 +280,11 @@ typedef struct _mp_state_vm_t {
     struct _mp_vfs_mount_t *vfs_mount_table;
     #endif
 
+    #if MICROPY_VFS_IMPORT_CACHE
+    // dict mapping a directory to a dict of its entries, see mp_vfs_import_stat
+    mp_obj_t vfs_import_cache;
+    #endif
+
     //
     // END ROOT POINTER SECTION
     ////////////////////////////////////////////////////////////
@@ -198,6 +300,16 @@ typedef struct _mp_state_vm_t {
     mp_thread_mutex_t qstr_mutex;
     #endif
 
+    #if MICROPY_PY_INSTANCE_SHAPES
+    size_t instance_shape_count;
+    #endif
+
+    #if MICROPY_VFS_IMPORT_CACHE
+    // number of import stats that went to a filesystem, and that didn't
+    size_t vfs_import_fs_ops;
+    size_t vfs_import_cached;
+    #endif
+
     #if MICROPY_ENABLE_COMPILER
     mp_uint_t mp_optimise_value;
     #endif
@@ -235,6 +347,11 @@ typedef struct _mp_state_thread_t {
     uint8_t *pystack_cur;
     #endif
 
+    #if MICROPY_EXC_TRACEBACK_BUF
+    // traceback entries (file, line, block) of the exception in tb_owner
+    size_t tb_buf[MICROPY_EXC_TRACEBACK_BUF * 3];
+    #endif
+
     ////////////////////////////////////////////////////////////
     // START ROOT POINTER SECTION
     // Everything that needs GC scanning must start here, and
@@ -245,6 +362,22 @@ typedef struct _mp_state_thread_t {
     mp_obj_dict_t *dict_globals;
 
     nlr_buf_t *nlr_top;
+
+    #if MICROPY_PYSTACK_GROW
+    // The pystack segment in use, if it's not the first one, and a spare one
+    struct _mp_pystack_seg_t *pystack_seg;
+    struct _mp_pystack_seg_t *pystack_spare;
+    #endif
+
+    #if MICROPY_OPT_GEN_RECYCLE
+    // A released generator frame, kept for reuse
+    void *gen_spare;
+    #endif
+
+    #if MICROPY_EXC_TRACEBACK_BUF
+    // The exception that last recorded its traceback in tb_buf
+    struct _mp_obj_exception_t *tb_owner;
+    #endif
 } mp_state_thread_t;
 
 // This structure combines the above 3 structures.
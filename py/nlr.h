@@ -86,7 +86,11 @@ struct _nlr_buf_t {
 };
 
 // Helper macros to save/restore the pystack state
-#if MICROPY_ENABLE_PYSTACK
+#if MICROPY_PYSTACK_GROW
+void mp_pystack_restore(void *ptr);
+#define MP_NLR_SAVE_PYSTACK(nlr_buf) (nlr_buf)->pystack = MP_STATE_THREAD(pystack_cur)
+#define MP_NLR_RESTORE_PYSTACK(nlr_buf) mp_pystack_restore((nlr_buf)->pystack)
+#elif MICROPY_ENABLE_PYSTACK
 #define MP_NLR_SAVE_PYSTACK(nlr_buf) (nlr_buf)->pystack = MP_STATE_THREAD(pystack_cur)
 #define MP_NLR_RESTORE_PYSTACK(nlr_buf) MP_STATE_THREAD(pystack_cur) = (nlr_buf)->pystack
 #else
@@ -84,7 +84,8 @@ STATIC mp_obj_t dict_make_new(const mp_obj_type_t *type, size_t n_args, size_t n
     mp_obj_t dict_out = mp_obj_new_dict(0);
     mp_obj_dict_t *dict = MP_OBJ_TO_PTR(dict_out);
     dict->base.type = type;
-    #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
+    #if MICROPY_PY_COLLECTIONS_ORDEREDDICT && !MICROPY_OPT_MAP_COMPACT
+    // a compact map already keeps insertion order
     if (type == &mp_type_ordereddict) {
         dict->map.is_ordered = 1;
     }
@@ -216,15 +217,10 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(dict_clear_obj, dict_clear);
 STATIC mp_obj_t dict_copy(mp_obj_t self_in) {
     mp_check_self(mp_obj_is_dict_type(self_in));
     mp_obj_dict_t *self = MP_OBJ_TO_PTR(self_in);
-    mp_obj_t other_out = mp_obj_new_dict(self->map.alloc);
-    mp_obj_dict_t *other = MP_OBJ_TO_PTR(other_out);
+    mp_obj_dict_t *other = m_new_obj(mp_obj_dict_t);
     other->base.type = self->base.type;
-    other->map.used = self->map.used;
-    other->map.all_keys_are_qstrs = self->map.all_keys_are_qstrs;
-    other->map.is_fixed = 0;
-    other->map.is_ordered = self->map.is_ordered;
-    memcpy(other->map.table, self->map.table, self->map.alloc * sizeof(mp_map_elem_t));
-    return other_out;
+    mp_map_init_copy(&other->map, &self->map);
+    return MP_OBJ_FROM_PTR(other);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(dict_copy_obj, dict_copy);
 
@@ -309,6 +305,21 @@ STATIC mp_obj_t dict_popitem(mp_obj_t self_in) {
     mp_check_self(mp_obj_is_dict_type(self_in));
     mp_obj_dict_t *self = MP_OBJ_TO_PTR(self_in);
     mp_ensure_not_fixed(self);
+    #if MICROPY_OPT_MAP_COMPACT
+    // entries are in insertion order, so remove the last one like CPython
+    mp_map_elem_t *next = NULL;
+    for (size_t i = self->map.alloc; i > 0; i--) {
+        if (mp_map_slot_is_filled(&self->map, i - 1)) {
+            next = &self->map.table[i - 1];
+            break;
+        }
+    }
+    if (next == NULL) {
+        mp_raise_msg(&mp_type_KeyError, "popitem(): dictionary is empty");
+    }
+    mp_obj_t items[] = {next->key, next->value};
+    mp_map_lookup(&self->map, items[0], MP_MAP_LOOKUP_REMOVE_IF_FOUND);
+    #else
     size_t cur = 0;
     mp_map_elem_t *next = dict_iter_next(self, &cur);
     if (next == NULL) {
@@ -318,6 +329,7 @@ STATIC mp_obj_t dict_popitem(mp_obj_t self_in) {
     mp_obj_t items[] = {next->key, next->value};
     next->key = MP_OBJ_SENTINEL; // must mark key as sentinel to indicate that it was deleted
     next->value = MP_OBJ_NULL;
+    #endif
     mp_obj_t tuple = mp_obj_new_tuple(2, items);
 
     return tuple;
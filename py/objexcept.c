@@ -37,6 +37,7 @@
 #include "py/runtime.h"
 #include "py/gc.h"
 #include "py/mperrno.h"
+#include "py/persistentcode.h"
 
 // Number of items per traceback entry (file, line, block)
 #define TRACEBACK_ENTRY_LEN (3)
@@ -493,9 +494,69 @@ void mp_obj_exception_clear_traceback(mp_obj_t self_in) {
     self->traceback_data = NULL;
 }
 
+#if MICROPY_EXC_TRACEBACK_BUF
+
+// While an exception records its traceback in the thread's tb_buf it has
+// traceback_alloc == 0.  Move the entries to the heap, or drop them if there
+// is no memory.
+STATIC void exception_traceback_to_heap(mp_obj_exception_t *self) {
+    size_t *tb_data = NULL;
+    if (self->traceback_len != 0) {
+        tb_data = m_new_maybe(size_t, self->traceback_len);
+        if (tb_data != NULL) {
+            memcpy(tb_data, self->traceback_data, self->traceback_len * sizeof(size_t));
+        }
+    }
+    self->traceback_data = tb_data;
+    self->traceback_alloc = self->traceback_len;
+}
+
+// Moves the traceback of the exception that owns this thread's tb_buf to the
+// heap.  A thread calls this before it ends, because its tb_buf is part of its
+// state on its C stack, and an exception it kept may be printed afterwards.
+void mp_obj_exception_release_traceback_buf(void) {
+    mp_obj_exception_t *owner = MP_STATE_THREAD(tb_owner);
+    if (owner != NULL && owner->traceback_alloc == 0 && owner->traceback_data == MP_STATE_THREAD(tb_buf)) {
+        exception_traceback_to_heap(owner);
+    }
+    MP_STATE_THREAD(tb_owner) = NULL;
+}
+
+#endif
+
 void mp_obj_exception_add_traceback(mp_obj_t self_in, qstr file, size_t line, qstr block) {
     GET_NATIVE_EXCEPTION(self, self_in);
 
+    #if MICROPY_EXC_TRACEBACK_BUF
+    size_t *tb_buf = MP_STATE_THREAD(tb_buf);
+    if (self->traceback_data == NULL
+        || (self->traceback_alloc == 0 && self->traceback_data != tb_buf)) {
+        // Take over this thread's buffer (a traceback left in the buffer of
+        // another thread is dropped).  The previous owner is a root pointer
+        // so is still valid, and keeps its traceback by moving it to the heap.
+        mp_obj_exception_release_traceback_buf();
+        MP_STATE_THREAD(tb_owner) = self;
+        self->traceback_data = tb_buf;
+        self->traceback_alloc = 0;
+        self->traceback_len = 0;
+    }
+    if (self->traceback_alloc == 0) {
+        if (self->traceback_len < MICROPY_EXC_TRACEBACK_BUF * TRACEBACK_ENTRY_LEN) {
+            size_t *tb_data = &tb_buf[self->traceback_len];
+            self->traceback_len += TRACEBACK_ENTRY_LEN;
+            tb_data[0] = file;
+            tb_data[1] = line;
+            tb_data[2] = block;
+            return;
+        }
+        // buffer is full, continue on the heap
+        exception_traceback_to_heap(self);
+        if (self->traceback_data == NULL) {
+            return;
+        }
+    }
+    #endif
+
     // append this traceback info to traceback data
     // if memory allocation fails (eg because gc is locked), just return
 
@@ -553,6 +614,22 @@ void mp_obj_exception_get_traceback(mp_obj_t self_in, size_t *n, size_t **values
         *n = 0;
         *values = NULL;
     } else {
+        #if MICROPY_PERSISTENT_CODE_LAZY_LINES
+        // read the line numbers that were left in .mpy files
+        for (size_t i = 0; i < self->traceback_len; i += TRACEBACK_ENTRY_LEN) {
+            size_t line = self->traceback_data[i + 1];
+            if (line & MP_LAZY_LINE_TAG) {
+                size_t block = self->traceback_data[i + 2];
+                // reading the file can run Python code of a VFS, whose own
+                // exceptions may move this traceback out of tb_buf
+                line = mp_raw_code_lazy_line(self->traceback_data[i], line, block >> MP_LAZY_LINE_CHECK_SHIFT);
+                if (i < self->traceback_len) {
+                    self->traceback_data[i + 1] = line;
+                    self->traceback_data[i + 2] = block & (((size_t)1 << MP_LAZY_LINE_CHECK_SHIFT) - 1);
+                }
+            }
+        }
+        #endif
         *n = self->traceback_len;
         *values = self->traceback_data;
     }
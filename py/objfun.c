@@ -167,7 +167,15 @@ qstr mp_obj_fun_get_name(mp_const_obj_t fun_in) {
     bc++; // skip n_pos_args
     bc++; // skip n_kwonly_args
     bc++; // skip n_def_pos_args
-    return mp_obj_code_get_name(bc);
+    qstr name = mp_obj_code_get_name(bc);
+    #if MICROPY_PERSISTENT_CODE_XIP
+    // (bit 0 of the qstr table may be set to mark a lazily loaded function)
+    const uint16_t *qstr_table = (const uint16_t*)((uintptr_t)fun->qstr_table & ~1);
+    if (qstr_table != NULL) {
+        name = qstr_table[name];
+    }
+    #endif
+    return name;
 }
 
 #if MICROPY_CPYTHON_COMPAT
@@ -192,7 +200,8 @@ STATIC void dump_args(const mp_obj_t *a, size_t sz) {
 
 // With this macro you can tune the maximum number of function state bytes
 // that will be allocated on the stack.  Any function that needs more
-// than this will try to use the heap, with fallback to stack allocation.
+// than this will try to use the heap, with fallback to stack allocation
+// (or, with MICROPY_PYSTACK_GROW, will use the pystack).
 #define VM_MAX_STATE_ON_STACK (11 * sizeof(mp_uint_t))
 
 #define DECODE_CODESTATE_SIZE(bytecode, n_state_out_var, state_size_out_var) \
@@ -261,7 +270,13 @@ STATIC mp_obj_t fun_bc_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const
     // allocate state for locals and stack
     mp_code_state_t *code_state = NULL;
     #if MICROPY_ENABLE_PYSTACK
-    code_state = mp_pystack_alloc(sizeof(mp_code_state_t) + state_size);
+    if (MICROPY_PYSTACK_GROW && state_size <= VM_MAX_STATE_ON_STACK) {
+        // small states are still quickest to allocate on the C stack
+        code_state = alloca(sizeof(mp_code_state_t) + state_size);
+        state_size = 0; // indicate that we allocated using alloca
+    } else {
+        code_state = mp_pystack_alloc(sizeof(mp_code_state_t) + state_size);
+    }
     #else
     if (state_size > VM_MAX_STATE_ON_STACK) {
         code_state = m_new_obj_var_maybe(mp_code_state_t, byte, state_size);
@@ -328,7 +343,9 @@ STATIC mp_obj_t fun_bc_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const
     }
 
     #if MICROPY_ENABLE_PYSTACK
-    mp_pystack_free(code_state);
+    if (state_size != 0) {
+        mp_pystack_free(code_state);
+    }
     #else
     // free the state if it was allocated on the heap
     if (state_size != 0) {
@@ -385,6 +402,9 @@ mp_obj_t mp_obj_new_fun_bc(mp_obj_t def_args_in, mp_obj_t def_kw_args, const byt
     o->globals = mp_globals_get();
     o->bytecode = code;
     o->const_table = const_table;
+    #if MICROPY_PERSISTENT_CODE_XIP
+    o->qstr_table = NULL;
+    #endif
     if (def_args != NULL) {
         memcpy(o->extra_args, def_args->items, n_def_args * sizeof(mp_obj_t));
     }
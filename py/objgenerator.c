@@ -26,9 +26,12 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include "py/runtime.h"
+#include "py/builtin.h"
+#include "py/gc.h"
 #include "py/bc.h"
 #include "py/objgenerator.h"
 #include "py/objfun.h"
@@ -43,6 +46,62 @@ typedef struct _mp_obj_gen_instance_t {
     mp_code_state_t code_state;
 } mp_obj_gen_instance_t;
 
+STATIC mp_obj_gen_instance_t *gen_instance_new(size_t n_bytes) {
+    #if MICROPY_OPT_GEN_RECYCLE
+    // reuse the spare generator frame, if there is one and it's big enough
+    mp_obj_gen_instance_t *o = MP_STATE_THREAD(gen_spare);
+    if (o != NULL && gc_nbytes(o) >= sizeof(mp_obj_gen_instance_t) + n_bytes) {
+        MP_STATE_THREAD(gen_spare) = NULL;
+        return o;
+    }
+    #endif
+    return m_new_obj_var(mp_obj_gen_instance_t, byte, n_bytes);
+}
+
+#if MICROPY_OPT_GEN_RECYCLE
+
+// Builtins that iterate over their argument and don't keep a reference to it.
+STATIC bool gen_consumer(mp_obj_t fun) {
+    return fun == MP_OBJ_FROM_PTR(&mp_builtin_sum_obj)
+        || fun == MP_OBJ_FROM_PTR(&mp_builtin_any_obj)
+        || fun == MP_OBJ_FROM_PTR(&mp_builtin_all_obj)
+        #if MICROPY_PY_BUILTINS_MIN_MAX
+        || fun == MP_OBJ_FROM_PTR(&mp_builtin_min_obj)
+        || fun == MP_OBJ_FROM_PTR(&mp_builtin_max_obj)
+        #endif
+        || fun == MP_OBJ_FROM_PTR(&mp_builtin_sorted_obj)
+        || fun == MP_OBJ_FROM_PTR(&mp_type_list)
+        || fun == MP_OBJ_FROM_PTR(&mp_type_tuple);
+}
+
+// Called by the VM after fun(gen) returned, where gen was created by a generator
+// expression and only referenced from the VM stack.  If fun is known not to have
+// kept a reference to it then gen and its function object are freed, with the
+// frame of gen kept for reuse.
+void mp_obj_gen_release_temp(mp_obj_t fun, mp_obj_t gen_in) {
+    if (!mp_obj_is_type(gen_in, &mp_type_gen_instance) || !gen_consumer(fun)) {
+        return;
+    }
+    mp_obj_gen_instance_t *gen = MP_OBJ_TO_PTR(gen_in);
+
+    // the function object was made just to create this generator
+    mp_obj_fun_bc_t *self_fun = gen->code_state.fun_bc;
+    size_t n_state = mp_decode_uint_value(self_fun->bytecode);
+    size_t n_exc_stack = mp_decode_uint_value(mp_decode_uint_skip(self_fun->bytecode));
+    m_del_obj(mp_obj_fun_bc_t, self_fun);
+
+    size_t n_bytes = n_state * sizeof(mp_obj_t) + n_exc_stack * sizeof(mp_exc_stack_t);
+    if (MP_STATE_THREAD(gen_spare) == NULL) {
+        // clear it so it doesn't keep any objects alive
+        memset(gen, 0, sizeof(mp_obj_gen_instance_t) + n_bytes);
+        MP_STATE_THREAD(gen_spare) = gen;
+    } else {
+        m_del_var(mp_obj_gen_instance_t, byte, n_bytes, gen);
+    }
+}
+
+#endif
+
 STATIC mp_obj_t gen_wrap_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     // A generating function is just a bytecode function with type mp_type_gen_wrap
     mp_obj_fun_bc_t *self_fun = MP_OBJ_TO_PTR(self_in);
@@ -52,7 +111,7 @@ STATIC mp_obj_t gen_wrap_call(mp_obj_t self_in, size_t n_args, size_t n_kw, cons
     size_t n_exc_stack = mp_decode_uint_value(mp_decode_uint_skip(self_fun->bytecode));
 
     // allocate the generator object, with room for local stack and exception stack
-    mp_obj_gen_instance_t *o = m_new_obj_var(mp_obj_gen_instance_t, byte,
+    mp_obj_gen_instance_t *o = gen_instance_new(
         n_state * sizeof(mp_obj_t) + n_exc_stack * sizeof(mp_exc_stack_t));
     o->base.type = &mp_type_gen_instance;
 
@@ -88,7 +147,7 @@ STATIC mp_obj_t native_gen_wrap_call(mp_obj_t self_in, size_t n_args, size_t n_k
     size_t n_exc_stack = 0;
 
     // Allocate the generator object, with room for local stack and exception stack
-    mp_obj_gen_instance_t *o = m_new_obj_var(mp_obj_gen_instance_t, byte,
+    mp_obj_gen_instance_t *o = gen_instance_new(
         n_state * sizeof(mp_obj_t) + n_exc_stack * sizeof(mp_exc_stack_t));
     o->base.type = &mp_type_gen_instance;
 
@@ -30,5 +30,6 @@
 #include "py/runtime.h"
 
 mp_vm_return_kind_t mp_obj_gen_resume(mp_obj_t self_in, mp_obj_t send_val, mp_obj_t throw_val, mp_obj_t *ret_val);
+void mp_obj_gen_release_temp(mp_obj_t fun, mp_obj_t gen_in);
 
 #endif // MICROPY_INCLUDED_PY_OBJGENERATOR_H
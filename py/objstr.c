@@ -173,6 +173,14 @@ mp_obj_t mp_obj_str_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_
                     return MP_OBJ_NEW_QSTR(q);
                 }
 
+                #if MICROPY_PY_STR_SLICE_VIEW
+                if (MP_OBJ_STR_IS_VIEW(args[0])) {
+                    // the byte following the data of a bytes view may be a UTF-8
+                    // continuation byte, which a str must never have, so copy it
+                    return mp_obj_new_str_copy(type, str_data, str_len);
+                }
+                #endif
+
                 mp_obj_str_t *o = MP_OBJ_TO_PTR(mp_obj_new_str_copy(type, NULL, str_len));
                 o->data = str_data;
                 o->hash = str_hash;
@@ -210,6 +218,11 @@ STATIC mp_obj_t bytes_make_new(const mp_obj_type_t *type_in, size_t n_args, size
             goto wrong_args;
         }
         GET_STR_DATA_LEN(args[0], str_data, str_len);
+        #if MICROPY_PY_STR_SLICE_VIEW
+        if (MP_OBJ_STR_IS_VIEW(args[0])) {
+            return mp_obj_str_new_slice(&mp_type_bytes, args[0], str_data, str_len);
+        }
+        #endif
         GET_STR_HASH(args[0], str_hash);
         if (str_hash == 0) {
             str_hash = qstr_compute_hash(str_data, str_len);
@@ -297,6 +310,49 @@ const byte *find_subbytes(const byte *haystack, size_t hlen, const byte *needle,
     return NULL;
 }
 
+#if MICROPY_PY_STR_INPLACE_CONCAT
+// Compute lhs + rhs for the += operator.  The result is a view of a buffer with room
+// to grow, so that if it is the lhs of the next += then rhs can be appended to the
+// buffer in place, without copying lhs.  That is only possible if lhs ends where the
+// used part of the buffer does, otherwise another str already extends lhs in there.
+STATIC mp_obj_t str_inplace_concat(const mp_obj_type_t *type, mp_obj_t lhs_in, const byte *lhs_data, size_t lhs_len, const byte *rhs_data, size_t rhs_len) {
+    size_t len = lhs_len + rhs_len;
+    mp_obj_str_buf_t *buf = NULL;
+    if (MP_OBJ_STR_IS_VIEW(lhs_in)) {
+        mp_obj_t owner = ((mp_obj_str_view_t*)MP_OBJ_TO_PTR(lhs_in))->owner;
+        if (MP_OBJ_STR_HAS_FLAG(owner, MP_OBJ_STR_HASH_BUF)) {
+            buf = MP_OBJ_TO_PTR(owner);
+            size_t offset = lhs_data - buf->str.data;
+            if (offset + lhs_len != buf->str.len || offset + len > buf->alloc) {
+                buf = NULL;
+            }
+        }
+    }
+    if (buf == NULL) {
+        // start a new buffer, with 50% extra room
+        buf = m_new_obj(mp_obj_str_buf_t);
+        buf->str.base.type = type;
+        buf->str.hash = MP_OBJ_STR_HASH_BUF;
+        buf->alloc = len + len / 2;
+        byte *data = m_new(byte, buf->alloc);
+        memcpy(data, lhs_data, lhs_len);
+        buf->str.data = data;
+        buf->str.len = lhs_len;
+        lhs_data = data;
+    }
+    memcpy((byte*)lhs_data + lhs_len, rhs_data, rhs_len);
+    buf->str.len += rhs_len;
+
+    mp_obj_str_view_t *o = m_new_obj(mp_obj_str_view_t);
+    o->str.base.type = type;
+    o->str.hash = MP_OBJ_STR_HASH_VIEW;
+    o->str.len = len;
+    o->str.data = lhs_data;
+    o->owner = MP_OBJ_FROM_PTR(buf);
+    return MP_OBJ_FROM_PTR(o);
+}
+#endif
+
 // Note: this function is used to check if an object is a str or bytes, which
 // works because both those types use it as their binary_op method.  Revisit
 // mp_obj_is_str_or_bytes if this fact changes.
@@ -386,6 +442,12 @@ mp_obj_t mp_obj_str_binary_op(mp_binary_op_t op, mp_obj_t lhs_in, mp_obj_t rhs_i
                 return lhs_in;
             }
 
+            #if MICROPY_PY_STR_INPLACE_CONCAT
+            if (op == MP_BINARY_OP_INPLACE_ADD && lhs_len + rhs_len >= MICROPY_PY_STR_SLICE_VIEW_MIN_LEN) {
+                return str_inplace_concat(lhs_type, lhs_in, lhs_data, lhs_len, rhs_data, rhs_len);
+            }
+            #endif
+
             vstr_t vstr;
             vstr_init_len(&vstr, lhs_len + rhs_len);
             memcpy(vstr.buf, lhs_data, lhs_len);
@@ -411,8 +473,9 @@ mp_obj_t mp_obj_str_binary_op(mp_binary_op_t op, mp_obj_t lhs_in, mp_obj_t rhs_i
 
 #if !MICROPY_PY_BUILTINS_STR_UNICODE
 // objstrunicode defines own version
-const byte *str_index_to_ptr(const mp_obj_type_t *type, const byte *self_data, size_t self_len,
+const byte *str_index_to_ptr(const mp_obj_type_t *type, mp_obj_t self_in, const byte *self_data, size_t self_len,
                              mp_obj_t index, bool is_slice) {
+    (void)self_in;
     size_t index_val = mp_get_index(type, self_len, index, is_slice);
     return self_data + index_val;
 }
@@ -430,7 +493,7 @@ STATIC mp_obj_t bytes_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
             if (!mp_seq_get_fast_slice_indexes(self_len, index, &slice)) {
                 mp_raise_NotImplementedError("only slices with step=1 (aka None) are supported");
             }
-            return mp_obj_new_str_of_type(type, self_data + slice.start, slice.stop - slice.start);
+            return mp_obj_str_new_slice(type, self_in, self_data + slice.start, slice.stop - slice.start);
         }
 #endif
         size_t index_val = mp_get_index(type, self_len, index, false);
@@ -699,10 +762,10 @@ STATIC mp_obj_t str_finder(size_t n_args, const mp_obj_t *args, int direction, b
     const byte *start = haystack;
     const byte *end = haystack + haystack_len;
     if (n_args >= 3 && args[2] != mp_const_none) {
-        start = str_index_to_ptr(self_type, haystack, haystack_len, args[2], true);
+        start = str_index_to_ptr(self_type, args[0], haystack, haystack_len, args[2], true);
     }
     if (n_args >= 4 && args[3] != mp_const_none) {
-        end = str_index_to_ptr(self_type, haystack, haystack_len, args[3], true);
+        end = str_index_to_ptr(self_type, args[0], haystack, haystack_len, args[3], true);
     }
 
     if (end < start) {
@@ -757,7 +820,7 @@ STATIC mp_obj_t str_startswith(size_t n_args, const mp_obj_t *args) {
     const char *prefix = mp_obj_str_get_data(args[1], &prefix_len);
     const byte *start = str;
     if (n_args > 2) {
-        start = str_index_to_ptr(self_type, str, str_len, args[2], true);
+        start = str_index_to_ptr(self_type, args[0], str, str_len, args[2], true);
     }
     if (prefix_len + (start - str) > str_len) {
         return mp_const_false;
@@ -1713,10 +1776,10 @@ STATIC mp_obj_t str_count(size_t n_args, const mp_obj_t *args) {
     const byte *start = haystack;
     const byte *end = haystack + haystack_len;
     if (n_args >= 3 && args[2] != mp_const_none) {
-        start = str_index_to_ptr(self_type, haystack, haystack_len, args[2], true);
+        start = str_index_to_ptr(self_type, args[0], haystack, haystack_len, args[2], true);
     }
     if (n_args >= 4 && args[3] != mp_const_none) {
-        end = str_index_to_ptr(self_type, haystack, haystack_len, args[3], true);
+        end = str_index_to_ptr(self_type, args[0], haystack, haystack_len, args[3], true);
     }
 
     // if needle_len is zero then we count each gap between characters as an occurrence
@@ -2030,6 +2093,53 @@ mp_obj_t mp_obj_new_str_of_type(const mp_obj_type_t *type, const byte* data, siz
     }
 }
 
+// Create a str/bytes object of the given type holding a slice of the data of self_in,
+// which must be a str/bytes object and data must point within its data.  If views are
+// enabled and the slice is large enough then the data is shared, otherwise it's copied.
+mp_obj_t mp_obj_str_new_slice(const mp_obj_type_t *type, mp_obj_t self_in, const byte *data, size_t len) {
+    // a slice of an ASCII str is also ASCII
+    mp_uint_t flags = MP_OBJ_STR_HAS_FLAG(self_in, MP_OBJ_STR_HASH_ASCII) ? MP_OBJ_STR_HASH_ASCII : 0;
+    #if MICROPY_PY_STR_SLICE_VIEW
+    if (len >= MICROPY_PY_STR_SLICE_VIEW_MIN_LEN) {
+        // a view of a view refers directly to the original owner, so views never chain
+        mp_obj_t owner = self_in;
+        if (MP_OBJ_STR_IS_VIEW(owner)) {
+            owner = ((mp_obj_str_view_t*)MP_OBJ_TO_PTR(owner))->owner;
+        }
+        // only share the data if the slice covers a decent part of it, so that a small
+        // slice doesn't keep a much larger buffer alive
+        GET_STR_LEN(owner, owner_len);
+        if (len >= owner_len / 4) {
+            mp_obj_str_view_t *o = m_new_obj(mp_obj_str_view_t);
+            o->str.base.type = type;
+            o->str.hash = MP_OBJ_STR_HASH_VIEW | flags;
+            o->str.len = len;
+            o->str.data = data;
+            o->owner = owner;
+            return MP_OBJ_FROM_PTR(o);
+        }
+    }
+    #endif
+    mp_obj_t o = mp_obj_new_str_of_type(type, data, len);
+    if (flags && !mp_obj_is_qstr(o)) {
+        ((mp_obj_str_t*)MP_OBJ_TO_PTR(o))->hash |= flags;
+    }
+    return o;
+}
+
+#if MICROPY_PY_STR_SLICE_VIEW
+// Turn a view into a regular str/bytes object with its own null-terminated copy of
+// the data.  The object stays the same so all references to it remain valid.
+STATIC void str_view_detach(mp_obj_str_view_t *self) {
+    byte *p = m_new(byte, self->str.len + 1);
+    memcpy(p, self->str.data, self->str.len);
+    p[self->str.len] = '\0';
+    self->str.data = p;
+    self->str.hash = qstr_compute_hash(p, self->str.len) | (self->str.hash & MP_OBJ_STR_HASH_ASCII);
+    self->owner = MP_OBJ_NULL;
+}
+#endif
+
 // Create a str using a qstr to store the data; may use existing or new qstr.
 mp_obj_t mp_obj_new_str_via_qstr(const char* data, size_t len) {
     return MP_OBJ_NEW_QSTR(qstr_from_strn(data, len));
@@ -2138,6 +2248,11 @@ qstr mp_obj_str_get_qstr(mp_obj_t self_in) {
 // at the moment all strings are zero terminated to help with C ASCIIZ compatibility
 const char *mp_obj_str_get_str(mp_obj_t self_in) {
     if (mp_obj_is_str_or_bytes(self_in)) {
+        #if MICROPY_PY_STR_SLICE_VIEW
+        if (MP_OBJ_STR_IS_VIEW(self_in)) {
+            str_view_detach(MP_OBJ_TO_PTR(self_in));
+        }
+        #endif
         GET_STR_DATA_LEN(self_in, s, l);
         (void)l; // len unused
         return (const char*)s;
@@ -38,11 +38,45 @@ typedef struct _mp_obj_str_t {
 
 #define MP_DEFINE_STR_OBJ(obj_name, str) mp_obj_str_t obj_name = {{&mp_type_str}, 0, sizeof(str) - 1, (const byte*)str}
 
+// The top bits of the hash field of a str/bytes object are used as flags and must
+// be masked off to get the hash (a qstr hash never uses these bits)
+#define MP_OBJ_STR_HASH_VIEW ((mp_uint_t)1 << (8 * sizeof(mp_uint_t) - 1)) // object is a view
+#define MP_OBJ_STR_HASH_ASCII ((mp_uint_t)1 << (8 * sizeof(mp_uint_t) - 2)) // data is known to be ASCII
+#define MP_OBJ_STR_HASH_BUF ((mp_uint_t)1 << (8 * sizeof(mp_uint_t) - 3)) // object is a concat buffer
+#define MP_OBJ_STR_HASH_FLAGS (MP_OBJ_STR_HASH_VIEW | MP_OBJ_STR_HASH_ASCII | MP_OBJ_STR_HASH_BUF)
+
+#define MP_OBJ_STR_HAS_FLAG(str_obj_in, flag) (!mp_obj_is_qstr(str_obj_in) && (((mp_obj_str_t*)MP_OBJ_TO_PTR(str_obj_in))->hash & (flag)))
+
+#if MICROPY_PY_STR_SLICE_VIEW
+// A view is a str/bytes object whose data points into the data of another str/bytes
+// object (the owner), which it keeps alive.  Its data is not null terminated and its
+// hash is never precomputed.
+typedef struct _mp_obj_str_view_t {
+    mp_obj_str_t str;
+    mp_obj_t owner;
+} mp_obj_str_view_t;
+
+#define MP_OBJ_STR_IS_VIEW(str_obj_in) MP_OBJ_STR_HAS_FLAG(str_obj_in, MP_OBJ_STR_HASH_VIEW)
+#endif
+
+#if MICROPY_PY_STR_INPLACE_CONCAT
+#if !MICROPY_PY_STR_SLICE_VIEW
+#error MICROPY_PY_STR_INPLACE_CONCAT requires MICROPY_PY_STR_SLICE_VIEW
+#endif
+// The buffer that the results of in-place concatenation are views of.  It is never
+// visible to Python code.  Its data is only ever appended to, len is the number of
+// bytes used so far and alloc the number of bytes allocated for data.
+typedef struct _mp_obj_str_buf_t {
+    mp_obj_str_t str;
+    size_t alloc;
+} mp_obj_str_buf_t;
+#endif
+
 // use this macro to extract the string hash
 // warning: the hash can be 0, meaning invalid, and must then be explicitly computed from the data
 #define GET_STR_HASH(str_obj_in, str_hash) \
     mp_uint_t str_hash; if (mp_obj_is_qstr(str_obj_in)) \
-    { str_hash = qstr_hash(MP_OBJ_QSTR_VALUE(str_obj_in)); } else { str_hash = ((mp_obj_str_t*)MP_OBJ_TO_PTR(str_obj_in))->hash; }
+    { str_hash = qstr_hash(MP_OBJ_QSTR_VALUE(str_obj_in)); } else { str_hash = ((mp_obj_str_t*)MP_OBJ_TO_PTR(str_obj_in))->hash & ~MP_OBJ_STR_HASH_FLAGS; }
 
 // use this macro to extract the string length
 #define GET_STR_LEN(str_obj_in, str_len) \
@@ -67,11 +101,12 @@ mp_obj_t mp_obj_str_format(size_t n_args, const mp_obj_t *args, mp_map_t *kwargs
 mp_obj_t mp_obj_str_split(size_t n_args, const mp_obj_t *args);
 mp_obj_t mp_obj_new_str_copy(const mp_obj_type_t *type, const byte* data, size_t len);
 mp_obj_t mp_obj_new_str_of_type(const mp_obj_type_t *type, const byte* data, size_t len);
+mp_obj_t mp_obj_str_new_slice(const mp_obj_type_t *type, mp_obj_t self_in, const byte *data, size_t len);
 
 mp_obj_t mp_obj_str_binary_op(mp_binary_op_t op, mp_obj_t lhs_in, mp_obj_t rhs_in);
 mp_int_t mp_obj_str_get_buffer(mp_obj_t self_in, mp_buffer_info_t *bufinfo, mp_uint_t flags);
 
-const byte *str_index_to_ptr(const mp_obj_type_t *type, const byte *self_data, size_t self_len,
+const byte *str_index_to_ptr(const mp_obj_type_t *type, mp_obj_t self_in, const byte *self_data, size_t self_len,
                              mp_obj_t index, bool is_slice);
 const byte *find_subbytes(const byte *haystack, size_t hlen, const byte *needle, size_t nlen, int direction);
 
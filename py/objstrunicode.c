@@ -31,6 +31,7 @@
 #include "py/objstr.h"
 #include "py/objlist.h"
 #include "py/runtime.h"
+#include "py/gc.h"
 
 #if MICROPY_PY_BUILTINS_STR_UNICODE
 
@@ -98,12 +99,97 @@ STATIC void uni_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t
     }
 }
 
+#if MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+
+// Strings shorter than this many bytes are always walked, because that is cheap enough
+#define STR_INDEX_MIN_LEN (64)
+
+// Number of chars between the checkpoints of an index
+#define STR_INDEX_STRIDE (32)
+
+// Index of a str, to convert char indices to byte offsets without walking all of
+// the UTF-8 data.  offsets[i] is the byte offset of char (i + 1) * STR_INDEX_STRIDE.
+// An index of an ASCII str has char_len equal to its length in bytes and no offsets.
+typedef struct _mp_str_index_t {
+    mp_obj_t str;
+    size_t char_len;
+    size_t offsets[];
+} mp_str_index_t;
+
+// Return the number of chars in the given str if that can be done cheaply, else -1.
+// If the str is not ASCII then *index_out is set to its index, which is created on
+// first use and kept in a small cache of the most recently used indices.  ASCII strs
+// on the heap are instead flagged as such, so they never need an index again.
+STATIC mp_int_t str_indexed_charlen(mp_obj_t self_in, const byte *self_data, size_t self_len, const mp_str_index_t **index_out) {
+    *index_out = NULL;
+    if (MP_OBJ_STR_HAS_FLAG(self_in, MP_OBJ_STR_HASH_ASCII)) {
+        return self_len;
+    }
+    if (self_len < STR_INDEX_MIN_LEN) {
+        return -1;
+    }
+
+    mp_str_index_t **cache = MP_STATE_VM(str_index_cache);
+    size_t i = 0;
+    while (i < MICROPY_PY_BUILTINS_STR_UNICODE_INDEX - 1 && (cache[i] == NULL || cache[i]->str != self_in)) {
+        ++i;
+    }
+    mp_str_index_t *index = cache[i];
+    if (index == NULL || index->str != self_in) {
+        size_t char_len = utf8_charlen(self_data, self_len);
+        #if MICROPY_ENABLE_GC
+        // only str objects on the heap can be updated, ones in ROM are read-only
+        if (char_len == self_len && !mp_obj_is_qstr(self_in) && gc_nbytes(MP_OBJ_TO_PTR(self_in)) != 0) {
+            ((mp_obj_str_t*)MP_OBJ_TO_PTR(self_in))->hash |= MP_OBJ_STR_HASH_ASCII;
+            return self_len;
+        }
+        #endif
+        size_t n = char_len == self_len ? 0 : char_len / STR_INDEX_STRIDE;
+        index = m_new_obj_var_maybe(mp_str_index_t, size_t, n);
+        if (index == NULL) {
+            return -1;
+        }
+        index->str = self_in;
+        index->char_len = char_len;
+        const byte *s = self_data;
+        for (size_t j = 0; j < n; ++j) {
+            for (size_t k = STR_INDEX_STRIDE; k; --k) {
+                ++s;
+                while (UTF8_IS_CONT(*s)) {
+                    ++s;
+                }
+            }
+            index->offsets[j] = s - self_data;
+        }
+        // the least recently used index (the last one) is evicted
+        i = MICROPY_PY_BUILTINS_STR_UNICODE_INDEX - 1;
+    }
+    memmove(&cache[1], &cache[0], i * sizeof(*cache));
+    cache[0] = index;
+
+    if (index->char_len != self_len) {
+        *index_out = index;
+    }
+    return index->char_len;
+}
+
+#endif
+
 STATIC mp_obj_t uni_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
     GET_STR_DATA_LEN(self_in, str_data, str_len);
     switch (op) {
         case MP_UNARY_OP_BOOL:
             return mp_obj_new_bool(str_len != 0);
         case MP_UNARY_OP_LEN:
+            #if MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+            {
+                const mp_str_index_t *index;
+                mp_int_t char_len = str_indexed_charlen(self_in, str_data, str_len, &index);
+                if (char_len >= 0) {
+                    return MP_OBJ_NEW_SMALL_INT(char_len);
+                }
+            }
+            #endif
             return MP_OBJ_NEW_SMALL_INT(utf8_charlen(str_data, str_len));
         default:
             return MP_OBJ_NULL; // op not supported
@@ -112,7 +198,7 @@ STATIC mp_obj_t uni_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
 
 // Convert an index into a pointer to its lead byte. Out of bounds indexing will raise IndexError or
 // be capped to the first/last character of the string, depending on is_slice.
-const byte *str_index_to_ptr(const mp_obj_type_t *type, const byte *self_data, size_t self_len,
+const byte *str_index_to_ptr(const mp_obj_type_t *type, mp_obj_t self_in, const byte *self_data, size_t self_len,
                              mp_obj_t index, bool is_slice) {
     // All str functions also handle bytes objects, and they call str_index_to_ptr(),
     // so it must handle bytes.
@@ -132,6 +218,40 @@ const byte *str_index_to_ptr(const mp_obj_type_t *type, const byte *self_data, s
         nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_TypeError, "string indices must be integers, not %s", mp_obj_get_type_str(index)));
     }
     const byte *s, *top = self_data + self_len;
+    #if MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+    const mp_str_index_t *str_index;
+    mp_int_t char_len = str_indexed_charlen(self_in, self_data, self_len, &str_index);
+    if (char_len >= 0) {
+        // The number of chars is known so the index can be bounds checked up front,
+        // then converted using the index (if not ASCII) to skip most of the walk.
+        if (i < 0) {
+            i += char_len;
+        }
+        if (i < 0 || i >= char_len) {
+            if (is_slice) {
+                return i < 0 ? self_data : top;
+            }
+            mp_raise_msg(&mp_type_IndexError, "string index out of range");
+        }
+        s = self_data;
+        if (str_index == NULL) {
+            return s + i;
+        }
+        if (i >= STR_INDEX_STRIDE) {
+            s += str_index->offsets[i / STR_INDEX_STRIDE - 1];
+            i %= STR_INDEX_STRIDE;
+        }
+        for (; i; --i) {
+            ++s;
+            while (UTF8_IS_CONT(*s)) {
+                ++s;
+            }
+        }
+        return s;
+    }
+    #else
+    (void)self_in;
+    #endif
     if (i < 0)
     {
         // Negative indexing is performed by counting from the end of the string.
@@ -191,24 +311,24 @@ STATIC mp_obj_t str_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
 
             const byte *pstart, *pstop;
             if (ostart != mp_const_none) {
-                pstart = str_index_to_ptr(type, self_data, self_len, ostart, true);
+                pstart = str_index_to_ptr(type, self_in, self_data, self_len, ostart, true);
             } else {
                 pstart = self_data;
             }
             if (ostop != mp_const_none) {
                 // pstop will point just after the stop character. This depends on
                 // the \0 at the end of the string.
-                pstop = str_index_to_ptr(type, self_data, self_len, ostop, true);
+                pstop = str_index_to_ptr(type, self_in, self_data, self_len, ostop, true);
             } else {
                 pstop = self_data + self_len;
             }
             if (pstop < pstart) {
                 return MP_OBJ_NEW_QSTR(MP_QSTR_);
             }
-            return mp_obj_new_str_of_type(type, (const byte *)pstart, pstop - pstart);
+            return mp_obj_str_new_slice(type, self_in, pstart, pstop - pstart);
         }
 #endif
-        const byte *s = str_index_to_ptr(type, self_data, self_len, index, false);
+        const byte *s = str_index_to_ptr(type, self_in, self_data, self_len, index, false);
         int len = 1;
         if (UTF8_IS_NONASCII(*s)) {
             // Count the number of 1 bits (after the first)
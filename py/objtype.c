@@ -44,8 +44,13 @@
 #define ENABLE_SPECIAL_ACCESSORS \
     (MICROPY_PY_DESCRIPTORS  || MICROPY_PY_DELATTR_SETATTR || MICROPY_PY_BUILTINS_PROPERTY)
 
-#define TYPE_FLAG_IS_SUBCLASSED (0x0001)
-#define TYPE_FLAG_HAS_SPECIAL_ACCESSORS (0x0002)
+#if MICROPY_PY_SLOTS
+// classes created at runtime also hold the shape that their instances start with
+typedef struct _mp_obj_class_t {
+    mp_obj_type_t type;
+    mp_obj_shape_t *slots_shape;
+} mp_obj_class_t;
+#endif
 
 STATIC mp_obj_t static_class_method_make_new(const mp_obj_type_t *self_in, size_t n_args, size_t n_kw, const mp_obj_t *args);
 
@@ -96,15 +101,338 @@ STATIC mp_obj_t native_base_init_wrapper(size_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(native_base_init_wrapper_obj, 1, MP_OBJ_FUN_ARGS_MAX, native_base_init_wrapper);
 
+/******************************************************************************/
+// instance attribute storage
+
+#if MICROPY_PY_INSTANCE_SHAPES
+
+// Slots are allocated in steps of this many attributes, so the allocated
+// size can always be derived from the number of keys in the shape.
+#define INSTANCE_SLOTS_STEP (4)
+#define INSTANCE_SLOTS_ALLOC(n) (((n) + INSTANCE_SLOTS_STEP - 1) / INSTANCE_SLOTS_STEP * INSTANCE_SLOTS_STEP)
+
+#if MICROPY_PY_SLOTS
+// Instances of a class with this flag only have the attributes named in
+// __slots__, held inline after subobj.
+#define instance_has_fixed_slots(self) ((self)->base.type->flags & TYPE_FLAG_HAS_SLOTS)
+#else
+#define instance_has_fixed_slots(self) (false)
+#endif
+
+STATIC mp_obj_shape_t *shape_new(const mp_obj_shape_t *parent, qstr attr) {
+    size_t n = parent == NULL ? 0 : parent->num_keys;
+    mp_obj_shape_t *shape = m_new_obj_var(mp_obj_shape_t, qstr, n + (parent != NULL));
+    shape->children = NULL;
+    shape->sibling = NULL;
+    shape->num_keys = n;
+    #if MICROPY_PY_SLOTS
+    shape->is_inline = false;
+    #endif
+    if (parent != NULL) {
+        memcpy(shape->keys, parent->keys, n * sizeof(qstr));
+        shape->keys[n] = attr;
+        shape->num_keys += 1;
+    }
+    ++MP_STATE_VM(instance_shape_count);
+    return shape;
+}
+
+STATIC mp_obj_shape_t *shape_root(void) {
+    if (MP_STATE_VM(instance_shape_root) == NULL) {
+        MP_STATE_VM(instance_shape_root) = shape_new(NULL, MP_QSTR_NULL);
+    }
+    return MP_STATE_VM(instance_shape_root);
+}
+
+// Return the shape reached by adding attr to the given shape.  If there's
+// no such shape yet then it's created, unless check_limits is true and the
+// limits on shapes have been reached, in which case NULL is returned.
+STATIC mp_obj_shape_t *shape_add(mp_obj_shape_t *shape, qstr attr, bool check_limits) {
+    size_t n = shape->num_keys;
+    for (mp_obj_shape_t *child = shape->children; child != NULL; child = child->sibling) {
+        if (child->keys[n] == attr) {
+            return child;
+        }
+    }
+    if (check_limits && (n >= MICROPY_PY_INSTANCE_SHAPES_MAX_ATTRS
+        || MP_STATE_VM(instance_shape_count) >= MICROPY_PY_INSTANCE_SHAPES_MAX)) {
+        return NULL;
+    }
+    mp_obj_shape_t *child = shape_new(shape, attr);
+    child->sibling = shape->children;
+    shape->children = child;
+    return child;
+}
+
+STATIC mp_int_t shape_find(const mp_obj_shape_t *shape, qstr attr) {
+    for (size_t i = 0; i < shape->num_keys; ++i) {
+        if (shape->keys[i] == attr) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Return the number of words to allocate after subobj for the slots of an
+// instance of type.
+STATIC size_t instance_num_inline_slots(const mp_obj_type_t *type) {
+    #if MICROPY_PY_SLOTS
+    if (type->flags & TYPE_FLAG_HAS_SLOTS) {
+        const mp_obj_shape_t *shape = ((const mp_obj_class_t*)type)->slots_shape;
+        if (shape->is_inline && shape->num_keys != 0) {
+            // the first slot goes in the members field
+            return shape->num_keys - 1;
+        }
+        return shape->num_keys;
+    }
+    #else
+    (void)type;
+    #endif
+    return 0;
+}
+
+STATIC void instance_init_members(mp_obj_instance_t *self, size_t num_native_bases) {
+    #if MICROPY_PY_SLOTS
+    // start with the layout given by __slots__, with all slots unset
+    mp_obj_shape_t *shape = ((const mp_obj_class_t*)self->base.type)->slots_shape;
+    if (shape != NULL) {
+        size_t n = shape->num_keys;
+        self->shape = shape;
+        self->members.slots = NULL;
+        if (shape->is_inline) {
+            // slots start at members.first_slot
+        } else if (instance_has_fixed_slots(self)) {
+            self->members.slots = &self->subobj[num_native_bases];
+        } else if (n != 0) {
+            self->members.slots = m_new(mp_obj_t, INSTANCE_SLOTS_ALLOC(n));
+        }
+        mp_obj_t *slots = MP_OBJ_INSTANCE_SLOTS(self, shape);
+        for (size_t i = 0; i < n; ++i) {
+            slots[i] = MP_OBJ_NULL;
+        }
+        return;
+    }
+    #else
+    (void)num_native_bases;
+    #endif
+    self->shape = shape_root();
+    self->members.slots = NULL;
+}
+
+// Move the attributes of the instance out of its slots into a map.
+STATIC void instance_convert_to_map(mp_obj_instance_t *self) {
+    const mp_obj_shape_t *shape = self->shape;
+    mp_map_t *map = m_new_obj(mp_map_t);
+    mp_map_init(map, shape->num_keys + 1);
+    for (size_t i = 0; i < shape->num_keys; ++i) {
+        if (self->members.slots[i] != MP_OBJ_NULL) {
+            mp_map_lookup(map, MP_OBJ_NEW_QSTR(shape->keys[i]), MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = self->members.slots[i];
+        }
+    }
+    self->shape = NULL;
+    self->members.map = map;
+}
+
+mp_obj_t *mp_obj_instance_find_attr(mp_obj_instance_t *self, qstr attr, byte *cache) {
+    if (self->shape == NULL) {
+        mp_map_elem_t *elem = mp_map_lookup(self->members.map, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP);
+        return elem == NULL ? NULL : &elem->value;
+    }
+    mp_int_t i = shape_find(self->shape, attr);
+    if (i < 0) {
+        return NULL;
+    }
+    if (cache != NULL) {
+        *cache = i;
+    }
+    return &MP_OBJ_INSTANCE_SLOTS(self, self->shape)[i];
+}
+
+// Note: the returned slot may hold MP_OBJ_NULL if it's an unset __slots__ entry
+#define instance_find_attr(self, attr) mp_obj_instance_find_attr((self), (attr), NULL)
+
+STATIC bool instance_store_attr(mp_obj_instance_t *self, qstr attr, mp_obj_t value) {
+    mp_obj_t *slot = instance_find_attr(self, attr);
+    if (slot != NULL) {
+        *slot = value;
+        return true;
+    }
+    if (instance_has_fixed_slots(self)) {
+        // not one of the names in __slots__
+        return false;
+    }
+    if (self->shape != NULL) {
+        mp_obj_shape_t *shape = shape_add(self->shape, attr, true);
+        if (shape != NULL) {
+            size_t n = self->shape->num_keys;
+            if (n % INSTANCE_SLOTS_STEP == 0) {
+                self->members.slots = m_renew(mp_obj_t, self->members.slots, n, n + INSTANCE_SLOTS_STEP);
+            }
+            self->members.slots[n] = value;
+            self->shape = shape;
+            return true;
+        }
+        instance_convert_to_map(self);
+    }
+    mp_map_lookup(self->members.map, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = value;
+    return true;
+}
+
+STATIC bool instance_delete_attr(mp_obj_instance_t *self, qstr attr) {
+    if (self->shape != NULL) {
+        mp_obj_t *slot = instance_find_attr(self, attr);
+        if (slot == NULL || *slot == MP_OBJ_NULL) {
+            return false;
+        }
+        if (instance_has_fixed_slots(self)) {
+            *slot = MP_OBJ_NULL;
+            return true;
+        }
+        // deleting attributes is rare so don't try to keep the slots layout
+        instance_convert_to_map(self);
+    }
+    return mp_map_lookup(self->members.map, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP_REMOVE_IF_FOUND) != NULL;
+}
+
+#if MICROPY_PY_SLOTS
+// Work out the shape that instances of a new class start with, from its
+// own __slots__ (if any) and the slots of its bases.  Instances have no
+// attributes other than their slots if every class that they derive from
+// defines __slots__ without "__dict__".
+STATIC mp_obj_shape_t *shape_in_tree(mp_obj_shape_t *shape) {
+    if (!shape->is_inline) {
+        return shape;
+    }
+    mp_obj_shape_t *tree_shape = shape_root();
+    for (size_t i = 0; i < shape->num_keys; ++i) {
+        tree_shape = shape_add(tree_shape, shape->keys[i], false);
+    }
+    return tree_shape;
+}
+
+// Whether a class attribute with the given name is inherited from the bases.
+// A slot can't have the name of one, as it may be a property or descriptor.
+STATIC bool bases_have_attr(size_t bases_len, const mp_obj_t *bases, qstr attr) {
+    for (size_t i = 0; i < bases_len; ++i) {
+        mp_obj_t dest[2];
+        mp_load_method_maybe(bases[i], attr, dest);
+        if (dest[0] != MP_OBJ_NULL) {
+            return true;
+        }
+    }
+    return false;
+}
+
+STATIC void class_init_slots(mp_obj_class_t *cls, size_t bases_len, const mp_obj_t *bases, size_t num_native_bases) {
+    mp_obj_shape_t *shape = NULL;
+    bool has_dict = false;
+    for (size_t i = 0; i < bases_len; ++i) {
+        const mp_obj_type_t *t = MP_OBJ_TO_PTR(bases[i]);
+        if (!mp_obj_is_instance_type(t)) {
+            continue;
+        }
+        if (!(t->flags & TYPE_FLAG_HAS_SLOTS)) {
+            has_dict = true;
+        }
+        mp_obj_shape_t *base_shape = ((const mp_obj_class_t*)t)->slots_shape;
+        if (base_shape != NULL && base_shape->num_keys != 0) {
+            if (shape != NULL && shape != base_shape) {
+                mp_raise_TypeError("multiple bases have instance lay-out conflict");
+            }
+            shape = base_shape;
+        }
+    }
+
+    mp_map_t *locals_map = &cls->type.locals_dict->map;
+    mp_map_elem_t *elem = mp_map_lookup(locals_map, MP_OBJ_NEW_QSTR(MP_QSTR___slots__), MP_MAP_LOOKUP);
+    if (elem == NULL) {
+        // instances get the slots of their base, but also a dict
+        cls->slots_shape = shape == NULL ? NULL : shape_in_tree(shape);
+        return;
+    }
+
+    shape = shape == NULL ? shape_root() : shape_in_tree(shape);
+    mp_obj_t iter = elem->value;
+    if (mp_obj_is_str(iter)) {
+        // a single name
+        iter = mp_obj_new_tuple(1, &iter);
+    }
+    iter = mp_getiter(iter, NULL);
+    mp_obj_t name;
+    while ((name = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
+        qstr attr = mp_obj_str_get_qstr(name);
+        if (attr == MP_QSTR___dict__) {
+            has_dict = true;
+            continue;
+        }
+        if (mp_map_lookup(locals_map, name, MP_MAP_LOOKUP) != NULL || bases_have_attr(bases_len, bases, attr)) {
+            if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
+                mp_raise_ValueError("__slots__ conflicts with class variable");
+            } else {
+                nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
+                    "'%q' in __slots__ conflicts with class variable", attr));
+            }
+        }
+        if (shape_find(shape, attr) < 0) {
+            shape = shape_add(shape, attr, false);
+        }
+    }
+    if (!has_dict) {
+        cls->type.flags |= TYPE_FLAG_HAS_SLOTS;
+        if (num_native_bases == 0) {
+            // store the slots inline, using a shape of this class's own
+            mp_obj_shape_t *inline_shape = m_new_obj_var(mp_obj_shape_t, qstr, shape->num_keys);
+            inline_shape->children = NULL;
+            inline_shape->sibling = NULL;
+            inline_shape->num_keys = shape->num_keys;
+            inline_shape->is_inline = true;
+            memcpy(inline_shape->keys, shape->keys, shape->num_keys * sizeof(qstr));
+            shape = inline_shape;
+        }
+    }
+    cls->slots_shape = shape;
+}
+#endif
+
+#else
+
+#define instance_has_fixed_slots(self) (false)
+
+STATIC size_t instance_num_inline_slots(const mp_obj_type_t *type) {
+    (void)type;
+    return 0;
+}
+
+STATIC void instance_init_members(mp_obj_instance_t *self, size_t num_native_bases) {
+    (void)num_native_bases;
+    mp_map_init(&self->members, 0);
+}
+
+STATIC mp_obj_t *instance_find_attr(mp_obj_instance_t *self, qstr attr) {
+    mp_map_elem_t *elem = mp_map_lookup(&self->members, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP);
+    return elem == NULL ? NULL : &elem->value;
+}
+
+STATIC bool instance_store_attr(mp_obj_instance_t *self, qstr attr, mp_obj_t value) {
+    mp_map_lookup(&self->members, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = value;
+    return true;
+}
+
+STATIC bool instance_delete_attr(mp_obj_instance_t *self, qstr attr) {
+    return mp_map_lookup(&self->members, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP_REMOVE_IF_FOUND) != NULL;
+}
+
+#endif
+
 #if !MICROPY_CPYTHON_COMPAT
 STATIC
 #endif
 mp_obj_instance_t *mp_obj_new_instance(const mp_obj_type_t *class, const mp_obj_type_t **native_base) {
     size_t num_native_bases = instance_count_native_bases(class, native_base);
     assert(num_native_bases < 2);
-    mp_obj_instance_t *o = m_new_obj_var(mp_obj_instance_t, mp_obj_t, num_native_bases);
+    mp_obj_instance_t *o = m_new_obj_var(mp_obj_instance_t, mp_obj_t, num_native_bases + instance_num_inline_slots(class));
     o->base.type = class;
-    mp_map_init(&o->members, 0);
+    instance_init_members(o, num_native_bases);
     // Initialise the native base-class slot (should be 1 at most) with a valid
     // object.  It doesn't matter which object, so long as it can be uniquely
     // distinguished from a native class that is initialised.
@@ -397,8 +725,18 @@ STATIC mp_obj_t instance_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
         const mp_obj_type_t *native_base;
         size_t num_native_bases = instance_count_native_bases(mp_obj_get_type(self_in), &native_base);
 
-        size_t sz = sizeof(*self) + sizeof(*self->subobj) * num_native_bases
-            + sizeof(*self->members.table) * self->members.alloc;
+        size_t sz = sizeof(*self) + sizeof(*self->subobj) * num_native_bases;
+        #if MICROPY_PY_INSTANCE_SHAPES
+        if (self->shape == NULL) {
+            sz += sizeof(mp_map_t) + sizeof(mp_map_elem_t) * self->members.map->alloc;
+        } else if (instance_has_fixed_slots(self)) {
+            sz += sizeof(mp_obj_t) * instance_num_inline_slots(self->base.type);
+        } else {
+            sz += sizeof(mp_obj_t) * INSTANCE_SLOTS_ALLOC(self->shape->num_keys);
+        }
+        #else
+        sz += sizeof(*self->members.table) * self->members.alloc;
+        #endif
         return MP_OBJ_NEW_SMALL_INT(sz);
     }
     #endif
@@ -580,18 +918,33 @@ STATIC void mp_obj_instance_load_attr(mp_obj_t self_in, qstr attr, mp_obj_t *des
     assert(mp_obj_is_instance_type(mp_obj_get_type(self_in)));
     mp_obj_instance_t *self = MP_OBJ_TO_PTR(self_in);
 
-    mp_map_elem_t *elem = mp_map_lookup(&self->members, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP);
-    if (elem != NULL) {
+    mp_obj_t *slot = instance_find_attr(self, attr);
+    if (slot != NULL && *slot != MP_OBJ_NULL) {
         // object member, always treated as a value
-        dest[0] = elem->value;
+        dest[0] = *slot;
         return;
     }
 #if MICROPY_CPYTHON_COMPAT
-    if (attr == MP_QSTR___dict__) {
+    if (attr == MP_QSTR___dict__ && !instance_has_fixed_slots(self)) {
         // Create a new dict with a copy of the instance's map items.
         // This creates, unlike CPython, a 'read-only' __dict__: modifying
         // it will not result in modifications to the actual instance members.
+        #if MICROPY_PY_INSTANCE_SHAPES
+        if (self->shape != NULL) {
+            const mp_obj_shape_t *shape = self->shape;
+            mp_obj_t attr_dict = mp_obj_new_dict(shape->num_keys);
+            for (size_t i = 0; i < shape->num_keys; ++i) {
+                if (self->members.slots[i] != MP_OBJ_NULL) {
+                    mp_obj_dict_store(attr_dict, MP_OBJ_NEW_QSTR(shape->keys[i]), self->members.slots[i]);
+                }
+            }
+            dest[0] = attr_dict;
+            return;
+        }
+        mp_map_t *map = self->members.map;
+        #else
         mp_map_t *map = &self->members;
+        #endif
         mp_obj_t attr_dict = mp_obj_new_dict(map->used);
         for (size_t i = 0; i < map->alloc; ++i) {
             if (mp_map_slot_is_filled(map, i)) {
@@ -788,12 +1141,10 @@ skip_special_accessors:
 
     if (value == MP_OBJ_NULL) {
         // delete attribute
-        mp_map_elem_t *elem = mp_map_lookup(&self->members, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP_REMOVE_IF_FOUND);
-        return elem != NULL;
+        return instance_delete_attr(self, attr);
     } else {
         // store attribute
-        mp_map_lookup(&self->members, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = value;
-        return true;
+        return instance_store_attr(self, attr, value);
     }
 }
 
@@ -1107,7 +1458,12 @@ mp_obj_t mp_obj_new_type(qstr name, mp_obj_t bases_tuple, mp_obj_t locals_dict)
         #endif
     }
 
+    #if MICROPY_PY_SLOTS
+    mp_obj_class_t *cls = m_new0(mp_obj_class_t, 1);
+    mp_obj_type_t *o = &cls->type;
+    #else
     mp_obj_type_t *o = m_new0(mp_obj_type_t, 1);
+    #endif
     o->base.type = &mp_type_type;
     o->flags = base_flags;
     o->name = name;
@@ -1163,6 +1519,10 @@ mp_obj_t mp_obj_new_type(qstr name, mp_obj_t bases_tuple, mp_obj_t locals_dict)
         mp_raise_TypeError("multiple bases have instance lay-out conflict");
     }
 
+    #if MICROPY_PY_SLOTS
+    class_init_slots(cls, bases_len, bases_items, num_native_bases);
+    #endif
+
     mp_map_t *locals_map = &o->locals_dict->map;
     mp_map_elem_t *elem = mp_map_lookup(locals_map, MP_OBJ_NEW_QSTR(MP_QSTR___new__), MP_MAP_LOOKUP);
     if (elem != NULL) {
@@ -28,15 +28,80 @@
 
 #include "py/obj.h"
 
+#if MICROPY_PY_SLOTS && !MICROPY_PY_INSTANCE_SHAPES
+#error MICROPY_PY_SLOTS requires MICROPY_PY_INSTANCE_SHAPES
+#endif
+
+// flags for the types of classes created at runtime
+#define TYPE_FLAG_IS_SUBCLASSED (0x0001)
+#define TYPE_FLAG_HAS_SPECIAL_ACCESSORS (0x0002)
+#define TYPE_FLAG_HAS_SLOTS (0x0004)
+
+#if MICROPY_PY_INSTANCE_SHAPES
+// A shape describes where an instance keeps its attributes: the attribute
+// named keys[i] is stored in slots[i].  Shapes form a tree rooted at the
+// empty shape with one edge per added attribute, so instances that have
+// the same attributes set in the same order share a shape.
+typedef struct _mp_obj_shape_t {
+    struct _mp_obj_shape_t *children;
+    struct _mp_obj_shape_t *sibling;
+    size_t num_keys;
+    #if MICROPY_PY_SLOTS
+    // set for the shapes of classes with __slots__ whose instances hold their
+    // slots inline, starting at members.first_slot; such shapes are not in the tree
+    bool is_inline;
+    #endif
+    qstr keys[];
+} mp_obj_shape_t;
+#endif
+
 // instance object
 // creating an instance of a class makes one of these objects
 typedef struct _mp_obj_instance_t {
     mp_obj_base_t base;
+    #if MICROPY_PY_INSTANCE_SHAPES
+    // if shape is NULL then the attributes are held in a map instead; an
+    // entry in slots may be MP_OBJ_NULL if it's an unset __slots__ attribute
+    mp_obj_shape_t *shape;
+    union {
+        mp_obj_t *slots;
+        mp_map_t *map;
+        #if MICROPY_PY_SLOTS
+        mp_obj_t first_slot;
+        #endif
+    } members;
+    #else
     mp_map_t members;
+    #endif
     mp_obj_t subobj[];
     // TODO maybe cache __getattr__ and __setattr__ for efficient lookup of them
 } mp_obj_instance_t;
 
+#if MICROPY_PY_INSTANCE_SHAPES
+#if MICROPY_PY_SLOTS
+#define MP_OBJ_INSTANCE_SLOTS(self, shape) ((shape)->is_inline ? &(self)->members.first_slot : (self)->members.slots)
+#else
+#define MP_OBJ_INSTANCE_SLOTS(self, shape) ((self)->members.slots)
+#endif
+
+// Return a pointer to the value of the given instance attribute, or NULL if
+// the instance doesn't have it (the value is MP_OBJ_NULL if it's an unset
+// __slots__ attribute).  If cache is not NULL then the attribute's slot index
+// is stored there.
+mp_obj_t *mp_obj_instance_find_attr(mp_obj_instance_t *self, qstr attr, byte *cache);
+
+// As above, but first try the slot index given by hint.  cache is updated
+// (if not NULL) when the hint was wrong.
+static inline mp_obj_t *mp_obj_instance_find_attr_cached(mp_obj_instance_t *self, qstr attr, const byte *hint, byte *cache) {
+    const mp_obj_shape_t *shape = self->shape;
+    size_t x = *hint;
+    if (shape != NULL && x < shape->num_keys && shape->keys[x] == attr) {
+        return &MP_OBJ_INSTANCE_SLOTS(self, shape)[x];
+    }
+    return mp_obj_instance_find_attr(self, attr, cache);
+}
+#endif
+
 #if MICROPY_CPYTHON_COMPAT
 // this is needed for object.__new__
 mp_obj_instance_t *mp_obj_new_instance(const mp_obj_type_t *cls, const mp_obj_type_t **native_base);
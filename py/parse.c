@@ -239,6 +239,15 @@ typedef struct _parser_t {
     #if MICROPY_COMP_CONST
     mp_map_t consts;
     #endif
+
+    #if MICROPY_COMP_STREAMING
+    mp_parse_stmt_hook_t stmt_hook;
+    void *stmt_hook_env;
+    // position of the node allocator at the start of the current top-level statement
+    mp_parse_chunk_t *stmt_mark_chunk_list;
+    mp_parse_chunk_t *stmt_mark_chunk;
+    size_t stmt_mark_used;
+    #endif
 } parser_t;
 
 STATIC const uint16_t *get_rule_arg(uint8_t r_id) {
@@ -290,6 +299,78 @@ STATIC void *parser_alloc(parser_t *parser, size_t num_bytes) {
     return ret;
 }
 
+#if MICROPY_COMP_STREAMING
+STATIC void parser_mark(parser_t *parser) {
+    parser->stmt_mark_chunk_list = parser->tree.chunk;
+    parser->stmt_mark_chunk = parser->cur_chunk;
+    parser->stmt_mark_used = parser->cur_chunk == NULL ? 0 : parser->cur_chunk->union_.used;
+}
+
+STATIC void parser_free_to_mark(parser_t *parser) {
+    // free the chunks that were finished since the mark, except the marked chunk itself
+    mp_parse_chunk_t *chunk = parser->tree.chunk;
+    while (chunk != parser->stmt_mark_chunk_list) {
+        mp_parse_chunk_t *next = chunk->union_.next;
+        if (chunk != parser->stmt_mark_chunk) {
+            m_del(byte, chunk, sizeof(mp_parse_chunk_t) + chunk->alloc);
+        }
+        chunk = next;
+    }
+    if (parser->cur_chunk != parser->stmt_mark_chunk) {
+        m_del(byte, parser->cur_chunk, sizeof(mp_parse_chunk_t) + parser->cur_chunk->alloc);
+    }
+
+    // continue allocating from the marked position
+    parser->tree.chunk = parser->stmt_mark_chunk_list;
+    parser->cur_chunk = parser->stmt_mark_chunk;
+    if (parser->cur_chunk != NULL) {
+        parser->cur_chunk->union_.used = parser->stmt_mark_used;
+    }
+}
+
+STATIC size_t parse_node_copy_size(mp_parse_node_t pn) {
+    if (!MP_PARSE_NODE_IS_STRUCT(pn)) {
+        return 0;
+    }
+    mp_parse_node_struct_t *pns = (mp_parse_node_struct_t*)pn;
+    size_t kind = MP_PARSE_NODE_STRUCT_KIND(pns);
+    size_t n = MP_PARSE_NODE_STRUCT_NUM_NODES(pns);
+    size_t size = sizeof(mp_parse_node_struct_t) + n * sizeof(mp_parse_node_t);
+    if (kind != RULE_const_object) {
+        if (rule_act_table[kind] & RULE_ACT_ADD_BLANK) {
+            // the blank node belongs to the compiler and is not a parse node
+            n -= 1;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            size += parse_node_copy_size(pns->nodes[i]);
+        }
+    }
+    return size;
+}
+
+STATIC mp_parse_node_t parse_node_copy(mp_parse_node_t pn, byte **buf) {
+    if (!MP_PARSE_NODE_IS_STRUCT(pn)) {
+        return pn;
+    }
+    mp_parse_node_struct_t *pns = (mp_parse_node_struct_t*)pn;
+    size_t kind = MP_PARSE_NODE_STRUCT_KIND(pns);
+    size_t n = MP_PARSE_NODE_STRUCT_NUM_NODES(pns);
+    size_t size = sizeof(mp_parse_node_struct_t) + n * sizeof(mp_parse_node_t);
+    mp_parse_node_struct_t *copy = (mp_parse_node_struct_t*)*buf;
+    *buf += size;
+    memcpy(copy, pns, size);
+    if (kind != RULE_const_object) {
+        if (rule_act_table[kind] & RULE_ACT_ADD_BLANK) {
+            n -= 1;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            copy->nodes[i] = parse_node_copy(pns->nodes[i], buf);
+        }
+    }
+    return (mp_parse_node_t)copy;
+}
+#endif
+
 STATIC void push_rule(parser_t *parser, size_t src_line, uint8_t rule_id, size_t arg_i) {
     if (parser->rule_stack_top >= parser->rule_stack_alloc) {
         rule_stack_t *rs = m_renew(rule_stack_t, parser->rule_stack, parser->rule_stack_alloc, parser->rule_stack_alloc + MICROPY_ALLOC_PARSE_RULE_INC);
@@ -595,6 +676,60 @@ STATIC bool fold_logical_constants(parser_t *parser, uint8_t rule_id, size_t *nu
         pop_result(parser);
         push_result_node(parser, pn);
         return true;
+
+    #if MICROPY_COMP_CONST_FOLDING_EXTRA
+    } else if (rule_id == RULE_comparison) {
+        // folding for comparisons of integers: < > == <= >= !=, possibly chained
+        mp_obj_t lhs;
+        if (!mp_parse_node_get_int_maybe(peek_result(parser, *num_args - 1), &lhs)) {
+            return false;
+        }
+        bool result = true;
+        for (ssize_t i = *num_args - 2; i > 0; i -= 2) {
+            mp_parse_node_t pn_op = peek_result(parser, i);
+            mp_obj_t rhs;
+            if (!MP_PARSE_NODE_IS_TOKEN(pn_op)
+                || !mp_parse_node_get_int_maybe(peek_result(parser, i - 1), &rhs)) {
+                return false;
+            }
+            mp_binary_op_t op;
+            switch (MP_PARSE_NODE_LEAF_ARG(pn_op)) {
+                case MP_TOKEN_OP_LESS: op = MP_BINARY_OP_LESS; break;
+                case MP_TOKEN_OP_MORE: op = MP_BINARY_OP_MORE; break;
+                case MP_TOKEN_OP_DBL_EQUAL: op = MP_BINARY_OP_EQUAL; break;
+                case MP_TOKEN_OP_LESS_EQUAL: op = MP_BINARY_OP_LESS_EQUAL; break;
+                case MP_TOKEN_OP_MORE_EQUAL: op = MP_BINARY_OP_MORE_EQUAL; break;
+                case MP_TOKEN_OP_NOT_EQUAL: op = MP_BINARY_OP_NOT_EQUAL; break;
+                default: return false; // "in" can't be applied to integers
+            }
+            if (mp_binary_op(op, lhs, rhs) == mp_const_false) {
+                result = false;
+            }
+            lhs = rhs;
+        }
+        for (size_t i = *num_args; i > 0; i--) {
+            pop_result(parser);
+        }
+        push_result_node(parser, mp_parse_node_new_leaf(MP_PARSE_NODE_TOKEN,
+            result ? MP_TOKEN_KW_TRUE : MP_TOKEN_KW_FALSE));
+        return true;
+
+    } else if (rule_id == RULE_test_if_expr) {
+        // folding for conditional expression with a constant condition
+        mp_parse_node_struct_t *pns = (mp_parse_node_struct_t*)peek_result(parser, 0);
+        mp_parse_node_t pn;
+        if (mp_parse_node_is_const_true(pns->nodes[0])) {
+            pn = peek_result(parser, 1);
+        } else if (mp_parse_node_is_const_false(pns->nodes[0])) {
+            pn = pns->nodes[1];
+        } else {
+            return false;
+        }
+        pop_result(parser);
+        pop_result(parser);
+        push_result_node(parser, pn);
+        return true;
+    #endif
     }
 
     return false;
@@ -728,6 +863,12 @@ STATIC bool fold_constants(parser_t *parser, uint8_t rule_id, size_t num_args) {
                 assert(elem->value == MP_OBJ_NULL);
                 elem->value = value;
 
+                #if MICROPY_COMP_CONST_IMPORT
+                if (MP_STATE_VM(parse_const_export) != MP_OBJ_NULL) {
+                    mp_obj_dict_store(MP_STATE_VM(parse_const_export), MP_OBJ_NEW_QSTR(id), value);
+                }
+                #endif
+
                 // If the constant starts with an underscore then treat it as a private
                 // variable and don't emit any code to store the value to the id.
                 if (qstr_str(id)[0] == '_') {
@@ -794,6 +935,203 @@ STATIC bool fold_constants(parser_t *parser, uint8_t rule_id, size_t num_args) {
 }
 #endif
 
+#if MICROPY_COMP_CONST_IMPORT
+// Returns the const() values of the module that "from <module> import" names,
+// or NULL if it isn't one of the modules in MP_STATE_VM(parse_const_modules).
+STATIC mp_map_t *import_from_consts(mp_parse_node_t pn_module) {
+    // get the name of the module, which can be dotted; relative imports are ignored
+    qstr module;
+    if (MP_PARSE_NODE_IS_ID(pn_module)) {
+        module = MP_PARSE_NODE_LEAF_ARG(pn_module);
+    } else if (MP_PARSE_NODE_IS_STRUCT_KIND(pn_module, RULE_dotted_name)) {
+        mp_parse_node_struct_t *pns = (mp_parse_node_struct_t*)pn_module;
+        vstr_t vstr;
+        vstr_init(&vstr, 16);
+        for (size_t i = 0; i < MP_PARSE_NODE_STRUCT_NUM_NODES(pns); ++i) {
+            if (i > 0) {
+                vstr_add_byte(&vstr, '.');
+            }
+            vstr_add_str(&vstr, qstr_str(MP_PARSE_NODE_LEAF_ARG(pns->nodes[i])));
+        }
+        module = qstr_from_strn(vstr.buf, vstr.len);
+        vstr_clear(&vstr);
+    } else {
+        return NULL;
+    }
+
+    mp_map_elem_t *elem = mp_map_lookup(mp_obj_dict_get_map(MP_STATE_VM(parse_const_modules)),
+        MP_OBJ_NEW_QSTR(module), MP_MAP_LOOKUP);
+    if (elem == NULL) {
+        return NULL;
+    }
+    return mp_obj_dict_get_map(elem->value);
+}
+
+// Whether the statement being parsed is at the top level of the module and
+// not inside a compound statement, so that it is always executed.
+STATIC bool parsing_module_level(parser_t *parser) {
+    for (size_t i = 0; i < parser->rule_stack_top; ++i) {
+        switch (parser->rule_stack[i].rule_id) {
+            case RULE_file_input:
+            case RULE_file_input_2:
+            case RULE_file_input_3:
+            case RULE_stmt:
+            case RULE_simple_stmt:
+            case RULE_simple_stmt_2:
+            case RULE_small_stmt:
+            case RULE_import_stmt:
+                break;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+// For "from <module> import <names>", where the parse nodes of <module> and
+// <names> are on the result stack: each name that is a const() of <module>
+// is added to the table of dynamic constants, so later uses get its value.
+// This is only done for imports at module level, and for names that the
+// module doesn't bind anywhere else, see mp_parse_find_const_stores.
+STATIC void import_consts(parser_t *parser) {
+    if (MP_STATE_VM(parse_const_modules) == MP_OBJ_NULL
+        || MP_STATE_VM(parse_const_stores) == MP_OBJ_NULL
+        || !parsing_module_level(parser)) {
+        return;
+    }
+
+    mp_map_t *module_consts = import_from_consts(peek_result(parser, 1));
+    if (module_consts == NULL) {
+        return;
+    }
+    mp_map_t *stores = mp_obj_dict_get_map(MP_STATE_VM(parse_const_stores));
+
+    mp_parse_node_t pn_names = peek_result(parser, 0);
+    mp_parse_node_t *nodes;
+    size_t n = mp_parse_node_extract_list(&pn_names, RULE_import_as_names, &nodes);
+    for (size_t i = 0; i < n; ++i) {
+        if (!MP_PARSE_NODE_IS_STRUCT_KIND(nodes[i], RULE_import_as_name)) {
+            // "from <module> import *" is not inlined
+            continue;
+        }
+        mp_parse_node_struct_t *pns = (mp_parse_node_struct_t*)nodes[i];
+        qstr name = MP_PARSE_NODE_LEAF_ARG(pns->nodes[0]);
+        mp_map_elem_t *elem_value = mp_map_lookup(module_consts, MP_OBJ_NEW_QSTR(name), MP_MAP_LOOKUP);
+        if (elem_value == NULL) {
+            continue;
+        }
+        if (!MP_PARSE_NODE_IS_NULL(pns->nodes[1])) {
+            // "import <name> as <alias>"
+            name = MP_PARSE_NODE_LEAF_ARG(pns->nodes[1]);
+        }
+        if (mp_map_lookup(stores, MP_OBJ_NEW_QSTR(name), MP_MAP_LOOKUP) != NULL) {
+            // the name is assigned elsewhere, so it doesn't always have this value
+            continue;
+        }
+        mp_map_lookup(&parser->consts, MP_OBJ_NEW_QSTR(name), MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = elem_value->value;
+        if (MP_STATE_VM(parse_const_export) != MP_OBJ_NULL) {
+            // the name is a global of this module too, so export it
+            mp_obj_dict_store(MP_STATE_VM(parse_const_export), MP_OBJ_NEW_QSTR(name), elem_value->value);
+        }
+    }
+}
+
+STATIC void const_stores_add(mp_map_t *stores, mp_parse_node_t pn) {
+    if (MP_PARSE_NODE_IS_ID(pn)) {
+        mp_map_lookup(stores, MP_OBJ_NEW_QSTR(MP_PARSE_NODE_LEAF_ARG(pn)), MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = mp_const_none;
+    } else if (MP_PARSE_NODE_IS_STRUCT(pn)) {
+        mp_parse_node_struct_t *pns = (mp_parse_node_struct_t*)pn;
+        size_t kind = MP_PARSE_NODE_STRUCT_KIND(pns);
+        size_t n = MP_PARSE_NODE_STRUCT_NUM_NODES(pns);
+        if (kind == RULE_const_object) {
+            return;
+        }
+        if (rule_act_table[kind] & RULE_ACT_ADD_BLANK) {
+            n -= 1;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            const_stores_add(stores, pns->nodes[i]);
+        }
+    }
+}
+
+STATIC void const_stores_find(mp_map_t *stores, mp_parse_node_t pn, bool module_level) {
+    if (!MP_PARSE_NODE_IS_STRUCT(pn)) {
+        return;
+    }
+    mp_parse_node_struct_t *pns = (mp_parse_node_struct_t*)pn;
+    size_t kind = MP_PARSE_NODE_STRUCT_KIND(pns);
+    size_t n = MP_PARSE_NODE_STRUCT_NUM_NODES(pns);
+    if (kind == RULE_const_object) {
+        return;
+    }
+    if (rule_act_table[kind] & RULE_ACT_ADD_BLANK) {
+        n -= 1;
+    }
+
+    // The targets of a binding are added whole, so eg the index of a[i] = x
+    // counts as bound too.  That only means that fewer names are inlined.
+    switch (kind) {
+        case RULE_file_input_2:
+        case RULE_simple_stmt_2:
+            for (size_t i = 0; i < n; ++i) {
+                const_stores_find(stores, pns->nodes[i], module_level);
+            }
+            return;
+        case RULE_import_from:
+            if (module_level && import_from_consts(pns->nodes[0]) != NULL) {
+                // the names this binds are the ones that get inlined
+                return;
+            }
+            const_stores_add(stores, pns->nodes[1]);
+            return;
+        case RULE_import_name:
+        case RULE_global_stmt:
+        case RULE_nonlocal_stmt:
+        case RULE_del_stmt:
+            const_stores_add(stores, pns->nodes[0]);
+            return;
+        case RULE_expr_stmt:
+            if (!MP_PARSE_NODE_IS_NULL(pns->nodes[1])) {
+                const_stores_add(stores, pns->nodes[0]);
+                if (MP_PARSE_NODE_IS_STRUCT_KIND(pns->nodes[1], RULE_expr_stmt_assign_list)) {
+                    // a = b = c
+                    mp_parse_node_struct_t *pns1 = (mp_parse_node_struct_t*)pns->nodes[1];
+                    for (size_t i = 0; i + 1 < MP_PARSE_NODE_STRUCT_NUM_NODES(pns1); ++i) {
+                        const_stores_add(stores, pns1->nodes[i]);
+                    }
+                }
+            }
+            break;
+        case RULE_for_stmt:
+        case RULE_comp_for:
+            const_stores_add(stores, pns->nodes[0]);
+            break;
+        case RULE_funcdef:
+            const_stores_add(stores, pns->nodes[0]);
+            const_stores_add(stores, pns->nodes[1]);
+            break;
+        case RULE_classdef:
+        case RULE_lambdef:
+        case RULE_lambdef_nocond:
+            const_stores_add(stores, pns->nodes[0]);
+            break;
+        case RULE_with_item:
+        case RULE_try_stmt_as_name:
+            const_stores_add(stores, pns->nodes[1]);
+            break;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        const_stores_find(stores, pns->nodes[i], false);
+    }
+}
+
+void mp_parse_find_const_stores(const mp_parse_tree_t *tree, mp_obj_t stores) {
+    const_stores_find(mp_obj_dict_get_map(stores), tree->root, true);
+}
+#endif
+
 STATIC void push_result_rule(parser_t *parser, size_t src_line, uint8_t rule_id, size_t num_args) {
     // optimise away parenthesis around an expression if possible
     if (rule_id == RULE_atom_paren) {
@@ -809,6 +1147,12 @@ STATIC void push_result_rule(parser_t *parser, size_t src_line, uint8_t rule_id,
         }
     }
 
+    #if MICROPY_COMP_CONST_IMPORT
+    if (rule_id == RULE_import_from) {
+        import_consts(parser);
+    }
+    #endif
+
     #if MICROPY_COMP_CONST_FOLDING
     if (fold_logical_constants(parser, rule_id, &num_args)) {
         // we folded this rule so return straight away
@@ -829,7 +1173,34 @@ STATIC void push_result_rule(parser_t *parser, size_t src_line, uint8_t rule_id,
     push_result_node(parser, (mp_parse_node_t)pn);
 }
 
+#if MICROPY_COMP_STREAMING
+STATIC void parser_stmt_done(parser_t *parser) {
+    mp_parse_node_t pn = peek_result(parser, 0);
+    if (!parser->stmt_hook(parser->stmt_hook_env, pn)) {
+        return;
+    }
+
+    // copy what is left of the statement into a chunk of its own, then free
+    // all nodes allocated for the original statement
+    size_t size = parse_node_copy_size(pn);
+    mp_parse_chunk_t *chunk = (mp_parse_chunk_t*)m_new(byte, sizeof(mp_parse_chunk_t) + size);
+    chunk->alloc = size;
+    byte *buf = chunk->data;
+    pn = parse_node_copy(pn, &buf);
+    parser_free_to_mark(parser);
+    chunk->union_.next = parser->tree.chunk;
+    parser->tree.chunk = chunk;
+    parser->result_stack[parser->result_stack_top - 1] = pn;
+}
+
+mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
+    return mp_parse_streaming(lex, input_kind, NULL, NULL);
+}
+
+mp_parse_tree_t mp_parse_streaming(mp_lexer_t *lex, mp_parse_input_kind_t input_kind, mp_parse_stmt_hook_t stmt_hook, void *stmt_hook_env) {
+#else
 mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
+#endif
 
     // initialise parser and allocate memory for its stacks
 
@@ -852,6 +1223,11 @@ mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
     mp_map_init(&parser.consts, 0);
     #endif
 
+    #if MICROPY_COMP_STREAMING
+    parser.stmt_hook = stmt_hook;
+    parser.stmt_hook_env = stmt_hook_env;
+    #endif
+
     // work out the top-level rule to use, and push it on the stack
     size_t top_level_rule;
     switch (input_kind) {
@@ -1033,6 +1409,17 @@ mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
             default: {
                 assert((rule_act & RULE_ACT_KIND_MASK) == RULE_ACT_LIST);
 
+                #if MICROPY_COMP_STREAMING
+                if (rule_id == RULE_file_input_2 && !backtrack && parser.stmt_hook != NULL) {
+                    // the previous top-level statement (if any) is complete, and
+                    // the nodes of the next one will be allocated from here on
+                    if (i > 0) {
+                        parser_stmt_done(&parser);
+                    }
+                    parser_mark(&parser);
+                }
+                #endif
+
                 // n=2 is: item item*
                 // n=1 is: item (sep item)*
                 // n=3 is: item (sep item)* [sep]
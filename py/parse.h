@@ -104,4 +104,20 @@ typedef struct _mp_parse_t {
 mp_parse_tree_t mp_parse(struct _mp_lexer_t *lex, mp_parse_input_kind_t input_kind);
 void mp_parse_tree_clear(mp_parse_tree_t *tree);
 
+#if MICROPY_COMP_CONST_IMPORT
+// Adds to the dict stores each name that the parsed module binds other than by
+// a module-level "from <module> import" of one of MP_STATE_VM(parse_const_modules).
+// The names are keys, with None as their values.
+void mp_parse_find_const_stores(const mp_parse_tree_t *tree, mp_obj_t stores);
+#endif
+
+#if MICROPY_COMP_STREAMING
+// Called with each top-level statement of file input as soon as it is parsed.
+// If it returns true then the hook has finished with the parts of the statement
+// that it set to MP_PARSE_NODE_NULL, and the parser frees them.
+typedef bool (*mp_parse_stmt_hook_t)(void *env, mp_parse_node_t pn);
+
+mp_parse_tree_t mp_parse_streaming(struct _mp_lexer_t *lex, mp_parse_input_kind_t input_kind, mp_parse_stmt_hook_t stmt_hook, void *stmt_hook_env);
+#endif
+
 #endif // MICROPY_INCLUDED_PY_PARSE_H
@@ -33,6 +33,8 @@
 #include "py/emitglue.h"
 #include "py/persistentcode.h"
 #include "py/bc.h"
+#include "py/bc0.h"
+#include "py/mperrno.h"
 
 #if MICROPY_PERSISTENT_CODE_LOAD || MICROPY_PERSISTENT_CODE_SAVE
 
@@ -46,7 +48,10 @@
 
 // Macros to encode/decode native architecture to/from the feature byte
 #define MPY_FEATURE_ENCODE_ARCH(arch) ((arch) << 2)
-#define MPY_FEATURE_DECODE_ARCH(feat) ((feat) >> 2)
+#define MPY_FEATURE_DECODE_ARCH(feat) (((feat) >> 2) & 0x1f)
+
+// Top bit of the feature byte marks an execute-in-place image
+#define MPY_FEATURE_XIP (0x80)
 
 // The feature flag bits encode the compile-time config options that
 // affect the generate bytecode.
@@ -77,8 +82,10 @@
 
 #if MICROPY_DYNAMIC_COMPILER
 #define MPY_FEATURE_ARCH_DYNAMIC mp_dynamic_compiler.native_arch
+#define MPY_SAVE_XIP_DYNAMIC mp_dynamic_compiler.persistent_code_xip
 #else
 #define MPY_FEATURE_ARCH_DYNAMIC MPY_FEATURE_ARCH
+#define MPY_SAVE_XIP_DYNAMIC (0)
 #endif
 
 #if MICROPY_PERSISTENT_CODE_LOAD || (MICROPY_PERSISTENT_CODE_SAVE && !MICROPY_DYNAMIC_COMPILER)
@@ -157,7 +164,7 @@ typedef struct _bytecode_prelude_t {
     uint code_info_size;
 } bytecode_prelude_t;
 
-#if MICROPY_PERSISTENT_CODE_SAVE || MICROPY_EMIT_NATIVE
+#if MICROPY_PERSISTENT_CODE_SAVE || MICROPY_EMIT_NATIVE || MICROPY_PERSISTENT_CODE_XIP
 
 // ip will point to start of opcodes
 // ip2 will point to simple_name, source_file qstrs
@@ -182,6 +189,7 @@ STATIC void extract_prelude(const byte **ip, const byte **ip2, bytecode_prelude_
 #if MICROPY_PERSISTENT_CODE_LOAD
 
 #include "py/parsenum.h"
+#include "py/objstr.h"
 
 #if MICROPY_EMIT_NATIVE
 
@@ -264,10 +272,42 @@ STATIC qstr load_qstr(mp_reader_t *reader, qstr_window_t *qw) {
     return qst;
 }
 
+#if MICROPY_PERSISTENT_CODE_XIP
+// Execute-in-place images store str/bytes data null terminated, so if the
+// image is in memory then the object can refer to the data where it is
+STATIC mp_obj_t load_str_xip(mp_reader_t *reader, const mp_obj_type_t *type) {
+    size_t len = read_uint(reader, NULL);
+    const byte *data = mp_reader_try_read_mem(reader, len + 1);
+    if (data == NULL) {
+        vstr_t vstr;
+        vstr_init_len(&vstr, len);
+        read_bytes(reader, (byte*)vstr.buf, len);
+        read_byte(reader); // null terminator
+        return mp_obj_new_str_from_vstr(type, &vstr);
+    }
+    if (type == &mp_type_str) {
+        qstr q = qstr_find_strn((const char*)data, len);
+        if (q != MP_QSTR_NULL) {
+            return MP_OBJ_NEW_QSTR(q);
+        }
+    }
+    mp_obj_str_t *o = m_new_obj(mp_obj_str_t);
+    o->base.type = type;
+    o->hash = qstr_compute_hash(data, len);
+    o->len = len;
+    o->data = data;
+    return MP_OBJ_FROM_PTR(o);
+}
+#endif
+
 STATIC mp_obj_t load_obj(mp_reader_t *reader) {
     byte obj_type = read_byte(reader);
     if (obj_type == 'e') {
         return MP_OBJ_FROM_PTR(&mp_const_ellipsis_obj);
+    #if MICROPY_PERSISTENT_CODE_XIP
+    } else if (obj_type == 'S' || obj_type == 'B') {
+        return load_str_xip(reader, obj_type == 'S' ? &mp_type_str : &mp_type_bytes);
+    #endif
     } else {
         size_t len = read_uint(reader, NULL);
         vstr_t vstr;
@@ -300,6 +340,158 @@ STATIC void load_prelude(mp_reader_t *reader, byte **ip, byte **ip2, bytecode_pr
     }
 }
 
+#if MICROPY_PERSISTENT_CODE_LAZY_LINES || MICROPY_PERSISTENT_CODE_LAZY
+
+// Reads a .mpy file while keeping count of the position in it, so that line
+// tables and functions can be left in the file and found again from their
+// offset
+typedef struct _file_reader_t {
+    mp_reader_t file;
+    size_t pos;
+    const char *path;
+    #if MICROPY_PERSISTENT_CODE_LAZY_LINES
+    qstr source_file; // the last one checked by lines_findable
+    bool findable;
+    #endif
+    #if MICROPY_PERSISTENT_CODE_LAZY
+    bool lazy; // whether functions can be left in the file
+    qstr path_qstr; // path, once a function was left in the file
+    #endif
+} file_reader_t;
+
+STATIC mp_uint_t file_reader_readbyte(void *data) {
+    file_reader_t *fr = data;
+    ++fr->pos;
+    return fr->file.readbyte(fr->file.data);
+}
+
+STATIC void file_reader_close(void *data) {
+    file_reader_t *fr = data;
+    fr->file.close(fr->file.data);
+}
+
+#endif
+
+#if MICROPY_PERSISTENT_CODE_LAZY_LINES
+
+// Makes the path that import gives to the .mpy file of source_file (a .py
+// file name relative to an entry of sys.path) in the i'th entry, and returns
+// false if there is no such entry
+STATIC bool lines_file_path(vstr_t *path, qstr source_file, size_t i) {
+    size_t path_num;
+    mp_obj_t *path_items;
+    mp_obj_list_get(mp_sys_path, &path_num, &path_items);
+    if (i >= path_num && !(i == 0 && path_num == 0)) {
+        return false;
+    }
+    vstr_reset(path);
+    if (path_num != 0) {
+        size_t len;
+        const char *dir = mp_obj_str_get_data(path_items[i], &len);
+        if (len > 0) {
+            vstr_add_strn(path, dir, len);
+            vstr_add_char(path, '/');
+        }
+    }
+    size_t len;
+    const char *src = (const char*)qstr_data(source_file, &len);
+    vstr_add_strn(path, src, len - 3);
+    vstr_add_str(path, ".mpy");
+    return true;
+}
+
+// The line tables of a .mpy file are only left in it if mp_raw_code_lazy_line
+// can find the file again without keeping its path, from the source file
+STATIC bool lines_findable(file_reader_t *fr, qstr source_file) {
+    if (fr->source_file != source_file) {
+        fr->source_file = source_file;
+        fr->findable = false;
+        size_t len;
+        const char *src = (const char*)qstr_data(source_file, &len);
+        if (len > 3 && memcmp(src + len - 3, ".py", 3) == 0) {
+            vstr_t path;
+            vstr_init(&path, strlen(fr->path) + 1);
+            for (size_t i = 0; lines_file_path(&path, source_file, i); ++i) {
+                if (strcmp(vstr_null_terminated_str(&path), fr->path) == 0) {
+                    fr->findable = true;
+                    break;
+                }
+            }
+            vstr_clear(&path);
+        }
+    }
+    return fr->findable;
+}
+
+// The check value of a line table, which tells whether the table found in the
+// file when a traceback is printed is still the one that was loaded
+#define LINES_CHECK_INIT (5381)
+
+STATIC uint16_t lines_check_add(uint16_t check, byte c) {
+    return (check * 33) ^ c;
+}
+
+// Replaces the line table of bytecode, if it is the longer of the two, with a
+// marker (0x80 0x00, which the line encoding never produces), the check value
+// of the table (2 bytes) and the offset of the table in the file, given that
+// of fun_data.  Returns the number of bytes by which this shortens fun_data.
+STATIC size_t lines_leave_in_file(byte *fun_data, size_t fun_data_len, size_t file_offset) {
+    byte *ci = fun_data;
+    ci = (byte*)mp_decode_uint_skip(ci); // skip n_state
+    ci = (byte*)mp_decode_uint_skip(ci); // skip n_exc_stack
+    ci += 4; // skip scope_flags, n_pos_args, n_kwonly_args, n_def_pos_args
+    size_t code_info_size = mp_decode_uint_value(ci);
+    byte *ci_body = (byte*)mp_decode_uint_skip(ci);
+    byte *lines = ci_body + 4; // skip simple_name, source_file
+    size_t lines_len = ci + code_info_size - lines;
+    file_offset += lines - fun_data;
+
+    // same decoding as in mp_raw_code_lazy_line
+    uint16_t check = LINES_CHECK_INIT;
+    for (const byte *l = lines; l < lines + lines_len;) {
+        byte c = *l++;
+        check = lines_check_add(check, c);
+        if (c == 0) {
+            break;
+        }
+        if ((c & 0x80) != 0 && l < lines + lines_len) {
+            check = lines_check_add(check, *l++);
+        }
+    }
+
+    byte loc[4 + (BITS_PER_WORD + 6) / 7];
+    byte *p = loc + sizeof(loc);
+    size_t n = file_offset;
+    *--p = n & 0x7f;
+    while ((n >>= 7) != 0) {
+        *--p = 0x80 | (n & 0x7f);
+    }
+    *--p = check >> 8;
+    *--p = check;
+    *--p = 0x00;
+    *--p = 0x80;
+    size_t loc_len = loc + sizeof(loc) - p;
+    if (lines_len <= loc_len
+        || file_offset >> (BITS_PER_WORD - 1 - MP_LAZY_LINE_BC_BITS) != 0
+        || fun_data_len >> MP_LAZY_LINE_BC_BITS != 0) {
+        return 0;
+    }
+    size_t saved = lines_len - loc_len;
+    memcpy(lines, p, loc_len);
+    memmove(lines + loc_len, lines + lines_len, fun_data + fun_data_len - (lines + lines_len));
+
+    // rewrite code_info_size in the same number of bytes
+    n = code_info_size - saved;
+    ci_body[-1] = n & 0x7f;
+    for (p = ci_body - 1; p > ci;) {
+        n >>= 7;
+        *--p = 0x80 | (n & 0x7f);
+    }
+    return saved;
+}
+
+#endif
+
 STATIC void load_bytecode(mp_reader_t *reader, qstr_window_t *qw, byte *ip, byte *ip_top) {
     while (ip < ip_top) {
         *ip = read_byte(reader);
@@ -321,7 +513,153 @@ STATIC void load_bytecode(mp_reader_t *reader, qstr_window_t *qw, byte *ip, byte
     }
 }
 
-STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
+#if MICROPY_PERSISTENT_CODE_LAZY
+
+// A function left in a .mpy file, to be loaded on its first call
+typedef struct _lazy_stub_t {
+    qstr path; // of the file, which is opened again to load the function
+    size_t offset; // of the function in the file
+    qstr_window_t qw; // the qstr window at that offset
+} lazy_stub_t;
+
+// The most bytes of a prelude up to and including source_file
+#define LAZY_PRELUDE_MAX (3 * ((BITS_PER_WORD + 6) / 7) + 8)
+
+STATIC void skip_bytes(mp_reader_t *reader, size_t len) {
+    while (len-- > 0) {
+        reader->readbyte(reader->data);
+    }
+}
+
+// Skip over a bytecode function, whose kind and length have been read, and its
+// children, changing the qstr window as loading them would.  The start of its
+// prelude, up to and including simple_name and source_file, is stored in
+// prelude and its length is returned.
+STATIC size_t skip_raw_code(mp_reader_t *reader, qstr_window_t *qw, size_t fun_data_len, byte *prelude) {
+    byte *p = prelude;
+    read_uint(reader, &p); // n_state
+    read_uint(reader, &p); // n_exc_stack
+    read_bytes(reader, p, 4); // scope_flags, n_pos_args, n_kwonly_args, n_def_pos_args
+    size_t n_arg = p[1] + p[2];
+    p += 4;
+    byte *ci = p;
+    size_t code_info_size = read_uint(reader, &p);
+    mp_int_t n = fun_data_len - (p - prelude) - (code_info_size - (p - ci));
+    skip_bytes(reader, code_info_size - (p - ci));
+    while (--n, read_byte(reader) != 255) {
+        // closure cells
+    }
+    while (n > 0) {
+        byte op = read_byte(reader);
+        size_t sz;
+        uint f = mp_opcode_format(&op, &sz, false);
+        n -= sz;
+        --sz;
+        if (f == MP_OPCODE_QSTR) {
+            load_qstr(reader, qw);
+            sz -= 2;
+        } else if (f == MP_OPCODE_VAR_UINT) {
+            while (--n, read_byte(reader) & 0x80) {
+            }
+        }
+        skip_bytes(reader, sz);
+    }
+    qstr simple_name = load_qstr(reader, qw);
+    qstr source_file = load_qstr(reader, qw);
+    *p++ = simple_name; *p++ = simple_name >> 8;
+    *p++ = source_file; *p++ = source_file >> 8;
+
+    size_t n_obj = read_uint(reader, NULL);
+    size_t n_raw_code = read_uint(reader, NULL);
+    for (size_t i = 0; i < n_arg; ++i) {
+        load_qstr(reader, qw);
+    }
+    for (size_t i = 0; i < n_obj; ++i) {
+        if (read_byte(reader) != 'e') {
+            skip_bytes(reader, read_uint(reader, NULL));
+        }
+    }
+    for (size_t i = 0; i < n_raw_code; ++i) {
+        byte child_prelude[LAZY_PRELUDE_MAX];
+        skip_raw_code(reader, qw, read_uint(reader, NULL) >> 2, child_prelude);
+    }
+    return p - prelude;
+}
+
+// Leave a bytecode function in the file that reader reads, given its offset and
+// the qstr window there, and make a raw code for it.  Until its first call, which
+// loads it with mp_raw_code_load_lazy, its bytecode is just the start of its
+// prelude, which is enough to call it and to get its name, and its constant
+// table is the stub.
+STATIC mp_raw_code_t *load_raw_code_stub(mp_reader_t *reader, qstr_window_t *qw, size_t fun_data_len, size_t offset, const qstr_window_t *qw_start) {
+    byte prelude[LAZY_PRELUDE_MAX];
+    size_t prelude_len = skip_raw_code(reader, qw, fun_data_len, prelude);
+    file_reader_t *fr = reader->data;
+    if (fr->path_qstr == MP_QSTR_NULL) {
+        fr->path_qstr = qstr_from_str(fr->path);
+    }
+    lazy_stub_t *stub = m_new_obj(lazy_stub_t);
+    stub->path = fr->path_qstr;
+    stub->offset = offset;
+    stub->qw = *qw_start;
+    mp_raw_code_t *rc = mp_emit_glue_new_raw_code();
+    rc->kind = MP_CODE_BYTECODE_LAZY;
+    rc->scope_flags = *mp_decode_uint_skip(mp_decode_uint_skip(prelude));
+    rc->fun_data = memcpy(m_new(byte, prelude_len), prelude, prelude_len);
+    rc->const_table = (const mp_uint_t*)stub;
+    return rc;
+}
+
+// Set the entries of a constant table for the children of the bytecode in
+// fun_data, which start at index ct_idx, to whether each child can be left in
+// the file.  Class bodies aren't, as they are run on import anyway.
+STATIC void mark_lazy_children(mp_reader_t *reader, const byte *fun_data, size_t fun_data_len, mp_uint_t *ct, size_t ct_idx, size_t n_raw_code) {
+    bool lazy = fun_data != NULL && reader->readbyte == file_reader_readbyte && ((file_reader_t*)reader->data)->lazy;
+    for (size_t i = 0; i < n_raw_code; ++i) {
+        ct[i] = lazy;
+    }
+    if (!lazy) {
+        return;
+    }
+    const byte *ip = fun_data;
+    const byte *ip2;
+    bytecode_prelude_t prelude;
+    extract_prelude(&ip, &ip2, &prelude);
+    const byte *top = fun_data + fun_data_len;
+    bool build_class = false;
+    while (ip < top) {
+        if (build_class && MP_BC_MAKE_FUNCTION <= *ip && *ip <= MP_BC_MAKE_CLOSURE_DEFARGS) {
+            const byte *arg = ip + 1;
+            size_t idx = mp_decode_uint(&arg) - ct_idx;
+            if (idx < n_raw_code) {
+                ct[idx] = false;
+            }
+        }
+        build_class = *ip == MP_BC_LOAD_BUILD_CLASS;
+        size_t sz;
+        mp_opcode_format(ip, &sz, true);
+        ip += sz;
+    }
+}
+
+#endif
+
+STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw, bool lazy) {
+    #if MICROPY_PERSISTENT_CODE_LAZY
+    // A nested bytecode function of a file that can seek is left in the file,
+    // unless it is smaller than the stub that would refer to it
+    size_t offset = 0;
+    qstr_window_t qw_start;
+    if (lazy && reader->readbyte == file_reader_readbyte && ((file_reader_t*)reader->data)->lazy) {
+        offset = ((file_reader_t*)reader->data)->pos;
+        qw_start = *qw;
+    } else {
+        lazy = false;
+    }
+    #else
+    (void)lazy;
+    #endif
+
     // Load function kind and data length
     size_t kind_len = read_uint(reader, NULL);
     int kind = (kind_len & 3) + MP_CODE_BYTECODE;
@@ -333,11 +671,20 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
     }
     #endif
 
+    #if MICROPY_PERSISTENT_CODE_LAZY
+    if (lazy && kind == MP_CODE_BYTECODE && fun_data_len >= sizeof(lazy_stub_t)) {
+        return load_raw_code_stub(reader, qw, fun_data_len, offset, &qw_start);
+    }
+    #endif
+
     uint8_t *fun_data = NULL;
     byte *ip2;
     bytecode_prelude_t prelude = {0};
+    #if MICROPY_PERSISTENT_CODE_LAZY_LINES
+    size_t file_offset = 0; // of fun_data, if its line table can be left in the file
+    #endif
     #if MICROPY_EMIT_NATIVE
-    size_t prelude_offset;
+    size_t prelude_offset = 0;
     mp_uint_t type_sig = 0;
     size_t n_qstr_link = 0;
     #endif
@@ -345,6 +692,11 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
     if (kind == MP_CODE_BYTECODE) {
         // Allocate memory for the bytecode
         fun_data = m_new(uint8_t, fun_data_len);
+        #if MICROPY_PERSISTENT_CODE_LAZY_LINES
+        if (reader->readbyte == file_reader_readbyte) {
+            file_offset = ((file_reader_t*)reader->data)->pos;
+        }
+        #endif
 
         // Load prelude
         byte *ip = fun_data;
@@ -402,15 +754,27 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
         qstr source_file = load_qstr(reader, qw);
         ip2[0] = simple_name; ip2[1] = simple_name >> 8;
         ip2[2] = source_file; ip2[3] = source_file >> 8;
+
+        #if MICROPY_PERSISTENT_CODE_LAZY_LINES
+        if (file_offset != 0 && lines_findable(reader->data, source_file)) {
+            size_t saved = lines_leave_in_file(fun_data, fun_data_len, file_offset);
+            if (saved != 0) {
+                fun_data = m_renew(uint8_t, fun_data, fun_data_len, fun_data_len - saved);
+                fun_data_len -= saved;
+            }
+        }
+        #endif
     }
 
+    size_t n_obj = 0;
+    size_t n_raw_code = 0;
     mp_uint_t *const_table = NULL;
     if (kind != MP_CODE_NATIVE_ASM) {
         // Load constant table for bytecode, native and viper
 
         // Number of entries in constant table
-        size_t n_obj = read_uint(reader, NULL);
-        size_t n_raw_code = read_uint(reader, NULL);
+        n_obj = read_uint(reader, NULL);
+        n_raw_code = read_uint(reader, NULL);
 
         // Allocate constant table
         size_t n_alloc = prelude.n_pos_args + prelude.n_kwonly_args + n_obj + n_raw_code;
@@ -437,9 +801,16 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
         for (size_t i = 0; i < n_obj; ++i) {
             *ct++ = (mp_uint_t)load_obj(reader);
         }
+        #if MICROPY_PERSISTENT_CODE_LAZY
+        mark_lazy_children(reader, kind == MP_CODE_BYTECODE ? fun_data : NULL, fun_data_len, ct, ct - const_table, n_raw_code);
+        for (size_t i = 0; i < n_raw_code; ++i, ++ct) {
+            *ct = (mp_uint_t)(uintptr_t)load_raw_code(reader, qw, *ct);
+        }
+        #else
         for (size_t i = 0; i < n_raw_code; ++i) {
-            *ct++ = (mp_uint_t)(uintptr_t)load_raw_code(reader, qw);
+            *ct++ = (mp_uint_t)(uintptr_t)load_raw_code(reader, qw, true);
         }
+        #endif
     }
 
     // Create raw_code and return it
@@ -474,6 +845,204 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
     return rc;
 }
 
+#if MICROPY_PERSISTENT_CODE_XIP
+
+STATIC mp_raw_code_t *load_raw_code_xip(mp_reader_t *reader, const uint16_t *qstr_table, bool lazy);
+
+// Load the constant table of the function whose bytecode is fun_data, which
+// makes rc ready to run
+STATIC void load_consts_xip(mp_reader_t *reader, mp_raw_code_t *rc, const byte *fun_data, size_t fun_data_len) {
+    const byte *ip = fun_data;
+    const byte *ip2;
+    bytecode_prelude_t prelude;
+    extract_prelude(&ip, &ip2, &prelude);
+
+    size_t n_obj = read_uint(reader, NULL);
+    size_t n_raw_code = read_uint(reader, NULL);
+    size_t n_arg = prelude.n_pos_args + prelude.n_kwonly_args;
+    mp_uint_t *const_table = m_new(mp_uint_t, n_arg + n_obj + n_raw_code);
+    mp_uint_t *ct = const_table;
+    for (size_t i = 0; i < n_arg; ++i) {
+        *ct++ = (mp_uint_t)MP_OBJ_NEW_QSTR(rc->qstr_table[read_uint(reader, NULL)]);
+    }
+    for (size_t i = 0; i < n_obj; ++i) {
+        *ct++ = (mp_uint_t)load_obj(reader);
+    }
+    for (size_t i = 0; i < n_raw_code; ++i) {
+        *ct++ = (mp_uint_t)(uintptr_t)load_raw_code_xip(reader, rc->qstr_table, MICROPY_PERSISTENT_CODE_LAZY);
+    }
+
+    mp_emit_glue_assign_bytecode(rc, fun_data,
+        #if MICROPY_PERSISTENT_CODE_SAVE || MICROPY_DEBUG_PRINTERS
+        fun_data_len,
+        #endif
+        const_table,
+        #if MICROPY_PERSISTENT_CODE_SAVE
+        n_obj, n_raw_code,
+        #endif
+        prelude.scope_flags);
+    (void)fun_data_len;
+}
+
+#if MICROPY_PERSISTENT_CODE_LAZY
+
+// Skip over a constant table, given the number of argument names at its start
+STATIC void skip_consts_xip(mp_reader_t *reader, size_t n_arg) {
+    size_t n_obj = read_uint(reader, NULL);
+    size_t n_raw_code = read_uint(reader, NULL);
+    for (size_t i = 0; i < n_arg; ++i) {
+        read_uint(reader, NULL);
+    }
+    for (size_t i = 0; i < n_obj; ++i) {
+        byte obj_type = read_byte(reader);
+        if (obj_type != 'e') {
+            size_t len = read_uint(reader, NULL);
+            mp_reader_try_read_mem(reader, len + (obj_type == 'S' || obj_type == 'B'));
+        }
+    }
+    for (size_t i = 0; i < n_raw_code; ++i) {
+        size_t fun_data_len = read_uint(reader, NULL) >> 2;
+        const byte *ip = mp_reader_try_read_mem(reader, fun_data_len);
+        ip = mp_decode_uint_skip(mp_decode_uint_skip(ip)); // n_state, n_exc_stack
+        skip_consts_xip(reader, ip[1] + ip[2]); // n_pos_args + n_kwonly_args
+    }
+}
+
+STATIC void load_lazy_xip(mp_raw_code_t *rc) {
+    // The constants follow the bytecode in the image, and their extent was
+    // already found when they were skipped over
+    const byte *consts = (const byte*)rc->const_table;
+    mp_reader_t reader;
+    mp_reader_new_mem(&reader, consts, (size_t)-1 - (uintptr_t)consts, 0);
+    load_consts_xip(&reader, rc, rc->fun_data, consts - (const byte*)rc->fun_data);
+    reader.close(reader.data);
+}
+
+#endif
+
+// An execute-in-place image has MPY_FEATURE_XIP set in its header, which is
+// followed by the number of qstrs the module uses and then those qstrs.  Each
+// raw code in it must be bytecode, which is stored exactly as it executes
+// except that its qstr arguments, simple_name and source_file are 16-bit
+// indices into the module's qstrs.  Function argument names are stored as
+// such indices too, and strs and bytes as 'S' and 'B' objects.
+//
+// With MICROPY_PERSISTENT_CODE_LAZY, nested functions of an image that is in
+// memory are only skipped over when the image is loaded; their raw code
+// records where their constants are, and these are loaded on the first call.
+STATIC mp_raw_code_t *load_raw_code_xip(mp_reader_t *reader, const uint16_t *qstr_table, bool lazy) {
+    size_t kind_len = read_uint(reader, NULL);
+    size_t fun_data_len = kind_len >> 2;
+    if ((kind_len & 3) != 0) {
+        // not bytecode
+        mp_raise_ValueError("incompatible .mpy file");
+    }
+
+    mp_raw_code_t *rc = mp_emit_glue_new_raw_code();
+    rc->qstr_table = qstr_table;
+
+    // Use the bytecode where it is if possible, else make a copy of it
+    const byte *fun_data = mp_reader_try_read_mem(reader, fun_data_len);
+    if (fun_data == NULL) {
+        byte *buf = m_new(byte, fun_data_len);
+        read_bytes(reader, buf, fun_data_len);
+        fun_data = buf;
+        lazy = false;
+    }
+
+    #if MICROPY_PERSISTENT_CODE_LAZY
+    if (lazy) {
+        const byte *ip = fun_data;
+        const byte *ip2;
+        bytecode_prelude_t prelude;
+        extract_prelude(&ip, &ip2, &prelude);
+        rc->kind = MP_CODE_BYTECODE_LAZY;
+        rc->scope_flags = prelude.scope_flags;
+        rc->fun_data = fun_data;
+        rc->const_table = (const mp_uint_t*)mp_reader_try_read_mem(reader, 0);
+        skip_consts_xip(reader, prelude.n_pos_args + prelude.n_kwonly_args);
+        return rc;
+    }
+    #else
+    (void)lazy;
+    #endif
+
+    load_consts_xip(reader, rc, fun_data, fun_data_len);
+    return rc;
+}
+
+STATIC mp_raw_code_t *load_module_xip(mp_reader_t *reader) {
+    size_t n_qstr = read_uint(reader, NULL);
+    uint16_t *qstr_table = m_new(uint16_t, n_qstr);
+    qstr_window_t qw;
+    qw.idx = 0;
+    for (size_t i = 0; i < n_qstr; ++i) {
+        qstr_table[i] = load_qstr(reader, &qw);
+    }
+    return load_raw_code_xip(reader, qstr_table, false);
+}
+
+#endif // MICROPY_PERSISTENT_CODE_XIP
+
+#if MICROPY_PERSISTENT_CODE_LAZY
+
+// Whether the prelude of a function starts as the one that was kept for it,
+// apart from code_info_size, which changes if its line table is left in the file
+STATIC bool lazy_prelude_equal(const byte *kept, const byte *loaded) {
+    const byte *ci = mp_decode_uint_skip(mp_decode_uint_skip(kept)) + 4;
+    size_t len = ci - kept;
+    return memcmp(kept, loaded, len) == 0
+        && memcmp(mp_decode_uint_skip(ci), mp_decode_uint_skip(loaded + len), 4) == 0;
+}
+
+// Load a function that was left in its .mpy file by load_raw_code_stub.  The
+// file is opened again from the path that import used, and the start of the
+// prelude is compared with the one that was kept, in case the file changed.
+STATIC void load_lazy_file(mp_raw_code_t *rc) {
+    lazy_stub_t *stub = (lazy_stub_t*)rc->const_table;
+    file_reader_t fr;
+    fr.path = qstr_str(stub->path);
+    mp_reader_new_file(&fr.file, fr.path);
+    if (!mp_reader_try_seek(&fr.file, stub->offset)) {
+        fr.file.close(fr.file.data);
+        mp_raise_OSError(MP_EIO);
+    }
+    fr.pos = stub->offset;
+    #if MICROPY_PERSISTENT_CODE_LAZY_LINES
+    fr.source_file = MP_QSTR_NULL;
+    #endif
+    fr.lazy = true;
+    fr.path_qstr = stub->path;
+    mp_reader_t reader;
+    reader.data = &fr;
+    reader.readbyte = file_reader_readbyte;
+    reader.close = file_reader_close;
+    qstr_window_t qw = stub->qw;
+    mp_raw_code_t *loaded = load_raw_code(&reader, &qw, false);
+    reader.close(reader.data);
+    if (loaded->kind != MP_CODE_BYTECODE || !lazy_prelude_equal(rc->fun_data, loaded->fun_data)) {
+        mp_raise_ValueError("incompatible .mpy file");
+    }
+    *rc = *loaded;
+    m_del_obj(mp_raw_code_t, loaded);
+}
+
+void mp_raw_code_load_lazy(mp_raw_code_t *rc) {
+    if (rc->kind != MP_CODE_BYTECODE_LAZY) {
+        // another function made from rc was called first
+        return;
+    }
+    #if MICROPY_PERSISTENT_CODE_XIP
+    if (rc->qstr_table != NULL) {
+        load_lazy_xip(rc);
+        return;
+    }
+    #endif
+    load_lazy_file(rc);
+}
+
+#endif
+
 mp_raw_code_t *mp_raw_code_load(mp_reader_t *reader) {
     byte header[4];
     read_bytes(reader, header, sizeof(header));
@@ -481,6 +1050,7 @@ mp_raw_code_t *mp_raw_code_load(mp_reader_t *reader) {
         || header[1] != MPY_VERSION
         || MPY_FEATURE_DECODE_FLAGS(header[2]) != MPY_FEATURE_FLAGS
         || header[3] > mp_small_int_bits()
+        || (!MICROPY_PERSISTENT_CODE_XIP && (header[2] & MPY_FEATURE_XIP))
         || read_uint(reader, NULL) > QSTR_WINDOW_SIZE) {
         mp_raise_ValueError("incompatible .mpy file");
     }
@@ -488,9 +1058,23 @@ mp_raw_code_t *mp_raw_code_load(mp_reader_t *reader) {
         && MPY_FEATURE_DECODE_ARCH(header[2]) != MPY_FEATURE_ARCH) {
         mp_raise_ValueError("incompatible .mpy arch");
     }
-    qstr_window_t qw;
-    qw.idx = 0;
-    mp_raw_code_t *rc = load_raw_code(reader, &qw);
+    mp_raw_code_t *rc;
+    #if MICROPY_PERSISTENT_CODE_XIP
+    if (header[2] & MPY_FEATURE_XIP) {
+        rc = load_module_xip(reader);
+    } else
+    #endif
+    {
+        #if MICROPY_PERSISTENT_CODE_LAZY
+        if (reader->readbyte == file_reader_readbyte && MPY_FEATURE_DECODE_ARCH(header[2]) != MP_NATIVE_ARCH_NONE) {
+            // native code isn't skipped over, so the whole file is loaded
+            ((file_reader_t*)reader->data)->lazy = false;
+        }
+        #endif
+        qstr_window_t qw;
+        qw.idx = 0;
+        rc = load_raw_code(reader, &qw, false);
+    }
     reader->close(reader->data);
     return rc;
 }
@@ -505,10 +1089,120 @@ mp_raw_code_t *mp_raw_code_load_mem(const byte *buf, size_t len) {
 
 mp_raw_code_t *mp_raw_code_load_file(const char *filename) {
     mp_reader_t reader;
+    #if MICROPY_PERSISTENT_CODE_XIP && defined(MP_PLAT_MAP_FILE)
+    // Execute-in-place images are run from a mapping of the file, which is
+    // never unmapped; other .mpy files are read in the usual way
+    size_t len;
+    const byte *buf = MP_PLAT_MAP_FILE(filename, &len);
+    if (buf != NULL) {
+        if (len >= 3 && buf[0] == 'M' && (buf[2] & MPY_FEATURE_XIP)) {
+            mp_reader_new_mem(&reader, buf, len, 0);
+            return mp_raw_code_load(&reader);
+        }
+        MP_PLAT_UNMAP_FILE(buf, len);
+    }
+    #endif
+    #if MICROPY_PERSISTENT_CODE_LAZY_LINES || MICROPY_PERSISTENT_CODE_LAZY
+    file_reader_t fr;
+    mp_reader_new_file(&fr.file, filename);
+    fr.pos = 0;
+    fr.path = filename;
+    #if MICROPY_PERSISTENT_CODE_LAZY_LINES
+    fr.source_file = MP_QSTR_NULL;
+    #endif
+    #if MICROPY_PERSISTENT_CODE_LAZY
+    fr.lazy = mp_reader_try_seek(&fr.file, 0);
+    fr.path_qstr = MP_QSTR_NULL;
+    #endif
+    reader.data = &fr;
+    reader.readbyte = file_reader_readbyte;
+    reader.close = file_reader_close;
+    #else
     mp_reader_new_file(&reader, filename);
+    #endif
     return mp_raw_code_load(&reader);
 }
 
+#if MICROPY_PERSISTENT_CODE_LAZY_LINES
+
+size_t mp_raw_code_lazy_line(qstr source_file, size_t lazy_line, size_t check) {
+    size_t offset = (lazy_line & ~MP_LAZY_LINE_TAG) >> MP_LAZY_LINE_BC_BITS;
+    size_t bc = lazy_line & (((size_t)1 << MP_LAZY_LINE_BC_BITS) - 1);
+    size_t source_line = 0;
+    mp_reader_t reader;
+    reader.data = NULL;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        // open the first file that import would find now
+        vstr_t path;
+        vstr_init(&path, 32);
+        for (size_t i = 0; reader.data == NULL && lines_file_path(&path, source_file, i); ++i) {
+            nlr_buf_t nlr2;
+            if (nlr_push(&nlr2) == 0) {
+                mp_reader_new_file(&reader, vstr_null_terminated_str(&path));
+                nlr_pop();
+            }
+        }
+        vstr_clear(&path);
+        if (reader.data != NULL) {
+            if (!mp_reader_try_seek(&reader, offset)) {
+                while (offset-- > 0) {
+                    reader.readbyte(reader.data);
+                }
+            }
+            // same decoding as in mp_execute_bytecode, except that the whole
+            // table is read, to compare it with the one that was loaded
+            uint16_t table_check = LINES_CHECK_INIT;
+            size_t line = 1;
+            bool found = false;
+            for (;;) {
+                mp_uint_t c = reader.readbyte(reader.data);
+                if (c == MP_READER_EOF) {
+                    break;
+                }
+                table_check = lines_check_add(table_check, c);
+                if (c == 0) {
+                    if (table_check == check) {
+                        source_line = line;
+                    }
+                    break;
+                }
+                size_t b, l;
+                if ((c & 0x80) == 0) {
+                    // 0b0LLBBBBB encoding
+                    b = c & 0x1f;
+                    l = c >> 5;
+                } else {
+                    // 0b1LLLBBBB 0bLLLLLLLL encoding (l's LSB in second byte)
+                    mp_uint_t c2 = reader.readbyte(reader.data);
+                    if (c2 == MP_READER_EOF) {
+                        break;
+                    }
+                    table_check = lines_check_add(table_check, c2);
+                    b = c & 0xf;
+                    l = ((c << 4) & 0x700) | c2;
+                }
+                if (!found && bc >= b) {
+                    bc -= b;
+                    line += l;
+                } else {
+                    found = true;
+                }
+            }
+        }
+        nlr_pop();
+    } else {
+        // there is no memory to look for the file, or it can't be read
+        source_line = 0;
+    }
+    if (reader.data != NULL) {
+        reader.close(reader.data);
+    }
+    return source_line;
+}
+
+#endif
+
 #endif // MICROPY_HAS_FILE_READER
 
 #endif // MICROPY_PERSISTENT_CODE_LOAD
@@ -552,19 +1246,20 @@ STATIC void save_qstr(mp_print_t *print, qstr_window_t *qw, qstr qst) {
     mp_print_bytes(print, str, len);
 }
 
-STATIC void save_obj(mp_print_t *print, mp_obj_t o) {
+STATIC void save_obj(mp_print_t *print, mp_obj_t o, bool xip) {
     if (mp_obj_is_str_or_bytes(o)) {
         byte obj_type;
         if (mp_obj_is_str(o)) {
-            obj_type = 's';
+            obj_type = xip ? 'S' : 's';
         } else {
-            obj_type = 'b';
+            obj_type = xip ? 'B' : 'b';
         }
         size_t len;
         const char *str = mp_obj_str_get_data(o, &len);
         mp_print_bytes(print, &obj_type, 1);
         mp_print_uint(print, len);
-        mp_print_bytes(print, (const byte*)str, len);
+        // execute-in-place images include the null terminator
+        mp_print_bytes(print, (const byte*)str, len + xip);
     } else if (MP_OBJ_TO_PTR(o) == &mp_const_ellipsis_obj) {
         byte obj_type = 'e';
         mp_print_bytes(print, &obj_type, 1);
@@ -685,7 +1380,7 @@ STATIC void save_raw_code(mp_print_t *print, mp_raw_code_t *rc, qstr_window_t *q
 
         // Save constant objects and raw code children
         for (size_t i = 0; i < rc->n_obj; ++i) {
-            save_obj(print, (mp_obj_t)*const_table++);
+            save_obj(print, (mp_obj_t)*const_table++, false);
         }
         for (size_t i = 0; i < rc->n_raw_code; ++i) {
             save_raw_code(print, (mp_raw_code_t*)(uintptr_t)*const_table++, qstr_window);
@@ -716,6 +1411,91 @@ STATIC bool mp_raw_code_has_native(mp_raw_code_t *rc) {
     return false;
 }
 
+// Return the index of qst in the execute-in-place module's qstr table,
+// adding it to the table if needed
+STATIC size_t xip_qstr_index(mp_map_t *qstr_table, qstr qst) {
+    mp_map_elem_t *elem = mp_map_lookup(qstr_table, MP_OBJ_NEW_QSTR(qst), MP_MAP_LOOKUP_ADD_IF_NOT_FOUND);
+    if (elem->value == MP_OBJ_NULL) {
+        elem->value = MP_OBJ_NEW_SMALL_INT(qstr_table->used - 1);
+    }
+    return MP_OBJ_SMALL_INT_VALUE(elem->value);
+}
+
+STATIC void xip_rewrite_qstr(mp_map_t *qstr_table, byte *p) {
+    size_t idx = xip_qstr_index(qstr_table, p[0] | (p[1] << 8));
+    p[0] = idx;
+    p[1] = idx >> 8;
+}
+
+// See load_raw_code_xip for the format
+STATIC void save_raw_code_xip(mp_print_t *print, mp_raw_code_t *rc, mp_map_t *qstr_table) {
+    // Save the bytecode with its qstrs replaced by indices into the qstr table
+    byte *buf = m_new(byte, rc->fun_data_len);
+    memcpy(buf, rc->fun_data, rc->fun_data_len);
+    const byte *ip = buf;
+    const byte *ip2;
+    bytecode_prelude_t prelude;
+    extract_prelude(&ip, &ip2, &prelude);
+    xip_rewrite_qstr(qstr_table, (byte*)ip2); // simple_name
+    xip_rewrite_qstr(qstr_table, (byte*)ip2 + 2); // source_file
+    const byte *ip_top = buf + rc->fun_data_len;
+    while (ip < ip_top) {
+        size_t sz;
+        if (mp_opcode_format(ip, &sz, true) == MP_OPCODE_QSTR) {
+            xip_rewrite_qstr(qstr_table, (byte*)ip + 1);
+        }
+        ip += sz;
+    }
+    mp_print_uint(print, rc->fun_data_len << 2);
+    mp_print_bytes(print, buf, rc->fun_data_len);
+    m_del(byte, buf, rc->fun_data_len);
+
+    // Save the constant table
+    mp_print_uint(print, rc->n_obj);
+    mp_print_uint(print, rc->n_raw_code);
+    const mp_uint_t *const_table = rc->const_table;
+    for (size_t i = 0; i < prelude.n_pos_args + prelude.n_kwonly_args; ++i) {
+        mp_obj_t o = (mp_obj_t)*const_table++;
+        mp_print_uint(print, xip_qstr_index(qstr_table, MP_OBJ_QSTR_VALUE(o)));
+    }
+    for (size_t i = 0; i < rc->n_obj; ++i) {
+        save_obj(print, (mp_obj_t)*const_table++, true);
+    }
+    for (size_t i = 0; i < rc->n_raw_code; ++i) {
+        save_raw_code_xip(print, (mp_raw_code_t*)(uintptr_t)*const_table++, qstr_table);
+    }
+}
+
+STATIC void save_module_xip(mp_print_t *print, mp_raw_code_t *rc) {
+    // The raw codes must be saved first to build up the qstr table
+    vstr_t vstr;
+    mp_print_t code_print;
+    vstr_init_print(&vstr, 256, &code_print);
+    mp_map_t qstr_table;
+    mp_map_init(&qstr_table, 0);
+    save_raw_code_xip(&code_print, rc, &qstr_table);
+
+    size_t n_qstr = qstr_table.used;
+    qstr *qstrs = m_new(qstr, n_qstr);
+    for (size_t i = 0; i < qstr_table.alloc; ++i) {
+        if (mp_map_slot_is_filled(&qstr_table, i)) {
+            qstrs[MP_OBJ_SMALL_INT_VALUE(qstr_table.table[i].value)] = MP_OBJ_QSTR_VALUE(qstr_table.table[i].key);
+        }
+    }
+    qstr_window_t qw;
+    qw.idx = 0;
+    memset(qw.window, 0, sizeof(qw.window));
+    mp_print_uint(print, n_qstr);
+    for (size_t i = 0; i < n_qstr; ++i) {
+        save_qstr(print, &qw, qstrs[i]);
+    }
+    mp_print_bytes(print, (const byte*)vstr.buf, vstr.len);
+
+    m_del(qstr, qstrs, n_qstr);
+    mp_map_deinit(&qstr_table);
+    vstr_clear(&vstr);
+}
+
 void mp_raw_code_save(mp_raw_code_t *rc, mp_print_t *print) {
     // header contains:
     //  byte  'M'
@@ -734,11 +1514,22 @@ void mp_raw_code_save(mp_raw_code_t *rc, mp_print_t *print) {
         #endif
     };
     if (mp_raw_code_has_native(rc)) {
+        if (MPY_SAVE_XIP_DYNAMIC) {
+            mp_raise_ValueError("native code can't be executed in place");
+        }
         header[2] |= MPY_FEATURE_ENCODE_ARCH(MPY_FEATURE_ARCH_DYNAMIC);
     }
+    if (MPY_SAVE_XIP_DYNAMIC) {
+        header[2] |= MPY_FEATURE_XIP;
+    }
     mp_print_bytes(print, header, sizeof(header));
     mp_print_uint(print, QSTR_WINDOW_SIZE);
 
+    if (MPY_SAVE_XIP_DYNAMIC) {
+        save_module_xip(print, rc);
+        return;
+    }
+
     qstr_window_t qw;
     qw.idx = 0;
     memset(qw.window, 0, sizeof(qw.window));
@@ -750,6 +1541,7 @@ void mp_raw_code_save(mp_raw_code_t *rc, mp_print_t *print) {
 
 #if defined(__i386__) || defined(__x86_64__) || defined(__unix__)
 
+#include <errno.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -762,12 +1554,16 @@ STATIC void fd_print_strn(void *env, const char *str, size_t len) {
 
 void mp_raw_code_save_file(mp_raw_code_t *rc, const char *filename) {
     int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        mp_raise_OSError(errno);
+    }
     mp_print_t fd_print = {(void*)(intptr_t)fd, fd_print_strn};
     mp_raw_code_save(rc, &fd_print);
     close(fd);
 }
 
-#else
+#elif !MICROPY_PERSISTENT_CODE_CACHE
+// Ports that only save code for the import cache don't need this function
 #error mp_raw_code_save_file not implemented for this platform
 #endif
 
@@ -47,10 +47,37 @@ enum {
 };
 
 mp_raw_code_t *mp_raw_code_load(mp_reader_t *reader);
+// If buf holds an execute-in-place image then its bytecode is run from buf,
+// which must stay valid and must not be on the GC heap
 mp_raw_code_t *mp_raw_code_load_mem(const byte *buf, size_t len);
 mp_raw_code_t *mp_raw_code_load_file(const char *filename);
+#if MICROPY_PERSISTENT_CODE_LAZY
+void mp_raw_code_load_lazy(mp_raw_code_t *rc);
+#endif
+
+#if MICROPY_PERSISTENT_CODE_LAZY_LINES
+// A traceback line number that is still to be read from a .mpy file, made of
+// the offset of the line table in the file and the offset in the bytecode.
+// The 16-bit check value of the table goes in the traceback entry's block
+// name, above its qstr, which is 16 bits in bytecode loaded from a file.
+#define MP_LAZY_LINE_TAG ((size_t)1 << (BITS_PER_WORD - 1))
+#define MP_LAZY_LINE_BC_BITS (BITS_PER_WORD / 2 - 1)
+#define MP_LAZY_LINE(file_offset, bc) (MP_LAZY_LINE_TAG | (file_offset) << MP_LAZY_LINE_BC_BITS | (bc))
+#define MP_LAZY_LINE_CHECK_SHIFT (16)
+// Returns 0 if the line can't be found, eg because the file is gone, sys.path
+// has changed or the table in the file no longer matches check
+size_t mp_raw_code_lazy_line(qstr source_file, size_t lazy_line, size_t check);
+#endif
 
 void mp_raw_code_save(mp_raw_code_t *rc, mp_print_t *print);
 void mp_raw_code_save_file(mp_raw_code_t *rc, const char *filename);
 
+#if MICROPY_PERSISTENT_CODE_CACHE
+// These are implemented in extmod/vfs_cache.c.  Loading returns NULL if there
+// is no usable copy, and a failure to save is ignored.
+bool mp_raw_code_cache_stamp(const char *src_path, uint32_t *stamp);
+mp_raw_code_t *mp_raw_code_load_cache(const char *cache_path, const uint32_t *stamp);
+void mp_raw_code_save_cache(mp_raw_code_t *rc, const char *cache_path, const uint32_t *stamp);
+#endif
+
 #endif // MICROPY_INCLUDED_PY_PERSISTENTCODE_H
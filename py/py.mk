@@ -289,6 +289,7 @@ PY_EXTMOD_O_BASENAME = \
 	extmod/modframebuf.o \
 	extmod/vfs.o \
 	extmod/vfs_reader.o \
+	extmod/vfs_cache.o \
 	extmod/vfs_posix.o \
 	extmod/vfs_posix_file.o \
 	extmod/vfs_fat.o \
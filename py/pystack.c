@@ -25,8 +25,14 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "py/runtime.h"
+#include "py/gc.h"
+
+#if MICROPY_PYSTACK_GROW && !MICROPY_ENABLE_PYSTACK
+#error MICROPY_PYSTACK_GROW requires MICROPY_ENABLE_PYSTACK
+#endif
 
 #if MICROPY_ENABLE_PYSTACK
 
@@ -34,14 +40,118 @@ void mp_pystack_init(void *start, void *end) {
     MP_STATE_THREAD(pystack_start) = start;
     MP_STATE_THREAD(pystack_end) = end;
     MP_STATE_THREAD(pystack_cur) = start;
+    #if MICROPY_PYSTACK_GROW
+    MP_STATE_THREAD(pystack_seg) = NULL;
+    MP_STATE_THREAD(pystack_spare) = NULL;
+    #endif
+}
+
+#if MICROPY_PYSTACK_GROW
+
+#define SEG_DATA(seg) ((uint8_t*)((seg) + 1))
+
+// Continue the pystack in a new segment with room for at least n_bytes, from
+// the GC heap.  Returns false if there's no memory for it.
+STATIC bool mp_pystack_grow(size_t n_bytes) {
+    mp_pystack_seg_t *seg = MP_STATE_THREAD(pystack_spare);
+    if (seg != NULL && seg->len >= n_bytes) {
+        MP_STATE_THREAD(pystack_spare) = NULL;
+    } else {
+        size_t len = MAX(n_bytes, MICROPY_PYSTACK_SEGMENT_SIZE - sizeof(mp_pystack_seg_t));
+        seg = (mp_pystack_seg_t*)m_new_maybe(uint8_t, sizeof(mp_pystack_seg_t) + len);
+        if (seg == NULL) {
+            return false;
+        }
+        seg->len = len;
+    }
+    seg->prev = MP_STATE_THREAD(pystack_seg);
+    seg->prev_start = MP_STATE_THREAD(pystack_start);
+    seg->prev_end = MP_STATE_THREAD(pystack_end);
+    seg->prev_cur = MP_STATE_THREAD(pystack_cur);
+    MP_STATE_THREAD(pystack_seg) = seg;
+    MP_STATE_THREAD(pystack_start) = SEG_DATA(seg);
+    MP_STATE_THREAD(pystack_end) = SEG_DATA(seg) + seg->len;
+    MP_STATE_THREAD(pystack_cur) = SEG_DATA(seg);
+    return true;
+}
+
+// Go back to earlier segments until ptr is in the one in use.
+void mp_pystack_shrink(void *ptr) {
+    do {
+        mp_pystack_seg_t *seg = MP_STATE_THREAD(pystack_seg);
+        assert(seg != NULL);
+        MP_STATE_THREAD(pystack_seg) = seg->prev;
+        MP_STATE_THREAD(pystack_start) = seg->prev_start;
+        MP_STATE_THREAD(pystack_end) = seg->prev_end;
+        MP_STATE_THREAD(pystack_cur) = seg->prev_cur;
+        // Keep the bigger of this and the spare, so that calls which keep
+        // crossing the end of a segment don't allocate every time.
+        mp_pystack_seg_t *spare = MP_STATE_THREAD(pystack_spare);
+        if (spare == NULL || spare->len < seg->len) {
+            MP_STATE_THREAD(pystack_spare) = seg;
+            seg = spare;
+        }
+        if (seg != NULL) {
+            m_del(uint8_t, seg, sizeof(mp_pystack_seg_t) + seg->len);
+        }
+    } while ((uint8_t*)ptr < MP_STATE_THREAD(pystack_start) || (uint8_t*)ptr > MP_STATE_THREAD(pystack_end));
+}
+
+// Called when an nlr jump unwinds the pystack to ptr.
+void mp_pystack_restore(void *ptr) {
+    if ((uint8_t*)ptr < MP_STATE_THREAD(pystack_start) || (uint8_t*)ptr > MP_STATE_THREAD(pystack_end)) {
+        mp_pystack_shrink(ptr);
+    }
+    MP_STATE_THREAD(pystack_cur) = ptr;
+}
+
+void *mp_pystack_realloc(void *ptr, size_t n_bytes) {
+    size_t old_n_bytes = MP_STATE_THREAD(pystack_cur) - (uint8_t*)ptr;
+    if ((uint8_t*)ptr + ((n_bytes + (MICROPY_PYSTACK_ALIGN - 1)) & ~(MICROPY_PYSTACK_ALIGN - 1)) <= MP_STATE_THREAD(pystack_end)) {
+        mp_pystack_free(ptr);
+        mp_pystack_alloc(n_bytes);
+        return ptr;
+    }
+    // Move it to a new segment.  The old block stays allocated (and traced)
+    // until it's copied, then goes when the new segment is left.
+    void *new_ptr = mp_pystack_alloc(n_bytes);
+    memcpy(new_ptr, ptr, MIN(old_n_bytes, n_bytes));
+    MP_STATE_THREAD(pystack_seg)->prev_cur = ptr;
+    return new_ptr;
+}
+
+size_t mp_pystack_usage(void) {
+    size_t n = MP_STATE_THREAD(pystack_cur) - MP_STATE_THREAD(pystack_start);
+    for (mp_pystack_seg_t *seg = MP_STATE_THREAD(pystack_seg); seg != NULL; seg = seg->prev) {
+        n += seg->prev_cur - seg->prev_start;
+    }
+    return n;
+}
+
+// The segments from the heap are traced through pystack_seg, so only the part
+// of the first one that's in use needs to be given to the GC.
+void mp_pystack_gc_collect(void) {
+    uint8_t *start = MP_STATE_THREAD(pystack_start);
+    uint8_t *cur = MP_STATE_THREAD(pystack_cur);
+    for (mp_pystack_seg_t *seg = MP_STATE_THREAD(pystack_seg); seg != NULL; seg = seg->prev) {
+        start = seg->prev_start;
+        cur = seg->prev_cur;
+    }
+    gc_collect_root((void**)(void*)start, (cur - start) / sizeof(void*));
 }
 
+#endif
+
 void *mp_pystack_alloc(size_t n_bytes) {
     n_bytes = (n_bytes + (MICROPY_PYSTACK_ALIGN - 1)) & ~(MICROPY_PYSTACK_ALIGN - 1);
     #if MP_PYSTACK_DEBUG
     n_bytes += MICROPY_PYSTACK_ALIGN;
     #endif
-    if (MP_STATE_THREAD(pystack_cur) + n_bytes > MP_STATE_THREAD(pystack_end)) {
+    if (MP_STATE_THREAD(pystack_cur) + n_bytes > MP_STATE_THREAD(pystack_end)
+        #if MICROPY_PYSTACK_GROW
+        && !mp_pystack_grow(n_bytes)
+        #endif
+        ) {
         // out of memory in the pystack
         nlr_raise(mp_obj_new_exception_arg1(&mp_type_RuntimeError,
             MP_OBJ_NEW_QSTR(MP_QSTR_pystack_space_exhausted)));
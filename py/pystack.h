@@ -34,6 +34,21 @@
 
 #if MICROPY_ENABLE_PYSTACK
 
+#if MICROPY_PYSTACK_GROW
+// The header of a segment added to the pystack.  It keeps the state of the
+// segment that was in use before, to go back to when this one is empty.
+typedef struct _mp_pystack_seg_t {
+    struct _mp_pystack_seg_t *prev;
+    uint8_t *prev_start;
+    uint8_t *prev_end;
+    uint8_t *prev_cur;
+    size_t len;
+} mp_pystack_seg_t;
+
+void mp_pystack_shrink(void *ptr);
+void mp_pystack_gc_collect(void);
+#endif
+
 void mp_pystack_init(void *start, void *end);
 void *mp_pystack_alloc(size_t n_bytes);
 
@@ -41,6 +56,11 @@ void *mp_pystack_alloc(size_t n_bytes);
 // pointer to the block that was allocated first and it and all subsequently
 // allocated blocks will be freed.
 static inline void mp_pystack_free(void *ptr) {
+    #if MICROPY_PYSTACK_GROW
+    if ((uint8_t*)ptr < MP_STATE_THREAD(pystack_start) || (uint8_t*)ptr > MP_STATE_THREAD(pystack_end)) {
+        mp_pystack_shrink(ptr);
+    }
+    #endif
     assert((uint8_t*)ptr >= MP_STATE_THREAD(pystack_start));
     assert((uint8_t*)ptr <= MP_STATE_THREAD(pystack_cur));
     #if MP_PYSTACK_DEBUG
@@ -58,14 +78,20 @@ static inline void mp_pystack_free(void *ptr) {
     MP_STATE_THREAD(pystack_cur) = (uint8_t*)ptr;
 }
 
-static inline void mp_pystack_realloc(void *ptr, size_t n_bytes) {
+#if MICROPY_PYSTACK_GROW
+void *mp_pystack_realloc(void *ptr, size_t n_bytes);
+size_t mp_pystack_usage(void);
+#else
+static inline void *mp_pystack_realloc(void *ptr, size_t n_bytes) {
     mp_pystack_free(ptr);
     mp_pystack_alloc(n_bytes);
+    return ptr;
 }
 
 static inline size_t mp_pystack_usage(void) {
     return MP_STATE_THREAD(pystack_cur) - MP_STATE_THREAD(pystack_start);
 }
+#endif
 
 static inline size_t mp_pystack_limit(void) {
     return MP_STATE_THREAD(pystack_end) - MP_STATE_THREAD(pystack_start);
@@ -109,8 +135,7 @@ static inline void *mp_nonlocal_alloc(size_t n_bytes) {
 
 static inline void *mp_nonlocal_realloc(void *ptr, size_t old_n_bytes, size_t new_n_bytes) {
     (void)old_n_bytes;
-    mp_pystack_realloc(ptr, new_n_bytes);
-    return ptr;
+    return mp_pystack_realloc(ptr, new_n_bytes);
 }
 
 static inline void mp_nonlocal_free(void *ptr, size_t n_bytes) {
@@ -66,6 +66,20 @@ void mp_reader_new_mem(mp_reader_t *reader, const byte *buf, size_t len, size_t
     reader->close = mp_reader_mem_close;
 }
 
+const byte *mp_reader_try_read_mem(mp_reader_t *reader, size_t len) {
+    if (reader->readbyte != mp_reader_mem_readbyte) {
+        return NULL;
+    }
+    mp_reader_mem_t *rm = (mp_reader_mem_t*)reader->data;
+    if (rm->free_len > 0 || (size_t)(rm->end - rm->cur) < len) {
+        // memory is freed when the reader is closed, or is too short
+        return NULL;
+    }
+    const byte *buf = rm->cur;
+    rm->cur += len;
+    return buf;
+}
+
 #if MICROPY_READER_POSIX
 
 #include <sys/stat.h>
@@ -124,6 +138,16 @@ void mp_reader_new_file_from_fd(mp_reader_t *reader, int fd, bool close_fd) {
     reader->close = mp_reader_posix_close;
 }
 
+STATIC bool mp_reader_posix_seek(mp_reader_posix_t *reader, size_t offset) {
+    if (lseek(reader->fd, offset, SEEK_SET) == (off_t)-1) {
+        return false;
+    }
+    int n = read(reader->fd, reader->buf, sizeof(reader->buf));
+    reader->len = n < 0 ? 0 : n;
+    reader->pos = 0;
+    return true;
+}
+
 #if !MICROPY_VFS_POSIX
 // If MICROPY_VFS_POSIX is defined then this function is provided by the VFS layer
 void mp_reader_new_file(mp_reader_t *reader, const char *filename) {
@@ -136,3 +160,24 @@ void mp_reader_new_file(mp_reader_t *reader, const char *filename) {
 #endif
 
 #endif
+
+bool mp_reader_try_seek(mp_reader_t *reader, size_t offset) {
+    if (reader->readbyte == mp_reader_mem_readbyte) {
+        mp_reader_mem_t *rm = (mp_reader_mem_t*)reader->data;
+        if (offset > (size_t)(rm->end - rm->beg)) {
+            return false;
+        }
+        rm->cur = rm->beg + offset;
+        return true;
+    }
+    #if MICROPY_READER_POSIX
+    if (reader->readbyte == mp_reader_posix_readbyte) {
+        return mp_reader_posix_seek(reader->data, offset);
+    }
+    #endif
+    #if MICROPY_READER_VFS
+    return mp_reader_vfs_try_seek(reader, offset);
+    #else
+    return false;
+    #endif
+}
@@ -43,4 +43,15 @@ void mp_reader_new_mem(mp_reader_t *reader, const byte *buf, size_t len, size_t
 void mp_reader_new_file(mp_reader_t *reader, const char *filename);
 void mp_reader_new_file_from_fd(mp_reader_t *reader, int fd, bool close_fd);
 
+// If the reader reads from memory that outlives it then return a pointer to
+// the next len bytes and skip over them, otherwise return NULL
+const byte *mp_reader_try_read_mem(mp_reader_t *reader, size_t len);
+
+// If the reader can seek then move it to the given offset from the start of
+// its input and return true, otherwise return false without moving it
+bool mp_reader_try_seek(mp_reader_t *reader, size_t offset);
+#if MICROPY_READER_VFS
+bool mp_reader_vfs_try_seek(mp_reader_t *reader, size_t offset);
+#endif
+
 #endif // MICROPY_INCLUDED_PY_READER_H
@@ -41,6 +41,7 @@
 #include "py/builtin.h"
 #include "py/stackctrl.h"
 #include "py/gc.h"
+#include "py/mperrno.h"
 
 #if MICROPY_DEBUG_VERBOSE // print debugging info
 #define DEBUG_PRINT (1)
@@ -56,6 +57,11 @@ const mp_obj_module_t mp_module___main__ = {
     .globals = (mp_obj_dict_t*)&MP_STATE_VM(dict_main),
 };
 
+#if MICROPY_OSERROR_PREALLOC
+STATIC const mp_rom_obj_tuple_t oserror_eagain_args = {{&mp_type_tuple}, 1, {MP_ROM_INT(MP_EAGAIN)}};
+STATIC const mp_rom_obj_tuple_t oserror_etimedout_args = {{&mp_type_tuple}, 1, {MP_ROM_INT(MP_ETIMEDOUT)}};
+#endif
+
 void mp_init(void) {
     qstr_init();
 
@@ -80,6 +86,18 @@ void mp_init(void) {
     MP_STATE_VM(mp_kbd_exception).args = (mp_obj_tuple_t*)&mp_const_empty_tuple_obj;
     #endif
 
+    #if MICROPY_OSERROR_PREALLOC
+    // initialise the exception objects for raising OSError(EAGAIN) and OSError(ETIMEDOUT)
+    for (size_t i = 0; i < 2; ++i) {
+        mp_obj_exception_t *exc = &MP_STATE_VM(mp_oserror_prealloc)[i];
+        exc->base.type = &mp_type_OSError;
+        exc->traceback_alloc = 0;
+        exc->traceback_len = 0;
+        exc->traceback_data = NULL;
+        exc->args = (mp_obj_tuple_t*)(i == 0 ? &oserror_eagain_args : &oserror_etimedout_args);
+    }
+    #endif
+
     // call port specific initialization if any
 #ifdef MICROPY_PORT_INIT_FUNC
     MICROPY_PORT_INIT_FUNC;
@@ -106,6 +124,31 @@ void mp_init(void) {
     MP_STATE_VM(mp_module_builtins_override_dict) = NULL;
     #endif
 
+    #if MICROPY_COMP_CONST_IMPORT
+    MP_STATE_VM(parse_const_modules) = MP_OBJ_NULL;
+    MP_STATE_VM(parse_const_export) = MP_OBJ_NULL;
+    MP_STATE_VM(parse_const_stores) = MP_OBJ_NULL;
+    #endif
+
+    #if MICROPY_OPT_GEN_RECYCLE
+    MP_STATE_THREAD(gen_spare) = NULL;
+    #endif
+
+    #if MICROPY_EXC_TRACEBACK_BUF
+    MP_STATE_THREAD(tb_owner) = NULL;
+    #endif
+
+    #if MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+    for (size_t i = 0; i < MICROPY_PY_BUILTINS_STR_UNICODE_INDEX; ++i) {
+        MP_STATE_VM(str_index_cache)[i] = NULL;
+    }
+    #endif
+
+    #if MICROPY_PY_INSTANCE_SHAPES
+    MP_STATE_VM(instance_shape_root) = NULL;
+    MP_STATE_VM(instance_shape_count) = 0;
+    #endif
+
     #if MICROPY_PY_OS_DUPTERM
     for (size_t i = 0; i < MICROPY_PY_OS_DUPTERM; ++i) {
         MP_STATE_VM(dupterm_objs[i]) = MP_OBJ_NULL;
@@ -118,6 +161,12 @@ void mp_init(void) {
     MP_STATE_VM(vfs_mount_table) = NULL;
     #endif
 
+    #if MICROPY_VFS_IMPORT_CACHE
+    MP_STATE_VM(vfs_import_cache) = MP_OBJ_NULL;
+    MP_STATE_VM(vfs_import_fs_ops) = 0;
+    MP_STATE_VM(vfs_import_cached) = 0;
+    #endif
+
     #if MICROPY_PY_THREAD_GIL
     mp_thread_mutex_init(&MP_STATE_VM(gil_mutex));
     #endif
@@ -659,12 +708,6 @@ void mp_call_prepare_args_n_kw_var(bool have_self, size_t n_args_n_kw, const mp_
 
     // We need to create the following array of objects:
     //     args[0 .. n_args]  unpacked(pos_seq)  args[n_args .. n_args + 2 * n_kw]  unpacked(kw_dict)
-    // TODO: optimize one day to avoid constructing new arg array? Will be hard.
-
-    // The new args array
-    mp_obj_t *args2;
-    uint args2_alloc;
-    uint args2_len = 0;
 
     // Try to get a hint for the size of the kw_dict
     uint kw_dict_len = 0;
@@ -672,6 +715,28 @@ void mp_call_prepare_args_n_kw_var(bool have_self, size_t n_args_n_kw, const mp_
         kw_dict_len = mp_obj_dict_len(kw_dict);
     }
 
+    // Forwarding a tuple on its own, as in f(*args) or f(*args, **kwargs) with
+    // empty kwargs: the tuple can't change, and it stays referenced by the
+    // caller for the duration of the call, so pass its items directly.
+    if (self == MP_OBJ_NULL && n_args == 0 && n_kw == 0
+        && pos_seq != MP_OBJ_NULL && mp_obj_is_type(pos_seq, &mp_type_tuple)
+        && (kw_dict == MP_OBJ_NULL || (mp_obj_is_type(kw_dict, &mp_type_dict) && kw_dict_len == 0))) {
+        size_t len;
+        mp_obj_t *items;
+        mp_obj_tuple_get(pos_seq, &len, &items);
+        out_args->fun = fun;
+        out_args->args = items;
+        out_args->n_args = len;
+        out_args->n_kw = 0;
+        out_args->n_alloc = 0;
+        return;
+    }
+
+    // The new args array
+    mp_obj_t *args2;
+    uint args2_alloc;
+    uint args2_len = 0;
+
     // Extract the pos_seq sequence to the new args array.
     // Note that it can be arbitrary iterator.
     if (pos_seq == MP_OBJ_NULL) {
@@ -816,7 +881,9 @@ mp_obj_t mp_call_method_n_kw_var(bool have_self, size_t n_args_n_kw, const mp_ob
     mp_call_prepare_args_n_kw_var(have_self, n_args_n_kw, args, &out_args);
 
     mp_obj_t res = mp_call_function_n_kw(out_args.fun, out_args.n_args, out_args.n_kw, out_args.args);
-    mp_nonlocal_free(out_args.args, out_args.n_alloc * sizeof(mp_obj_t));
+    if (out_args.n_alloc != 0) {
+        mp_nonlocal_free(out_args.args, out_args.n_alloc * sizeof(mp_obj_t));
+    }
 
     return res;
 }
@@ -1419,9 +1486,17 @@ mp_obj_t mp_parse_compile_execute(mp_lexer_t *lex, mp_parse_input_kind_t parse_i
 
     nlr_buf_t nlr;
     if (nlr_push(&nlr) == 0) {
-        qstr source_name = lex->source_name;
-        mp_parse_tree_t parse_tree = mp_parse(lex, parse_input_kind);
-        mp_obj_t module_fun = mp_compile(&parse_tree, source_name, MP_EMIT_OPT_NONE, false);
+        mp_obj_t module_fun;
+        #if MICROPY_COMP_STREAMING
+        if (parse_input_kind == MP_PARSE_FILE_INPUT) {
+            module_fun = mp_compile_lexer(lex, MP_EMIT_OPT_NONE);
+        } else
+        #endif
+        {
+            qstr source_name = lex->source_name;
+            mp_parse_tree_t parse_tree = mp_parse(lex, parse_input_kind);
+            module_fun = mp_compile(&parse_tree, source_name, MP_EMIT_OPT_NONE, false);
+        }
 
         mp_obj_t ret;
         if (MICROPY_PY_BUILTINS_COMPILE && globals == NULL) {
@@ -1475,6 +1550,13 @@ NORETURN void mp_raise_TypeError(const char *msg) {
 }
 
 NORETURN void mp_raise_OSError(int errno_) {
+    #if MICROPY_OSERROR_PREALLOC
+    if (errno_ == MP_EAGAIN || errno_ == MP_ETIMEDOUT) {
+        mp_obj_exception_t *exc = &MP_STATE_VM(mp_oserror_prealloc)[errno_ == MP_ETIMEDOUT];
+        mp_obj_exception_clear_traceback(MP_OBJ_FROM_PTR(exc));
+        nlr_raise(MP_OBJ_FROM_PTR(exc));
+    }
+    #endif
     nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(errno_)));
 }
 
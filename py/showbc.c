@@ -29,6 +29,7 @@
 
 #include "py/bc0.h"
 #include "py/bc.h"
+#include "py/emitglue.h"
 
 #if MICROPY_DEBUG_PRINTERS
 
@@ -46,8 +47,13 @@
 
 #if MICROPY_PERSISTENT_CODE
 
+#if MICROPY_PERSISTENT_CODE_XIP
+#define MAP_QSTR(qst) (mp_showbc_qstr_table != NULL ? mp_showbc_qstr_table[qst] : (qst))
+#else
+#define MAP_QSTR(qst) (qst)
+#endif
 #define DECODE_QSTR \
-    qst = ip[0] | ip[1] << 8; \
+    qst = MAP_QSTR(ip[0] | ip[1] << 8); \
     ip += 2;
 #define DECODE_PTR \
     DECODE_UINT; \
@@ -79,9 +85,15 @@
 
 const byte *mp_showbc_code_start;
 const mp_uint_t *mp_showbc_const_table;
+#if MICROPY_PERSISTENT_CODE_XIP
+STATIC const uint16_t *mp_showbc_qstr_table;
+#endif
 
 void mp_bytecode_print(const void *descr, const byte *ip, mp_uint_t len, const mp_uint_t *const_table) {
     mp_showbc_code_start = ip;
+    #if MICROPY_PERSISTENT_CODE_XIP
+    mp_showbc_qstr_table = ((const mp_raw_code_t*)descr)->qstr_table;
+    #endif
 
     // get bytecode parameters
     mp_uint_t n_state = mp_decode_uint(&ip);
@@ -96,8 +108,8 @@ void mp_bytecode_print(const void *descr, const byte *ip, mp_uint_t len, const m
     ip += code_info_size;
 
     #if MICROPY_PERSISTENT_CODE
-    qstr block_name = code_info[0] | (code_info[1] << 8);
-    qstr source_file = code_info[2] | (code_info[3] << 8);
+    qstr block_name = MAP_QSTR(code_info[0] | (code_info[1] << 8));
+    qstr source_file = MAP_QSTR(code_info[2] | (code_info[3] << 8));
     code_info += 4;
     #else
     qstr block_name = mp_decode_uint(&code_info);
@@ -143,6 +155,11 @@ void mp_bytecode_print(const void *descr, const byte *ip, mp_uint_t len, const m
         mp_int_t bc = bytecode_start - ip;
         mp_uint_t source_line = 1;
         printf("  bc=" INT_FMT " line=" UINT_FMT "\n", bc, source_line);
+        #if MICROPY_PERSISTENT_CODE_LAZY_LINES
+        if (code_info[0] == 0x80 && code_info[1] == 0x00) {
+            printf("  (lines at offset " UINT_FMT " of .mpy file)\n", mp_decode_uint_value(code_info + 4));
+        } else
+        #endif
         for (const byte* ci = code_info; *ci;) {
             if ((ci[0] & 0x80) == 0) {
                 // 0b0LLBBBBB encoding
@@ -159,6 +176,9 @@ void mp_bytecode_print(const void *descr, const byte *ip, mp_uint_t len, const m
         }
     }
     mp_bytecode_print2(ip, len - 0, const_table);
+    #if MICROPY_PERSISTENT_CODE_XIP
+    mp_showbc_qstr_table = NULL;
+    #endif
 }
 
 const byte *mp_bytecode_print_str(const byte *ip) {
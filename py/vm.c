@@ -31,9 +31,11 @@
 
 #include "py/emitglue.h"
 #include "py/objtype.h"
+#include "py/objgenerator.h"
 #include "py/runtime.h"
 #include "py/bc0.h"
 #include "py/bc.h"
+#include "py/persistentcode.h"
 
 #if 0
 #define TRACE(ip) printf("sp=%d ", (int)(sp - &code_state->state[0] + 1)); mp_bytecode_print2(ip, 1, code_state->fun_bc->const_table);
@@ -58,9 +60,19 @@
 
 #if MICROPY_PERSISTENT_CODE
 
+#if MICROPY_PERSISTENT_CODE_XIP
+// Execute-in-place bytecode holds indices into its module's qstr table
+#define DECODE_QSTR \
+    qstr qst = ip[0] | ip[1] << 8; \
+    ip += 2; \
+    if (MP_UNLIKELY(qstr_table != NULL)) { \
+        qst = qstr_table[qst]; \
+    }
+#else
 #define DECODE_QSTR \
     qstr qst = ip[0] | ip[1] << 8; \
     ip += 2;
+#endif
 #define DECODE_PTR \
     DECODE_UINT; \
     void *ptr = (void*)(uintptr_t)code_state->fun_bc->const_table[unum]
@@ -85,6 +97,14 @@
 
 #endif
 
+#if MICROPY_PERSISTENT_CODE_XIP
+// Execute-in-place bytecode may be in read-only memory so the map lookup
+// caches in it are never updated
+#define CACHE_IS_WRITABLE (qstr_table == NULL)
+#else
+#define CACHE_IS_WRITABLE (1)
+#endif
+
 #define PUSH(val) *++sp = (val)
 #define POP() (*sp--)
 #define TOP() (*sp)
@@ -152,6 +172,9 @@ run_code_state: ;
     // Pointers which are constant for particular invocation of mp_execute_bytecode()
     mp_obj_t * /*const*/ fastn;
     mp_exc_stack_t * /*const*/ exc_stack;
+    #if MICROPY_PERSISTENT_CODE_XIP
+    const uint16_t * /*const*/ qstr_table = code_state->fun_bc->qstr_table;
+    #endif
     {
         size_t n_state = mp_decode_uint_value(code_state->fun_bc->bytecode);
         fastn = &code_state->state[n_state - 1];
@@ -281,7 +304,9 @@ dispatch_loop:
                     } else {
                         mp_map_elem_t *elem = mp_map_lookup(&mp_locals_get()->map, MP_OBJ_NEW_QSTR(qst), MP_MAP_LOOKUP);
                         if (elem != NULL) {
-                            *(byte*)ip = (elem - &mp_locals_get()->map.table[0]) & 0xff;
+                            if (CACHE_IS_WRITABLE) {
+                                *(byte*)ip = (elem - &mp_locals_get()->map.table[0]) & 0xff;
+                            }
                             PUSH(elem->value);
                         } else {
                             PUSH(mp_load_name(MP_OBJ_QSTR_VALUE(key)));
@@ -310,7 +335,9 @@ dispatch_loop:
                     } else {
                         mp_map_elem_t *elem = mp_map_lookup(&mp_globals_get()->map, MP_OBJ_NEW_QSTR(qst), MP_MAP_LOOKUP);
                         if (elem != NULL) {
-                            *(byte*)ip = (elem - &mp_globals_get()->map.table[0]) & 0xff;
+                            if (CACHE_IS_WRITABLE) {
+                                *(byte*)ip = (elem - &mp_globals_get()->map.table[0]) & 0xff;
+                            }
                             PUSH(elem->value);
                         } else {
                             PUSH(mp_load_global(MP_OBJ_QSTR_VALUE(key)));
@@ -335,6 +362,13 @@ dispatch_loop:
                     mp_obj_t top = TOP();
                     if (mp_obj_is_instance_type(mp_obj_get_type(top))) {
                         mp_obj_instance_t *self = MP_OBJ_TO_PTR(top);
+                        #if MICROPY_PY_INSTANCE_SHAPES
+                        mp_obj_t *slot = mp_obj_instance_find_attr_cached(self, qst, ip, CACHE_IS_WRITABLE ? (byte*)ip : NULL);
+                        if (slot == NULL || *slot == MP_OBJ_NULL) {
+                            goto load_attr_cache_fail;
+                        }
+                        SET_TOP(*slot);
+                        #else
                         mp_uint_t x = *ip;
                         mp_obj_t key = MP_OBJ_NEW_QSTR(qst);
                         mp_map_elem_t *elem;
@@ -343,12 +377,15 @@ dispatch_loop:
                         } else {
                             elem = mp_map_lookup(&self->members, key, MP_MAP_LOOKUP);
                             if (elem != NULL) {
-                                *(byte*)ip = elem - &self->members.table[0];
+                                if (CACHE_IS_WRITABLE) {
+                                    *(byte*)ip = elem - &self->members.table[0];
+                                }
                             } else {
                                 goto load_attr_cache_fail;
                             }
                         }
                         SET_TOP(elem->value);
+                        #endif
                         ip++;
                         DISPATCH();
                     }
@@ -427,12 +464,22 @@ dispatch_loop:
                 // self->members then it can't be a property or have descriptors.  A
                 // consequence of this is that we can't use MP_MAP_LOOKUP_ADD_IF_NOT_FOUND
                 // in the fast-path below, because that store could override a property.
+                // The exception is an unset __slots__ entry, which an instance has from
+                // the start: it's stored to here only if the class has no __setattr__,
+                // properties or descriptors, otherwise the store goes the slow way.
                 ENTRY(MP_BC_STORE_ATTR): {
                     MARK_EXC_IP_SELECTIVE();
                     DECODE_QSTR;
                     mp_obj_t top = TOP();
                     if (mp_obj_is_instance_type(mp_obj_get_type(top)) && sp[-1] != MP_OBJ_NULL) {
                         mp_obj_instance_t *self = MP_OBJ_TO_PTR(top);
+                        #if MICROPY_PY_INSTANCE_SHAPES
+                        mp_obj_t *slot = mp_obj_instance_find_attr_cached(self, qst, ip, CACHE_IS_WRITABLE ? (byte*)ip : NULL);
+                        if (slot == NULL || (*slot == MP_OBJ_NULL && (self->base.type->flags & TYPE_FLAG_HAS_SPECIAL_ACCESSORS))) {
+                            goto store_attr_cache_fail;
+                        }
+                        *slot = sp[-1];
+                        #else
                         mp_uint_t x = *ip;
                         mp_obj_t key = MP_OBJ_NEW_QSTR(qst);
                         mp_map_elem_t *elem;
@@ -441,12 +488,15 @@ dispatch_loop:
                         } else {
                             elem = mp_map_lookup(&self->members, key, MP_MAP_LOOKUP);
                             if (elem != NULL) {
-                                *(byte*)ip = elem - &self->members.table[0];
+                                if (CACHE_IS_WRITABLE) {
+                                    *(byte*)ip = elem - &self->members.table[0];
+                                }
                             } else {
                                 goto store_attr_cache_fail;
                             }
                         }
                         elem->value = sp[-1];
+                        #endif
                         sp -= 2;
                         ip++;
                         DISPATCH();
@@ -916,6 +966,15 @@ unwind_jump:;
                         }
                     }
                     #endif
+                    #if MICROPY_OPT_GEN_RECYCLE
+                    if (unum & MP_BC_CALL_FLAG_TEMP_GEN) {
+                        mp_obj_t fun = *sp;
+                        mp_obj_t gen = sp[1];
+                        SET_TOP(mp_call_function_n_kw(fun, 1, 0, sp + 1));
+                        mp_obj_gen_release_temp(fun, gen);
+                        DISPATCH();
+                    }
+                    #endif
                     SET_TOP(mp_call_function_n_kw(*sp, unum & 0xff, (unum >> 8) & 0xff, sp + 1));
                     DISPATCH();
                 }
@@ -942,7 +1001,9 @@ unwind_jump:;
                         #if !MICROPY_ENABLE_PYSTACK
                         // Freeing args at this point does not follow a LIFO order so only do it if
                         // pystack is not enabled.  For pystack, they are freed when code_state is.
-                        mp_nonlocal_free(out_args.args, out_args.n_alloc * sizeof(mp_obj_t));
+                        if (out_args.n_alloc != 0) {
+                            mp_nonlocal_free(out_args.args, out_args.n_alloc * sizeof(mp_obj_t));
+                        }
                         #endif
                         #if !MICROPY_ENABLE_PYSTACK
                         if (new_state == NULL) {
@@ -1025,7 +1086,9 @@ unwind_jump:;
                         #if !MICROPY_ENABLE_PYSTACK
                         // Freeing args at this point does not follow a LIFO order so only do it if
                         // pystack is not enabled.  For pystack, they are freed when code_state is.
-                        mp_nonlocal_free(out_args.args, out_args.n_alloc * sizeof(mp_obj_t));
+                        if (out_args.n_alloc != 0) {
+                            mp_nonlocal_free(out_args.args, out_args.n_alloc * sizeof(mp_obj_t));
+                        }
                         #endif
                         #if !MICROPY_ENABLE_PYSTACK
                         if (new_state == NULL) {
@@ -1377,6 +1440,12 @@ unwind_loop:
                 qstr block_name = ip[0] | (ip[1] << 8);
                 qstr source_file = ip[2] | (ip[3] << 8);
                 ip += 4;
+                #if MICROPY_PERSISTENT_CODE_XIP
+                if (qstr_table != NULL) {
+                    block_name = qstr_table[block_name];
+                    source_file = qstr_table[source_file];
+                }
+                #endif
                 #else
                 qstr block_name = mp_decode_uint_value(ip);
                 ip = mp_decode_uint_skip(ip);
@@ -1384,26 +1453,36 @@ unwind_loop:
                 ip = mp_decode_uint_skip(ip);
                 #endif
                 size_t source_line = 1;
-                size_t c;
-                while ((c = *ip)) {
-                    size_t b, l;
-                    if ((c & 0x80) == 0) {
-                        // 0b0LLBBBBB encoding
-                        b = c & 0x1f;
-                        l = c >> 5;
-                        ip += 1;
-                    } else {
-                        // 0b1LLLBBBB 0bLLLLLLLL encoding (l's LSB in second byte)
-                        b = c & 0xf;
-                        l = ((c << 4) & 0x700) | ip[1];
-                        ip += 2;
-                    }
-                    if (bc >= b) {
-                        bc -= b;
-                        source_line += l;
-                    } else {
-                        // found source line corresponding to bytecode offset
-                        break;
+                #if MICROPY_PERSISTENT_CODE_LAZY_LINES
+                if (ip[0] == 0x80 && ip[1] == 0x00) {
+                    // the line table is in a .mpy file, and is only read if
+                    // the traceback gets printed
+                    source_line = MP_LAZY_LINE(mp_decode_uint_value(ip + 4), bc);
+                    block_name |= (size_t)(ip[2] | ip[3] << 8) << MP_LAZY_LINE_CHECK_SHIFT;
+                } else
+                #endif
+                {
+                    size_t c;
+                    while ((c = *ip)) {
+                        size_t b, l;
+                        if ((c & 0x80) == 0) {
+                            // 0b0LLBBBBB encoding
+                            b = c & 0x1f;
+                            l = c >> 5;
+                            ip += 1;
+                        } else {
+                            // 0b1LLLBBBB 0bLLLLLLLL encoding (l's LSB in second byte)
+                            b = c & 0xf;
+                            l = ((c << 4) & 0x700) | ip[1];
+                            ip += 2;
+                        }
+                        if (bc >= b) {
+                            bc -= b;
+                            source_line += l;
+                        } else {
+                            // found source line corresponding to bytecode offset
+                            break;
+                        }
                     }
                 }
                 mp_obj_exception_add_traceback(MP_OBJ_FROM_PTR(nlr.ret_val), source_file, source_line, block_name);
@@ -1447,6 +1526,9 @@ unwind_loop:
                 size_t n_state = mp_decode_uint_value(code_state->fun_bc->bytecode);
                 fastn = &code_state->state[n_state - 1];
                 exc_stack = (mp_exc_stack_t*)(code_state->state + n_state);
+                #if MICROPY_PERSISTENT_CODE_XIP
+                qstr_table = code_state->fun_bc->qstr_table;
+                #endif
                 // variables that are visible to the exception handler (declared volatile)
                 exc_sp = MP_TAGPTR_PTR(code_state->exc_sp); // stack grows up, exc_sp points to top of stack
                 goto unwind_loop;
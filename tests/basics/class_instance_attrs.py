@@ -0,0 +1,68 @@
+# test storing, loading and deleting many instance attributes
+
+class A:
+    pass
+
+# same attribute names set in different orders
+a = A()
+a.x = 1
+a.y = 2
+b = A()
+b.y = 3
+b.x = 4
+print(a.x, a.y, b.x, b.y)
+
+# the same code loading attributes from instances with different layouts
+def get_xy(o):
+    return o.x + o.y
+for o in (a, b, a, b):
+    print(get_xy(o))
+
+# overwrite existing attributes
+a.x = 10
+b.y = 30
+print(get_xy(a), get_xy(b))
+
+# delete an attribute, then use the instance again
+del a.x
+print(hasattr(a, 'x'), a.y)
+try:
+    a.x
+except AttributeError:
+    print('AttributeError')
+try:
+    del a.x
+except AttributeError:
+    print('AttributeError')
+a.x = 5
+a.z = 6
+print(get_xy(a), a.z)
+
+# many attributes on a single instance
+c = A()
+for i in range(40):
+    setattr(c, 'attr%d' % i, i)
+print(sum(getattr(c, 'attr%d' % i) for i in range(40)))
+c.attr0 = 100
+print(c.attr0, c.attr39)
+del c.attr20
+print(hasattr(c, 'attr20'), hasattr(c, 'attr21'))
+
+# many instances with distinct attribute names
+l = []
+for i in range(300):
+    o = A()
+    setattr(o, 'u%d' % i, i)
+    o.v = i
+    l.append(o)
+print(sum(getattr(o, 'u%d' % i) + o.v for i, o in enumerate(l)))
+
+# class attribute is shadowed by an instance attribute
+class B:
+    x = 'class'
+o = B()
+print(o.x)
+o.x = 'instance'
+print(o.x, B.x)
+del o.x
+print(o.x)
@@ -0,0 +1,141 @@
+# test classes with __slots__
+
+class Point:
+    __slots__ = ('x', 'y')
+
+    def __init__(self, x, y):
+        self.x = x
+        self.y = y
+
+p = Point(1, 2)
+try:
+    p.z = 3
+except AttributeError:
+    pass
+else:
+    print("SKIP")
+    raise SystemExit
+
+print(p.x, p.y)
+p.x = 10
+print(p.x + p.y)
+print(Point.__slots__)
+
+# unset slot
+p = object.__new__(Point)
+try:
+    p.x
+except AttributeError:
+    print('AttributeError')
+p.x = 5
+print(p.x)
+
+# delete a slot
+p = Point(1, 2)
+del p.x
+print(hasattr(p, 'x'), p.y)
+try:
+    del p.x
+except AttributeError:
+    print('AttributeError')
+p.x = 3
+print(p.x, p.y)
+
+# no __dict__
+try:
+    p.__dict__
+except AttributeError:
+    print('AttributeError')
+
+# __slots__ given as a single str, and as a list
+class A:
+    __slots__ = 'a'
+class B:
+    __slots__ = ['a', 'b']
+a = A()
+a.a = 1
+b = B()
+b.a = 2
+b.b = 3
+print(a.a, b.a, b.b)
+try:
+    a.b = 1
+except AttributeError:
+    print('AttributeError')
+
+# empty __slots__
+class E:
+    __slots__ = ()
+try:
+    E().x = 1
+except AttributeError:
+    print('AttributeError')
+
+# __dict__ in __slots__ allows other attributes
+class D:
+    __slots__ = ('x', '__dict__')
+d = D()
+d.x = 1
+d.y = 2
+print(d.x, d.y)
+
+# subclass with more slots
+class Point3(Point):
+    __slots__ = ('z',)
+    def __init__(self, x, y, z):
+        super().__init__(x, y)
+        self.z = z
+p = Point3(1, 2, 3)
+print(p.x, p.y, p.z)
+try:
+    p.w = 4
+except AttributeError:
+    print('AttributeError')
+
+# subclass without __slots__ has a __dict__
+class Point4(Point):
+    pass
+p = Point4(1, 2)
+p.w = 4
+print(p.x, p.y, p.w)
+del p.x
+print(hasattr(p, 'x'), p.y, p.w)
+
+# slots and methods/properties
+class C:
+    __slots__ = ('_v',)
+    def __init__(self):
+        self._v = 0
+    @property
+    def v(self):
+        return self._v
+    def inc(self):
+        self._v += 1
+c = C()
+for i in range(5):
+    c.inc()
+print(c.v)
+
+# conflict with a class variable
+try:
+    class F:
+        __slots__ = ('x',)
+        x = 1
+except ValueError:
+    print('ValueError')
+
+# many instances
+l = [Point(i, i) for i in range(100)]
+print(sum(p.x + p.y for p in l))
+
+# native base class
+class L(list):
+    __slots__ = ('tag',)
+l = L([1, 2])
+l.tag = 'x'
+l.append(3)
+print(l, l.tag, len(l))
+try:
+    l.other = 1
+except AttributeError:
+    print('AttributeError')
@@ -0,0 +1,40 @@
+# test that __slots__ can't hide the class attributes of a base class
+# (CPython lets a slot hide them)
+
+try:
+    class Test:
+        __slots__ = ('x',)
+    Test().y = 1
+except AttributeError:
+    pass
+else:
+    print('SKIP')
+    raise SystemExit
+
+
+class A:
+    x = 1
+    @property
+    def p(self):
+        return 2
+    def m(self):
+        return 3
+
+for name in ('x', 'p', 'm', 'q'):
+    try:
+        class B(A):
+            __slots__ = (name,)
+        print(name, 'ok')
+    except ValueError:
+        print(name, 'ValueError')
+
+
+# also through a base that has no __slots__ of its own
+class C(A):
+    pass
+
+try:
+    class D(C):
+        __slots__ = ('p',)
+except ValueError:
+    print('ValueError')
@@ -0,0 +1,65 @@
+# test that stores to __slots__ go through __setattr__ and descriptors
+
+# feature test for __setattr__
+try:
+    class Test():
+        def __delattr__(self, attr): pass
+    del Test().noexist
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+try:
+    class Test:
+        __slots__ = ('x',)
+    Test().y = 1
+except AttributeError:
+    pass
+else:
+    print('SKIP')
+    raise SystemExit
+
+
+class A:
+    __slots__ = ('x',)
+    def __setattr__(self, attr, val):
+        print('set', attr, val)
+
+a = A()
+for i in range(2):
+    a.x = i
+try:
+    a.x
+except AttributeError:
+    print('AttributeError')
+
+
+# __setattr__ of a base class
+class B(A):
+    __slots__ = ('y',)
+
+b = B()
+for i in range(2):
+    b.y = i
+
+
+# a descriptor of a base class sees the stores to its name
+class Desc:
+    def __get__(self, obj, cls):
+        return 'get'
+    def __set__(self, obj, val):
+        print('__set__', val)
+
+class C:
+    d = Desc()
+    __slots__ = ('x',)
+
+class D(C):
+    __slots__ = ('y',)
+    def __init__(self):
+        self.y = 1
+        self.d = 2
+
+for i in range(2):
+    d = D()
+    print(d.y, d.d)
@@ -0,0 +1,34 @@
+# tests constant folding of comparisons and conditional expressions in parser
+
+def f(x):
+    print('f', x)
+    return x
+
+print(1 < 2, 2 < 1, 1 > 2, 2 > 1)
+print(1 == 1, 1 == 2, 1 != 1, 1 != 2)
+print(1 <= 1, 2 <= 1, 1 >= 1, 1 >= 2)
+print(-1 < 0 < 1, 0 < 1 < 1, 1 < 2 > 0, 3 > 2 > 1 > 0 < 5)
+print(1 << 100 > 1 << 99, -(1 << 80) < -(1 << 79))
+print((1 + 2) * 3 == 9, 7 // 2 != 3)
+
+# comparisons that can't be folded
+print(1 < f(2), f(1) < 2 < 3, 1 < 2 < f(3))
+print(1 in (1,), 1 not in (1,))
+
+# folded comparisons used with logical operators
+print(1 < 2 and f(3), 1 > 2 and f(3), 1 > 2 or f(4), not 1 == 1)
+
+# conditional expressions with a constant condition
+print(f(1) if 1 < 2 else f(2))
+print(f(1) if 1 > 2 else f(2))
+print(f(1) if True else f(2), f(1) if 0 else f(2))
+print(f(1) if 1 else f(2) if f(0) else f(3))
+print(f(1) if 0 else f(2) if 1 else f(3))
+
+# constant conditions of statements
+if 1 > 2:
+    print('not printed')
+elif 1 < 2:
+    print('elif')
+while 2 < 1:
+    print('not printed')
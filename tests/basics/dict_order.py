@@ -0,0 +1,79 @@
+# test that dicts keep their items in insertion order
+
+# skip if the dict implementation is not ordered
+keys = [str(i) for i in range(20, 0, -1)]
+d = {}
+for k in keys:
+    d[k] = None
+if list(d) != keys:
+    print("SKIP")
+    raise SystemExit
+
+# small dict
+d = {}
+d["b"] = 1
+d["a"] = 2
+d[3] = 3
+d[-1] = 4
+print(list(d.items()))
+
+# replacing a value keeps its position
+d["b"] = 5
+print(list(d.items()))
+
+# deleting then re-adding moves the key to the end
+del d["b"]
+print(list(d.items()))
+d["b"] = 6
+print(list(d.items()))
+
+# delete the last key, then add more
+del d["b"]
+del d[-1]
+d["c"] = 7
+print(list(d.items()))
+
+# keys that are not str or small int
+d = {"x": 1, 2.5: 2, (1, 2): 3, None: 4, "y": 5}
+print(list(d.items()))
+print(d[2.5], d[(1, 2)], d[None], d.get(3.5))
+
+# True, 1 and 1.0 are the same key
+d = {}
+d[1] = "a"
+d[True] = "b"
+d[1.0] = "c"
+print(len(d), list(d.items()))
+d = {"a": 0, 2: 1}
+print(d[2.0], 2.0 in d, 3.0 in d)
+
+# many keys, with deletions while growing
+d = {}
+for i in range(200):
+    d[i * 3] = i
+    if i % 3 == 0:
+        del d[i * 3]
+print(len(d), list(d)[:5], list(d)[-5:])
+for i in range(200):
+    d[i * 3] = -i
+print(len(d), list(d.values())[:5], list(d.values())[-5:])
+
+# copy keeps the order
+d = {"z": 1, "y": 2, "x": 3}
+c = d.copy()
+c["w"] = 4
+print(list(d), list(c))
+
+# popitem removes the last item
+d = {1: 1, 2: 2, 3: 3}
+print(d.popitem(), d.popitem(), d)
+
+# unhashable keys are still rejected
+try:
+    {}[[]] = 1
+except TypeError:
+    print("TypeError")
+try:
+    {1: 2}.get([])
+except TypeError:
+    print("TypeError")
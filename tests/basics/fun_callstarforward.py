@@ -0,0 +1,48 @@
+# test forwarding of *args and **kwargs through a wrapper
+
+def f(a, b, c=3, *, d=4):
+    return a, b, c, d
+
+def wrap(*args, **kwargs):
+    return f(*args, **kwargs)
+
+print(wrap(1, 2))
+print(wrap(1, 2, 5))
+print(wrap(1, b=2))
+print(wrap(1, 2, d=6, c=5))
+print(wrap(d=6, c=5, b=2, a=1))
+print(wrap(*(1, 2)))
+print(wrap(*[1, 2], **{}))
+
+# keywords in and out of declaration order, some going to **kwargs
+def g(a, b, c, **kw):
+    return a, b, c, sorted(kw.items())
+
+print(g(a=1, b=2, c=3))
+print(g(c=3, b=2, a=1))
+print(g(b=2, x=0, a=1, c=3, y=4))
+print(g(1, c=3, z=5, b=2))
+print(g(1, 2, 3, **{'w': 0}))
+
+# the **kwargs dict must be a new, mutable dict
+def h(**kw):
+    kw['new'] = 1
+    return kw
+
+d = {'a': 1}
+print(sorted(h(**d).items()), d)
+print(h(), h())
+
+# the *args tuple passed through unchanged
+t = (1, 2, 3)
+def k(*args):
+    return args
+print(k(*t), k(*t) == t)
+print(max(*t), min(*t, **{}))
+
+# errors still detected
+for args, kwargs in (((1,), {'a': 1}), ((), {'b': 2}), ((1, 2), {'e': 0}), ((1, 2, 3, 4), {})):
+    try:
+        wrap(*args, **kwargs)
+    except TypeError:
+        print('TypeError')
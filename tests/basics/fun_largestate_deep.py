@@ -0,0 +1,37 @@
+# test deep recursion of functions with a large state, which may need the
+# state to be allocated in several separate chunks
+
+def f(n, *args):
+    a = b = c = d = e = g = h = n
+    t = (a, b, c, d, e, g, h) + args
+    if n == 0:
+        return len(t)
+    return f(n - 1, *t[:4]) + 1
+
+print(f(120))
+
+# unwind through many frames with an exception, then recurse again
+def g(n):
+    x1 = x2 = x3 = x4 = x5 = x6 = x7 = x8 = n
+    if n == 0:
+        raise ValueError(x1 + x8)
+    try:
+        return g(n - 1)
+    finally:
+        x1 += 1
+
+for i in range(3):
+    try:
+        g(120 + i * 10)
+    except ValueError as er:
+        print("ValueError", er)
+print(f(100))
+
+# a call with many arguments made in a deep frame
+def h(n):
+    y1 = y2 = y3 = y4 = y5 = y6 = y7 = y8 = n
+    if n == 0:
+        return sum(*[list(range(40))]) + max(*range(60))
+    return h(n - 1)
+
+print(h(140))
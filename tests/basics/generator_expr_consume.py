@@ -0,0 +1,40 @@
+# test generator expressions passed directly to builtins that consume them
+
+l = list(range(10))
+
+def f(n):
+    return sum(x * n for x in l), any(x > n for x in l), all(x < n for x in l)
+
+for i in range(4):
+    print(f(i))
+
+print(list(x for x in l if x & 1), tuple(str(x) for x in l[:3]))
+print(min(x - 5 for x in l), max(-x for x in l), sorted(-x for x in l)[:3])
+
+# generator expression closing over a local, nested in another one
+def g(k):
+    return sum(sum(x * y for y in range(k)) for x in range(k))
+print(g(3), g(5))
+
+# short-circuiting leaves the generator suspended
+print(any(x == 2 for x in l), all(x < 2 for x in l), sum(x for x in l))
+
+# exception raised from within the generator
+try:
+    sum(1 // (x - 3) for x in l)
+except ZeroDivisionError:
+    print("ZeroDivisionError")
+print(sum(x for x in range(5)))
+
+# a function that keeps its argument must still see a usable generator
+kept = []
+def sum(it):
+    kept.append(it)
+    return 0
+sum(x for x in l)
+print(next(kept[0]), list(kept[0]))
+del sum
+
+# the same generator object used before and after a call
+gen = (x for x in l)
+print(max(gen), list(gen))
@@ -0,0 +1,50 @@
+# test repeated in-place concatenation of str/bytes, which may append to a shared buffer
+
+for empty, piece, rpiece in (("", "ab", "ba"), (b"", b"ab", b"ba")):
+    s = empty
+    saved = []
+    for i in range(100):
+        s += piece
+        if i % 20 == 0:
+            saved.append(s)
+    print(len(s), s[:10], s[-10:])
+    # earlier results must be unchanged by later appends
+    print([len(x) for x in saved], saved[2])
+
+    # two different strs extending the same str
+    t = s[:40]
+    u = t
+    t += piece * 2
+    u += rpiece * 2
+    print(t[-8:], u[-8:], len(t), len(u))
+    t += piece
+    print(t[-8:], u[-8:])
+
+    # extending a slice which ends before the used part of the buffer
+    v = t[:50]
+    v += piece
+    print(v[-6:], t[48:56])
+
+    # self concatenation
+    w = s[:60]
+    w += w
+    print(len(w), w == s[:60] * 2)
+
+    # hash, equality, comparison
+    print(hash(s) == hash(s[:]), s == piece * 100, s < s + piece)
+    d = {s: 1}
+    print(d[piece * 100])
+
+# mix of str methods on the results
+s = ""
+for i in range(50):
+    s += "%d," % i
+print(s.split(",")[-5:], s.count("1"), s.find("30"))
+s += "end"
+print(s.endswith("end"), s.upper()[-10:], s.encode()[-8:])
+
+# bytes with other buffer types on the rhs
+b = b"x" * 40
+b += bytearray(b"12")
+b += memoryview(b"34")
+print(b)
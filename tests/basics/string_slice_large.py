@@ -0,0 +1,43 @@
+# test slicing of large str/bytes objects, which may share the original data
+
+s = "0123456789abcdefghijklmnopqrstuvwxyz" * 4
+b = b"0123456789abcdefghijklmnopqrstuvwxyz" * 4
+
+# large slices, and slices of slices
+for x in (s, b):
+    y = x[10:100]
+    print(len(y), y)
+    z = y[5:80]
+    print(len(z), z)
+    print(z[2:70][1:60])
+    print(x[:-1][1:])
+
+# comparison and hashing must be the same as for a copy
+t = s[36:]
+print(t == s[:108], t == s[:108] + "", t < s[37:], t != s[1:109])
+print(hash(t) == hash(s[:108]), hash(b[36:]) == hash(b[:108]))
+d = {s[:40]: 1, s[40:80]: 2}
+print(d[s[36:76]], d[s[4:44]], s[:41] in d)
+d = {b[:40]: 1, b[40:80]: 2}
+print(d[b[36:76]], d[b[4:44]], b[:41] in d)
+print(s[5:50] in s, s.find(s[50:100]))
+
+# str methods operating on a large slice
+print(t.upper())
+print(t.split("z"))
+print(t.replace("abc", "---"))
+print(t.strip("0123"), t.startswith(s[36:40]), t.endswith(s[-5:]))
+print(t + t[:32])
+print(s[36:].encode()[:40].decode())
+print(b[36:].decode()[:40].encode())
+print(str(b[:80], "utf-8"))
+print(bytes(s[:80], "utf-8"))
+
+# buffer protocol
+print(bytearray(b[36:100]))
+print(memoryview(b[36:100])[2:6] == b"2345")
+n = "1234567890" * 5
+print(int(n[1:45]), int(n[3:40].encode()))
+
+# a small slice of a large object
+print(s[100:110], b[2:4])
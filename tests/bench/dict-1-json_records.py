@@ -0,0 +1,19 @@
+import bench
+try:
+    import ujson as json
+except ImportError:
+    import json
+
+# parse JSON records into dicts and look up their fields
+text = json.dumps([{"id": i, "name": "sensor%d" % i, "temp": i * 0.5,
+    "unit": "C", "ok": True, "tags": ["a", "b"]} for i in range(100)])
+
+def test(num):
+    for i in iter(range(num // 50000)):
+        recs = json.loads(text)
+        s = 0
+        for r in recs:
+            if r["ok"] and "temp" in r and "missing" not in r:
+                s += r["id"]
+
+bench.run(test)
@@ -0,0 +1,14 @@
+import bench
+
+# look up keys that are and aren't in a mid-sized dict
+def test(num):
+    d = {}
+    for i in range(12):
+        d["key%d" % i] = i
+    k1 = "key3"
+    k2 = "nokey"
+    for i in iter(range(num // 10)):
+        d.get(k1)
+        d.get(k2)
+
+bench.run(test)
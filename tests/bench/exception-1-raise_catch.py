@@ -0,0 +1,15 @@
+import bench
+
+def f(n):
+    if n == 0:
+        raise ValueError
+    f(n - 1)
+
+def test(num):
+    for i in iter(range(num // 10)):
+        try:
+            f(2)
+        except ValueError:
+            pass
+
+bench.run(test)
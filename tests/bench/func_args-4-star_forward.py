@@ -0,0 +1,13 @@
+import bench
+
+def func(a, b, c=0, *, d=1):
+    pass
+
+def wrapper(*args, **kwargs):
+    return func(*args, **kwargs)
+
+def test(num):
+    for i in iter(range(num)):
+        wrapper(i, i, c=i, d=i)
+
+bench.run(test)
@@ -0,0 +1,18 @@
+# Function call overhead test
+# Recursive calls to a function with a few locals, so its frame is not tiny
+import bench
+
+def f(n, a, b):
+    if n == 0:
+        return a
+    c = a + b
+    d = a - b
+    e = c * d
+    g = (c, d)
+    return f(n - 1, b, e & 0xff) + len(g)
+
+def test(num):
+    for i in iter(range(num // 20)):
+        f(20, i, 1)
+
+bench.run(test)
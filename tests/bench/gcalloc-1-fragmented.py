@@ -0,0 +1,16 @@
+import bench
+
+# allocate objects of mixed sizes in a heap fragmented by long-lived objects
+# that leave small holes between them
+def test(num):
+    keep = []
+    junk = []
+    for i in range(10000):
+        keep.append((i, i))
+        junk.append((i,) * 10)
+    junk = None
+    for i in iter(range(num // 100)):
+        t = (i,) * (i % 16 + 8)
+        l = [i] * (i % 13 + 1)
+
+bench.run(test)
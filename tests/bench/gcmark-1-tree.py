@@ -0,0 +1,15 @@
+import bench
+import gc
+
+# collect a heap holding a deep binary tree of tuples
+def tree(depth):
+    if depth == 0:
+        return None
+    return (tree(depth - 1), tree(depth - 1))
+
+def test(num):
+    t = tree(14)
+    for i in range(num // 200000):
+        gc.collect()
+
+bench.run(test)
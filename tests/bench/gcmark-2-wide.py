@@ -0,0 +1,14 @@
+import bench
+import gc
+
+# collect a heap holding many small objects reachable from a few wide lists
+# and dicts
+def test(num):
+    keep = []
+    for i in range(4):
+        keep.append([[j, str(j)] for j in range(1000)])
+        keep.append({j: (j,) for j in range(1000)})
+    for i in range(num // 200000):
+        gc.collect()
+
+bench.run(test)
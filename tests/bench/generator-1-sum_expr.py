@@ -0,0 +1,8 @@
+import bench
+
+def test(num):
+    l = list(range(8))
+    for i in iter(range(num // 10)):
+        sum(x + i for x in l)
+
+bench.run(test)
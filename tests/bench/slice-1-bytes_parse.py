@@ -0,0 +1,14 @@
+import bench
+
+# parse length-prefixed records out of a packet by repeatedly slicing it
+PKT = b"".join(bytes([48]) + bytes(range(64, 112)) for i in range(20))
+
+def test(num):
+    for i in iter(range(num // 2000)):
+        p = PKT
+        while p:
+            n = p[0]
+            rec = p[1:1 + n]
+            p = p[1 + n:]
+
+bench.run(test)
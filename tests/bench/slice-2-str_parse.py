@@ -0,0 +1,14 @@
+import bench
+
+# split lines off the front of a text buffer by repeatedly slicing it
+TEXT = "".join("line %02d: %s\n" % (i, "x" * 40) for i in range(20))
+
+def test(num):
+    for i in iter(range(num // 2000)):
+        s = TEXT
+        while s:
+            n = s.find("\n")
+            line = s[:n]
+            s = s[n + 1:]
+
+bench.run(test)
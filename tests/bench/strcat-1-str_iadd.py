@@ -0,0 +1,10 @@
+import bench
+
+# build a long str by repeated in-place concatenation
+def test(num):
+    for i in iter(range(num // 10000000)):
+        s = ""
+        for j in range(10000):
+            s += "item,"
+
+bench.run(test)
@@ -0,0 +1,11 @@
+import bench
+
+# build a long str by appending to a list and joining it
+def test(num):
+    for i in iter(range(num // 10000000)):
+        l = []
+        for j in range(10000):
+            l.append("item,")
+        s = "".join(l)
+
+bench.run(test)
@@ -0,0 +1,10 @@
+import bench
+
+# build a long bytes by repeated in-place concatenation
+def test(num):
+    for i in iter(range(num // 10000000)):
+        s = b""
+        for j in range(10000):
+            s += b"item,"
+
+bench.run(test)
@@ -0,0 +1,15 @@
+import bench
+
+# index every char of a long non-ASCII str in turn
+S = "".join(chr(0x3b1 + i % 20) for i in range(1000))
+
+def test(num):
+    for i in iter(range(num // 100000)):
+        s = S
+        n = len(s)
+        j = 0
+        while j < n:
+            c = s[j]
+            j += 1
+
+bench.run(test)
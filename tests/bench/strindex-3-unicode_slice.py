@@ -0,0 +1,12 @@
+import bench
+
+# take fixed-size slices at increasing offsets of a long non-ASCII str
+S = "".join(chr(0x3b1 + i % 20) for i in range(1000))
+
+def test(num):
+    for i in iter(range(num // 100000)):
+        s = S
+        for j in range(0, len(s) - 8, 4):
+            t = s[j:j + 8]
+
+bench.run(test)
@@ -0,0 +1,19 @@
+import bench
+
+class Foo:
+    __slots__ = ("a", "b", "c", "d")
+
+    def __init__(self, a, b, c, d):
+        self.a = a
+        self.b = b
+        self.c = c
+        self.d = d
+
+# create many small objects with __slots__ and read their attributes
+def test(num):
+    s = 0
+    for i in iter(range(num // 20)):
+        o = Foo(i, 1, 2, 3)
+        s += o.a + o.d
+
+bench.run(test)
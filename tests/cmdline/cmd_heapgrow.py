@@ -0,0 +1,40 @@
+# cmdline: -X heapsize=64k -X heapmax=1m
+# test a GC heap that grows when it is full and shrinks when it empties again
+import gc
+
+# create the globals used below now, so the dict holding them isn't grown (and
+# kept) in one of the extra regions
+b = peak = i = None
+
+gc.collect()
+start = gc.mem_free() + gc.mem_alloc()
+print(start < 70000)
+
+# an object bigger than the initial heap
+b = bytearray(200000)
+print(len(b), gc.mem_free() + gc.mem_alloc() > 200000)
+b = None
+
+# but not more than the maximum
+try:
+    bytearray(2000000)
+except MemoryError:
+    print("MemoryError")
+
+# lots of small live objects
+def fill():
+    l = []
+    for i in range(5000):
+        l.append([i, str(i)])
+    print(sum(x[0] for x in l), all(x[1] == str(x[0]) for x in l))
+    return gc.mem_free() + gc.mem_alloc()
+
+
+peak = fill()
+print(peak > start)
+
+# once everything is freed, the extra regions are given back (apart from any
+# still holding long-lived objects that were allocated while the heap was full)
+for i in range(8):
+    gc.collect()
+print(gc.mem_free() + gc.mem_alloc() < peak // 2)
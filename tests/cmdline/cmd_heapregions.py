@@ -0,0 +1,24 @@
+# cmdline: -X heapsize=256k -X heapregions=4
+# test a GC heap made of several separate regions
+import gc
+
+gc.collect()
+print(gc.mem_free() + gc.mem_alloc() > 200000)
+
+# an object must fit in one region
+try:
+    bytearray(100000)
+except MemoryError:
+    print("MemoryError")
+b = bytearray(40000)
+print(len(b))
+b = None
+
+# fill the heap with linked objects, dropping some along the way
+l = []
+for i in range(1500):
+    l.append([i, str(i)])
+    if i % 7 == 0:
+        l[i // 2] = None
+gc.collect()
+print(sum(x[0] for x in l if x), all(x[1] == str(x[0]) for x in l if x))
@@ -0,0 +1,82 @@
+# test that imports from a FAT filesystem match names regardless of case
+
+try:
+    import uos
+    uos.VfsFat
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+import sys
+
+
+class RAMFS:
+
+    SEC_SIZE = 512
+
+    def __init__(self, blocks):
+        self.data = bytearray(blocks * self.SEC_SIZE)
+
+    def readblocks(self, n, buf):
+        for i in range(len(buf)):
+            buf[i] = self.data[n * self.SEC_SIZE + i]
+
+    def writeblocks(self, n, buf):
+        for i in range(len(buf)):
+            self.data[n * self.SEC_SIZE + i] = buf[i]
+
+    def ioctl(self, op, arg):
+        if op == 4:  # BP_IOCTL_SEC_COUNT
+            return len(self.data) // self.SEC_SIZE
+        if op == 5:  # BP_IOCTL_SEC_SIZE
+            return self.SEC_SIZE
+
+
+try:
+    bdev = RAMFS(50)
+except MemoryError:
+    print("SKIP")
+    raise SystemExit
+
+uos.VfsFat.mkfs(bdev)
+vfs = uos.VfsFat(bdev)
+uos.mount(vfs, '/ramdisk')
+
+with open('/ramdisk/CaseMod.py', 'w') as f:
+    f.write('x = 1\n')
+uos.mkdir('/ramdisk/CasePkg')
+with open('/ramdisk/CasePkg/__init__.py', 'w') as f:
+    f.write('y = 2\n')
+
+sys.path.insert(0, '/ramdisk')
+
+# the first import lists the directory, the others are answered from it
+import CaseMod
+import casemod
+import CASEMOD
+print(CaseMod.x, casemod.x, CASEMOD.x)
+import casepkg
+print(casepkg.y)
+
+# names that aren't there at all are still not found
+try:
+    import casemod2
+except ImportError:
+    print('ImportError')
+
+# a directory with a name that isn't ASCII is not cached, but still imports
+uos.mkdir('/ramdisk/uni')
+with open('/ramdisk/uni/\u00e9t\u00e9.py', 'w') as f:
+    f.write('z = 3\n')
+with open('/ramdisk/uni/UniMod.py', 'w') as f:
+    f.write('z = 4\n')
+sys.path[0] = '/ramdisk/uni'
+import unimod
+print(unimod.z)
+try:
+    import unimod2
+except ImportError:
+    print('ImportError')
+
+sys.path.pop(0)
+uos.umount('/ramdisk')
@@ -0,0 +1,117 @@
+# test that imports from a VFS answer their stats from directory listings
+
+import sys
+
+try:
+    import uio
+    uio.IOBase
+    import uos
+    uos.mount
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+
+class UserFile(uio.IOBase):
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+    def read(self):
+        return self.data
+    def readinto(self, buf):
+        n = 0
+        while n < len(buf) and self.pos < len(self.data):
+            buf[n] = self.data[self.pos]
+            n += 1
+            self.pos += 1
+        return n
+    def ioctl(self, req, arg):
+        return 0
+    def close(self):
+        pass
+
+
+class UserFS:
+    def __init__(self, files):
+        self.files = files
+        self.ops = []
+    def mount(self, readonly, mksfs):
+        pass
+    def umount(self):
+        pass
+    def ilistdir(self, path):
+        self.ops.append('ilistdir ' + path)
+        if path != '/':
+            raise OSError(2)
+        for name in self.files:
+            yield (name[1:], 0x8000, 0)
+    def stat(self, path):
+        if path in self.files:
+            return (32768, 0, 0, 0, 0, 0, 0, 0, 0, 0)
+        self.ops.append('stat ' + path)
+        raise OSError(2)
+    def open(self, path, mode):
+        if 'w' in mode:
+            self.files[path] = b''
+        return UserFile(self.files[path])
+
+
+fs = UserFS({
+    '/cachemod1.py': b"x = 1",
+    '/cachemod2.py': b"x = 2",
+})
+uos.mount(fs, '/userfs')
+sys.path.insert(0, '/userfs/missing')
+sys.path.insert(0, '/userfs')
+
+import cachemod1
+if not fs.ops or not fs.ops[0].startswith('ilistdir'):
+    # the port doesn't cache import stats
+    uos.umount('/userfs')
+    print("SKIP")
+    raise SystemExit
+import cachemod2
+print(cachemod1.x, cachemod2.x)
+
+# neither the missing files nor the missing directory are stat'd
+try:
+    import cachemod3
+except ImportError:
+    print('ImportError')
+print(fs.ops)
+
+# creating a file drops the cache
+fs.ops = []
+open('/userfs/cachemod3.py', 'w').close()
+fs.files['/cachemod3.py'] = b"x = 3"
+import cachemod3
+print(cachemod3.x, fs.ops)
+
+# so does unmounting
+uos.umount('/userfs')
+try:
+    import cachemod4
+except ImportError:
+    print('ImportError')
+sys.path.pop(0)
+sys.path.pop(0)
+
+
+# a listing that only gives names still answers for missing files
+class NameOnlyFS(UserFS):
+    def ilistdir(self, path):
+        for item in UserFS.ilistdir(self, path):
+            yield item[:1]
+
+
+fs = NameOnlyFS({'/cachemod5.py': b"x = 5"})
+uos.mount(fs, '/userfs')
+sys.path.insert(0, '/userfs')
+import cachemod5
+try:
+    import cachemod6
+except ImportError:
+    print('ImportError')
+print(cachemod5.x, fs.ops)
+uos.umount('/userfs')
+sys.path.pop(0)
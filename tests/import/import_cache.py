@@ -0,0 +1,73 @@
+# test the compiled copies of .py files that imports keep in .mpc files
+
+import sys
+
+try:
+    import uos, ustruct
+    uos.stat
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+
+def write(name, data, mode='w'):
+    with open(name, mode) as f:
+        f.write(data)
+
+
+def read(name):
+    with open(name, 'rb') as f:
+        return f.read()
+
+
+def stamp(name):
+    st = uos.stat(name)
+    return ustruct.pack('<II', st[8], st[6])
+
+
+def reimport():
+    sys.modules.pop('cache_mod', None)
+    import cache_mod
+    return cache_mod.x
+
+
+def clean():
+    for name in ('cache_mod.py', 'cache_mod.mpc'):
+        try:
+            uos.remove(name)
+        except OSError:
+            pass
+
+
+sys.path.insert(0, '')
+write('cache_mod.py', 'x = 1\n')
+reimport()
+try:
+    uos.stat('cache_mod.mpc')
+except OSError:
+    clean()
+    print("SKIP")
+    raise SystemExit
+
+# the copy holds the stamp of the source and then a .mpy
+print(read('cache_mod.mpc')[:9] == stamp('cache_mod.py') + b'M')
+
+# a changed source is compiled again and its copy is rewritten
+write('cache_mod.py', 'x = 22\n')
+print(reimport())
+mpc22 = read('cache_mod.mpc')
+print(mpc22[:8] == stamp('cache_mod.py'))
+
+# a copy with a matching stamp is used instead of the source
+write('cache_mod.py', 'x = 3\n')
+write('cache_mod.mpc', stamp('cache_mod.py') + mpc22[8:], 'wb')
+print(reimport())
+
+# a copy that can't be loaded is replaced
+write('cache_mod.mpc', stamp('cache_mod.py') + b'garbage', 'wb')
+print(reimport())
+print(read('cache_mod.mpc')[8:9])
+print(reimport())
+
+clean()
+sys.path.pop(0)
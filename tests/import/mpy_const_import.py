@@ -0,0 +1,86 @@
+# test that mpy-cross only inlines constants from "from <module> import" when
+# the import is at module level and the name isn't bound anywhere else
+
+import sys
+
+try:
+    import uos
+    uos.system
+    uos.getenv
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+mpy_cross = uos.getenv('MICROPY_MPYCROSS') or '../mpy-cross/mpy-cross'
+try:
+    uos.stat(mpy_cross)
+except OSError:
+    print("SKIP")
+    raise SystemExit
+
+SOURCES = {
+    # a conditional import may not happen
+    'cimp_try': (
+        "try:\n"
+        "    from cimp_consts import X\n"
+        "except ImportError:\n"
+        "    X = 5\n"
+        "print(X)\n"
+    ),
+    # an import in a function doesn't bind the name in the module
+    'cimp_func': (
+        "def g():\n"
+        "    from cimp_consts import Y\n"
+        "    return Y\n"
+        "Y = 7\n"
+        "print(g(), Y)\n"
+    ),
+    # a name that is assigned later is not inlined, the others are
+    'cimp_store': (
+        "from cimp_consts import X, Z\n"
+        "def f():\n"
+        "    return X, Z\n"
+        "print(f())\n"
+        "X = 1\n"
+        "print(f())\n"
+    ),
+    # names bound by for, with and except are not inlined either
+    'cimp_bind': (
+        "from cimp_consts import X, Y, Z\n"
+        "for X in (10,):\n"
+        "    pass\n"
+        "try:\n"
+        "    raise ValueError\n"
+        "except ValueError as Y:\n"
+        "    print(X, type(Y), Z)\n"
+    ),
+}
+
+
+def write(name, data):
+    with open(name, 'w') as f:
+        f.write(data)
+
+
+write('cimp_consts.py', "from micropython import const\nX = const(1)\nY = const(2)\nZ = const(3)\n")
+for name, source in SOURCES.items():
+    write(name + '.py', source)
+    ret = uos.system('%s -mcache-lookup-bc -c cimp_consts.py %s.py' % (mpy_cross, name))
+    print(name, ret)
+    uos.remove(name + '.py')
+
+# at runtime the module has other values, to tell which names were inlined
+write('cimp_consts.py', "X = 100\nY = 200\nZ = 300\n")
+sys.path.insert(0, '')
+for name in sorted(SOURCES):
+    try:
+        __import__(name)
+    except Exception as e:
+        print(name, repr(e))
+sys.path.pop(0)
+
+for name in ['cimp_consts.py', 'cimp_consts.mpc'] + [name + '.mpy' for name in SOURCES]:
+    try:
+        uos.remove(name)
+    except OSError:
+        pass
@@ -0,0 +1,54 @@
+# test calling functions of an execute-in-place .mpy image that are loaded
+# on their first call
+
+import sys, gc
+
+try:
+    import uos
+    uos.remove
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+# def f(a, b=2):
+#     return (a + b, 'xip', b'ip')
+# def g():
+#     def h(x):
+#         return (x, 'h')
+#     return h
+mpy = (
+    b'M\x04\x83\x1f \t\x00\x07\x16mod_laz'
+    b'y.py\x02f\x02g\x06xip\x02a\x02b'
+    b'\x02h\x02x|\x02\x000\x00\x00\x00\x08\x00\x00\x01\x00'
+    b'J\x00\x00\xff\x82P\x01\x18a\x00$\x02\x00`\x01$'
+    b'\x03\x00\x11[\x00\x02h\x05\x00\x00\x02\x00\x01\x08\x02\x00'
+    b'\x01\x00!\x00\x00\xff\xb0\xb1\xf1\x16\x04\x00\x17\x02P\x03'
+    b'[\x01\x00\x05\x06B\x02ip\x00T\x02\x000\x00\x00'
+    b'\x00\t\x03\x00\x01\x00aC\x00\x00\xff`\x00\xc0\xb0['
+    b'\x00\x01\\\x03\x00\x00\x01\x00\x00\t\x07\x00\x01\x00a '
+    b'\x00\x00\xff\xb0\x16\x07\x00P\x02[\x00\x00\x08'
+)
+
+with open('mod_lazy.mpy', 'wb') as f:
+    f.write(mpy)
+sys.path.insert(0, '')
+try:
+    import mod_lazy
+except ValueError:
+    # the port can't execute .mpy files in place
+    mod_lazy = None
+sys.path.pop(0)
+if mod_lazy is None:
+    uos.remove('mod_lazy.mpy')
+    print("SKIP")
+    raise SystemExit
+
+# the functions must survive a collection before their first call
+gc.collect()
+print(mod_lazy.f.__name__, mod_lazy.g.__name__)
+print(mod_lazy.f(1), mod_lazy.f(2, 3))
+h = mod_lazy.g()
+gc.collect()
+print(h.__name__, h(4), mod_lazy.g()(5))
+
+uos.remove('mod_lazy.mpy')
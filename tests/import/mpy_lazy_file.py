@@ -0,0 +1,138 @@
+# test calling functions of a .mpy file that may be left in the file on
+# import and read from it on their first call
+
+import sys, gc
+
+try:
+    import uos
+    uos.remove
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+# def f(a, b=2):
+#     l = [a, a + 1, a + 2, a + 3, a + 4, a + 5, a + 6, a + 7, a + 8, a + 9]
+#     l += [a * 2, a * 3, a * 4, a * 5, a * 6, a * 7, a * 8, a * 9]
+#     t = (a, b, 'f', b'f', 1.5, 10 ** 20)
+#     return sum(l) + b, t
+#
+#
+# def g(n):
+#     for i in range(n):
+#         yield [i, i + 1, i + 2, i + 3, i + 4, i + 5, i + 6, i + 7, i + 8]
+#         yield [i * 2, i * 3, i * 4, i * 5, i * 6, i * 7, i * 8, i * 9]
+#
+#
+# def k(x):
+#     def h(y):
+#         l = [x, y, x + y, x - y, x * y, x // y, x % y, x ** y, 'h']
+#         l += [x + 1, y + 1, x + 2, y + 2, x + 3, y + 3, x + 4, y + 4]
+#         return l + [x * 2, y * 2, x * 3, y * 3]
+#
+#     return h
+#
+#
+# class C:
+#     def __init__(self, v):
+#         self.v = [v, v + 1, v + 2, v + 3, v + 4, v + 5, v + 6, v + 7]
+#         self.w = [v * 2, v * 3, v * 4, v * 5, v * 6, v * 7, v * 8, v * 9]
+#
+#     def m(self):
+#         l = [w * 2 for w in self.v] + [w * 3 for w in self.w] + ['m']
+#         l += [self.v[0] + 1, self.v[1] + 2, self.v[2] + 3, self.v[3] + 4]
+#         l += [self.w[0] - 1, self.w[1] - 2, self.w[2] - 3, self.w[3] - 4]
+#         return l
+mpy = (
+    b'M\x04\x03\x1f \x81P\x03\x000\x00\x00\x00\r\x07\x00'
+    b'Q\x01\x8a\x07e`\x85\t\x00\x00\xff\x82P\x01\x18a'
+    b'\x00$\x02f`\x01$\x02g`\x02$\x02k `'
+    b'\x03\x16\x02Cd\x02$\x01\x11[\x00\x07 mod'
+    b'_lazy_file.py\x00\x04\x83'
+    b'(\x0f\x00\x10\x02\x00\x01\x0bR\x01Q\x01!?=/'
+    b'\x00\x00\xff\xb0\xb0\x81\xf1\xb0\x82\xf1\xb0\x83\xf1\xb0\x84\xf1'
+    b'\xb0\x85\xf1\xb0\x86\xf1\xb0\x87\xf1\xb0\x88\xf1\xb0\x89\xf1Q'
+    b'\n\xc2\xb2\xb0\x82\xf3\xb0\x83\xf3\xb0\x84\xf3\xb0\x85\xf3\xb0'
+    b'\x86\xf3\xb0\x87\xf3\xb0\x88\xf3\xb0\x89\xf3Q\x08\xe5\xc2\xb0'
+    b'\xb1\x16\t\x17\x02\x17\x03\x8a\x94\xf7P\x06\xc3\x1c\x00\x99'
+    b'\x00\xb2d\x01\xb1\xf1\xb3P\x02[\x01\x03\x02\x00\x02a'
+    b'\x02bb\x01ff\x031.5\x82x\x0e\x00\x04\x01'
+    b"\x00\x00\x0bV\x01Q\x01\x81\x08'=\x00\x00\xff\xb0\x80"
+    b'5=\x800\xc1\xb1\xb1\x81\xf1\xb1\x82\xf1\xb1\x83\xf1\xb1'
+    b'\x84\xf1\xb1\x85\xf1\xb1\x86\xf1\xb1\x87\xf1\xb1\x88\xf1Q\t'
+    b']2\xb1\x82\xf3\xb1\x83\xf3\xb1\x84\xf3\xb1\x85\xf3\xb1\x86'
+    b'\xf3\xb1\x87\xf3\xb1\x88\xf3\xb1\x89\xf3Q\x08]2\x81\xe5'
+    b'13\xd76\xbd\x7f22\x11[\r\x07\x00\x00\x02n'
+    b'h\x03\x000\x01\x00\x00\x0bY\x01Q\x01\x82\x0ee@'
+    b'\x00\x00\x00\xff\xb0b\x01\x01\xc1\xb1[\x0f\x05\x00\x01\x02'
+    b'x\x83$\r\x00\x00\x02\x00\x00\r[\x01Q\x01\x81\x0f'
+    b'\x1f"\x1f"\x00\x00\xff\x1a\x00\xb1\x1a\x00\xb1\xf1\x1a\x00'
+    b'\xb1\xf2\x1a\x00\xb1\xf3\x1a\x00\xb1\xf4\x1a\x00\xb1\xf6\x1a\x00'
+    b'\xb1\xf7\x16\x02hQ\t\xc2\xb2\x1a\x00\x81\xf1\xb1\x81\xf1'
+    b'\x1a\x00\x82\xf1\xb1\x82\xf1\x1a\x00\x83\xf1\xb1\x83\xf1\x1a\x00'
+    b'\x84\xf1\xb1\x84\xf1Q\x08\xe5\xc2\xb2\x1a\x00\x82\xf3\xb1\x82'
+    b'\xf3\x1a\x00\x83\xf3\xb1\x83\xf3Q\x04\xf1[\x01\x05\x00\x00'
+    b'\x00\x05\x02y\x81,\x01\x000\x00\x00\x00\x0b]\x01Q'
+    b'\x01\x8e\x17e \x00\x00\xff\x1b\x00\x17\x00$\x00\x16\x16'
+    b'\x15$\x00\x1a`\x00$\x00\x11`\x01$\x02m\x11['
+    b'\x03\x07\x00\x02\x82<\x0b\x00\x00\x02\x00\x00\n\x11\x00Q'
+    b'\x01\x81\x18=\x00\x00\xff\xb1\xb1\x81\xf1\xb1\x82\xf1\xb1\x83'
+    b'\xf1\xb1\x84\xf1\xb1\x85\xf1\xb1\x86\xf1\xb1\x87\xf1Q\x08\xb0'
+    b'&\x02v\x00\xb1\x82\xf3\xb1\x83\xf3\xb1\x84\xf3\xb1\x85\xf3'
+    b'\xb1\x86\xf3\xb1\x87\xf3\xb1\x88\xf3\xb1\x89\xf3Q\x08\xb0&'
+    b'\x02w\x00\x11[\x00\x11\x05\x00\x00\x00\x89\x05\x84\x0c\x08'
+    b'\x000\x01\x00\x00\x0e`\x01Q\x01\x81\x1c:\x1f*\x1f'
+    b'*\x00\x00\xff`\x01\xb0\x1d\x01\x00d\x01`\x02\xb0\x1d'
+    b'\x05\x00d\x01\xf1\x16\tQ\x01\xf1\xc1\xb1\xb0\x1d\x05\x00'
+    b'\x80!\x81\xf1\xb0\x1d\x01\x00\x81!\x82\xf1\xb0\x1d\x01\x00'
+    b'\x82!\x83\xf1\xb0\x1d\x01\x00\x83!\x84\xf1Q\x04\xe5\xc1'
+    b'\xb1\xb0\x1d\x05\x00\x80!\x81\xf2\xb0\x1d\x01\x00\x81!\x82'
+    b'\xf2\xb0\x1d\x01\x00\x82!\x83\xf2\xb0\x1d\x01\x00\x83!\x84'
+    b'\xf2Q\x04\xe5\xc1\xb1[\x05\x07\x00\x02\x00\x89\x81\x04\t'
+    b'\x00\x00\x01\x00\x00\t\xc1\x00Q\x01\x89\x1c\x00\x00\xffQ'
+    b'\x00\xb0GC\t\x00\xc1\xb1\x82\xf3W\x145\xf4\x7f['
+    b'\x14<listcomp>\x03\x00\x00\x00\x05'
+    b'\x81\x04\t\x00\x00\x01\x00\x00\t\xc1\x00Q\x01\x89\x1c\x00'
+    b'\x00\xffQ\x00\xb0GC\t\x00\xc1\xb1\x83\xf3W\x145'
+    b'\xf4\x7f[\x03\x03\x00\x00\x00\x05'
+)
+
+with open('mod_lazy_file.mpy', 'wb') as f:
+    f.write(mpy)
+sys.path.insert(0, '')
+try:
+    import mod_lazy_file
+except ValueError:
+    # the port can't load this .mpy file
+    mod_lazy_file = None
+sys.path.pop(0)
+if mod_lazy_file is None:
+    uos.remove('mod_lazy_file.mpy')
+    print("SKIP")
+    raise SystemExit
+
+# the functions must survive a collection before their first call
+gc.collect()
+print(mod_lazy_file.f.__name__, mod_lazy_file.g.__name__, mod_lazy_file.C.m.__name__)
+print(mod_lazy_file.f(1), mod_lazy_file.f(2, 3))
+print(list(mod_lazy_file.g(2)))
+h = mod_lazy_file.k(7)
+gc.collect()
+print(h(2), mod_lazy_file.k(9)(4))
+c = mod_lazy_file.C(3)
+print(c.m(), mod_lazy_file.C(4).m())
+
+# a function whose prelude changed in the file since the import isn't loaded
+# from it: it raises ValueError if it was left in the file, and otherwise it
+# runs as before
+del sys.modules['mod_lazy_file']
+sys.path.insert(0, '')
+import mod_lazy_file
+sys.path.pop(0)
+with open('mod_lazy_file.mpy', 'wb') as f:
+    f.write(mpy.replace(b'\x0f\x00\x10\x02\x00\x01', b'\x10\x00\x10\x02\x00\x01'))
+try:
+    print(mod_lazy_file.f(1) == (101, (1, 2, 'f', b'f', 1.5, 10 ** 20)))
+except ValueError:
+    print(True)
+
+uos.remove('mod_lazy_file.mpy')
@@ -0,0 +1,129 @@
+# test the line numbers in tracebacks of functions loaded from a .mpy file,
+# whose line tables may be left in the file until a traceback is printed
+
+import sys, gc
+
+try:
+    import uos, uio
+    uos.remove
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+# def f(a):
+#     b = a + 1
+#     c = b * 2
+#     d = c - 1
+#     e = [d] * 2
+#     return g(e)
+#
+#
+# def g(d):
+#     x = 1
+#     y = 2
+#     z = x + y
+#     w = z * 2
+#     return d[w]
+#
+#
+# class C:
+#     def m(self):
+#         return [1 // i for i in range(2)]
+#
+#
+# def h(n):
+#     # a gap of lines and a long stretch of bytecode, so the line table
+#     # needs its two-byte entries
+#
+#
+#
+#
+#
+#
+#
+#
+#
+#     l = [n, n + 1, n + 2, n + 3, n + 4, n + 5, n + 6, n + 7, n + 8, n + 9]
+#     m = l[n]
+#     m += 1
+#     m *= 20
+#     return l[m]
+mpy = (
+    b'M\x04\x03\x1f \x81@\x03\x000\x00\x00\x00\r\x07\x00'
+    b'Q\x01\x86\x08\x85\x08k@\x00\x00\xff`\x00$\x02f'
+    b'`\x01$\x02g `\x02\x16\x02Cd\x02$\x01`'
+    b'\x03$\x02h\x11[\x00\x07\x18mod_lin'
+    b'es.py\x00\x04\x814\x07\x00\x10\x01\x00\x00\x0c'
+    b'R\x01Q\x01!$$$&\x00\x00\xff\xb0\x81\xf1\xc1'
+    b'\xb1\x82\xf3\xc2\xb2\x81\xf2\xc3\xb3Q\x01\x82\xf3\xc4\x1c\x07'
+    b'\x00\xb4d\x01[\t\x05\x00\x00\x02a\x81\x10\x07\x00\x00'
+    b'\x01\x00\x00\rW\x01Q\x01\x81\t""$$\x00\x00'
+    b'\xff\x81\xc1\x82\xc2\xb1\xb2\xf1\xc3\xb3\x82\xf3\xc4\xb0\xb4!'
+    b'[\x07\x05\x00\x00\x02d\x81\x10\x01\x000\x00\x00\x00\t'
+    b'\\\x01Q\x01\x8e\x11\x00\x00\xff\x1b\x00\x17\x00$\x00\x16'
+    b'\x16\r$\x00\x1a`\x00$\x02m\x11[\x03\x07\x00\x01'
+    b'p\x04\x000\x01\x00\x00\t]\x01Q\x01\x81\x12\x00\x00'
+    b'\xff`\x01\x1c\x00|\x00\x82d\x01d\x01[\x05\x03\x00'
+    b'\x01\x00\x89\x81\x04\t\x00\x00\x01\x00\x00\t\xc1\x00Q\x01'
+    b'\x89\x12\x00\x00\xffQ\x00\xb0GC\t\x00\xc1\x81\xb1\xf4'
+    b'W\x145\xf4\x7f[\x14<listcomp'
+    b'>\x03\x00\x00\x00\x05\x82\x0c\x0e\x00\x00\x01\x00\x00\r_'
+    b'\x01Q\x01\x81!?$$$\x00\x00\xff\xb0\xb0\x81\xf1'
+    b'\xb0\x82\xf1\xb0\x83\xf1\xb0\x84\xf1\xb0\x85\xf1\xb0\x86\xf1\xb0'
+    b'\x87\xf1\xb0\x88\xf1\xb0\x89\xf1Q\n\xc1\xb1\xb0!\xc2\xb2'
+    b'\x81\xe5\xc2\xb2\x94\xe7\xc2\xb1\xb2![\x11\x03\x00\x00\x02'
+    b'n'
+)
+
+with open('mod_lines.mpy', 'wb') as f:
+    f.write(mpy)
+# the file stays on sys.path, where the line tables are looked for
+sys.path.insert(0, '')
+try:
+    import mod_lines
+except ValueError:
+    # the port can't load this .mpy file
+    mod_lines = None
+if mod_lines is None:
+    sys.path.pop(0)
+    uos.remove('mod_lines.mpy')
+    print("SKIP")
+    raise SystemExit
+
+
+def print_tb(e):
+    buf = uio.StringIO()
+    sys.print_exception(e, buf)
+    for line in buf.getvalue().split('\n'):
+        if 'mod_lines' in line or 'Error' in line:
+            print(line)
+
+
+excs = []
+for fun, arg in ((mod_lines.f, 1), (mod_lines.C().m, None), (mod_lines.h, 1)):
+    try:
+        fun() if arg is None else fun(arg)
+    except Exception as e:
+        excs.append(e)
+        print_tb(e)
+
+# the tracebacks are the same when printed again, after a collection
+gc.collect()
+for e in excs:
+    print_tb(e)
+
+# a traceback that is printed after the file has changed doesn't take line
+# numbers from the table that is now there: the line of f is 0 if its table
+# was left in the file (and 6 if not), but not 7 as in the changed table
+try:
+    mod_lines.f(1)
+except Exception as e:
+    exc = e
+with open('mod_lines.mpy', 'wb') as f:
+    f.write(mpy.replace(b'!$$$&\x00', b'!$$$F\x00'))
+buf = uio.StringIO()
+sys.print_exception(exc, buf)
+print('line 7' not in buf.getvalue())
+
+sys.path.pop(0)
+uos.remove('mod_lines.mpy')
@@ -0,0 +1,119 @@
+# test importing of execute-in-place .mpy images
+
+import sys, uio
+
+try:
+    uio.IOBase
+    import uos
+    uos.mount
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+
+class UserFile(uio.IOBase):
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+    def read(self):
+        return self.data
+    def readinto(self, buf):
+        n = 0
+        while n < len(buf) and self.pos < len(self.data):
+            buf[n] = self.data[self.pos]
+            n += 1
+            self.pos += 1
+        return n
+    def ioctl(self, req, arg):
+        return 0
+
+
+class UserFS:
+    def __init__(self, files):
+        self.files = files
+    def mount(self, readonly, mksfs):
+        pass
+    def umount(self):
+        pass
+    def stat(self, path):
+        if path in self.files:
+            return (32768, 0, 0, 0, 0, 0, 0, 0, 0, 0)
+        raise OSError
+    def open(self, path, mode):
+        return UserFile(self.files[path])
+
+
+# these are the test .mpy files
+user_files = {
+    # XIP image containing native code
+    '/mod0.mpy': (
+        b'M\x04\x83\x1f\x20' # header
+        b'\x00' # n_qstr
+        b'\x09' # n bytes, native code
+            b'\x00\x00'
+    ),
+
+    # def f(a, b=2):
+    #     return (a + b, 'xip', b'ip')
+    # print(f(1), f.__name__)
+    '/mod1.mpy': (
+        b'M\x04\x83\x1f\x20' # header
+
+        b'\x08' # n_qstr
+            b'\x00\x07' # 0: <module>
+            b'\x0emod1.py' # 1
+            b'\x02f' # 2
+            b'\x00\x7b' # 3: print
+            b'\x00\x17' # 4: __name__
+            b'\x06xip' # 5
+            b'\x02a' # 6
+            b'\x02b' # 7
+
+        b'\x81\x40' # n bytes, bytecode
+            b'\x03\x00\x30\x00\x00\x00\x08' # prelude
+            b'\x00\x00\x01\x00' # simple_name, source_file
+            b'\x4a\x00\x00\xff' # line info
+            b'\x82\x50\x01\x18\x61\x00' # LOAD_CONST_SMALL_INT, BUILD_TUPLE, LOAD_NULL, MAKE_FUNCTION_DEFARGS
+            b'\x24\x02\x00' # STORE_NAME f
+            b'\x1b\x03\x00\x00' # LOAD_NAME print
+            b'\x1b\x02\x00\x00\x81\x64\x01' # LOAD_NAME f, LOAD_CONST_SMALL_INT, CALL_FUNCTION
+            b'\x1b\x02\x00\x00\x1d\x04\x00\x00' # LOAD_NAME f, LOAD_ATTR __name__
+            b'\x64\x02\x32\x11\x5b' # CALL_FUNCTION, POP_TOP, LOAD_CONST_NONE, RETURN_VALUE
+        b'\x00\x01' # n_obj, n_raw_code
+
+        b'\x68' # n bytes, bytecode
+            b'\x05\x00\x00\x02\x00\x01\x08' # prelude
+            b'\x02\x00\x01\x00' # simple_name, source_file
+            b'\x21\x00\x00\xff' # line info
+            b'\xb0\xb1\xf1' # LOAD_FAST, LOAD_FAST, BINARY_OP
+            b'\x16\x05\x00\x17\x02' # LOAD_CONST_STRING 'xip', LOAD_CONST_OBJ
+            b'\x50\x03\x5b' # BUILD_TUPLE, RETURN_VALUE
+        b'\x01\x00' # n_obj, n_raw_code
+        b'\x06\x07' # arg names
+        b'B\x02ip\x00' # bytes object
+    ),
+}
+
+# create and mount a user filesystem
+uos.mount(UserFS(user_files), '/userfs')
+sys.path.append('/userfs')
+
+# the images above are for ports that cache map lookups in bytecode and have unicode
+try:
+    import mod1
+except ValueError:
+    print('SKIP')
+    raise SystemExit
+finally:
+    uos.umount('/userfs')
+    sys.path.pop()
+
+# an XIP image can only hold bytecode
+uos.mount(UserFS(user_files), '/userfs')
+sys.path.append('/userfs')
+try:
+    import mod0
+except ValueError as er:
+    print('mod0 ValueError', er)
+uos.umount('/userfs')
+sys.path.pop()
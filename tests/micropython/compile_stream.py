@@ -0,0 +1,82 @@
+# test top-level definitions that are compiled while the rest of the file is parsed
+
+# module-level names used before and after the definitions
+A = 1
+
+def f1(a, b=A, *args, c=[i * 2 for i in range(3)], d=lambda x: x + 1, **kw):
+    return a, b, args, c, d(a), kw
+
+print(f1(1))
+print(f1(1, 2, 3, c=4, e=5))
+
+def deco(n):
+    def wrap(f):
+        return lambda: (f(), n)
+    return wrap
+
+@deco((lambda: 42)())
+@deco([x for x in "ab"])
+def f2():
+    "doc"
+    return B
+
+B = 2
+print(f2())
+
+# closures and nested functions
+def f3(x):
+    def g(y):
+        def h():
+            return x + y
+        return h
+    return g
+
+print(f3(1)(2)())
+
+# generators and globals
+def f4(n):
+    global C
+    C = n
+    for i in range(n):
+        yield i
+
+print(list(f4(3)), C)
+
+# classes, methods, super() and keyword arguments to bases
+class Base:
+    def __init__(self, v=A):
+        self.v = v
+    def get(self):
+        return self.v
+
+class C1(Base, **{}):
+    "class doc"
+    k = [A * i for i in range(2)]
+    def __init__(self):
+        super().__init__(3)
+    def get(self):
+        return super().get() + 1
+
+print(C1().get(), C1.k, Base().get())
+
+# redefinition and definitions that are not at the top level
+def f5():
+    return 1
+
+if A:
+    def f5():
+        return 2
+
+print(f5())
+
+def f5(a=f5()):
+    return a
+
+print(f5())
+
+# errors in a definition are raised once the whole module is parsed
+for src in ("def f():\n break\n", "def f():\n return\nx = (\n", "class C:\n def f(self, a=1, b):\n  pass\n"):
+    try:
+        exec(src)
+    except SyntaxError:
+        print("SyntaxError")
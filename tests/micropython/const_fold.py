@@ -0,0 +1,86 @@
+# test constant folding with names declared with const(), and code that the
+# bytecode peephole optimiser may remove or rewrite
+
+from micropython import const
+
+DEBUG = const(0)
+LEVEL = const(2)
+BIG = const(1 << 100)
+
+print(DEBUG > 0, LEVEL >= 2, 0 < LEVEL < 3, BIG > LEVEL, BIG == 1 << 100)
+print('a' if DEBUG else 'b', 'c' if LEVEL == 2 else 'd')
+
+if DEBUG > 0:
+    print('debug')
+elif LEVEL > 1:
+    print('level', LEVEL)
+
+def f(x):
+    if x:
+        return 1
+    else:
+        return 2
+    print('unreachable')
+
+print(f(0), f(1))
+
+# jumps to jumps
+def g(n):
+    r = []
+    for i in range(n):
+        if i % 2:
+            if i % 3:
+                r.append(i)
+        else:
+            while i:
+                i -= 1
+                if i == 2:
+                    break
+            else:
+                continue
+    return r
+
+print(g(10))
+
+# code after raise and return inside exception blocks
+def h(x):
+    try:
+        if x:
+            raise ValueError(x)
+        return 'ret'
+        print('unreachable')
+    except ValueError:
+        return 'exc'
+        print('unreachable')
+    finally:
+        print('finally')
+
+print(h(0), h(1))
+
+class CM:
+    def __enter__(self):
+        print('enter')
+    def __exit__(self, a, b, c):
+        print('exit', a)
+
+def w(x):
+    with CM():
+        if x:
+            raise ValueError
+        return x
+
+print(w(0))
+try:
+    w(1)
+except ValueError:
+    print('ValueError')
+
+# values that are computed and then discarded
+def d(a):
+    None
+    1
+    'str'
+    a
+    return a, [a, a]
+
+print(d(3))
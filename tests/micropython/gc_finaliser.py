@@ -0,0 +1,39 @@
+# test that finalisers are called once for each unreachable object, and never
+# for reachable ones
+
+try:
+    FinaliserTest
+except NameError:
+    print('SKIP')
+    raise SystemExit
+
+import gc
+
+N = 100
+calls = [0] * N
+
+# the finaliser may be called with the heap locked, so it mustn't allocate
+def fin(i):
+    calls[i] += 1
+
+def make():
+    objs = [FinaliserTest(fin, i) for i in range(N)]
+    # keep the objects with an even index
+    return objs[::2]
+
+keep = make()
+for i in range(4):
+    gc.collect()
+
+# objects still referenced aren't finalised, the others are at most once
+print(calls[::2] == [0] * (N // 2))
+print(max(calls) == 1)
+# the GC is conservative, so an odd one may still be found on the stack
+print(sum(calls) > N // 2 - 5)
+
+# once unreachable the rest are finalised too, and none a second time
+keep = None
+for i in range(4):
+    gc.collect()
+print(max(calls) == 1)
+print(sum(calls) > N - 10)
@@ -0,0 +1,46 @@
+# test that with deferred finalisers, objects only reachable from an object
+# whose finaliser is pending are kept until the finaliser has been called
+
+try:
+    FinaliserTest
+except NameError:
+    print('SKIP')
+    raise SystemExit
+
+import gc
+
+N = 10
+data = [None] * N
+
+# the finaliser may be called with the heap locked, so it mustn't allocate
+def fin(arg):
+    data[arg[0]] = arg[1]
+
+def make():
+    for i in range(N):
+        # only the FinaliserTest object refers to the list of bytearrays
+        FinaliserTest(fin, (i, [bytearray(bytes([j]) * 32) for j in range(50)]))
+
+make()
+gc.collect()
+
+# Scheduled functions, and so deferred finalisers, are only called on a jump of
+# the VM, so none are called until the "if" below.  Meanwhile the memory freed
+# by the collection is allocated again, and none of it may be what the pending
+# finalisers refer to.
+n_called = N - data.count(None)
+garbage = list(map(bytearray, [b'\xff' * 32] * 500))
+garbage = None
+if n_called:
+    print('SKIP')
+    raise SystemExit
+
+# the finalisers are called from now on
+print(data.count(None) < 3)
+print(all(d is None or d == [bytearray(bytes([j]) * 32) for j in range(50)] for d in data))
+
+# and once called, the objects and what they refer to are freed
+data = [None] * N
+for i in range(4):
+    gc.collect()
+print(data == [None] * N)
@@ -0,0 +1,48 @@
+# test allocating objects of mixed sizes in a heap fragmented by long-lived
+# objects, which uses runs of free blocks of all sizes
+
+import gc
+
+try:
+    gc.mem_free
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+def fill(n, size):
+    return bytearray(bytes([n & 0xff]) * size)
+
+# each object is filled with its index in the list it was first allocated to
+def intact(objs, sizes):
+    return all(b == fill(n, size) for b, (n, size) in zip(objs, sizes))
+
+# long-lived objects with free runs of different sizes left between them
+keep_sizes = [(i, 16 + 8 * (i % 5)) for i in range(200)]
+keep = []
+gaps = []
+for i, size in keep_sizes:
+    keep.append(fill(i, size))
+    gaps.append(bytearray(16 * (1 + i % 7)))
+gaps = None
+gc.collect()
+free_start = gc.mem_free()
+
+ok = True
+for r in range(20):
+    sizes = [(j, 8 * (1 + (j * 7 + r) % 13)) for j in range(100)]
+    objs = [fill(j, size) for j, size in sizes]
+    # freeing some of them mixes the runs up further
+    for j in range(r % 3, len(objs), 3):
+        objs[j] = None
+        sizes[j] = None
+    objs = [b for b in objs if b is not None]
+    sizes = [s for s in sizes if s is not None]
+    if r % 4 == 0:
+        gc.collect()
+    ok = ok and intact(objs, sizes) and intact(keep, keep_sizes)
+print(ok)
+
+# everything allocated since is freed again
+objs = sizes = None
+gc.collect()
+print(gc.mem_free() >= free_start - 1024)
@@ -37,6 +37,10 @@ def test():
         f2(i, i)        # 2 args
     f3(1, 2, 3, 4)  # function with lots of local state
 
+# functions loaded from a .mpy file may only be read in on their first call,
+# which allocates, so call test() once before disabling heap allocation
+test()
+
 # call test() with heap allocation disabled
 micropython.heap_lock()
 test()
@@ -0,0 +1,73 @@
+import sys
+try:
+    try:
+        import uio as io
+    except ImportError:
+        import io
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+if hasattr(sys, 'print_exception'):
+    print_exception = sys.print_exception
+else:
+    import traceback
+    print_exception = lambda e, f: traceback.print_exception(None, e, sys.exc_info()[2], file=f)
+
+def print_exc(e):
+    buf = io.StringIO()
+    print_exception(e, buf)
+    s = buf.getvalue()
+    for l in s.split("\n"):
+        # uPy on pyboard prints <stdin> as file, so remove filename.
+        if l.startswith("  File "):
+            l = l.split('"')
+            print(l[0], l[2])
+        # uPy and CPy tracebacks differ in that CPy prints a source line for
+        # each traceback entry. In this case, we know that offending line
+        # has 4-space indent, so filter it out.
+        elif not l.startswith("    "):
+            print(l)
+
+# the traceback of an exception must survive other exceptions being raised
+
+def f(n):
+    if n == 0:
+        raise ValueError(n)
+    f(n - 1)
+
+def catch(n):
+    try:
+        f(n)
+    except ValueError as e:
+        return e
+
+e1 = catch(2)
+e2 = catch(1)
+for i in range(3):
+    catch(3)
+print_exc(e1)
+print_exc(e2)
+
+# more entries than fit in a fixed buffer
+print_exc(catch(30))
+
+# an exception raised while handling another
+try:
+    try:
+        f(1)
+    except ValueError as e:
+        saved = e
+        f(2)
+except ValueError as e:
+    print_exc(e)
+print_exc(saved)
+
+# re-raising a saved exception adds to its traceback
+def reraise(e):
+    raise e
+try:
+    reraise(e1)
+except ValueError as e:
+    print(e is e1)
+    print_exc(e)
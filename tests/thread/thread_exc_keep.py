@@ -0,0 +1,64 @@
+# test printing an exception that was raised in a thread after the thread ends
+
+import sys, _thread
+try:
+    import utime as time
+    import uio as io
+except ImportError:
+    import time, io
+
+
+def deep(n):
+    if n == 0:
+        raise ValueError("boom")
+    deep(n - 1)
+
+
+def worker():
+    try:
+        deep(3)
+    except ValueError as e:
+        saved.append(e)
+    with lock:
+        global n_finished
+        n_finished += 1
+
+
+# use up stack in other threads, to reuse the memory of the ended one
+def clobber(n):
+    a = b = c = d = n * 1000003
+    if n:
+        clobber(n - 1)
+
+
+def other():
+    clobber(50)
+    try:
+        deep(2)
+    except ValueError:
+        pass
+    with lock:
+        global n_finished
+        n_finished += 1
+
+
+lock = _thread.allocate_lock()
+saved = []
+n_finished = 0
+
+_thread.start_new_thread(worker, ())
+while n_finished < 1:
+    time.sleep(0.01)
+time.sleep(0.1)
+
+for i in range(3):
+    _thread.start_new_thread(other, ())
+while n_finished < 4:
+    time.sleep(0.01)
+time.sleep(0.1)
+
+# print the traceback without the file names, which depend on how the test runs
+buf = io.StringIO()
+sys.print_exception(saved[0], buf)
+for line in buf.getvalue().split("\n"):
+    print(line.split(", ", 1)[-1])
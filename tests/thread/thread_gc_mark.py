@@ -0,0 +1,57 @@
+# cmdline: -X heapsize=8m -X gcthreads=4
+# test that the GC keeps the same objects when the heap is big enough for it
+# to be marked in parallel, while other threads are allocating
+#
+# The output must be the same as with -X gcthreads=1.
+
+import gc
+import _thread
+
+def make_tree(depth, tag):
+    if depth == 0:
+        return [tag]
+    return [make_tree(depth - 1, tag), make_tree(depth - 1, tag), tag]
+
+def check_tree(tree, depth, tag):
+    if depth == 0:
+        return tree == [tag]
+    return (len(tree) == 3 and tree[2] == tag
+        and check_tree(tree[0], depth - 1, tag) and check_tree(tree[1], depth - 1, tag))
+
+def thread_entry(tag):
+    tree = make_tree(10, tag)
+    ok = True
+    for i in range(5):
+        garbage = make_tree(8, -tag)
+        garbage = None
+        gc.collect()
+        ok = ok and check_tree(tree, 10, tag)
+    with lock:
+        print(ok)
+        global n_finished
+        n_finished += 1
+
+gc.collect()
+alloc_start = gc.mem_alloc()
+
+lock = _thread.allocate_lock()
+n_thread = 4
+n_finished = 0
+
+for i in range(n_thread):
+    _thread.start_new_thread(thread_entry, (i + 1,))
+
+while n_finished < n_thread:
+    pass
+
+# nothing is left of the trees once the threads are done
+gc.collect()
+print(gc.mem_alloc() - alloc_start < 32 * 1024)
+
+# and marking a heap that doesn't change keeps the same objects each time
+# (alloc is already a global, so storing to it doesn't allocate)
+alloc = 0
+gc.collect()
+alloc = gc.mem_alloc()
+gc.collect()
+print(gc.mem_alloc() == alloc)
@@ -0,0 +1,14 @@
+# test slicing of large str objects with non-ASCII chars
+
+s = "aπβγ€-0123456789-אבג-\U0001f600" * 4
+
+t = s[3:90]
+print(len(t), t)
+print(t[1:40][2:20])
+print(t[-30:-1], t[-1], t[30])
+print(t == s[3:90], hash(t) == hash(s[3:90]))
+print(t.encode()[:30])
+print("|".join(t.split("-")))
+for c in s[60:]:
+    print(c, end="")
+print()
@@ -0,0 +1,31 @@
+# test indexing of long str objects, which may use an index of the UTF-8 data
+
+s = "".join(chr(0x3b1 + i % 20) + chr(0x41 + i % 26) for i in range(200))
+a = "0123456789" * 20
+
+for x in (s, a):
+    n = len(x)
+    print(n, x[0], x[1], x[31], x[32], x[33], x[63], x[64], x[n - 1])
+    print(x[-1], x[-32], x[-33], x[-n])
+    print(x[30:70], x[-70:-30])
+    print(x[n - 5:n + 5], x[-n - 5:5], x[n:], x[-n - 10:-n])
+    for i in (n, -n - 1, 10 ** 3):
+        try:
+            x[i]
+        except IndexError:
+            print("IndexError", i)
+    print("".join(x[i] for i in range(0, n, 37)))
+    print(x.find(x[100:110]), x.find(x[100:110], 50), x.find(x[100:110], 101, 300))
+    print(x.count(x[10:12], 5, -5), x.startswith(x[64:70], 64))
+
+# interleave indexing of several strings, so the cache of indices is exercised
+strs = [s[i:] for i in range(5)] + [a, s]
+for i in range(0, 300, 7):
+    print("".join(t[i % len(t)] for t in strs))
+
+# a str indexed while it's being built up
+t = ""
+for i in range(100):
+    t += chr(0x430 + i % 32)
+    print(t[i // 2], end="")
+print()
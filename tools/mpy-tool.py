@@ -74,6 +74,20 @@ global_qstrs = [None] # MP_QSTR_NULL should never be referenced
 for n in qstrutil.static_qstr_list:
     global_qstrs.append(QStrType(n))
 
+# In bundle mode, the names of the constant objects and constant tables that
+# have been emitted, by their value, so that later equal ones can share them
+bundle_objs = {}
+bundle_const_tables = {}
+
+def const_obj_key(obj):
+    # the type is part of the key because eg 1 == 1.0 == True, and floats are
+    # compared by their bits so that 0.0 and -0.0 stay apart
+    if type(obj) is float:
+        return (float, struct.pack('<d', obj))
+    elif type(obj) is complex:
+        return (complex, struct.pack('<dd', obj.real, obj.imag))
+    return (type(obj), obj)
+
 class QStrWindow:
     def __init__(self, size):
         self.window = []
@@ -316,8 +330,17 @@ class RawCode(object):
 
     def freeze_constants(self):
         # generate constant objects
+        self.obj_names = []
         for i, obj in enumerate(self.objs):
             obj_name = 'const_obj_%s_%u' % (self.escaped_name, i)
+            if config.bundle and obj is not MPFunTable:
+                # equal constants of all modules share the first one's object
+                key = const_obj_key(obj)
+                if key in bundle_objs:
+                    self.obj_names.append(bundle_objs[key])
+                    continue
+                bundle_objs[key] = obj_name
+            self.obj_names.append(obj_name)
             if obj is MPFunTable:
                 pass
             elif obj is Ellipsis:
@@ -366,31 +389,42 @@ class RawCode(object):
                 raise FreezeError(self, 'freezing of object %r is not implemented' % (obj,))
 
         # generate constant table, if it has any entries
+        self.const_table_name = 'const_table_data_%s' % self.escaped_name
         const_table_len = len(self.qstrs) + len(self.objs) + len(self.raw_codes)
         if const_table_len:
-            print('STATIC const mp_rom_obj_t const_table_data_%s[%u] = {'
-                % (self.escaped_name, const_table_len))
+            entries = []
             for qst in self.qstrs:
-                print('    MP_ROM_QSTR(%s),' % global_qstrs[qst].qstr_id)
+                entries.append('    MP_ROM_QSTR(%s),' % global_qstrs[qst].qstr_id)
             for i in range(len(self.objs)):
                 if self.objs[i] is MPFunTable:
-                    print('    mp_fun_table,')
+                    entries.append('    mp_fun_table,')
                 elif type(self.objs[i]) is float:
-                    print('#if MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_A || MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_B')
-                    print('    MP_ROM_PTR(&const_obj_%s_%u),' % (self.escaped_name, i))
-                    print('#elif MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_C')
+                    entries.append('#if MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_A || MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_B')
+                    entries.append('    MP_ROM_PTR(&%s),' % self.obj_names[i])
+                    entries.append('#elif MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_C')
                     n = struct.unpack('<I', struct.pack('<f', self.objs[i]))[0]
                     n = ((n & ~0x3) | 2) + 0x80800000
-                    print('    (mp_rom_obj_t)(0x%08x),' % (n,))
-                    print('#elif MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_D')
+                    entries.append('    (mp_rom_obj_t)(0x%08x),' % (n,))
+                    entries.append('#elif MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_D')
                     n = struct.unpack('<Q', struct.pack('<d', self.objs[i]))[0]
                     n += 0x8004000000000000
-                    print('    (mp_rom_obj_t)(0x%016x),' % (n,))
-                    print('#endif')
+                    entries.append('    (mp_rom_obj_t)(0x%016x),' % (n,))
+                    entries.append('#endif')
                 else:
-                    print('    MP_ROM_PTR(&const_obj_%s_%u),' % (self.escaped_name, i))
+                    entries.append('    MP_ROM_PTR(&%s),' % self.obj_names[i])
             for rc in self.raw_codes:
-                print('    MP_ROM_PTR(&raw_code_%s),' % rc.escaped_name)
+                entries.append('    MP_ROM_PTR(&raw_code_%s),' % rc.escaped_name)
+            if config.bundle:
+                # functions with the same argument names and constants, and
+                # no children, share one table
+                key = tuple(entries)
+                if key in bundle_const_tables:
+                    self.const_table_name = bundle_const_tables[key]
+                    return
+                bundle_const_tables[key] = self.const_table_name
+            print('STATIC const mp_rom_obj_t %s[%u] = {' % (self.const_table_name, const_table_len))
+            for entry in entries:
+                print(entry)
             print('};')
 
     def freeze_module(self, qstr_links=(), type_sig=0):
@@ -403,7 +437,7 @@ class RawCode(object):
         print('    .n_pos_args = %u,' % self.prelude[3])
         print('    .fun_data = fun_data_%s,' % self.escaped_name)
         if len(self.qstrs) + len(self.objs) + len(self.raw_codes):
-            print('    .const_table = (mp_uint_t*)const_table_data_%s,' % self.escaped_name)
+            print('    .const_table = (mp_uint_t*)%s,' % self.const_table_name)
         else:
             print('    .const_table = NULL,')
         print('    #if MICROPY_PERSISTENT_CODE_SAVE')
@@ -711,10 +745,12 @@ def read_mpy(filename):
         if header[1] != config.MPY_VERSION:
             raise Exception('incompatible .mpy version')
         feature_byte = header[2]
+        if feature_byte & 0x80:
+            raise Exception('execute-in-place .mpy files cannot be frozen')
         qw_size = read_uint(f)
         config.MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE = (feature_byte & 1) != 0
         config.MICROPY_PY_BUILTINS_STR_UNICODE = (feature_byte & 2) != 0
-        config.native_arch = feature_byte >> 2
+        config.native_arch = (feature_byte >> 2) & 0x1f
         config.mp_small_int_bits = header[3]
         qstr_win = QStrWindow(qw_size)
         return read_raw_code(f, qstr_win)
@@ -731,7 +767,13 @@ def freeze_mpy(base_qstrs, raw_codes):
         if q is None or q.qstr_esc in base_qstrs or q.qstr_esc in new:
             continue
         new[q.qstr_esc] = (len(new), q.qstr_esc, q.str)
-    new = sorted(new.values(), key=lambda x: x[0])
+    if config.bundle:
+        # order the qstrs by their value rather than by the order in which the
+        # modules use them, so the pool is the same whatever the order of the
+        # modules and strings with a common prefix are next to each other
+        new = sorted(new.values(), key=lambda x: x[2])
+    else:
+        new = sorted(new.values(), key=lambda x: x[0])
 
     print('#include "py/mpconfig.h"')
     print('#include "py/objint.h"')
@@ -821,6 +863,8 @@ def main():
         help='dump contents of files')
     cmd_parser.add_argument('-f', '--freeze', action='store_true',
         help='freeze files')
+    cmd_parser.add_argument('-b', '--bundle', action='store_true',
+        help='when freezing, share equal constants and constant tables between all files')
     cmd_parser.add_argument('-q', '--qstr-header',
         help='qstr header file to freeze against')
     cmd_parser.add_argument('-mlongint-impl', choices=['none', 'longlong', 'mpz'], default='mpz',
@@ -838,6 +882,7 @@ def main():
         'mpz':config.MICROPY_LONGINT_IMPL_MPZ,
     }[args.mlongint_impl]
     config.MPZ_DIG_SIZE = args.mmpz_dig_size
+    config.bundle = args.bundle
 
     # set config values for qstrs, and get the existing base set of qstrs
     if args.qstr_header:
@@ -2,11 +2,16 @@
 import argparse
 import os
 import os.path
+import subprocess
 
 argparser = argparse.ArgumentParser(description="Compile all .py files to .mpy recursively")
 argparser.add_argument("-o", "--out", help="output directory (default: input dir)")
 argparser.add_argument("--target", help="select MicroPython target config")
 argparser.add_argument("-mcache-lookup-bc", action="store_true", help="cache map lookups in the bytecode")
+argparser.add_argument("-c", "--const", action="append", default=[], metavar="[MODULE=]FILE",
+    help="inline the const() values of this module where they are imported (can be repeated)")
+argparser.add_argument("-j", "--jobs", type=int, default=os.cpu_count() or 1,
+    help="number of processes to compile with (default: number of CPUs)")
 argparser.add_argument("dir", help="input directory")
 args = argparser.parse_args()
 
@@ -22,17 +27,30 @@ if not args.out:
 
 path_prefix_len = len(args.dir) + 1
 
+# -c files are given relative to the current directory, but mpy-cross is run
+# from within the input directory, so the source names of the files are
+# relative to it
+def abs_const(arg):
+    name, eq, file = arg.rpartition("=")
+    return name + eq + os.path.abspath(file)
+
+py_files = []
 for path, subdirs, files in os.walk(args.dir):
     for f in files:
         if f.endswith(".py"):
             fpath = path + "/" + f
-            #print(fpath)
-            out_fpath = args.out + "/" + fpath[path_prefix_len:-3] + ".mpy"
-            out_dir = os.path.dirname(out_fpath)
+            py_files.append(fpath[path_prefix_len:])
+            out_dir = os.path.dirname(args.out + "/" + fpath[path_prefix_len:])
             if not os.path.isdir(out_dir):
                 os.makedirs(out_dir)
-            cmd = "mpy-cross -v -v %s -s %s %s -o %s" % (TARGET_OPTS.get(args.target, ""),
-                fpath[path_prefix_len:], fpath, out_fpath)
-            #print(cmd)
-            res = os.system(cmd)
-            assert res == 0
+
+# compile all the files with a single run of mpy-cross, or a few of them if
+# there are more files than fit on a command line
+cmd = ["mpy-cross", "-j", str(args.jobs), "-o", os.path.abspath(args.out) + "/"]
+cmd += TARGET_OPTS.get(args.target, "").split()
+for c in args.const:
+    cmd += ["-c", abs_const(c)]
+for i in range(0, len(py_files), 1000):
+    #print(cmd + py_files[i:i + 1000])
+    res = subprocess.call(cmd + py_files[i:i + 1000], cwd=args.dir)
+    assert res == 0